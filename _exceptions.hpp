@@ -11,6 +11,7 @@
 #include <exception>
 #include <string>
 #include <sstream>
+#include <utility>
 
 
 template <typename T> inline
@@ -21,6 +22,25 @@ std::string toString(T value)
 	return ss.str();
 }
 
+template <typename T> inline
+auto describe(T const& value, int)
+	-> decltype(std::declval<std::ostream&>() << value, std::string())
+{
+	return toString<T const&>(value);
+}
+
+template <typename T> inline
+std::string describe(T const&, long)
+{
+	return "?";
+}
+
+template <typename T> inline
+std::string describe(T const& value)
+{
+	return describe(value, 0);
+}
+
 inline IndexOutOfBoundsException::IndexOutOfBoundsException()
 {	
 	message_ = new char[21];
@@ -70,7 +90,19 @@ template <typename KEY> inline
 KeyError<KEY>::KeyError(KEY key, std::string type) : 
 	key_(key), mappingType_(type) {
 
-	std::string keyString = toString<KEY>(key);
+	setMessage(toString<KEY>(key));
+}
+
+template <typename KEY> template <typename QUERY> inline
+KeyError<KEY>::KeyError(QUERY const& key, std::string type) :
+	key_(), mappingType_(type) {
+
+	setMessage(describe(key));
+}
+
+template <typename KEY> inline
+void KeyError<KEY>::setMessage(std::string const& keyString)
+{
 	std::size_t arraySize = \
 		34 + keyString.length() + mappingType_.length();
 	message_ = new char[arraySize];
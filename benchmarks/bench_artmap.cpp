@@ -0,0 +1,94 @@
+/**
+ * \file bench_artmap.cpp
+ * \brief Lookups of URL-like string keys in ArtMap, against NonHashMap and
+ *        HashMap.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../structures/artmap.hpp"
+#include "../structures/hashmap.hpp"
+#include "../structures/nonhashmap.hpp"
+
+
+/**
+ * \brief xorshift, so the generator stays out of the measurement.
+ */
+std::uint32_t next(std::uint32_t& seed)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/**
+ * \brief Keys shaped like URLs: a few hosts, a few sections, then an id,
+ *        so they share long prefixes.
+ */
+std::vector<std::string> makeKeys(std::size_t count, std::uint32_t& seed)
+{
+	const char* hosts[] = {"https://example.com/", "https://example.org/",
+		"https://static.example.net/"};
+	const char* sections[] = {"articles/", "users/profile/", "images/2016/"};
+	std::vector<std::string> keys;
+	for (std::size_t i = 0; i < count; ++i)
+		keys.push_back(std::string(hosts[next(seed) % 3])
+			+ sections[next(seed) % 3] + std::to_string(i * 7919 % count));
+	return keys;
+}
+
+/**
+ * \brief Adds every key, then looks each of the trace up, and returns
+ *        millions of lookups per second.
+ */
+template <typename Map>
+double run(std::vector<std::string> const& keys,
+	std::vector<std::string> const& trace, long& checksum)
+{
+	Map map;
+	for (std::size_t i = 0; i < keys.size(); ++i)
+		map.insertOrAssign(keys[i], static_cast<int>(i));
+
+	auto start = std::chrono::steady_clock::now();
+	for (std::string const& key : trace)
+		if (map.contains(key))
+			checksum += map.getValue(key);
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+	return trace.size() / elapsed.count() / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+	const std::size_t lookups = 200000;
+	std::uint32_t seed = 2463534242u;
+	long checksum = 0;
+
+	std::cout << "keys\tArtMap\tNonHashMap\tHashMap (Mlookups/s)"
+		<< std::endl;
+	const std::size_t largest = argc > 1 ? std::atol(argv[1]) : 65536;
+	for (std::size_t count = 256; count <= largest; count *= 4) {
+		std::vector<std::string> keys = makeKeys(count, seed);
+		// Every other lookup is for a key that is not there.
+		std::vector<std::string> trace;
+		for (std::size_t i = 0; i < lookups; ++i)
+			trace.push_back(i % 2 == 0 ? keys[next(seed) % count]
+				: keys[next(seed) % count] + "x");
+
+		std::cout << count << "\t"
+			<< run<ArtMap<std::string, int>>(keys, trace, checksum) << "\t"
+			<< run<NonHashMap<std::string, int>>(keys, trace, checksum)
+			<< "\t\t"
+			<< run<HashMap<std::string, int>>(keys, trace, checksum)
+			<< std::endl;
+	}
+	std::cout << "(checksum " << checksum << ")" << std::endl;
+	return 0;
+}
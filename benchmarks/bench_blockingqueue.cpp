@@ -0,0 +1,126 @@
+/**
+ * \file bench_blockingqueue.cpp
+ * \brief Multi-producer/multi-consumer throughput of BlockingQueue against a
+ *        Deque guarded by a mutex and condition variable.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../structures/blockingqueue.hpp"
+#include "../structures/deque.hpp"
+
+
+/**
+ * \brief The handoff queue BlockingQueue replaces.
+ */
+class LockedDeque
+{
+public:
+	explicit LockedDeque(std::size_t capacity) : capacity_{capacity} {}
+
+	void push(int value)
+	{
+		std::unique_lock<std::mutex> lock{mutex_};
+		notFull_.wait(lock, [this]() { return items_.size() < capacity_; });
+		items_.append(value);
+		notEmpty_.notify_one();
+	}
+
+	int pop()
+	{
+		std::unique_lock<std::mutex> lock{mutex_};
+		notEmpty_.wait(lock, [this]() { return !items_.isEmpty(); });
+		int value = items_.getHead();
+		items_.remove();
+		notFull_.notify_one();
+		return value;
+	}
+
+private:
+	std::size_t capacity_;
+	Deque<int> items_;
+	std::mutex mutex_;
+	std::condition_variable notFull_;
+	std::condition_variable notEmpty_;
+};
+
+/**
+ * \brief Runs producers/consumers over a queue and returns millions of
+ *        items per second.
+ */
+template <typename Produce, typename Consume>
+double run(int producers, int consumers, int perProducer,
+	Produce produce, Consume consume)
+{
+	int total = producers * perProducer;
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; ++p)
+		threads.emplace_back([=]() { produce(perProducer); });
+	for (int c = 0; c < consumers; ++c) {
+		// Spread the remainder over the first consumers.
+		int share = total / consumers + (c < total % consumers ? 1 : 0);
+		threads.emplace_back([=]() { consume(share); });
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+	return total / elapsed.count() / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+	const int perProducer = argc > 1 ? std::atoi(argv[1]) : 1000000;
+	const std::size_t capacity = 1024;
+	const int batch = 64;
+	int cores = static_cast<int>(std::thread::hardware_concurrency());
+	if (cores < 2)
+		cores = 2;
+
+	std::cout << "threads\tlocked deque\tqueue\tqueue (batch " << batch
+			  << ")\t[Mitems/s]" << std::endl;
+
+	for (int pairs = 1; pairs * 2 <= cores; pairs *= 2) {
+		LockedDeque locked{capacity};
+		double lockedRate = run(pairs, pairs, perProducer / pairs,
+			[&](int n) { for (int i = 0; i < n; ++i) locked.push(i); },
+			[&](int n) { for (int i = 0; i < n; ++i) locked.pop(); });
+
+		BlockingQueue<int> queue{capacity};
+		double queueRate = run(pairs, pairs, perProducer / pairs,
+			[&](int n) { for (int i = 0; i < n; ++i) queue.push(i); },
+			[&](int n) { for (int i = 0; i < n; ++i) queue.pop(); });
+
+		BlockingQueue<int> batched{capacity};
+		double batchRate = run(pairs, pairs, perProducer / pairs,
+			[&](int n) {
+				int values[batch];
+				for (int i = 0; i < batch; ++i)
+					values[i] = i;
+				for (int i = 0; i < n; i += batch) {
+					int count = n - i < batch ? n - i : batch;
+					batched.pushBatch(values, values + count);
+				}
+			},
+			[&](int n) {
+				int values[batch];
+				while (n > 0)
+					n -= static_cast<int>(batched.popBatch(
+						values, n < batch ? n : batch));
+			});
+
+		std::cout << pairs << "P/" << pairs << "C\t" << lockedRate << "\t\t"
+				  << queueRate << "\t" << batchRate << std::endl;
+	}
+	return 0;
+}
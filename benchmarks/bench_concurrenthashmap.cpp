@@ -0,0 +1,126 @@
+/**
+ * \file bench_concurrenthashmap.cpp
+ * \brief Scaling of ConcurrentHashMap from one thread to every core, with
+ *        read-heavy and write-heavy mixes, against a NonHashMap guarded by
+ *        a single mutex.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../structures/concurrenthashmap.hpp"
+#include "../structures/nonhashmap.hpp"
+
+
+/**
+ * \brief The globally locked map ConcurrentHashMap replaces.
+ */
+class LockedMap
+{
+public:
+	bool find(int key, int& value)
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		if (!map_.contains(key))
+			return false;
+		value = map_.getValue(key);
+		return true;
+	}
+
+	void insertOrAssign(int key, int value)
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		if (map_.contains(key))
+			map_.getValue(key) = value;
+		else
+			map_.addValue(key, value);
+	}
+
+private:
+	NonHashMap<int, int> map_;
+	std::mutex mutex_;
+};
+
+/**
+ * \brief Runs threads workers doing opsPerThread random operations, of
+ *        which writePercent are writes, and returns millions of operations
+ *        per second.
+ */
+template <typename MapType>
+double run(MapType& map, int threads, long opsPerThread, int keys,
+	int writePercent, long& checksum)
+{
+	std::vector<long> sums(threads, 0);
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; ++t)
+		workers.emplace_back([&, t]() {
+			std::uint32_t seed = 2463534242u + t;
+			long sum = 0;
+			for (long i = 0; i < opsPerThread; ++i) {
+				// xorshift keeps the generator out of the measurement.
+				seed ^= seed << 13;
+				seed ^= seed >> 17;
+				seed ^= seed << 5;
+				int key = static_cast<int>(seed % keys);
+				int value;
+				if (static_cast<int>((seed >> 20) % 100) < writePercent)
+					map.insertOrAssign(key, static_cast<int>(i));
+				else if (map.find(key, value))
+					sum += value;
+			}
+			sums[t] = sum;
+		});
+	for (std::thread& worker : workers)
+		worker.join();
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+
+	for (long sum : sums)
+		checksum += sum;
+	return threads * opsPerThread / elapsed.count() / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+	const long opsPerThread = argc > 1 ? std::atol(argv[1]) : 1000000;
+	const int keys = 10000;
+	int cores = static_cast<int>(std::thread::hardware_concurrency());
+	if (cores < 1)
+		cores = 1;
+	long checksum = 0;
+
+	const int mixes[] = {5, 50};
+	for (int writePercent : mixes) {
+		std::cout << writePercent << "% writes" << std::endl;
+		std::cout << "threads\tConcurrentHashMap\tlocked NonHashMap"
+			<< " (Mops/s)" << std::endl;
+		for (int threads = 1; ;
+				threads = threads * 2 < cores ? threads * 2 : cores) {
+			ConcurrentHashMap<int, int> sharded;
+			LockedMap locked;
+			for (int key = 0; key < keys; ++key) {
+				sharded.insertOrAssign(key, key);
+				locked.insertOrAssign(key, key);
+			}
+
+			double shardedRate = run(sharded, threads, opsPerThread, keys,
+				writePercent, checksum);
+			double lockedRate = run(locked, threads, opsPerThread, keys,
+				writePercent, checksum);
+			std::cout << threads << "\t" << shardedRate << "\t\t\t"
+				<< lockedRate << std::endl;
+
+			if (threads == cores)
+				break;
+		}
+	}
+	std::cout << "(checksum " << checksum << ")" << std::endl;
+	return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * \file bench_lrucache.cpp
+ * \brief A read-through cache workload on LruCache, against a NonHashMap
+ *        plus a Deque of keys in recency order.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "../structures/deque.hpp"
+#include "../structures/lrucache.hpp"
+#include "../structures/nonhashmap.hpp"
+
+
+/**
+ * \brief The cache LruCache replaces: every hit finds and moves its key in
+ *        the deque, which is O(n).
+ */
+class MapAndDeque
+{
+public:
+	explicit MapAndDeque(std::size_t capacity) : capacity_{capacity}
+	{
+	}
+
+	int* get(int key)
+	{
+		if (!map_.contains(key))
+			return nullptr;
+		order_.remove(order_.index_of(key));
+		order_.appendLeft(key);
+		return &map_.getValue(key);
+	}
+
+	void put(int key, int value)
+	{
+		if (order_.size() == capacity_) {
+			map_.removeValue(order_.getTail());
+			order_.removeTail();
+		}
+		map_.addValue(key, value);
+		order_.appendLeft(key);
+	}
+
+private:
+	std::size_t capacity_;
+	NonHashMap<int, int> map_;
+	Deque<int> order_;
+};
+
+/**
+ * \brief xorshift, so the generator stays out of the measurement.
+ */
+std::uint32_t next(std::uint32_t& seed)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/**
+ * \brief Looks up every key of the trace, putting each miss, and returns
+ *        millions of lookups per second.
+ */
+template <typename Cache>
+double run(std::size_t capacity, std::vector<int> const& trace,
+	long& checksum)
+{
+	Cache cache{capacity};
+	auto start = std::chrono::steady_clock::now();
+	for (int key : trace) {
+		int* value = cache.get(key);
+		if (value != nullptr)
+			checksum += *value;
+		else
+			cache.put(key, key);
+	}
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+	return trace.size() / elapsed.count() / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+	const std::size_t lookups = 200000;
+	std::uint32_t seed = 2463534242u;
+	long checksum = 0;
+
+	std::cout << "capacity\tLruCache\tNonHashMap+Deque (Mlookups/s)"
+		<< std::endl;
+	const std::size_t largest = argc > 1 ? std::atol(argv[1]) : 4096;
+	for (std::size_t capacity = 64; capacity <= largest; capacity *= 4) {
+		// Keys drawn from twice the capacity: about half the lookups hit.
+		std::vector<int> trace(lookups);
+		for (int& key : trace)
+			key = static_cast<int>(next(seed) % (2 * capacity));
+
+		std::cout << capacity << "\t\t"
+			<< run<LruCache<int, int>>(capacity, trace, checksum) << "\t\t"
+			<< run<MapAndDeque>(capacity, trace, checksum) << std::endl;
+	}
+	std::cout << "(checksum " << checksum << ")" << std::endl;
+	return 0;
+}
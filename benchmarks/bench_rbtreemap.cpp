@@ -0,0 +1,112 @@
+/**
+ * \file bench_rbtreemap.cpp
+ * \brief Random inserts, lookups and removals on RBTreeMap, against
+ *        std::map and NonHashMap.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "../structures/nonhashmap.hpp"
+#include "../structures/rbtreemap.hpp"
+
+
+/**
+ * \brief std::map behind the Map calls the benchmark makes.
+ */
+class StdMap
+{
+public:
+	void addValue(int key, int value)
+	{
+		map_.insert(std::make_pair(key, value));
+	}
+
+	void removeValue(int key)
+	{
+		map_.erase(key);
+	}
+
+	int& getValue(int key)
+	{
+		return map_.find(key)->second;
+	}
+
+private:
+	std::map<int, int> map_;
+};
+
+/**
+ * \brief Seconds taken by fn().
+ */
+template <typename Fn>
+double timed(Fn fn)
+{
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+/**
+ * \brief Inserts every key, looks each one up lookups times over, then
+ *        removes them all, printing millions of operations per second for
+ *        each phase.
+ */
+template <typename MapType>
+void run(char const* name, std::vector<int> const& keys, int lookups,
+	long& checksum)
+{
+	MapType map;
+	double n = static_cast<double>(keys.size());
+	double insert = timed([&]() {
+		for (int key : keys)
+			map.addValue(key, key);
+	});
+	double find = timed([&]() {
+		for (int round = 0; round < lookups; ++round)
+			for (std::size_t i = keys.size(); i > 0; --i)
+				checksum += map.getValue(keys[i - 1]);
+	});
+	double remove = timed([&]() {
+		for (int key : keys)
+			map.removeValue(key);
+	});
+
+	std::cout << name << "\t" << n / insert / 1e6 << "\t"
+		<< n * lookups / find / 1e6 << "\t" << n / remove / 1e6 << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	const std::size_t count = argc > 1 ? std::atol(argv[1]) : 20000;
+	const int lookups = 20;
+
+	// Distinct keys in random order: a shuffled range.
+	std::vector<int> keys(count);
+	std::uint32_t seed = 2463534242u;
+	for (std::size_t i = 0; i < count; ++i)
+		keys[i] = static_cast<int>(i);
+	for (std::size_t i = count; i > 1; --i) {
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		std::swap(keys[i - 1], keys[seed % i]);
+	}
+
+	long checksum = 0;
+	std::cout << count << " keys" << std::endl;
+	std::cout << "map\t\tinsert\tfind\tremove (Mops/s)" << std::endl;
+	run<RBTreeMap<int, int>>("RBTreeMap", keys, lookups, checksum);
+	run<StdMap>("std::map", keys, lookups, checksum);
+	run<NonHashMap<int, int>>("NonHashMap", keys, lookups, checksum);
+	std::cout << "(checksum " << checksum << ")" << std::endl;
+	return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * \file bench_smallmap.cpp
+ * \brief Building, querying and dropping many tiny maps with SmallMap,
+ *        against NonHashMap and HashMap, counting the allocations each
+ *        makes.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../structures/hashmap.hpp"
+#include "../structures/nonhashmap.hpp"
+#include "../structures/smallmap.hpp"
+
+
+/**
+ * \brief Allocations made since the program started.
+ */
+static std::size_t allocations = 0;
+
+void* operator new(std::size_t size)
+{
+	++allocations;
+	if (void* memory = std::malloc(size == 0 ? 1 : size))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+/**
+ * \brief Builds rounds maps of the given keys, looks every key and one
+ *        missing key up in each, and prints nanoseconds and allocations
+ *        per map.
+ */
+template <typename Map>
+void run(std::vector<std::string> const& keys, std::size_t rounds,
+	long& checksum)
+{
+	std::size_t before = allocations;
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t round = 0; round < rounds; ++round) {
+		Map map;
+		for (std::size_t i = 0; i < keys.size(); ++i)
+			map.insertOrAssign(keys[i], static_cast<int>(i + round));
+		for (std::string const& key : keys)
+			checksum += map.getValue(key);
+		checksum += map.contains("missing");
+	}
+	std::chrono::duration<double, std::nano> elapsed =
+		std::chrono::steady_clock::now() - start;
+	std::cout << "\t" << elapsed.count() / rounds << " ns, "
+		<< static_cast<double>(allocations - before) / rounds << " allocs";
+}
+
+int main(int argc, char** argv)
+{
+	const std::size_t rounds = argc > 1 ? std::atol(argv[1]) : 200000;
+	long checksum = 0;
+
+	std::cout << "pairs\tSmallMap<8>\t\t\tNonHashMap\t\t\tHashMap"
+		<< std::endl;
+	for (std::size_t count : {2, 4, 8, 16}) {
+		// Short keys, so std::string itself does not allocate.
+		std::vector<std::string> keys;
+		for (std::size_t i = 0; i < count; ++i)
+			keys.push_back("key" + std::to_string(i));
+
+		std::cout << count;
+		run<SmallMap<std::string, int>>(keys, rounds, checksum);
+		run<NonHashMap<std::string, int>>(keys, rounds, checksum);
+		run<HashMap<std::string, int>>(keys, rounds, checksum);
+		std::cout << std::endl;
+	}
+	std::cout << "(checksum " << checksum << ")" << std::endl;
+	return 0;
+}
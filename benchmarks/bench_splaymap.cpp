@@ -0,0 +1,141 @@
+/**
+ * \file bench_splaymap.cpp
+ * \brief Lookups on Zipf-distributed and uniform traces, comparing SplayMap
+ *        (splaying and read-only) with RBTreeMap and std::map.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "../structures/rbtreemap.hpp"
+#include "../structures/splaymap.hpp"
+
+
+/**
+ * \brief std::map behind the Map calls the benchmark makes.
+ */
+class StdMap
+{
+public:
+	void addValue(int key, int value)
+	{
+		map_.insert(std::make_pair(key, value));
+	}
+
+	int& getValue(int key)
+	{
+		return map_.find(key)->second;
+	}
+
+private:
+	std::map<int, int> map_;
+};
+
+/**
+ * \brief xorshift, so the generator stays out of the measurement.
+ */
+std::uint32_t next(std::uint32_t& seed)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/**
+ * \brief Only SplayMap has a read-only mode.
+ */
+template <typename MapType>
+void setReadOnly(MapType&, bool)
+{
+}
+
+void setReadOnly(SplayMap<int, int>& map, bool readOnly)
+{
+	map.setReadOnly(readOnly);
+}
+
+/**
+ * \brief Builds a map from the shuffled keys, looks up every key of the
+ *        trace and returns millions of lookups per second.
+ * \details Each map is built on its own, so that its nodes are not
+ *          interleaved in the heap with another map's.
+ */
+template <typename MapType>
+double run(std::vector<int> const& keys, std::vector<int> const& trace,
+	bool readOnly, long& checksum)
+{
+	MapType map;
+	for (int key : keys)
+		map.addValue(key, key);
+	setReadOnly(map, readOnly);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int key : trace)
+		checksum += map.getValue(key);
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+	return trace.size() / elapsed.count() / 1e6;
+}
+
+/**
+ * \brief Times the trace against each map.
+ */
+void compare(char const* name, std::vector<int> const& keys,
+	std::vector<int> const& trace, long& checksum)
+{
+	std::cout << name << "\t"
+		<< run<SplayMap<int, int>>(keys, trace, false, checksum) << "\t"
+		<< run<SplayMap<int, int>>(keys, trace, true, checksum) << "\t\t"
+		<< run<RBTreeMap<int, int>>(keys, trace, false, checksum) << "\t\t"
+		<< run<StdMap>(keys, trace, false, checksum) << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	const std::size_t count = argc > 1 ? std::atol(argv[1]) : 100000;
+	const double exponent = argc > 2 ? std::atof(argv[2]) : 1.2;
+	const std::size_t lookups = 4000000;
+	std::uint32_t seed = 2463534242u;
+
+	// Shuffled so that hot keys are scattered over the key space.
+	std::vector<int> keys(count);
+	for (std::size_t i = 0; i < count; ++i)
+		keys[i] = static_cast<int>(i);
+	for (std::size_t i = count; i > 1; --i)
+		std::swap(keys[i - 1], keys[next(seed) % i]);
+
+	// The key of rank r is keys[r]; draw ranks by inverting the CDF.
+	std::vector<double> cumulative(count);
+	double total = 0;
+	for (std::size_t rank = 0; rank < count; ++rank) {
+		total += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+		cumulative[rank] = total;
+	}
+	std::vector<int> zipf(lookups);
+	std::vector<int> uniform(lookups);
+	for (std::size_t i = 0; i < lookups; ++i) {
+		double draw = next(seed) / 4294967296.0 * total;
+		std::size_t rank = std::lower_bound(cumulative.begin(),
+			cumulative.end(), draw) - cumulative.begin();
+		zipf[i] = keys[rank < count ? rank : count - 1];
+		uniform[i] = keys[next(seed) % count];
+	}
+
+	long checksum = 0;
+	std::cout << count << " keys, Zipf exponent " << exponent << std::endl;
+	std::cout << "trace\tSplayMap\tread-only\tRBTreeMap\tstd::map"
+		<< " (Mlookups/s)" << std::endl;
+	compare("Zipf", keys, zipf, checksum);
+	compare("uniform", keys, uniform, checksum);
+	std::cout << "(checksum " << checksum << ")" << std::endl;
+	return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * \file bench_spscring.cpp
+ * \brief Two-thread throughput of SpscRing, element-wise and with spans,
+ *        against BlockingQueue.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "../structures/blockingqueue.hpp"
+#include "../structures/spscring.hpp"
+
+
+/**
+ * \brief Runs one producer and one consumer and returns millions of items
+ *        per second.
+ */
+template <typename Produce, typename Consume>
+double run(Produce produce, Consume consume, long items)
+{
+	auto start = std::chrono::steady_clock::now();
+	std::thread producer(produce);
+	consume();
+	producer.join();
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start;
+	return items / elapsed.count() / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+	const long items = argc > 1 ? std::atol(argv[1]) : 50000000;
+	const std::size_t capacity = 4096;
+	const std::size_t batch = 256;
+	long checksum = 0;
+
+	BlockingQueue<long> queue{capacity};
+	double queueRate = run(
+		[&]() { for (long i = 0; i < items; ++i) queue.push(i); },
+		[&]() { for (long i = 0; i < items; ++i) checksum += queue.pop(); },
+		items);
+
+	SpscRing<long> single{capacity};
+	double singleRate = run(
+		[&]() {
+			for (long i = 0; i < items; ++i)
+				while (!single.tryPush(i))
+					std::this_thread::yield();
+		},
+		[&]() {
+			long value;
+			for (long i = 0; i < items; ++i) {
+				while (!single.tryPop(value))
+					std::this_thread::yield();
+				checksum += value;
+			}
+		},
+		items);
+
+	SpscRing<long> spans{capacity};
+	double spanRate = run(
+		[&]() {
+			long next = 0;
+			while (next < items) {
+				SpscRing<long>::Span span = spans.reserve(batch);
+				std::size_t i = 0;
+				for (; i < span.size && next < items; ++i)
+					span[i] = next++;
+				spans.commit(i);
+				if (i == 0)
+					std::this_thread::yield();
+			}
+		},
+		[&]() {
+			long seen = 0;
+			while (seen < items) {
+				SpscRing<long>::Span span = spans.peek(batch);
+				for (long value : span)
+					checksum += value;
+				spans.release(span.size);
+				seen += static_cast<long>(span.size);
+				if (span.size == 0)
+					std::this_thread::yield();
+			}
+		},
+		items);
+
+	std::cout << "BlockingQueue\t" << queueRate << " Mitems/s" << std::endl;
+	std::cout << "SpscRing\t" << singleRate << " Mitems/s" << std::endl;
+	std::cout << "SpscRing spans\t" << spanRate << " Mitems/s" << std::endl;
+	std::cout << "(checksum " << checksum << ")" << std::endl;
+	return 0;
+}
@@ -18,6 +18,12 @@
  */
 template <typename T> std::string toString(T value);
 
+/**
+ * \brief toString(value) if value can be printed, and otherwise "?".
+ */
+template <typename T>
+std::string describe(T const& value);
+
 /**
  * \brief Exception to be thrown if an illegal index would be accessed
  *        by a program.
@@ -69,6 +75,14 @@ public:
 	 */
 	KeyError(KEY key_, std::string type);
 
+	/**
+	 * \brief Constructor for a lookup by a key of another type.  The key
+	 *        is named in the message as it is, without converting it to
+	 *        KEY, or left out if it cannot be printed.
+	 */
+	template <typename QUERY>
+	KeyError(QUERY const& key, std::string type);
+
 	/**
 	 * \brief Destroys the dynamically allocated message array.
 	 */
@@ -80,6 +94,11 @@ public:
  	virtual const char* what() const throw();
 
 private:
+	/**
+	 * \brief Builds the message around the printed key.
+	 */
+	void setMessage(std::string const& keyString);
+
 	char* message_;
 	KEY key_;
 	std::string mappingType_;
@@ -0,0 +1,1050 @@
+/**
+ * \file _artmap.hpp
+ * \brief Private implementation file of the adaptive radix tree map.
+ */
+
+#ifndef _ART_MAP_HPP
+#define _ART_MAP_HPP 1
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "map.hpp"
+#include "mapviews.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename K, typename V>
+const std::size_t ArtMap<K, V>::MaxPrefix;
+
+template <typename K, typename V>
+const unsigned char ArtMap<K, V>::LeafKind;
+
+template <typename K, typename V>
+const unsigned char ArtMap<K, V>::Kind4;
+
+template <typename K, typename V>
+const unsigned char ArtMap<K, V>::Kind16;
+
+template <typename K, typename V>
+const unsigned char ArtMap<K, V>::Kind48;
+
+template <typename K, typename V>
+const unsigned char ArtMap<K, V>::Kind256;
+
+template <typename K, typename V> inline
+ArtMap<K, V>::Leaf::Leaf(K&& key, V&& value) :
+	Node{LeafKind}, key_(std::move(key)), value_(std::move(value))
+{
+}
+
+template <typename K, typename V> inline
+ArtMap<K, V>::Leaf::Leaf(K const& key, V const& value) :
+	Node{LeafKind}, key_(key), value_(value)
+{
+}
+
+template <typename K, typename V> inline
+ArtMap<K, V>::ArtMap() : root_{nullptr}, size_{0}
+{
+}
+
+template <typename K, typename V> inline
+ArtMap<K, V>::ArtMap(ArtMap<K, V> const& orig) : ArtMap()
+{
+	if (orig.root_ == nullptr)
+		return;
+	try {
+		clone(orig.root_, &root_);
+	} catch (...) {
+		destroy(root_);
+		throw;
+	}
+	size_ = orig.size_;
+}
+
+template <typename K, typename V> inline
+ArtMap<K, V>::ArtMap(ArtMap<K, V>&& other) : ArtMap()
+{
+	swap(*this, other);
+}
+
+template <typename K, typename V> inline
+ArtMap<K, V>& ArtMap<K, V>::operator=(ArtMap<K, V> rhs)
+{
+	swap(*this, rhs);
+	return *this;
+}
+
+template <typename K, typename V> inline
+void swap(ArtMap<K, V>& lhs, ArtMap<K, V>& rhs)
+{
+	std::swap(lhs.root_, rhs.root_);
+	std::swap(lhs.size_, rhs.size_);
+}
+
+template <typename K, typename V> inline
+ArtMap<K, V>::~ArtMap()
+{
+	destroy(root_);
+}
+
+template <typename K, typename V> inline
+void ArtMap<K, V>::addValue(K key, V value)
+{
+	if (!findOrInsert(key, std::move(value)).second)
+		throw KeyError<K>{key, "ArtMap"};
+}
+
+template <typename K, typename V> inline
+bool ArtMap<K, V>::insertOrAssign(K key, V value)
+{
+	std::pair<V&, bool> result = findOrInsert(key, std::move(value));
+	if (!result.second)
+		result.first = std::move(value);
+	return result.second;
+}
+
+template <typename K, typename V> template <typename... Args> inline
+std::pair<V&, bool> ArtMap<K, V>::tryEmplace(K key, Args&&... args)
+{
+	return findOrInsert(key, std::forward<Args>(args)...);
+}
+
+template <typename K, typename V> template <typename Fn> inline
+V& ArtMap<K, V>::upsert(K key, Fn fn)
+{
+	V& value = findOrInsert(key).first;
+	fn(value);
+	return value;
+}
+
+template <typename K, typename V> inline
+void ArtMap<K, V>::removeValue(K const& key)
+{
+	Leaf* leaf = detach(&root_, ArtKey<K>(key));
+	if (leaf == nullptr)
+		throw KeyError<K>{key, "ArtMap"};
+	release(leaf);
+	--size_;
+}
+
+template <typename K, typename V> inline
+V& ArtMap<K, V>::getValue(K const& key) const
+{
+	Leaf* leaf = findLeaf(ArtKey<K>(key));
+	if (leaf == nullptr)
+		throw KeyError<K>{key, "ArtMap"};
+	return leaf->value_;
+}
+
+template <typename K, typename V> inline
+V* ArtMap<K, V>::find(K const& key) const
+{
+	Leaf* leaf = findLeaf(ArtKey<K>(key));
+	return leaf == nullptr ? nullptr : &leaf->value_;
+}
+
+template <typename K, typename V> inline
+std::size_t ArtMap<K, V>::size() const
+{
+	return size_;
+}
+
+template <typename K, typename V> inline
+bool ArtMap<K, V>::isEmpty() const
+{
+	return size_ == 0;
+}
+
+template <typename K, typename V> inline
+bool ArtMap<K, V>::contains(K const& key) const
+{
+	return findLeaf(ArtKey<K>(key)) != nullptr;
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void ArtMap<K, V>::forEachWithPrefix(K const& prefix, Fn fn) const
+{
+	ArtKey<K> bytes(prefix);
+	Node* node = root_;
+	std::size_t depth = 0;
+	while (node != nullptr) {
+		if (node->kind_ == LeafKind) {
+			Leaf* leaf = static_cast<Leaf*>(node);
+			ArtKey<K> own(leaf->key_);
+			if (own.size() >= bytes.size()
+					&& std::memcmp(own.data(), bytes.data(), bytes.size()) == 0)
+				fn(static_cast<K const&>(leaf->key_),
+					static_cast<V const&>(leaf->value_));
+			return;
+		}
+
+		// Once the prefix runs out, everything below matches it.
+		Inner* inner = static_cast<Inner*>(node);
+		std::size_t matched = prefixMismatch(inner, bytes, depth);
+		if (depth + matched == bytes.size()) {
+			visit<Leaf const>(inner, fn);
+			return;
+		}
+		if (matched < inner->prefixLength_)
+			return;
+		depth += inner->prefixLength_;
+
+		Node** child = findChild(inner, bytes.data()[depth]);
+		node = child == nullptr ? nullptr : *child;
+		++depth;
+	}
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::keys_view ArtMap<K, V>::keys() const
+{
+	return keys_view{{this, minimum(root_)}, {this, nullptr}, size_};
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::values_view ArtMap<K, V>::values()
+{
+	return values_view{{this, minimum(root_)}, {this, nullptr}, size_};
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::const_values_view ArtMap<K, V>::values() const
+{
+	return const_values_view{{this, minimum(root_)}, {this, nullptr}, size_};
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::items_view ArtMap<K, V>::items()
+{
+	return items_view{{this, minimum(root_)}, {this, nullptr}, size_};
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::const_items_view ArtMap<K, V>::items() const
+{
+	return const_items_view{{this, minimum(root_)}, {this, nullptr}, size_};
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void ArtMap<K, V>::forEach(Fn fn)
+{
+	visit<Leaf>(root_, fn);
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void ArtMap<K, V>::forEach(Fn fn) const
+{
+	visit<Leaf const>(root_, fn);
+}
+
+template <typename K, typename V> template <typename LeafT> inline
+typename ArtMap<K, V>::template LeafCursor<LeafT>&
+ArtMap<K, V>::LeafCursor<LeafT>::operator++()
+{
+	leaf_ = map_->successor(leaf_);
+	return *this;
+}
+
+template <typename K, typename V> template <typename LeafT> inline
+LeafT& ArtMap<K, V>::LeafCursor<LeafT>::operator*() const
+{
+	return *leaf_;
+}
+
+template <typename K, typename V> template <typename LeafT> inline
+bool ArtMap<K, V>::LeafCursor<LeafT>::operator==(const LeafCursor& rhs) const
+{
+	return leaf_ == rhs.leaf_;
+}
+
+template <typename K, typename V> inline
+bool ArtMap<K, V>::matches(Leaf const* leaf, ArtKey<K> const& bytes)
+{
+	ArtKey<K> own(leaf->key_);
+	return own.size() == bytes.size()
+		&& std::memcmp(own.data(), bytes.data(), bytes.size()) == 0;
+}
+
+template <typename K, typename V> inline
+std::size_t ArtMap<K, V>::checkPrefix(Inner const* node,
+	ArtKey<K> const& bytes, std::size_t depth)
+{
+	std::size_t limit = std::min(
+		std::min<std::size_t>(node->prefixLength_, MaxPrefix),
+		bytes.size() - depth);
+	std::size_t i = 0;
+	while (i < limit && node->prefix_[i] == bytes.data()[depth + i])
+		++i;
+	return i;
+}
+
+template <typename K, typename V> inline
+std::size_t ArtMap<K, V>::prefixMismatch(Inner* node, ArtKey<K> const& bytes,
+	std::size_t depth)
+{
+	std::size_t limit = std::min<std::size_t>(node->prefixLength_,
+		bytes.size() - depth);
+	std::size_t stored = std::min(limit, MaxPrefix);
+	std::size_t i = 0;
+	while (i < stored && node->prefix_[i] == bytes.data()[depth + i])
+		++i;
+	if (i < stored || limit <= MaxPrefix)
+		return i;
+
+	// Every leaf below holds the whole prefix, so any of them can supply
+	// the bytes that were not stored.
+	ArtKey<K> full(minimum(node)->key_);
+	while (i < limit && full.data()[depth + i] == bytes.data()[depth + i])
+		++i;
+	return i;
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::Node** ArtMap<K, V>::findChild(Inner* node,
+	unsigned char byte)
+{
+	switch (node->kind_) {
+	case Kind4: {
+		Node4* small = static_cast<Node4*>(node);
+		for (std::size_t i = 0; i < small->count_; ++i)
+			if (small->bytes_[i] == byte)
+				return &small->children_[i];
+		return nullptr;
+	}
+	case Kind16: {
+		Node16* medium = static_cast<Node16*>(node);
+#if defined(__SSE2__)
+		// One compare matches the byte against all sixteen at once; the mask
+		// drops the unused tail.
+		__m128i matches = _mm_cmpeq_epi8(
+			_mm_set1_epi8(static_cast<char>(byte)),
+			_mm_loadu_si128(reinterpret_cast<__m128i const*>(medium->bytes_)));
+		unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(matches))
+			& ((1u << medium->count_) - 1);
+		return mask == 0 ? nullptr
+			: &medium->children_[__builtin_ctz(mask)];
+#else
+		for (std::size_t i = 0; i < medium->count_; ++i)
+			if (medium->bytes_[i] == byte)
+				return &medium->children_[i];
+		return nullptr;
+#endif
+	}
+	case Kind48: {
+		Node48* large = static_cast<Node48*>(node);
+		unsigned char slot = large->slots_[byte];
+		return slot == 0 ? nullptr : &large->children_[slot - 1];
+	}
+	default: {
+		Node256* full = static_cast<Node256*>(node);
+		return full->children_[byte] == nullptr ? nullptr
+			: &full->children_[byte];
+	}
+	}
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::Node* ArtMap<K, V>::nextChild(Inner* node, int& byte)
+{
+	switch (node->kind_) {
+	case Kind4: {
+		Node4* small = static_cast<Node4*>(node);
+		for (std::size_t i = 0; i < small->count_; ++i)
+			if (small->bytes_[i] > byte) {
+				byte = small->bytes_[i];
+				return small->children_[i];
+			}
+		return nullptr;
+	}
+	case Kind16: {
+		Node16* medium = static_cast<Node16*>(node);
+		for (std::size_t i = 0; i < medium->count_; ++i)
+			if (medium->bytes_[i] > byte) {
+				byte = medium->bytes_[i];
+				return medium->children_[i];
+			}
+		return nullptr;
+	}
+	case Kind48: {
+		Node48* large = static_cast<Node48*>(node);
+		for (int b = byte + 1; b < 256; ++b)
+			if (large->slots_[b] != 0) {
+				byte = b;
+				return large->children_[large->slots_[b] - 1];
+			}
+		return nullptr;
+	}
+	default: {
+		Node256* full = static_cast<Node256*>(node);
+		for (int b = byte + 1; b < 256; ++b)
+			if (full->children_[b] != nullptr) {
+				byte = b;
+				return full->children_[b];
+			}
+		return nullptr;
+	}
+	}
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::Node* ArtMap<K, V>::lastChild(Inner* node)
+{
+	switch (node->kind_) {
+	case Kind4: {
+		Node4* small = static_cast<Node4*>(node);
+		return small->count_ == 0 ? nullptr
+			: small->children_[small->count_ - 1];
+	}
+	case Kind16: {
+		Node16* medium = static_cast<Node16*>(node);
+		return medium->count_ == 0 ? nullptr
+			: medium->children_[medium->count_ - 1];
+	}
+	case Kind48: {
+		Node48* large = static_cast<Node48*>(node);
+		for (int b = 255; b >= 0; --b)
+			if (large->slots_[b] != 0)
+				return large->children_[large->slots_[b] - 1];
+		return nullptr;
+	}
+	default: {
+		Node256* full = static_cast<Node256*>(node);
+		for (int b = 255; b >= 0; --b)
+			if (full->children_[b] != nullptr)
+				return full->children_[b];
+		return nullptr;
+	}
+	}
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::Node** ArtMap<K, V>::children(Inner* node,
+	std::size_t& length)
+{
+	switch (node->kind_) {
+	case Kind4:
+		length = 4;
+		return static_cast<Node4*>(node)->children_;
+	case Kind16:
+		length = 16;
+		return static_cast<Node16*>(node)->children_;
+	case Kind48:
+		length = 48;
+		return static_cast<Node48*>(node)->children_;
+	default:
+		length = 256;
+		return static_cast<Node256*>(node)->children_;
+	}
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::Leaf* ArtMap<K, V>::minimum(Node* node)
+{
+	// A key ending at a node is a prefix of, so sorts before, every key
+	// below it.
+	while (node != nullptr && node->kind_ != LeafKind) {
+		Inner* inner = static_cast<Inner*>(node);
+		if (inner->end_ != nullptr)
+			return inner->end_;
+		int byte = -1;
+		node = nextChild(inner, byte);
+	}
+	return static_cast<Leaf*>(node);
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::Leaf* ArtMap<K, V>::successor(Leaf const* leaf) const
+{
+	// The successor is the smallest leaf under the last node passed on the
+	// way down that has a child after the one taken.
+	ArtKey<K> bytes(leaf->key_);
+	Node* next = nullptr;
+	Node* node = root_;
+	std::size_t depth = 0;
+	while (node->kind_ != LeafKind) {
+		Inner* inner = static_cast<Inner*>(node);
+		depth += inner->prefixLength_;
+		int byte = -1;
+		if (depth == bytes.size()) {
+			// leaf is this node's own, and all of its children come after.
+			Node* first = nextChild(inner, byte);
+			return minimum(first != nullptr ? first : next);
+		}
+
+		byte = bytes.data()[depth];
+		Node* later = nextChild(inner, byte);
+		if (later != nullptr)
+			next = later;
+		node = *findChild(inner, bytes.data()[depth]);
+		++depth;
+	}
+	return minimum(next);
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::Leaf* ArtMap<K, V>::findLeaf(
+	ArtKey<K> const& bytes) const
+{
+	// Prefixes are checked only as far as they are stored; the comparison
+	// with the leaf at the end catches a mismatch past that.
+	Node* node = root_;
+	std::size_t depth = 0;
+	while (node != nullptr) {
+		if (node->kind_ == LeafKind) {
+			Leaf* leaf = static_cast<Leaf*>(node);
+			return matches(leaf, bytes) ? leaf : nullptr;
+		}
+
+		Inner* inner = static_cast<Inner*>(node);
+		if (inner->prefixLength_ != 0) {
+			if (checkPrefix(inner, bytes, depth)
+					!= std::min<std::size_t>(inner->prefixLength_, MaxPrefix))
+				return nullptr;
+			depth += inner->prefixLength_;
+		}
+		if (depth >= bytes.size()) {
+			Leaf* leaf = inner->end_;
+			return depth == bytes.size() && leaf != nullptr
+				&& matches(leaf, bytes) ? leaf : nullptr;
+		}
+
+		Node** child = findChild(inner, bytes.data()[depth]);
+		node = child == nullptr ? nullptr : *child;
+		++depth;
+	}
+	return nullptr;
+}
+
+template <typename K, typename V> template <typename... Args> inline
+std::pair<V&, bool> ArtMap<K, V>::findOrInsert(K& key, Args&&... args)
+{
+	// bytes may point into key, so no byte is read once key has been moved
+	// into its leaf.
+	ArtKey<K> bytes(key);
+	Node** link = &root_;
+	std::size_t depth = 0;
+	for (;;) {
+		Node* node = *link;
+		if (node == nullptr) {
+			Leaf* leaf = newLeaf(key, std::forward<Args>(args)...);
+			*link = leaf;
+			++size_;
+			return {leaf->value_, true};
+		}
+
+		if (node->kind_ == LeafKind) {
+			Leaf* existing = static_cast<Leaf*>(node);
+			if (matches(existing, bytes))
+				return {existing->value_, false};
+
+			// A new node takes the bytes the two keys share as its prefix
+			// and holds both leaves.
+			ArtKey<K> other(existing->key_);
+			std::size_t limit = std::min(other.size(), bytes.size());
+			std::size_t common = depth;
+			while (common < limit
+					&& other.data()[common] == bytes.data()[common])
+				++common;
+			bool ends = common == bytes.size();
+			unsigned char byte = ends ? 0 : bytes.data()[common];
+
+			Node4* inner = new Node4();
+			inner->kind_ = Kind4;
+			inner->prefixLength_ = static_cast<std::uint32_t>(common - depth);
+			std::memcpy(inner->prefix_, bytes.data() + depth,
+				std::min(common - depth, MaxPrefix));
+			if (common == other.size()) {
+				inner->end_ = existing;
+			} else {
+				inner->bytes_[0] = other.data()[common];
+				inner->children_[0] = existing;
+				inner->count_ = 1;
+			}
+
+			Leaf* leaf;
+			try {
+				leaf = newLeaf(key, std::forward<Args>(args)...);
+			} catch (...) {
+				release(inner);
+				throw;
+			}
+			*link = inner;
+			if (ends)
+				inner->end_ = leaf;
+			else
+				addChild(link, byte, leaf);
+			++size_;
+			return {leaf->value_, true};
+		}
+
+		Inner* inner = static_cast<Inner*>(node);
+		if (inner->prefixLength_ != 0) {
+			std::size_t matched = prefixMismatch(inner, bytes, depth);
+			if (matched < inner->prefixLength_) {
+				// The key leaves the prefix part way: a new node takes the
+				// shared part, and this node keeps what follows the byte
+				// where they differ.
+				bool ends = depth + matched == bytes.size();
+				unsigned char byte = ends ? 0 : bytes.data()[depth + matched];
+				std::size_t rest = inner->prefixLength_ - matched - 1;
+				unsigned char own;
+				unsigned char restBytes[MaxPrefix];
+				if (inner->prefixLength_ <= MaxPrefix) {
+					own = inner->prefix_[matched];
+					std::memcpy(restBytes, inner->prefix_ + matched + 1,
+						std::min(rest, MaxPrefix));
+				} else {
+					ArtKey<K> full(minimum(inner)->key_);
+					own = full.data()[depth + matched];
+					std::memcpy(restBytes, full.data() + depth + matched + 1,
+						std::min(rest, MaxPrefix));
+				}
+
+				Node4* parent = new Node4();
+				Leaf* leaf;
+				try {
+					leaf = newLeaf(key, std::forward<Args>(args)...);
+				} catch (...) {
+					release(parent);
+					throw;
+				}
+				parent->kind_ = Kind4;
+				parent->prefixLength_ = static_cast<std::uint32_t>(matched);
+				std::memcpy(parent->prefix_, inner->prefix_,
+					std::min(matched, MaxPrefix));
+				parent->bytes_[0] = own;
+				parent->children_[0] = inner;
+				parent->count_ = 1;
+				inner->prefixLength_ = static_cast<std::uint32_t>(rest);
+				std::memcpy(inner->prefix_, restBytes, std::min(rest, MaxPrefix));
+
+				*link = parent;
+				if (ends)
+					parent->end_ = leaf;
+				else
+					addChild(link, byte, leaf);
+				++size_;
+				return {leaf->value_, true};
+			}
+			depth += inner->prefixLength_;
+		}
+
+		if (depth == bytes.size()) {
+			if (inner->end_ != nullptr)
+				return {inner->end_->value_, false};
+			inner->end_ = newLeaf(key, std::forward<Args>(args)...);
+			++size_;
+			return {inner->end_->value_, true};
+		}
+
+		unsigned char byte = bytes.data()[depth];
+		Node** child = findChild(inner, byte);
+		if (child != nullptr) {
+			link = child;
+			++depth;
+			continue;
+		}
+
+		Leaf* leaf = newLeaf(key, std::forward<Args>(args)...);
+		try {
+			addChild(link, byte, leaf);
+		} catch (...) {
+			key = std::move(leaf->key_);
+			release(leaf);
+			throw;
+		}
+		++size_;
+		return {leaf->value_, true};
+	}
+}
+
+template <typename K, typename V> template <typename... Args> inline
+typename ArtMap<K, V>::Leaf* ArtMap<K, V>::newLeaf(K& key, Args&&... args)
+{
+	return new Leaf(std::move(key), V(std::forward<Args>(args)...));
+}
+
+template <typename K, typename V> inline
+void ArtMap<K, V>::addChild(Node** link, unsigned char byte, Node* child)
+{
+	Inner* node = static_cast<Inner*>(*link);
+	switch (node->kind_) {
+	case Kind4: {
+		Node4* small = static_cast<Node4*>(node);
+		if (small->count_ < 4) {
+			std::size_t i = small->count_;
+			for (; i > 0 && small->bytes_[i - 1] > byte; --i) {
+				small->bytes_[i] = small->bytes_[i - 1];
+				small->children_[i] = small->children_[i - 1];
+			}
+			small->bytes_[i] = byte;
+			small->children_[i] = child;
+			++small->count_;
+			return;
+		}
+
+		Node16* grown = new Node16();
+		copyHeader(grown, small);
+		grown->kind_ = Kind16;
+		std::copy(small->bytes_, small->bytes_ + 4, grown->bytes_);
+		std::copy(small->children_, small->children_ + 4, grown->children_);
+		*link = grown;
+		release(small);
+		break;
+	}
+	case Kind16: {
+		Node16* medium = static_cast<Node16*>(node);
+		if (medium->count_ < 16) {
+			std::size_t i = medium->count_;
+			for (; i > 0 && medium->bytes_[i - 1] > byte; --i) {
+				medium->bytes_[i] = medium->bytes_[i - 1];
+				medium->children_[i] = medium->children_[i - 1];
+			}
+			medium->bytes_[i] = byte;
+			medium->children_[i] = child;
+			++medium->count_;
+			return;
+		}
+
+		Node48* grown = new Node48();
+		copyHeader(grown, medium);
+		grown->kind_ = Kind48;
+		for (std::size_t i = 0; i < 16; ++i) {
+			grown->slots_[medium->bytes_[i]] = static_cast<unsigned char>(i + 1);
+			grown->children_[i] = medium->children_[i];
+		}
+		*link = grown;
+		release(medium);
+		break;
+	}
+	case Kind48: {
+		Node48* large = static_cast<Node48*>(node);
+		if (large->count_ < 48) {
+			std::size_t slot = 0;
+			while (large->children_[slot] != nullptr)
+				++slot;
+			large->children_[slot] = child;
+			large->slots_[byte] = static_cast<unsigned char>(slot + 1);
+			++large->count_;
+			return;
+		}
+
+		Node256* grown = new Node256();
+		copyHeader(grown, large);
+		grown->kind_ = Kind256;
+		for (std::size_t b = 0; b < 256; ++b)
+			if (large->slots_[b] != 0)
+				grown->children_[b] = large->children_[large->slots_[b] - 1];
+		*link = grown;
+		release(large);
+		break;
+	}
+	default: {
+		Node256* full = static_cast<Node256*>(node);
+		full->children_[byte] = child;
+		++full->count_;
+		return;
+	}
+	}
+	addChild(link, byte, child);
+}
+
+template <typename K, typename V> inline
+typename ArtMap<K, V>::Leaf* ArtMap<K, V>::detach(Node** link,
+	ArtKey<K> const& bytes)
+{
+	std::size_t depth = 0;
+	for (;;) {
+		Node* node = *link;
+		if (node == nullptr)
+			return nullptr;
+		if (node->kind_ == LeafKind) {
+			// Only a root leaf is reached here; leaves further down are
+			// taken from their parent below.
+			Leaf* leaf = static_cast<Leaf*>(node);
+			if (!matches(leaf, bytes))
+				return nullptr;
+			*link = nullptr;
+			return leaf;
+		}
+
+		Inner* inner = static_cast<Inner*>(node);
+		if (inner->prefixLength_ != 0) {
+			if (checkPrefix(inner, bytes, depth)
+					!= std::min<std::size_t>(inner->prefixLength_, MaxPrefix))
+				return nullptr;
+			depth += inner->prefixLength_;
+		}
+		if (depth >= bytes.size()) {
+			Leaf* leaf = inner->end_;
+			if (depth != bytes.size() || leaf == nullptr
+					|| !matches(leaf, bytes))
+				return nullptr;
+			inner->end_ = nullptr;
+			collapse(link);
+			return leaf;
+		}
+
+		unsigned char byte = bytes.data()[depth];
+		Node** child = findChild(inner, byte);
+		if (child == nullptr)
+			return nullptr;
+		if ((*child)->kind_ == LeafKind) {
+			Leaf* leaf = static_cast<Leaf*>(*child);
+			if (!matches(leaf, bytes))
+				return nullptr;
+			removeChild(link, byte);
+			collapse(link);
+			return leaf;
+		}
+		link = child;
+		++depth;
+	}
+}
+
+template <typename K, typename V> inline
+void ArtMap<K, V>::removeChild(Node** link, unsigned char byte)
+{
+	// Nodes shrink a few children below the size they grow at, so a key
+	// added and removed at the boundary does not resize every time.  A
+	// failed allocation just leaves the node larger than it needs to be.
+	Inner* node = static_cast<Inner*>(*link);
+	switch (node->kind_) {
+	case Kind4: {
+		Node4* small = static_cast<Node4*>(node);
+		std::size_t i = 0;
+		while (small->bytes_[i] != byte)
+			++i;
+		for (; i + 1 < small->count_; ++i) {
+			small->bytes_[i] = small->bytes_[i + 1];
+			small->children_[i] = small->children_[i + 1];
+		}
+		small->children_[--small->count_] = nullptr;
+		return;
+	}
+	case Kind16: {
+		Node16* medium = static_cast<Node16*>(node);
+		std::size_t i = 0;
+		while (medium->bytes_[i] != byte)
+			++i;
+		for (; i + 1 < medium->count_; ++i) {
+			medium->bytes_[i] = medium->bytes_[i + 1];
+			medium->children_[i] = medium->children_[i + 1];
+		}
+		medium->children_[--medium->count_] = nullptr;
+		if (medium->count_ != 3)
+			return;
+
+		Node4* shrunk = new (std::nothrow) Node4();
+		if (shrunk == nullptr)
+			return;
+		copyHeader(shrunk, medium);
+		shrunk->kind_ = Kind4;
+		std::copy(medium->bytes_, medium->bytes_ + 3, shrunk->bytes_);
+		std::copy(medium->children_, medium->children_ + 3, shrunk->children_);
+		*link = shrunk;
+		release(medium);
+		return;
+	}
+	case Kind48: {
+		Node48* large = static_cast<Node48*>(node);
+		large->children_[large->slots_[byte] - 1] = nullptr;
+		large->slots_[byte] = 0;
+		--large->count_;
+		if (large->count_ != 12)
+			return;
+
+		Node16* shrunk = new (std::nothrow) Node16();
+		if (shrunk == nullptr)
+			return;
+		copyHeader(shrunk, large);
+		shrunk->kind_ = Kind16;
+		std::size_t i = 0;
+		for (std::size_t b = 0; b < 256; ++b)
+			if (large->slots_[b] != 0) {
+				shrunk->bytes_[i] = static_cast<unsigned char>(b);
+				shrunk->children_[i++] = large->children_[large->slots_[b] - 1];
+			}
+		*link = shrunk;
+		release(large);
+		return;
+	}
+	default: {
+		Node256* full = static_cast<Node256*>(node);
+		full->children_[byte] = nullptr;
+		--full->count_;
+		if (full->count_ != 37)
+			return;
+
+		Node48* shrunk = new (std::nothrow) Node48();
+		if (shrunk == nullptr)
+			return;
+		copyHeader(shrunk, full);
+		shrunk->kind_ = Kind48;
+		std::size_t slot = 0;
+		for (std::size_t b = 0; b < 256; ++b)
+			if (full->children_[b] != nullptr) {
+				shrunk->children_[slot] = full->children_[b];
+				shrunk->slots_[b] = static_cast<unsigned char>(++slot);
+			}
+		*link = shrunk;
+		release(full);
+		return;
+	}
+	}
+}
+
+template <typename K, typename V> inline
+void ArtMap<K, V>::collapse(Node** link)
+{
+	Inner* inner = static_cast<Inner*>(*link);
+	if (inner->count_ + (inner->end_ != nullptr ? 1 : 0) != 1)
+		return;
+
+	if (inner->count_ == 0) {
+		*link = inner->end_;
+		release(inner);
+		return;
+	}
+
+	int byte = -1;
+	Node* child = nextChild(inner, byte);
+	if (child->kind_ != LeafKind) {
+		// The child's prefix becomes this node's prefix, the byte between
+		// them and its own prefix, as far as that fits.
+		Inner* below = static_cast<Inner*>(child);
+		unsigned char prefix[MaxPrefix];
+		std::size_t length = std::min<std::size_t>(inner->prefixLength_,
+			MaxPrefix);
+		std::memcpy(prefix, inner->prefix_, length);
+		if (length < MaxPrefix)
+			prefix[length++] = static_cast<unsigned char>(byte);
+		std::size_t more = std::min<std::size_t>(below->prefixLength_,
+			MaxPrefix - length);
+		std::memcpy(prefix + length, below->prefix_, more);
+		std::memcpy(below->prefix_, prefix, length + more);
+		below->prefixLength_ += inner->prefixLength_ + 1;
+	}
+	*link = child;
+	release(inner);
+}
+
+template <typename K, typename V> inline
+void ArtMap<K, V>::copyHeader(Inner* to, Inner const* from)
+{
+	to->count_ = from->count_;
+	to->prefixLength_ = from->prefixLength_;
+	std::memcpy(to->prefix_, from->prefix_, MaxPrefix);
+	to->end_ = from->end_;
+}
+
+template <typename K, typename V> template <typename LeafT, typename Fn>
+inline void ArtMap<K, V>::visit(Node* node, Fn& fn)
+{
+	if (node == nullptr)
+		return;
+	if (node->kind_ == LeafKind) {
+		LeafT* leaf = static_cast<Leaf*>(node);
+		fn(static_cast<K const&>(leaf->key_), leaf->value_);
+		return;
+	}
+
+	Inner* inner = static_cast<Inner*>(node);
+	visit<LeafT>(inner->end_, fn);
+	int byte = -1;
+	while (Node* child = nextChild(inner, byte))
+		visit<LeafT>(child, fn);
+}
+
+template <typename K, typename V> inline
+void ArtMap<K, V>::clone(Node* from, Node** to)
+{
+	Inner* copy;
+	switch (from->kind_) {
+	case LeafKind: {
+		Leaf* leaf = static_cast<Leaf*>(from);
+		*to = new Leaf(leaf->key_, leaf->value_);
+		return;
+	}
+	case Kind4:
+		copy = new Node4(*static_cast<Node4*>(from));
+		break;
+	case Kind16:
+		copy = new Node16(*static_cast<Node16*>(from));
+		break;
+	case Kind48:
+		copy = new Node48(*static_cast<Node48*>(from));
+		break;
+	default:
+		copy = new Node256(*static_cast<Node256*>(from));
+		break;
+	}
+
+	// The copy starts with no children, so that a throw part way leaves a
+	// tree destroy() can free.
+	std::size_t length;
+	Node** copies = children(copy, length);
+	std::fill(copies, copies + length, nullptr);
+	copy->end_ = nullptr;
+	*to = copy;
+
+	Inner* inner = static_cast<Inner*>(from);
+	if (inner->end_ != nullptr) {
+		Node* end = nullptr;
+		clone(inner->end_, &end);
+		copy->end_ = static_cast<Leaf*>(end);
+	}
+	Node** originals = children(inner, length);
+	for (std::size_t i = 0; i < length; ++i)
+		if (originals[i] != nullptr)
+			clone(originals[i], &copies[i]);
+}
+
+template <typename K, typename V> inline
+void ArtMap<K, V>::destroy(Node* node)
+{
+	if (node == nullptr)
+		return;
+	if (node->kind_ != LeafKind) {
+		Inner* inner = static_cast<Inner*>(node);
+		destroy(inner->end_);
+		std::size_t length;
+		Node** all = children(inner, length);
+		for (std::size_t i = 0; i < length; ++i)
+			destroy(all[i]);
+	}
+	release(node);
+}
+
+template <typename K, typename V> inline
+void ArtMap<K, V>::release(Node* node)
+{
+	switch (node->kind_) {
+	case LeafKind:
+		delete static_cast<Leaf*>(node);
+		break;
+	case Kind4:
+		delete static_cast<Node4*>(node);
+		break;
+	case Kind16:
+		delete static_cast<Node16*>(node);
+		break;
+	case Kind48:
+		delete static_cast<Node48*>(node);
+		break;
+	default:
+		delete static_cast<Node256*>(node);
+		break;
+	}
+}
+
+#endif
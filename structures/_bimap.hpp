@@ -0,0 +1,372 @@
+/**
+ * \file _bimap.hpp
+ * \brief Private implementation file of the bidirectional map.
+ */
+
+#ifndef _BI_MAP_HPP
+#define _BI_MAP_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "mapviews.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE>
+const std::uint32_t BiMap<K, V, KH, VH, KE, VE>::Empty;
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+BiMap<K, V, KH, VH, KE, VE>::BiMap() :
+	entries_{},
+	byKey_{},
+	byValue_{},
+	hashKey_{},
+	hashValue_{},
+	equalKey_{},
+	equalValue_{}
+{
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+BiMap<K, V, KH, VH, KE, VE>::BiMap(BiMap<K, V, KH, VH, KE, VE> const& orig) :
+	entries_{orig.entries_},
+	byKey_{orig.byKey_},
+	byValue_{orig.byValue_},
+	hashKey_{orig.hashKey_},
+	hashValue_{orig.hashValue_},
+	equalKey_{orig.equalKey_},
+	equalValue_{orig.equalValue_}
+{
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+BiMap<K, V, KH, VH, KE, VE>::BiMap(BiMap<K, V, KH, VH, KE, VE>&& other) :
+	BiMap()
+{
+	swap(*this, other);
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+BiMap<K, V, KH, VH, KE, VE>& BiMap<K, V, KH, VH, KE, VE>::operator=(
+	BiMap<K, V, KH, VH, KE, VE> rhs)
+{
+	swap(*this, rhs);
+	return *this;
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+void swap(BiMap<K, V, KH, VH, KE, VE>& lhs, BiMap<K, V, KH, VH, KE, VE>& rhs)
+{
+	std::swap(lhs.entries_, rhs.entries_);
+	std::swap(lhs.byKey_, rhs.byKey_);
+	std::swap(lhs.byValue_, rhs.byValue_);
+	std::swap(lhs.hashKey_, rhs.hashKey_);
+	std::swap(lhs.hashValue_, rhs.hashValue_);
+	std::swap(lhs.equalKey_, rhs.equalKey_);
+	std::swap(lhs.equalValue_, rhs.equalValue_);
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+void BiMap<K, V, KH, VH, KE, VE>::addValue(K key, V value)
+{
+	std::size_t keyHash = mix(hashKey_(key));
+	std::size_t valueHash = mix(hashValue_(value));
+	if (findKey(key, keyHash) != Empty)
+		throw KeyError<K>{key, "BiMap"};
+	if (findValue(value, valueHash) != Empty)
+		throw KeyError<V>{value, "BiMap"};
+
+	makeRoom(entries_.size() + 1);
+	appendEntry(Entry{std::move(key), std::move(value), keyHash, valueHash});
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+std::size_t BiMap<K, V, KH, VH, KE, VE>::replace(K key, V value)
+{
+	std::size_t keyHash = mix(hashKey_(key));
+	std::size_t valueHash = mix(hashValue_(value));
+	std::uint32_t byKey = findKey(key, keyHash);
+	std::uint32_t byValue = findValue(value, valueHash);
+	if (byKey != Empty && byKey == byValue)
+		return 0;
+
+	// Everything that can throw happens before the first removal.
+	Entry entry{std::move(key), std::move(value), keyHash, valueHash};
+	makeRoom(entries_.size() + 1);
+
+	std::size_t displaced = 0;
+	if (byKey != Empty && byValue != Empty) {
+		// Erasing the later entry first leaves the earlier one in place.
+		eraseEntry(byKey > byValue ? byKey : byValue);
+		eraseEntry(byKey > byValue ? byValue : byKey);
+		displaced = 2;
+	} else if (byKey != Empty) {
+		eraseEntry(byKey);
+		displaced = 1;
+	} else if (byValue != Empty) {
+		eraseEntry(byValue);
+		displaced = 1;
+	}
+	appendEntry(std::move(entry));
+	return displaced;
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+void BiMap<K, V, KH, VH, KE, VE>::removeValue(K const& key)
+{
+	std::uint32_t entry = findKey(key, mix(hashKey_(key)));
+	if (entry == Empty)
+		throw KeyError<K>{key, "BiMap"};
+	eraseEntry(entry);
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+void BiMap<K, V, KH, VH, KE, VE>::removeByValue(V const& value)
+{
+	std::uint32_t entry = findValue(value, mix(hashValue_(value)));
+	if (entry == Empty)
+		throw KeyError<V>{value, "BiMap"};
+	eraseEntry(entry);
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+V const& BiMap<K, V, KH, VH, KE, VE>::getValue(K const& key) const
+{
+	std::uint32_t entry = findKey(key, mix(hashKey_(key)));
+	if (entry == Empty)
+		throw KeyError<K>{key, "BiMap"};
+	return entries_[entry].value_;
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+K const& BiMap<K, V, KH, VH, KE, VE>::getKey(V const& value) const
+{
+	std::uint32_t entry = findValue(value, mix(hashValue_(value)));
+	if (entry == Empty)
+		throw KeyError<V>{value, "BiMap"};
+	return entries_[entry].key_;
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+std::size_t BiMap<K, V, KH, VH, KE, VE>::size() const
+{
+	return entries_.size();
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+bool BiMap<K, V, KH, VH, KE, VE>::isEmpty() const
+{
+	return entries_.empty();
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+bool BiMap<K, V, KH, VH, KE, VE>::contains(K const& key) const
+{
+	return findKey(key, mix(hashKey_(key))) != Empty;
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+bool BiMap<K, V, KH, VH, KE, VE>::containsValue(V const& value) const
+{
+	return findValue(value, mix(hashValue_(value))) != Empty;
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+void BiMap<K, V, KH, VH, KE, VE>::reserve(std::size_t count)
+{
+	makeRoom(count);
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+typename BiMap<K, V, KH, VH, KE, VE>::keys_view
+BiMap<K, V, KH, VH, KE, VE>::keys() const
+{
+	return keys_view{entries_.data(), entries_.data() + entries_.size(),
+		entries_.size()};
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+typename BiMap<K, V, KH, VH, KE, VE>::values_view
+BiMap<K, V, KH, VH, KE, VE>::values() const
+{
+	return values_view{entries_.data(), entries_.data() + entries_.size(),
+		entries_.size()};
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+typename BiMap<K, V, KH, VH, KE, VE>::items_view
+BiMap<K, V, KH, VH, KE, VE>::items() const
+{
+	return items_view{entries_.data(), entries_.data() + entries_.size(),
+		entries_.size()};
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE>
+template <typename Fn> inline
+void BiMap<K, V, KH, VH, KE, VE>::forEach(Fn fn) const
+{
+	for (Entry const& entry : entries_)
+		fn(entry.key_, entry.value_);
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+std::size_t BiMap<K, V, KH, VH, KE, VE>::mix(std::size_t hash)
+{
+	std::uint64_t mixed = static_cast<std::uint64_t>(hash);
+	mixed *= 0x9E3779B97F4A7C15ull;
+	return static_cast<std::size_t>(mixed ^ (mixed >> 32));
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE>
+template <typename Match> inline
+std::size_t BiMap<K, V, KH, VH, KE, VE>::probe(
+	std::vector<std::uint32_t> const& table, std::size_t hash,
+	Match match) const
+{
+	std::size_t mask = table.size() - 1;
+	for (std::size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+		if (table[slot] == Empty || match(table[slot]))
+			return slot;
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+std::uint32_t BiMap<K, V, KH, VH, KE, VE>::findKey(
+	K const& key, std::size_t hash) const
+{
+	if (byKey_.empty())
+		return Empty;
+	return byKey_[probe(byKey_, hash, [&](std::uint32_t entry) {
+		return entries_[entry].keyHash_ == hash &&
+			equalKey_(entries_[entry].key_, key);
+	})];
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+std::uint32_t BiMap<K, V, KH, VH, KE, VE>::findValue(
+	V const& value, std::size_t hash) const
+{
+	if (byValue_.empty())
+		return Empty;
+	return byValue_[probe(byValue_, hash, [&](std::uint32_t entry) {
+		return entries_[entry].valueHash_ == hash &&
+			equalValue_(entries_[entry].value_, value);
+	})];
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+std::size_t BiMap<K, V, KH, VH, KE, VE>::slotOf(
+	std::vector<std::uint32_t> const& table, std::size_t hash,
+	std::uint32_t entry) const
+{
+	return probe(table, hash,
+		[&](std::uint32_t other) { return other == entry; });
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+void BiMap<K, V, KH, VH, KE, VE>::eraseSlot(
+	std::vector<std::uint32_t>& table, std::size_t slot, bool byValue)
+{
+	std::size_t mask = table.size() - 1;
+	std::size_t hole = slot;
+	for (std::size_t next = (hole + 1) & mask; table[next] != Empty;
+			next = (next + 1) & mask) {
+		Entry const& entry = entries_[table[next]];
+		std::size_t home = (byValue ? entry.valueHash_ : entry.keyHash_) & mask;
+		// Move next back unless its home lies cyclically in (hole, next].
+		if (((next - home) & mask) >= ((next - hole) & mask)) {
+			table[hole] = table[next];
+			hole = next;
+		}
+	}
+	table[hole] = Empty;
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+void BiMap<K, V, KH, VH, KE, VE>::eraseEntry(std::uint32_t entry)
+{
+	eraseSlot(byKey_, slotOf(byKey_, entries_[entry].keyHash_, entry), false);
+	eraseSlot(byValue_, slotOf(byValue_, entries_[entry].valueHash_, entry),
+		true);
+
+	std::uint32_t last = static_cast<std::uint32_t>(entries_.size() - 1);
+	if (entry != last) {
+		Entry& moved = entries_[last];
+		byKey_[slotOf(byKey_, moved.keyHash_, last)] = entry;
+		byValue_[slotOf(byValue_, moved.valueHash_, last)] = entry;
+		entries_[entry] = std::move(moved);
+	}
+	entries_.pop_back();
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+void BiMap<K, V, KH, VH, KE, VE>::appendEntry(Entry&& entry)
+{
+	std::uint32_t index = static_cast<std::uint32_t>(entries_.size());
+	entries_.push_back(std::move(entry));
+	Entry const& added = entries_.back();
+
+	auto none = [](std::uint32_t) { return false; };
+	byKey_[probe(byKey_, added.keyHash_, none)] = index;
+	byValue_[probe(byValue_, added.valueHash_, none)] = index;
+}
+
+template <typename K, typename V, typename KH, typename VH, typename KE,
+	typename VE> inline
+void BiMap<K, V, KH, VH, KE, VE>::makeRoom(std::size_t count)
+{
+	// Reserve geometrically so repeated single insertions stay amortised.
+	if (count > entries_.capacity())
+		entries_.reserve(count > 2 * entries_.capacity() ?
+			count : 2 * entries_.capacity());
+
+	// Tables are kept at most half full.
+	if (2 * count <= byKey_.size())
+		return;
+	std::size_t capacity = byKey_.empty() ? 16 : byKey_.size();
+	while (2 * count > capacity)
+		capacity <<= 1;
+
+	std::vector<std::uint32_t> byKey(capacity, Empty);
+	std::vector<std::uint32_t> byValue(capacity, Empty);
+	auto none = [](std::uint32_t) { return false; };
+	for (std::uint32_t i = 0; i < entries_.size(); ++i) {
+		byKey[probe(byKey, entries_[i].keyHash_, none)] = i;
+		byValue[probe(byValue, entries_[i].valueHash_, none)] = i;
+	}
+	byKey_.swap(byKey);
+	byValue_.swap(byValue);
+}
+
+#endif
@@ -0,0 +1,408 @@
+/**
+ * \file _blockingqueue.hpp
+ * \brief Private implementation file for the bounded blocking queue.
+ */
+
+#ifndef _BLOCKING_QUEUE_HPP
+#define _BLOCKING_QUEUE_HPP 1
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+template <typename T> inline
+BlockingQueue<T>::BlockingQueue(std::size_t capacity) :
+	slots_{nullptr},
+	mask_{0},
+	pushPosition_{0},
+	popPosition_{0},
+	pushWaiters_{0},
+	popWaiters_{0}
+{
+	std::size_t rounded = 2;
+	while (rounded < capacity)
+		rounded <<= 1;
+
+	slots_ = new Slot[rounded];
+	mask_ = rounded - 1;
+	for (std::size_t i = 0; i < rounded; ++i)
+		slots_[i].sequence_.store(i, std::memory_order_relaxed);
+}
+
+template <typename T> inline
+BlockingQueue<T>::~BlockingQueue()
+{
+	delete [] slots_;
+}
+
+template <typename T> inline
+std::size_t BlockingQueue<T>::claimForPush(
+	std::size_t maxItems, std::size_t& position)
+{
+	std::size_t pos = pushPosition_.load(std::memory_order_relaxed);
+	for (;;) {
+		std::size_t count = 0;
+		std::size_t sequence = 0;
+		while (count < maxItems) {
+			sequence = slots_[(pos + count) & mask_].sequence_.load(
+				std::memory_order_acquire);
+			if (sequence != pos + count)
+				break;
+			++count;
+		}
+
+		if (count == 0) {
+			// A sequence behind our ticket means the slot still holds a value
+			// from the previous lap: the queue is full.
+			if (static_cast<std::intptr_t>(sequence - pos) < 0)
+				return 0;
+			pos = pushPosition_.load(std::memory_order_relaxed);
+		} else if (pushPosition_.compare_exchange_weak(
+				pos, pos + count, std::memory_order_relaxed)) {
+			position = pos;
+			return count;
+		}
+	}
+}
+
+template <typename T> inline
+std::size_t BlockingQueue<T>::claimForPop(
+	std::size_t maxItems, std::size_t& position)
+{
+	std::size_t pos = popPosition_.load(std::memory_order_relaxed);
+	for (;;) {
+		std::size_t count = 0;
+		std::size_t sequence = 0;
+		while (count < maxItems) {
+			sequence = slots_[(pos + count) & mask_].sequence_.load(
+				std::memory_order_acquire);
+			if (sequence != pos + count + 1)
+				break;
+			++count;
+		}
+
+		if (count == 0) {
+			if (static_cast<std::intptr_t>(sequence - (pos + 1)) < 0)
+				return 0;
+			pos = popPosition_.load(std::memory_order_relaxed);
+		} else if (popPosition_.compare_exchange_weak(
+				pos, pos + count, std::memory_order_relaxed)) {
+			position = pos;
+			return count;
+		}
+	}
+}
+
+template <typename T> inline
+void BlockingQueue<T>::notifyConsumers(bool all)
+{
+	// Pairs with the fence a sleeper issues after registering itself: either
+	// we see the waiter, or the waiter's retry sees our value.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (popWaiters_.load(std::memory_order_relaxed) == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock{mutex_};
+	if (all)
+		notEmpty_.notify_all();
+	else
+		notEmpty_.notify_one();
+}
+
+template <typename T> inline
+void BlockingQueue<T>::notifyProducers(bool all)
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (pushWaiters_.load(std::memory_order_relaxed) == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock{mutex_};
+	if (all)
+		notFull_.notify_all();
+	else
+		notFull_.notify_one();
+}
+
+template <typename T> inline
+bool BlockingQueue<T>::tryPush(T value)
+{
+	std::size_t position;
+	if (claimForPush(1, position) == 0)
+		return false;
+
+	Slot& slot = slots_[position & mask_];
+	slot.value_ = std::move(value);
+	slot.sequence_.store(position + 1, std::memory_order_release);
+	notifyConsumers(false);
+	return true;
+}
+
+template <typename T> inline
+bool BlockingQueue<T>::tryPop(T& value)
+{
+	std::size_t position;
+	if (claimForPop(1, position) == 0)
+		return false;
+
+	Slot& slot = slots_[position & mask_];
+	value = std::move(slot.value_);
+	slot.sequence_.store(position + mask_ + 1, std::memory_order_release);
+	notifyProducers(false);
+	return true;
+}
+
+template <typename T> inline
+void BlockingQueue<T>::push(T value)
+{
+	tryPushFor(std::move(value), std::chrono::hours::max());
+}
+
+template <typename T> inline
+T BlockingQueue<T>::pop()
+{
+	T value;
+	tryPopFor(value, std::chrono::hours::max());
+	return value;
+}
+
+template <typename T> template <typename Rep, typename Period> inline
+bool BlockingQueue<T>::tryPushFor(
+	T value, const std::chrono::duration<Rep, Period>& timeout)
+{
+	// Anything longer than a year is treated as "wait forever"; this also
+	// keeps the deadline arithmetic from overflowing.
+	bool forever = timeout > std::chrono::hours(24 * 365);
+	auto deadline = std::chrono::steady_clock::now();
+	if (!forever)
+		deadline += std::chrono::duration_cast<
+			std::chrono::steady_clock::duration>(timeout);
+
+	std::size_t position;
+	std::size_t claimed = 0;
+	for (int spin = 0; spin < 64 && claimed == 0; ++spin) {
+		claimed = claimForPush(1, position);
+		if (claimed == 0)
+			std::this_thread::yield();
+	}
+
+	if (claimed == 0) {
+		std::unique_lock<std::mutex> lock{mutex_};
+		pushWaiters_.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		while ((claimed = claimForPush(1, position)) == 0) {
+			if (forever) {
+				notFull_.wait(lock);
+			} else if (notFull_.wait_until(lock, deadline) ==
+					std::cv_status::timeout) {
+				claimed = claimForPush(1, position);
+				break;
+			}
+		}
+		pushWaiters_.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	if (claimed == 0)
+		return false;
+
+	Slot& slot = slots_[position & mask_];
+	slot.value_ = std::move(value);
+	slot.sequence_.store(position + 1, std::memory_order_release);
+	notifyConsumers(false);
+	return true;
+}
+
+template <typename T> template <typename Rep, typename Period> inline
+bool BlockingQueue<T>::tryPopFor(
+	T& value, const std::chrono::duration<Rep, Period>& timeout)
+{
+	bool forever = timeout > std::chrono::hours(24 * 365);
+	auto deadline = std::chrono::steady_clock::now();
+	if (!forever)
+		deadline += std::chrono::duration_cast<
+			std::chrono::steady_clock::duration>(timeout);
+
+	std::size_t position;
+	std::size_t claimed = 0;
+	for (int spin = 0; spin < 64 && claimed == 0; ++spin) {
+		claimed = claimForPop(1, position);
+		if (claimed == 0)
+			std::this_thread::yield();
+	}
+
+	if (claimed == 0) {
+		std::unique_lock<std::mutex> lock{mutex_};
+		popWaiters_.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		while ((claimed = claimForPop(1, position)) == 0) {
+			if (forever) {
+				notEmpty_.wait(lock);
+			} else if (notEmpty_.wait_until(lock, deadline) ==
+					std::cv_status::timeout) {
+				claimed = claimForPop(1, position);
+				break;
+			}
+		}
+		popWaiters_.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	if (claimed == 0)
+		return false;
+
+	Slot& slot = slots_[position & mask_];
+	value = std::move(slot.value_);
+	slot.sequence_.store(position + mask_ + 1, std::memory_order_release);
+	notifyProducers(false);
+	return true;
+}
+
+template <typename T> template <typename It> inline
+std::size_t BlockingQueue<T>::pushRun(It& first, std::size_t count)
+{
+	std::size_t position;
+	std::size_t claimed = claimForPush(count, position);
+	for (std::size_t i = 0; i < claimed; ++i, ++first) {
+		Slot& slot = slots_[(position + i) & mask_];
+		slot.value_ = *first;
+		slot.sequence_.store(position + i + 1, std::memory_order_release);
+	}
+
+	if (claimed > 0)
+		notifyConsumers(claimed > 1);
+	return claimed;
+}
+
+template <typename T> template <typename It> inline
+void BlockingQueue<T>::pushAll(It first, std::size_t count)
+{
+	while (count > 0) {
+		std::size_t pushed = pushRun(first, count);
+		if (pushed > 0) {
+			count -= pushed;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock{mutex_};
+		pushWaiters_.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		// Sleep until at least one slot frees up, then go back to claiming
+		// without the lock held.
+		std::size_t sequence = 0;
+		std::size_t pos = 0;
+		for (;;) {
+			pos = pushPosition_.load(std::memory_order_relaxed);
+			sequence = slots_[pos & mask_].sequence_.load(
+				std::memory_order_acquire);
+			if (static_cast<std::intptr_t>(sequence - pos) >= 0)
+				break;
+			notFull_.wait(lock);
+		}
+		pushWaiters_.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+template <typename T> template <typename ForwardIt> inline
+std::size_t BlockingQueue<T>::tryPushBatch(ForwardIt first, ForwardIt last)
+{
+	std::size_t wanted = static_cast<std::size_t>(std::distance(first, last));
+	if (wanted == 0)
+		return 0;
+	if (WritesNothrow<ForwardIt>::value)
+		return pushRun(first, wanted);
+
+	// A claimed slot must be published, so make the copies that may throw
+	// first; moving them in afterwards is assumed not to, as in tryPush().
+	std::vector<T> values(first, last);
+	auto moving = std::make_move_iterator(values.begin());
+	return pushRun(moving, wanted);
+}
+
+template <typename T> template <typename ForwardIt> inline
+void BlockingQueue<T>::pushBatch(ForwardIt first, ForwardIt last)
+{
+	std::size_t count = static_cast<std::size_t>(std::distance(first, last));
+	if (WritesNothrow<ForwardIt>::value) {
+		pushAll(first, count);
+		return;
+	}
+
+	std::vector<T> values(first, last);
+	pushAll(std::make_move_iterator(values.begin()), count);
+}
+
+template <typename T> template <typename OutputIt> inline
+std::size_t BlockingQueue<T>::tryPopBatch(OutputIt out, std::size_t maxItems)
+{
+	if (maxItems == 0)
+		return 0;
+
+	std::size_t position;
+	std::size_t claimed = claimForPop(maxItems, position);
+	for (std::size_t i = 0; i < claimed; ++i, ++out) {
+		Slot& slot = slots_[(position + i) & mask_];
+		*out = std::move(slot.value_);
+		slot.sequence_.store(
+			position + i + mask_ + 1, std::memory_order_release);
+	}
+
+	if (claimed > 0)
+		notifyProducers(claimed > 1);
+	return claimed;
+}
+
+template <typename T> template <typename OutputIt> inline
+std::size_t BlockingQueue<T>::popBatch(OutputIt out, std::size_t maxItems)
+{
+	if (maxItems == 0)
+		return 0;
+
+	for (;;) {
+		std::size_t popped = tryPopBatch(out, maxItems);
+		if (popped > 0)
+			return popped;
+
+		std::unique_lock<std::mutex> lock{mutex_};
+		popWaiters_.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		std::size_t sequence = 0;
+		std::size_t pos = 0;
+		for (;;) {
+			pos = popPosition_.load(std::memory_order_relaxed);
+			sequence = slots_[pos & mask_].sequence_.load(
+				std::memory_order_acquire);
+			if (static_cast<std::intptr_t>(sequence - (pos + 1)) >= 0)
+				break;
+			notEmpty_.wait(lock);
+		}
+		popWaiters_.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+template <typename T> inline
+std::size_t BlockingQueue<T>::size() const
+{
+	std::size_t pushed = pushPosition_.load(std::memory_order_relaxed);
+	std::size_t popped = popPosition_.load(std::memory_order_relaxed);
+	return pushed > popped ? pushed - popped : 0;
+}
+
+template <typename T> inline
+bool BlockingQueue<T>::isEmpty() const
+{
+	return size() == 0;
+}
+
+template <typename T> inline
+std::size_t BlockingQueue<T>::capacity() const
+{
+	return mask_ + 1;
+}
+
+#endif
@@ -0,0 +1,206 @@
+/**
+ * \file _bloomfilter.hpp
+ * \brief Private implementation file of the blocked Bloom filter.
+ */
+
+#ifndef _BLOOM_FILTER_HPP
+#define _BLOOM_FILTER_HPP 1
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+template <typename K, typename Hash>
+constexpr double BloomFilter<K, Hash>::DefaultFalsePositiveRate;
+
+template <typename K, typename Hash>
+const std::size_t BloomFilter<K, Hash>::BlockWords;
+
+template <typename K, typename Hash>
+const std::uint32_t BloomFilter<K, Hash>::Salt[BloomFilter<K, Hash>::BlockWords] =
+{
+	0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+	0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+};
+
+template <typename K, typename Hash> inline
+BloomFilter<K, Hash>::BloomFilter(std::size_t capacity,
+	double falsePositiveRate, Hash hash) :
+		storage_{},
+		offset_{0},
+		blockCount_{0},
+		size_{0},
+		capacity_{capacity},
+		falsePositiveRate_{std::min(std::max(falsePositiveRate, 0.0001), 0.5)},
+		hash_(std::move(hash))
+{
+	if (capacity_ == 0)
+		return;
+
+	// Every key sets BlockWords bits, so solve (1 - e^(-k/b))^k = rate for b
+	// bits per key, plus a tenth for confining each key to a block.
+	double perKey = -double(BlockWords)
+		/ std::log(1 - std::pow(falsePositiveRate_, 1.0 / BlockWords));
+	double bits = 1.1 * perKey * capacity_;
+	std::size_t blockBits = 64 * BlockWords;
+	blockCount_ = static_cast<std::size_t>(std::ceil(bits / blockBits));
+	allocate();
+}
+
+template <typename K, typename Hash> inline
+BloomFilter<K, Hash>::BloomFilter(BloomFilter<K, Hash> const& orig) :
+	storage_{},
+	offset_{0},
+	blockCount_{orig.blockCount_},
+	size_{orig.size_},
+	capacity_{orig.capacity_},
+	falsePositiveRate_{orig.falsePositiveRate_},
+	hash_(orig.hash_)
+{
+	// The copy's storage may start at a different offset from a cache line.
+	allocate();
+	std::copy(orig.storage_.begin() + orig.offset_,
+		orig.storage_.begin() + orig.offset_ + blockCount_ * BlockWords,
+		storage_.begin() + offset_);
+}
+
+template <typename K, typename Hash> inline
+BloomFilter<K, Hash>::BloomFilter(BloomFilter<K, Hash>&& other) :
+	BloomFilter(0, DefaultFalsePositiveRate, other.hash_)
+{
+	swap(*this, other);
+}
+
+template <typename K, typename Hash> inline
+BloomFilter<K, Hash>& BloomFilter<K, Hash>::operator=(BloomFilter<K, Hash> rhs)
+{
+	swap(*this, rhs);
+	return *this;
+}
+
+template <typename K, typename Hash> inline
+void swap(BloomFilter<K, Hash>& lhs, BloomFilter<K, Hash>& rhs)
+{
+	std::swap(lhs.storage_, rhs.storage_);
+	std::swap(lhs.offset_, rhs.offset_);
+	std::swap(lhs.blockCount_, rhs.blockCount_);
+	std::swap(lhs.size_, rhs.size_);
+	std::swap(lhs.capacity_, rhs.capacity_);
+	std::swap(lhs.falsePositiveRate_, rhs.falsePositiveRate_);
+	std::swap(lhs.hash_, rhs.hash_);
+}
+
+template <typename K, typename Hash> inline
+void BloomFilter<K, Hash>::add(K const& key)
+{
+	++size_;
+	if (blockCount_ == 0)
+		return;
+
+	std::uint64_t hash = hashOf(key);
+	std::uint64_t* block = blockOf(hash);
+	std::uint32_t low = static_cast<std::uint32_t>(hash);
+	for (std::size_t i = 0; i < BlockWords; ++i)
+		block[i] |= std::uint64_t{1} << ((low * Salt[i]) >> 26);
+}
+
+template <typename K, typename Hash> inline
+bool BloomFilter<K, Hash>::mayContain(K const& key) const
+{
+	if (blockCount_ == 0)
+		return true;
+
+	std::uint64_t hash = hashOf(key);
+	std::uint64_t const* block = blockOf(hash);
+	std::uint32_t low = static_cast<std::uint32_t>(hash);
+
+	// Gather every missing bit rather than stopping at the first, so the
+	// loop has no branches.
+	std::uint64_t missing = 0;
+	for (std::size_t i = 0; i < BlockWords; ++i)
+		missing |= ~block[i] & (std::uint64_t{1} << ((low * Salt[i]) >> 26));
+	return missing == 0;
+}
+
+template <typename K, typename Hash> inline
+void BloomFilter<K, Hash>::clear()
+{
+	std::fill(storage_.begin(), storage_.end(), 0);
+	size_ = 0;
+}
+
+template <typename K, typename Hash> inline
+std::size_t BloomFilter<K, Hash>::size() const
+{
+	return size_;
+}
+
+template <typename K, typename Hash> inline
+std::size_t BloomFilter<K, Hash>::capacity() const
+{
+	return capacity_;
+}
+
+template <typename K, typename Hash> inline
+double BloomFilter<K, Hash>::falsePositiveRate() const
+{
+	return falsePositiveRate_;
+}
+
+template <typename K, typename Hash> inline
+std::size_t BloomFilter<K, Hash>::bitCount() const
+{
+	return blockCount_ * BlockWords * 64;
+}
+
+template <typename K, typename Hash> inline
+Hash BloomFilter<K, Hash>::hashFunction() const
+{
+	return hash_;
+}
+
+template <typename K, typename Hash> inline
+std::uint64_t BloomFilter<K, Hash>::hashOf(K const& key) const
+{
+	std::uint64_t hash = static_cast<std::uint64_t>(hash_(key));
+	hash *= 0x9E3779B97F4A7C15ull;
+	return hash ^ (hash >> 32);
+}
+
+template <typename K, typename Hash> inline
+std::uint64_t* BloomFilter<K, Hash>::blockOf(std::uint64_t hash)
+{
+	// Multiply-shift maps the high half onto [0, blockCount_) without a
+	// division.
+	std::uint64_t block = ((hash >> 32) * blockCount_) >> 32;
+	return storage_.data() + offset_ + block * BlockWords;
+}
+
+template <typename K, typename Hash> inline
+std::uint64_t const* BloomFilter<K, Hash>::blockOf(std::uint64_t hash) const
+{
+	std::uint64_t block = ((hash >> 32) * blockCount_) >> 32;
+	return storage_.data() + offset_ + block * BlockWords;
+}
+
+template <typename K, typename Hash> inline
+void BloomFilter<K, Hash>::allocate()
+{
+	if (blockCount_ == 0)
+		return;
+
+	// One spare block's worth of words leaves room to slide the first
+	// block onto a cache line boundary.
+	storage_.assign((blockCount_ + 1) * BlockWords, 0);
+	std::uintptr_t address =
+		reinterpret_cast<std::uintptr_t>(storage_.data());
+	std::uintptr_t misalignment = address % (BlockWords * 8);
+	offset_ = misalignment == 0 ? 0
+		: (BlockWords * 8 - misalignment) / sizeof(std::uint64_t);
+}
+
+#endif
@@ -0,0 +1,843 @@
+/**
+ * \file _btreemap.hpp
+ * \brief Private implementation file of the B+ tree map.
+ */
+
+#ifndef _BTREE_MAP_HPP
+#define _BTREE_MAP_HPP 1
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename K, typename V>
+const std::size_t BTreeMap<K, V>::Capacity;
+
+template <typename K, typename V>
+const std::size_t BTreeMap<K, V>::MinCount;
+
+template <typename K, typename V>
+const std::size_t BTreeMap<K, V>::MaxHeight;
+
+template <typename K, typename V>
+const std::size_t BTreeMap<K, V>::SmallBatchRatio;
+
+template <typename K, typename V> inline
+BTreeMap<K, V>::BTreeMap() : root_{nullptr}, first_{nullptr}, size_{0}
+{
+}
+
+template <typename K, typename V> template <typename InputIt> inline
+BTreeMap<K, V>::BTreeMap(InputIt first, InputIt last) : BTreeMap()
+{
+	insertBatch(first, last);
+}
+
+template <typename K, typename V> inline
+BTreeMap<K, V>::BTreeMap(BTreeMap<K, V> const& orig) : BTreeMap()
+{
+	std::vector<std::pair<K, V>> pairs;
+	pairs.reserve(orig.size_);
+	orig.forEach([&](K const& key, V const& value) {
+		pairs.push_back(std::make_pair(key, value));
+	});
+	build(pairs);
+}
+
+template <typename K, typename V> inline
+BTreeMap<K, V>::BTreeMap(BTreeMap<K, V>&& other) : BTreeMap()
+{
+	swap(*this, other);
+}
+
+template <typename K, typename V> inline
+BTreeMap<K, V>& BTreeMap<K, V>::operator=(BTreeMap<K, V> rhs)
+{
+	swap(*this, rhs);
+	return *this;
+}
+
+template <typename K, typename V> inline
+void swap(BTreeMap<K, V>& lhs, BTreeMap<K, V>& rhs)
+{
+	std::swap(lhs.root_, rhs.root_);
+	std::swap(lhs.first_, rhs.first_);
+	std::swap(lhs.size_, rhs.size_);
+}
+
+template <typename K, typename V> inline
+BTreeMap<K, V>::~BTreeMap()
+{
+	destroy(root_);
+}
+
+template <typename K, typename V> template <typename InputIt> inline
+void BTreeMap<K, V>::bulkLoad(InputIt first, InputIt last)
+{
+	std::vector<std::pair<K, V>> pairs;
+	for (; first != last; ++first) {
+		if (!pairs.empty() && !(pairs.back().first < first->first))
+			throw KeyError<K>{first->first, "BTreeMap"};
+		pairs.push_back(std::make_pair(first->first, first->second));
+	}
+
+	BTreeMap<K, V> loaded;
+	loaded.build(pairs);
+	swap(*this, loaded);
+}
+
+template <typename K, typename V> template <typename InputIt> inline
+void BTreeMap<K, V>::insertBatch(InputIt first, InputIt last)
+{
+	std::vector<std::pair<K, V>> added;
+	added.reserve(batchSize(first, last));
+	for (; first != last; ++first)
+		added.push_back(std::make_pair(first->first, first->second));
+	if (added.empty())
+		return;
+
+	// A rebuild costs O(n) however few pairs come in, so a batch that is
+	// small next to the map is cheaper inserted pair by pair.
+	if (added.size() * SmallBatchRatio < size_) {
+		for (std::pair<K, V>& pair : added)
+			insertOrAssign(std::move(pair.first), std::move(pair.second));
+		return;
+	}
+
+	std::stable_sort(added.begin(), added.end(),
+		[](std::pair<K, V> const& lhs, std::pair<K, V> const& rhs) {
+			return lhs.first < rhs.first;
+		});
+
+	// The present pairs are moved straight out of the leaves, in order.
+	Leaf* leaf = first_;
+	std::size_t slot = 0;
+	auto atEnd = [&]() {
+		while (leaf != nullptr && slot == leaf->count_) {
+			leaf = leaf->next_;
+			slot = 0;
+		}
+		return leaf == nullptr;
+	};
+
+	std::vector<std::pair<K, V>> pairs;
+	pairs.reserve(size_ + added.size());
+	BTreeMap<K, V> loaded;
+	try {
+		// A run of equal keys keeps its range order through the stable
+		// sort, so its last pair is the one that wins, over the map's pair
+		// as well.
+		for (std::size_t i = 0; i < added.size(); ++i) {
+			if (i + 1 < added.size() && !(added[i].first < added[i + 1].first))
+				continue;
+			for (; !atEnd() && leaf->keys_[slot] < added[i].first; ++slot)
+				pairs.push_back(std::make_pair(std::move(leaf->keys_[slot]),
+					std::move(leaf->values_[slot])));
+			if (!atEnd() && !(added[i].first < leaf->keys_[slot]))
+				++slot;
+			pairs.push_back(std::move(added[i]));
+		}
+		for (; !atEnd(); ++slot)
+			pairs.push_back(std::make_pair(std::move(leaf->keys_[slot]),
+				std::move(leaf->values_[slot])));
+		loaded.build(pairs);
+	} catch (...) {
+		// The pairs have left the leaves, so there is no map to go back to.
+		BTreeMap<K, V> empty;
+		swap(*this, empty);
+		throw;
+	}
+	swap(*this, loaded);
+}
+
+template <typename K, typename V> inline
+void BTreeMap<K, V>::addValue(K key, V value)
+{
+	if (!findOrInsert(key, std::move(value)).second)
+		throw KeyError<K>{key, "BTreeMap"};
+}
+
+template <typename K, typename V> inline
+bool BTreeMap<K, V>::insertOrAssign(K key, V value)
+{
+	std::pair<V&, bool> result = findOrInsert(key, std::move(value));
+	if (!result.second)
+		result.first = std::move(value);
+	return result.second;
+}
+
+template <typename K, typename V> template <typename... Args> inline
+std::pair<V&, bool> BTreeMap<K, V>::tryEmplace(K key, Args&&... args)
+{
+	return findOrInsert(key, std::forward<Args>(args)...);
+}
+
+template <typename K, typename V> template <typename Fn> inline
+V& BTreeMap<K, V>::upsert(K key, Fn fn)
+{
+	V& value = findOrInsert(key).first;
+	fn(value);
+	return value;
+}
+
+template <typename K, typename V> template <typename... Args> inline
+std::pair<V&, bool> BTreeMap<K, V>::findOrInsert(K& key,
+	Args&&... args)
+{
+	if (root_ == nullptr) {
+		Leaf* leaf = new Leaf;
+		leaf->leaf_ = true;
+		leaf->count_ = 0;
+		leaf->next_ = nullptr;
+		root_ = first_ = leaf;
+	}
+
+	Inner* path[MaxHeight];
+	std::size_t slots[MaxHeight];
+	std::size_t depth = 0;
+	Leaf* leaf = descend(key, path, slots, depth);
+	std::size_t index = lowerIndex(leaf, key);
+	if (index < leaf->count_ && !(key < leaf->keys_[index]))
+		return {leaf->values_[index], false};
+
+	V value(std::forward<Args>(args)...);
+
+	if (leaf->count_ == Capacity) {
+		Leaf* right = splitLeaf(leaf);
+		insertIntoParent(path, slots, depth, leaf, right->keys_[0], right);
+		if (index > leaf->count_) {
+			index -= leaf->count_;
+			leaf = right;
+		}
+	}
+
+	for (std::size_t i = leaf->count_; i > index; --i) {
+		leaf->keys_[i] = std::move(leaf->keys_[i - 1]);
+		leaf->values_[i] = std::move(leaf->values_[i - 1]);
+	}
+	leaf->keys_[index] = std::move(key);
+	leaf->values_[index] = std::move(value);
+	++leaf->count_;
+	++size_;
+	return {leaf->values_[index], true};
+}
+
+template <typename K, typename V> inline
+void BTreeMap<K, V>::removeValue(K const& key)
+{
+	if (root_ == nullptr)
+		throw KeyError<K>{key, "BTreeMap"};
+
+	Inner* path[MaxHeight];
+	std::size_t slots[MaxHeight];
+	std::size_t depth = 0;
+	Leaf* leaf = descend(key, path, slots, depth);
+	std::size_t index = lowerIndex(leaf, key);
+	if (index == leaf->count_ || key < leaf->keys_[index])
+		throw KeyError<K>{key, "BTreeMap"};
+
+	// Separators above may still name the removed key; they remain valid
+	// bounds, so they are left alone.
+	for (std::size_t i = index + 1; i < leaf->count_; ++i) {
+		leaf->keys_[i - 1] = std::move(leaf->keys_[i]);
+		leaf->values_[i - 1] = std::move(leaf->values_[i]);
+	}
+	--leaf->count_;
+	--size_;
+	fixLeaf(path, slots, depth, leaf);
+}
+
+template <typename K, typename V> inline
+V& BTreeMap<K, V>::getValue(K const& key) const
+{
+	if (root_ != nullptr) {
+		std::size_t depth = 0;
+		Leaf* leaf = descend(key, nullptr, nullptr, depth);
+		std::size_t index = lowerIndex(leaf, key);
+		if (index < leaf->count_ && !(key < leaf->keys_[index]))
+			return leaf->values_[index];
+	}
+	throw KeyError<K>{key, "BTreeMap"};
+}
+
+template <typename K, typename V> template <typename Q, typename> inline
+V& BTreeMap<K, V>::getValue(Q const& key) const
+{
+	if (root_ != nullptr) {
+		std::size_t depth = 0;
+		Leaf* leaf = descend(key, nullptr, nullptr, depth);
+		std::size_t index = lowerIndex(leaf, key);
+		if (index < leaf->count_ && !(key < leaf->keys_[index]))
+			return leaf->values_[index];
+	}
+	throw KeyError<K>{key, "BTreeMap"};
+}
+
+template <typename K, typename V> inline
+std::size_t BTreeMap<K, V>::size() const
+{
+	return size_;
+}
+
+template <typename K, typename V> inline
+bool BTreeMap<K, V>::isEmpty() const
+{
+	return size_ == 0;
+}
+
+template <typename K, typename V> inline
+bool BTreeMap<K, V>::contains(K const& key) const
+{
+	if (root_ == nullptr)
+		return false;
+	std::size_t depth = 0;
+	Leaf* leaf = descend(key, nullptr, nullptr, depth);
+	std::size_t index = lowerIndex(leaf, key);
+	return index < leaf->count_ && !(key < leaf->keys_[index]);
+}
+
+template <typename K, typename V> template <typename Q, typename> inline
+bool BTreeMap<K, V>::contains(Q const& key) const
+{
+	if (root_ == nullptr)
+		return false;
+	std::size_t depth = 0;
+	Leaf* leaf = descend(key, nullptr, nullptr, depth);
+	std::size_t index = lowerIndex(leaf, key);
+	return index < leaf->count_ && !(key < leaf->keys_[index]);
+}
+
+template <typename K, typename V> inline
+std::size_t BTreeMap<K, V>::height() const
+{
+	std::size_t height = 0;
+	for (Node* node = root_; node != nullptr; ++height) {
+		if (node->leaf_)
+			node = nullptr;
+		else
+			node = static_cast<Inner*>(node)->children_[0];
+	}
+	return height;
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::iterator BTreeMap<K, V>::lowerBound(K const& key)
+{
+	if (root_ == nullptr)
+		return end();
+	std::size_t depth = 0;
+	Leaf* leaf = descend(key, nullptr, nullptr, depth);
+	LeafCursor<V> cursor{leaf, lowerIndex(leaf, key)};
+	return items_view{cursor, cursor, 0}.begin();
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::const_iterator BTreeMap<K, V>::lowerBound(K const& key) const
+{
+	if (root_ == nullptr)
+		return end();
+	std::size_t depth = 0;
+	Leaf const* leaf = descend(key, nullptr, nullptr, depth);
+	LeafCursor<V const> cursor{leaf, lowerIndex(leaf, key)};
+	return const_items_view{cursor, cursor, 0}.begin();
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::items_view BTreeMap<K, V>::range(K lo, K hi)
+{
+	LeafCursor<V> first{nullptr, 0};
+	LeafCursor<V> last{nullptr, 0};
+	std::size_t count = 0;
+	if (root_ != nullptr && lo < hi) {
+		std::size_t depth = 0;
+		Leaf* leaf = descend(lo, nullptr, nullptr, depth);
+		std::size_t index = lowerIndex(leaf, lo);
+		first = LeafCursor<V>{leaf, index};
+
+		// Count whole leaves until the one holding hi.
+		while (leaf != nullptr) {
+			std::size_t stop = lowerIndex(leaf, hi);
+			count += stop - index;
+			if (stop < leaf->count_) {
+				last = LeafCursor<V>{leaf, stop};
+				break;
+			}
+			leaf = leaf->next_;
+			index = 0;
+		}
+	}
+	return items_view{first, last, count};
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::const_items_view
+BTreeMap<K, V>::range(K lo, K hi) const
+{
+	LeafCursor<V const> first{nullptr, 0};
+	LeafCursor<V const> last{nullptr, 0};
+	std::size_t count = 0;
+	if (root_ != nullptr && lo < hi) {
+		std::size_t depth = 0;
+		Leaf const* leaf = descend(lo, nullptr, nullptr, depth);
+		std::size_t index = lowerIndex(leaf, lo);
+		first = LeafCursor<V const>{leaf, index};
+
+		while (leaf != nullptr) {
+			std::size_t stop = lowerIndex(leaf, hi);
+			count += stop - index;
+			if (stop < leaf->count_) {
+				last = LeafCursor<V const>{leaf, stop};
+				break;
+			}
+			leaf = leaf->next_;
+			index = 0;
+		}
+	}
+	return const_items_view{first, last, count};
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::keys_view BTreeMap<K, V>::keys() const
+{
+	return keys_view{{first_, 0}, {nullptr, 0}, size_};
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::values_view BTreeMap<K, V>::values()
+{
+	return values_view{{first_, 0}, {nullptr, 0}, size_};
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::const_values_view BTreeMap<K, V>::values() const
+{
+	return const_values_view{{first_, 0}, {nullptr, 0}, size_};
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::items_view BTreeMap<K, V>::items()
+{
+	return items_view{{first_, 0}, {nullptr, 0}, size_};
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::const_items_view BTreeMap<K, V>::items() const
+{
+	return const_items_view{{first_, 0}, {nullptr, 0}, size_};
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void BTreeMap<K, V>::forEach(Fn fn)
+{
+	for (Leaf* leaf = first_; leaf != nullptr; leaf = leaf->next_)
+		for (std::size_t i = 0; i < leaf->count_; ++i)
+			fn(static_cast<K const&>(leaf->keys_[i]), leaf->values_[i]);
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void BTreeMap<K, V>::forEach(Fn fn) const
+{
+	for (Leaf const* leaf = first_; leaf != nullptr; leaf = leaf->next_)
+		for (std::size_t i = 0; i < leaf->count_; ++i)
+			fn(leaf->keys_[i], leaf->values_[i]);
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::iterator BTreeMap<K, V>::begin()
+{
+	return items().begin();
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::iterator BTreeMap<K, V>::end()
+{
+	return items().end();
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::const_iterator BTreeMap<K, V>::begin() const
+{
+	return items().begin();
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::const_iterator BTreeMap<K, V>::end() const
+{
+	return items().end();
+}
+
+template <typename K, typename V> template <typename Q> inline
+std::size_t BTreeMap<K, V>::lowerIndex(Node const* node, Q const& key)
+{
+	// Counting rather than searching keeps the loop free of early exits, so
+	// it unrolls (and vectorises for arithmetic keys) over the key array.
+	std::size_t index = 0;
+	for (std::size_t i = 0; i < node->count_; ++i)
+		index += node->keys_[i] < key;
+	return index;
+}
+
+template <typename K, typename V> template <typename Q> inline
+std::size_t BTreeMap<K, V>::upperIndex(Node const* node, Q const& key)
+{
+	std::size_t index = 0;
+	for (std::size_t i = 0; i < node->count_; ++i)
+		index += !(key < node->keys_[i]);
+	return index;
+}
+
+template <typename K, typename V> template <typename Q> inline
+typename BTreeMap<K, V>::Leaf* BTreeMap<K, V>::descend(Q const& key,
+	Inner** path, std::size_t* slots, std::size_t& depth) const
+{
+	Node* node = root_;
+	depth = 0;
+	while (!node->leaf_) {
+		Inner* inner = static_cast<Inner*>(node);
+		std::size_t slot = upperIndex(inner, key);
+		if (path != nullptr) {
+			path[depth] = inner;
+			slots[depth] = slot;
+		}
+		++depth;
+		node = inner->children_[slot];
+	}
+	return static_cast<Leaf*>(node);
+}
+
+template <typename K, typename V> inline
+typename BTreeMap<K, V>::Leaf* BTreeMap<K, V>::splitLeaf(Leaf* leaf)
+{
+	Leaf* right = new Leaf;
+	right->leaf_ = true;
+	right->count_ = leaf->count_ - leaf->count_ / 2;
+	std::size_t offset = leaf->count_ / 2;
+	for (std::size_t i = 0; i < right->count_; ++i) {
+		right->keys_[i] = std::move(leaf->keys_[offset + i]);
+		right->values_[i] = std::move(leaf->values_[offset + i]);
+	}
+	leaf->count_ = offset;
+	right->next_ = leaf->next_;
+	leaf->next_ = right;
+	return right;
+}
+
+template <typename K, typename V> inline
+void BTreeMap<K, V>::insertIntoParent(Inner** path, std::size_t* slots,
+	std::size_t depth, Node* left, K separator, Node* right)
+{
+	if (depth == 0) {
+		Inner* root = new Inner;
+		root->leaf_ = false;
+		root->count_ = 1;
+		root->keys_[0] = std::move(separator);
+		root->children_[0] = left;
+		root->children_[1] = right;
+		root_ = root;
+		return;
+	}
+
+	Inner* parent = path[depth - 1];
+	std::size_t slot = slots[depth - 1];
+	if (parent->count_ < Capacity) {
+		for (std::size_t i = parent->count_; i > slot; --i) {
+			parent->keys_[i] = std::move(parent->keys_[i - 1]);
+			parent->children_[i + 1] = parent->children_[i];
+		}
+		parent->keys_[slot] = std::move(separator);
+		parent->children_[slot + 1] = right;
+		++parent->count_;
+		return;
+	}
+
+	// Lay the overfull node out in scratch space, then cut it in two around
+	// the middle key, which moves up a level.
+	K keys[Capacity + 1];
+	Node* children[Capacity + 2];
+	for (std::size_t i = 0, j = 0; i <= Capacity; ++i)
+		keys[i] = i == slot ? separator : std::move(parent->keys_[j++]);
+	for (std::size_t i = 0, j = 0; i <= Capacity + 1; ++i)
+		children[i] = i == slot + 1 ? right : parent->children_[j++];
+
+	std::size_t middle = (Capacity + 1) / 2;
+	Inner* sibling = new Inner;
+	sibling->leaf_ = false;
+	sibling->count_ = Capacity - middle;
+	parent->count_ = middle;
+	for (std::size_t i = 0; i < middle; ++i) {
+		parent->keys_[i] = std::move(keys[i]);
+		parent->children_[i] = children[i];
+	}
+	parent->children_[middle] = children[middle];
+	for (std::size_t i = 0; i < sibling->count_; ++i) {
+		sibling->keys_[i] = std::move(keys[middle + 1 + i]);
+		sibling->children_[i] = children[middle + 1 + i];
+	}
+	sibling->children_[sibling->count_] = children[Capacity + 1];
+
+	insertIntoParent(path, slots, depth - 1, parent, std::move(keys[middle]),
+		sibling);
+}
+
+template <typename K, typename V> inline
+void BTreeMap<K, V>::fixLeaf(Inner** path, std::size_t* slots,
+	std::size_t depth, Leaf* leaf)
+{
+	if (depth == 0) {
+		if (leaf->count_ == 0) {
+			delete leaf;
+			root_ = first_ = nullptr;
+		}
+		return;
+	}
+	if (leaf->count_ >= MinCount)
+		return;
+
+	Inner* parent = path[depth - 1];
+	std::size_t slot = slots[depth - 1];
+	Leaf* left = slot > 0 ?
+		static_cast<Leaf*>(parent->children_[slot - 1]) : nullptr;
+	Leaf* right = slot < parent->count_ ?
+		static_cast<Leaf*>(parent->children_[slot + 1]) : nullptr;
+
+	if (left != nullptr && left->count_ > MinCount) {
+		for (std::size_t i = leaf->count_; i > 0; --i) {
+			leaf->keys_[i] = std::move(leaf->keys_[i - 1]);
+			leaf->values_[i] = std::move(leaf->values_[i - 1]);
+		}
+		--left->count_;
+		leaf->keys_[0] = std::move(left->keys_[left->count_]);
+		leaf->values_[0] = std::move(left->values_[left->count_]);
+		++leaf->count_;
+		parent->keys_[slot - 1] = leaf->keys_[0];
+		return;
+	}
+	if (right != nullptr && right->count_ > MinCount) {
+		leaf->keys_[leaf->count_] = std::move(right->keys_[0]);
+		leaf->values_[leaf->count_] = std::move(right->values_[0]);
+		++leaf->count_;
+		for (std::size_t i = 1; i < right->count_; ++i) {
+			right->keys_[i - 1] = std::move(right->keys_[i]);
+			right->values_[i - 1] = std::move(right->values_[i]);
+		}
+		--right->count_;
+		parent->keys_[slot] = right->keys_[0];
+		return;
+	}
+
+	// Neither sibling can spare a pair, so merge with one of them.
+	std::size_t removed = slot;
+	if (left != nullptr) {
+		right = leaf;
+		leaf = left;
+		removed = slot - 1;
+	}
+	for (std::size_t i = 0; i < right->count_; ++i) {
+		leaf->keys_[leaf->count_ + i] = std::move(right->keys_[i]);
+		leaf->values_[leaf->count_ + i] = std::move(right->values_[i]);
+	}
+	leaf->count_ += right->count_;
+	leaf->next_ = right->next_;
+	delete right;
+	removeChild(parent, removed);
+	fixInner(path, slots, depth - 1);
+}
+
+template <typename K, typename V> inline
+void BTreeMap<K, V>::fixInner(Inner** path, std::size_t* slots,
+	std::size_t depth)
+{
+	Inner* node = path[depth];
+	if (depth == 0) {
+		if (node->count_ == 0) {
+			root_ = node->children_[0];
+			delete node;
+		}
+		return;
+	}
+	if (node->count_ >= MinCount)
+		return;
+
+	Inner* parent = path[depth - 1];
+	std::size_t slot = slots[depth - 1];
+	Inner* left = slot > 0 ?
+		static_cast<Inner*>(parent->children_[slot - 1]) : nullptr;
+	Inner* right = slot < parent->count_ ?
+		static_cast<Inner*>(parent->children_[slot + 1]) : nullptr;
+
+	if (left != nullptr && left->count_ > MinCount) {
+		// Rotate right through the parent's separator.
+		node->children_[node->count_ + 1] = node->children_[node->count_];
+		for (std::size_t i = node->count_; i > 0; --i) {
+			node->keys_[i] = std::move(node->keys_[i - 1]);
+			node->children_[i] = node->children_[i - 1];
+		}
+		node->keys_[0] = std::move(parent->keys_[slot - 1]);
+		node->children_[0] = left->children_[left->count_];
+		++node->count_;
+		--left->count_;
+		parent->keys_[slot - 1] = std::move(left->keys_[left->count_]);
+		return;
+	}
+	if (right != nullptr && right->count_ > MinCount) {
+		// Rotate left through the parent's separator.
+		node->keys_[node->count_] = std::move(parent->keys_[slot]);
+		node->children_[node->count_ + 1] = right->children_[0];
+		++node->count_;
+		parent->keys_[slot] = std::move(right->keys_[0]);
+		for (std::size_t i = 1; i < right->count_; ++i) {
+			right->keys_[i - 1] = std::move(right->keys_[i]);
+			right->children_[i - 1] = right->children_[i];
+		}
+		right->children_[right->count_ - 1] = right->children_[right->count_];
+		--right->count_;
+		return;
+	}
+
+	std::size_t removed = slot;
+	if (left != nullptr) {
+		right = node;
+		node = left;
+		removed = slot - 1;
+	}
+	node->keys_[node->count_] = std::move(parent->keys_[removed]);
+	for (std::size_t i = 0; i < right->count_; ++i) {
+		node->keys_[node->count_ + 1 + i] = std::move(right->keys_[i]);
+		node->children_[node->count_ + 1 + i] = right->children_[i];
+	}
+	node->children_[node->count_ + 1 + right->count_] =
+		right->children_[right->count_];
+	node->count_ += 1 + right->count_;
+	delete right;
+	removeChild(parent, removed);
+	fixInner(path, slots, depth - 1);
+}
+
+template <typename K, typename V> inline
+void BTreeMap<K, V>::removeChild(Inner* node, std::size_t index)
+{
+	for (std::size_t i = index + 1; i < node->count_; ++i) {
+		node->keys_[i - 1] = std::move(node->keys_[i]);
+		node->children_[i] = node->children_[i + 1];
+	}
+	--node->count_;
+}
+
+template <typename K, typename V> inline
+void BTreeMap<K, V>::build(std::vector<std::pair<K, V>>& pairs)
+{
+	if (pairs.empty())
+		return;
+
+	// Spread the pairs evenly so that every leaf is at least half full.
+	std::size_t leaves = (pairs.size() + Capacity - 1) / Capacity;
+	std::vector<Node*> level;
+	std::vector<K> lowest;
+	level.reserve(leaves);
+	lowest.reserve(leaves);
+	Leaf* previous = nullptr;
+	for (std::size_t l = 0, next = 0; l < leaves; ++l) {
+		Leaf* leaf = new Leaf;
+		leaf->leaf_ = true;
+		leaf->count_ = pairs.size() / leaves + (l < pairs.size() % leaves);
+		leaf->next_ = nullptr;
+		for (std::size_t i = 0; i < leaf->count_; ++i, ++next) {
+			leaf->keys_[i] = std::move(pairs[next].first);
+			leaf->values_[i] = std::move(pairs[next].second);
+		}
+		if (previous == nullptr)
+			first_ = leaf;
+		else
+			previous->next_ = leaf;
+		previous = leaf;
+		level.push_back(leaf);
+		lowest.push_back(leaf->keys_[0]);
+	}
+
+	// Each inner level is the level below, chunked evenly.
+	while (level.size() > 1) {
+		std::size_t groups = (level.size() + Capacity) / (Capacity + 1);
+		std::vector<Node*> parents;
+		std::vector<K> parentLowest;
+		parents.reserve(groups);
+		parentLowest.reserve(groups);
+		for (std::size_t g = 0, next = 0; g < groups; ++g) {
+			std::size_t children =
+				level.size() / groups + (g < level.size() % groups);
+			Inner* inner = new Inner;
+			inner->leaf_ = false;
+			inner->count_ = children - 1;
+			for (std::size_t i = 0; i < children; ++i) {
+				inner->children_[i] = level[next + i];
+				if (i > 0)
+					inner->keys_[i - 1] = std::move(lowest[next + i]);
+			}
+			parents.push_back(inner);
+			parentLowest.push_back(std::move(lowest[next]));
+			next += children;
+		}
+		level.swap(parents);
+		lowest.swap(parentLowest);
+	}
+
+	root_ = level[0];
+	size_ = pairs.size();
+}
+
+template <typename K, typename V> inline
+void BTreeMap<K, V>::destroy(Node* node)
+{
+	if (node == nullptr)
+		return;
+	if (node->leaf_) {
+		delete static_cast<Leaf*>(node);
+		return;
+	}
+	Inner* inner = static_cast<Inner*>(node);
+	for (std::size_t i = 0; i <= inner->count_; ++i)
+		destroy(inner->children_[i]);
+	delete inner;
+}
+
+template <typename K, typename V> template <typename ValueT> inline
+BTreeMap<K, V>::LeafCursor<ValueT>::LeafCursor(LeafT* leaf, std::size_t index) :
+	leaf_{leaf}, index_{index}
+{
+	if (leaf_ != nullptr && index_ == leaf_->count_) {
+		leaf_ = leaf_->next_;
+		index_ = 0;
+	}
+}
+
+template <typename K, typename V> template <typename ValueT> inline
+typename BTreeMap<K, V>::template LeafCursor<ValueT>&
+BTreeMap<K, V>::LeafCursor<ValueT>::operator++()
+{
+	if (++index_ == leaf_->count_) {
+		leaf_ = leaf_->next_;
+		index_ = 0;
+	}
+	return *this;
+}
+
+template <typename K, typename V> template <typename ValueT> inline
+typename BTreeMap<K, V>::template SlotRef<ValueT>
+BTreeMap<K, V>::LeafCursor<ValueT>::operator*() const
+{
+	return SlotRef<ValueT>{leaf_->keys_[index_], leaf_->values_[index_]};
+}
+
+template <typename K, typename V> template <typename ValueT> inline
+bool BTreeMap<K, V>::LeafCursor<ValueT>::operator==(
+	const LeafCursor& rhs) const
+{
+	return leaf_ == rhs.leaf_ && index_ == rhs.index_;
+}
+
+#endif
@@ -0,0 +1,265 @@
+/**
+ * \file _concurrenthashmap.hpp
+ * \brief Private implementation file of the sharded concurrent hash map.
+ */
+
+#ifndef _CONCURRENT_HASH_MAP_HPP
+#define _CONCURRENT_HASH_MAP_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+#include "map.hpp"
+#include "hashmap.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::uint32_t ConcurrentHashMap<K, V, Hash, Eq>::SharedSpinLock::Writer;
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::uint32_t
+ConcurrentHashMap<K, V, Hash, Eq>::SharedSpinLock::WriterWaiting;
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::uint32_t ConcurrentHashMap<K, V, Hash, Eq>::SharedSpinLock::Reader;
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+ConcurrentHashMap<K, V, Hash, Eq>::ConcurrentHashMap(std::size_t shardCount) :
+	shards_{nullptr},
+	shardMask_{0},
+	size_{0},
+	hash_{}
+{
+	std::size_t count = 1;
+	while (count < shardCount)
+		count <<= 1;
+	shards_ = new Shard[count];
+	shardMask_ = count - 1;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+ConcurrentHashMap<K, V, Hash, Eq>::~ConcurrentHashMap()
+{
+	delete[] shards_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void ConcurrentHashMap<K, V, Hash, Eq>::addValue(K key, V value)
+{
+	Shard& shard = shardFor(key);
+	shard.lock_.lock();
+	try {
+		shard.map_.addValue(std::move(key), std::move(value));
+	} catch (...) {
+		shard.lock_.unlock();
+		throw;
+	}
+	size_.fetch_add(1, std::memory_order_relaxed);
+	shard.lock_.unlock();
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void ConcurrentHashMap<K, V, Hash, Eq>::removeValue(K const& key)
+{
+	Shard& shard = shardFor(key);
+	shard.lock_.lock();
+	try {
+		shard.map_.removeValue(key);
+	} catch (...) {
+		shard.lock_.unlock();
+		throw;
+	}
+	size_.fetch_sub(1, std::memory_order_relaxed);
+	shard.lock_.unlock();
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V& ConcurrentHashMap<K, V, Hash, Eq>::getValue(K const& key) const
+{
+	Shard& shard = shardFor(key);
+	shard.lock_.lockShared();
+	V* value = shard.map_.find(key);
+	shard.lock_.unlockShared();
+	if (value == nullptr)
+		throw KeyError<K>{key, "ConcurrentHashMap"};
+	return *value;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool ConcurrentHashMap<K, V, Hash, Eq>::find(K const& key, V& value) const
+{
+	Shard& shard = shardFor(key);
+	shard.lock_.lockShared();
+	V* found = shard.map_.find(key);
+	bool present = found != nullptr;
+	if (present)
+		value = *found;
+	shard.lock_.unlockShared();
+	return present;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool ConcurrentHashMap<K, V, Hash, Eq>::insertOrAssign(K key, V value)
+{
+	Shard& shard = shardFor(key);
+	shard.lock_.lock();
+	bool added;
+	try {
+		added = shard.map_.insertOrAssign(std::move(key), std::move(value));
+	} catch (...) {
+		shard.lock_.unlock();
+		throw;
+	}
+	if (added)
+		size_.fetch_add(1, std::memory_order_relaxed);
+	shard.lock_.unlock();
+	return added;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Fn> inline
+V ConcurrentHashMap<K, V, Hash, Eq>::computeIfAbsent(K key, Fn fn)
+{
+	Shard& shard = shardFor(key);
+
+	// Most calls find the key, so try under the read lock first.
+	shard.lock_.lockShared();
+	V* found = shard.map_.find(key);
+	if (found != nullptr) {
+		V value = *found;
+		shard.lock_.unlockShared();
+		return value;
+	}
+	shard.lock_.unlockShared();
+
+	// fn may be slow, so it runs with no lock held; another writer may add
+	// the key meanwhile, and then its value wins.
+	V computed = fn(key);
+	shard.lock_.lock();
+	try {
+		std::pair<V&, bool> result =
+			shard.map_.tryEmplace(std::move(key), std::move(computed));
+		if (result.second)
+			size_.fetch_add(1, std::memory_order_relaxed);
+		V value = result.first;
+		shard.lock_.unlock();
+		return value;
+	} catch (...) {
+		shard.lock_.unlock();
+		throw;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t ConcurrentHashMap<K, V, Hash, Eq>::size() const
+{
+	return size_.load(std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool ConcurrentHashMap<K, V, Hash, Eq>::isEmpty() const
+{
+	return size() == 0;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool ConcurrentHashMap<K, V, Hash, Eq>::contains(K const& key) const
+{
+	Shard& shard = shardFor(key);
+	shard.lock_.lockShared();
+	bool present = shard.map_.find(key) != nullptr;
+	shard.lock_.unlockShared();
+	return present;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Fn> inline
+void ConcurrentHashMap<K, V, Hash, Eq>::forEach(Fn fn) const
+{
+	for (std::size_t i = 0; i <= shardMask_; ++i) {
+		Shard const& shard = shards_[i];
+		shard.lock_.lockShared();
+		try {
+			shard.map_.forEach(fn);
+		} catch (...) {
+			shard.lock_.unlockShared();
+			throw;
+		}
+		shard.lock_.unlockShared();
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t ConcurrentHashMap<K, V, Hash, Eq>::shardCount() const
+{
+	return shardMask_ + 1;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename ConcurrentHashMap<K, V, Hash, Eq>::Shard&
+ConcurrentHashMap<K, V, Hash, Eq>::shardFor(K const& key) const
+{
+	// HashMap places keys using a Fibonacci multiply of the same hash, so
+	// the shard is picked with a different multiplier; otherwise every key
+	// in a shard would share the bits that choose its home slot.
+	std::uint64_t hash = static_cast<std::uint64_t>(hash_(key));
+	hash *= 0xC2B2AE3D27D4EB4Full;
+	return shards_[static_cast<std::size_t>(hash >> 32) & shardMask_];
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+ConcurrentHashMap<K, V, Hash, Eq>::SharedSpinLock::SharedSpinLock() :
+	state_{0}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void ConcurrentHashMap<K, V, Hash, Eq>::SharedSpinLock::lockShared()
+{
+	for (int spin = 1; ; ++spin) {
+		std::uint32_t state = state_.load(std::memory_order_relaxed);
+		if ((state & (Writer | WriterWaiting)) == 0 &&
+				state_.compare_exchange_weak(state, state + Reader,
+					std::memory_order_acquire, std::memory_order_relaxed))
+			return;
+		if (spin % 64 == 0)
+			std::this_thread::yield();
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void ConcurrentHashMap<K, V, Hash, Eq>::SharedSpinLock::unlockShared()
+{
+	state_.fetch_sub(Reader, std::memory_order_release);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void ConcurrentHashMap<K, V, Hash, Eq>::SharedSpinLock::lock()
+{
+	for (int spin = 1; ; ++spin) {
+		std::uint32_t state = state_.load(std::memory_order_relaxed);
+		if ((state & ~WriterWaiting) == 0) {
+			// Clearing WriterWaiting here is harmless: any other waiting
+			// writer sets it again on its next attempt.
+			if (state_.compare_exchange_weak(state, Writer,
+					std::memory_order_acquire, std::memory_order_relaxed))
+				return;
+		} else if ((state & WriterWaiting) == 0) {
+			state_.fetch_or(WriterWaiting, std::memory_order_relaxed);
+		}
+		if (spin % 64 == 0)
+			std::this_thread::yield();
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void ConcurrentHashMap<K, V, Hash, Eq>::SharedSpinLock::unlock()
+{
+	state_.fetch_and(~Writer, std::memory_order_release);
+}
+
+#endif
@@ -166,6 +166,8 @@ void Deque<T>::remove()
 	}
 	delete head_;
 	head_ = newHead;
+	if (head_ == nullptr)
+		tail_ = nullptr;
 	--numElements_;
 }
 
@@ -175,6 +177,16 @@ void Deque<T>::remove(std::size_t n)
 	if (n >= numElements_) 
 		throw IndexOutOfBoundsException(n, "Deque");
 
+	// The ends have no neighbour on one side.
+	if (n == 0) {
+		remove();
+		return;
+	}
+	if (n == numElements_ - 1) {
+		removeTail();
+		return;
+	}
+
 	ListNode* toRemove = getListNode(n);
 	ListNode* prev = toRemove->previous_;
 	ListNode* after = toRemove->next_;
@@ -185,6 +197,22 @@ void Deque<T>::remove(std::size_t n)
 	delete toRemove;
 }
 
+template <typename T> inline
+void Deque<T>::removeTail()
+{
+	if (numElements_ == 0)
+		throw IndexOutOfBoundsException(0, "Deque");
+
+	ListNode* newTail = tail_->previous_;
+	if (newTail != nullptr)
+		newTail->next_ = nullptr;
+	else
+		head_ = nullptr;
+	delete tail_;
+	tail_ = newTail;
+	--numElements_;
+}
+
 template <typename T> inline
 T Deque<T>::pop()
 {
@@ -0,0 +1,213 @@
+/**
+ * \file _frozenmap.hpp
+ * \brief Private implementation file of the compile-time perfect hash map.
+ */
+
+#ifndef _FROZEN_MAP_HPP
+#define _FROZEN_MAP_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+#include "mapviews.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+const std::uint64_t FrozenMap<K, V, N, Hash, Eq>::MaxAttempts;
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+constexpr FrozenMap<K, V, N, Hash, Eq>::FrozenMap(
+	std::pair<K, V> const (&pairs)[N]) :
+		slots_{},
+		seeds_{},
+		hash_{},
+		equal_{}
+{
+	build(pairs);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+constexpr FrozenMap<K, V, N, Hash, Eq>::FrozenMap(
+	std::initializer_list<std::pair<K, V>> pairs) :
+		slots_{},
+		seeds_{},
+		hash_{},
+		equal_{}
+{
+	if (pairs.size() != N)
+		throw IndexOutOfBoundsException(pairs.size(), "FrozenMap");
+	build(pairs.begin());
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+constexpr V const* FrozenMap<K, V, N, Hash, Eq>::find(K const& key) const
+{
+	std::uint64_t hash = mix(hash_(key));
+	Slot const& slot = slots_[slotOf(hash, seeds_[bucketOf(hash)])];
+	return equal_(slot.key_, key) ? &slot.value_ : nullptr;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+constexpr V const& FrozenMap<K, V, N, Hash, Eq>::getValue(K const& key) const
+{
+	V const* value = find(key);
+	if (value == nullptr)
+		throw KeyError<K>{key, "FrozenMap"};
+	return *value;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+constexpr bool FrozenMap<K, V, N, Hash, Eq>::contains(K const& key) const
+{
+	return find(key) != nullptr;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+constexpr std::size_t FrozenMap<K, V, N, Hash, Eq>::size() const
+{
+	return N;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+constexpr bool FrozenMap<K, V, N, Hash, Eq>::isEmpty() const
+{
+	return false;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline typename FrozenMap<K, V, N, Hash, Eq>::keys_view
+FrozenMap<K, V, N, Hash, Eq>::keys() const
+{
+	return keys_view{slots_, slots_ + N, N};
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline typename FrozenMap<K, V, N, Hash, Eq>::values_view
+FrozenMap<K, V, N, Hash, Eq>::values() const
+{
+	return values_view{slots_, slots_ + N, N};
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline typename FrozenMap<K, V, N, Hash, Eq>::items_view
+FrozenMap<K, V, N, Hash, Eq>::items() const
+{
+	return items_view{slots_, slots_ + N, N};
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename Fn> inline
+void FrozenMap<K, V, N, Hash, Eq>::forEach(Fn fn) const
+{
+	for (Slot const& slot : slots_)
+		fn(slot.key_, slot.value_);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+constexpr std::uint64_t FrozenMap<K, V, N, Hash, Eq>::mix(std::uint64_t hash)
+{
+	hash ^= hash >> 32;
+	hash *= 0xD6E8FEB86659FD93ull;
+	hash ^= hash >> 32;
+	hash *= 0xD6E8FEB86659FD93ull;
+	return hash ^ (hash >> 32);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+constexpr std::size_t FrozenMap<K, V, N, Hash, Eq>::bucketOf(
+	std::uint64_t hash)
+{
+	return static_cast<std::size_t>((hash >> 32) % N);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+constexpr std::size_t FrozenMap<K, V, N, Hash, Eq>::slotOf(
+	std::uint64_t hash, std::uint64_t seed)
+{
+	return static_cast<std::size_t>(mix(hash ^ seed) % N);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+constexpr void FrozenMap<K, V, N, Hash, Eq>::build(
+	std::pair<K, V> const* pairs)
+{
+	// Counting sort of the pairs by bucket: bucket b's pairs end up in
+	// members[start[b], start[b + 1]).
+	std::uint64_t hashes[N] = {};
+	std::size_t start[N + 1] = {};
+	for (std::size_t i = 0; i < N; ++i) {
+		hashes[i] = mix(hash_(pairs[i].first));
+		++start[bucketOf(hashes[i]) + 1];
+	}
+	std::size_t largest = 0;
+	for (std::size_t b = 0; b < N; ++b) {
+		largest = start[b + 1] > largest ? start[b + 1] : largest;
+		start[b + 1] += start[b];
+	}
+	std::size_t members[N] = {};
+	std::size_t filled[N] = {};
+	for (std::size_t i = 0; i < N; ++i) {
+		std::size_t bucket = bucketOf(hashes[i]);
+		members[start[bucket] + filled[bucket]++] = i;
+	}
+
+	// Big buckets are the hardest to place, so they go while the table is
+	// still empty.
+	bool taken[N] = {};
+	for (std::size_t size = largest; size > 0; --size) {
+		for (std::size_t b = 0; b < N; ++b) {
+			std::size_t first = start[b];
+			if (start[b + 1] - first != size)
+				continue;
+
+			for (std::size_t i = first; i < first + size; ++i)
+				for (std::size_t j = first; j < i; ++j)
+					if (equal_(pairs[members[i]].first,
+							pairs[members[j]].first))
+						throw KeyError<K>{pairs[members[i]].first,
+							"FrozenMap"};
+
+			for (std::uint64_t attempt = 0; ; ++attempt) {
+				// Only keys whose 64 bit hashes are equal never separate.
+				if (attempt == MaxAttempts)
+					throw KeyError<K>{pairs[members[first]].first,
+						"FrozenMap"};
+
+				std::uint64_t seed = attempt * 0x9E3779B97F4A7C15ull;
+				std::size_t placed = 0;
+				while (placed < size) {
+					std::size_t slot =
+						slotOf(hashes[members[first + placed]], seed);
+					if (taken[slot])
+						break;
+					taken[slot] = true;
+					++placed;
+				}
+				if (placed == size) {
+					seeds_[b] = seed;
+					break;
+				}
+				for (std::size_t i = first; i < first + placed; ++i)
+					taken[slotOf(hashes[members[i]], seed)] = false;
+			}
+
+			for (std::size_t i = first; i < first + size; ++i) {
+				Slot& slot = slots_[slotOf(hashes[members[i]], seeds_[b])];
+				slot.key_ = pairs[members[i]].first;
+				slot.value_ = pairs[members[i]].second;
+			}
+		}
+	}
+}
+
+template <typename K, typename V, std::size_t N>
+constexpr FrozenMap<K, V, N> makeFrozenMap(
+	std::pair<K, V> const (&pairs)[N])
+{
+	return FrozenMap<K, V, N>{pairs};
+}
+
+#endif
@@ -0,0 +1,767 @@
+/**
+ * \file _hashmap.hpp
+ * \brief Private implementation file of the open-addressing hash map.
+ */
+
+#ifndef _HASH_MAP_HPP
+#define _HASH_MAP_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <utility>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+#include "../exceptions.hpp"
+
+
+inline std::size_t StringHash::operator()(std::string const& key) const
+{
+	return hashBytes(key.data(), key.size());
+}
+
+inline std::size_t StringHash::operator()(char const* key) const
+{
+	return hashBytes(key, std::strlen(key));
+}
+
+inline std::size_t StringHash::hashBytes(char const* data, std::size_t size)
+{
+	const std::uint64_t multiplier = 0xFF51AFD7ED558CCDull;
+	std::uint64_t hash = 0x9E3779B97F4A7C15ull ^ size;
+	for (; size >= 8; data += 8, size -= 8) {
+		std::uint64_t word;
+		std::memcpy(&word, data, sizeof(word));
+		hash = (hash ^ word) * multiplier;
+		hash ^= hash >> 32;
+	}
+	std::uint64_t tail = 0;
+	std::memcpy(&tail, data, size);
+	hash = (hash ^ tail) * multiplier;
+	return static_cast<std::size_t>(hash ^ (hash >> 29));
+}
+
+inline bool StringEqual::operator()(std::string const& lhs,
+	std::string const& rhs) const
+{
+	return lhs == rhs;
+}
+
+inline bool StringEqual::operator()(std::string const& lhs,
+	char const* rhs) const
+{
+	return lhs.compare(rhs) == 0;
+}
+
+inline bool StringEqual::operator()(char const* lhs,
+	std::string const& rhs) const
+{
+	return rhs.compare(lhs) == 0;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::size_t HashMap<K, V, Hash, Eq>::GroupWidth;
+
+template <typename K, typename V, typename Hash, typename Eq>
+const unsigned char HashMap<K, V, Hash, Eq>::Empty;
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::size_t HashMap<K, V, Hash, Eq>::NotFound;
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+HashMap<K, V, Hash, Eq>::HashMap() :
+	control_{nullptr},
+	slots_{nullptr},
+	capacity_{0},
+	size_{0},
+	growthLimit_{0},
+	maxLoadFactor_{0.875f},
+	hash_{},
+	equal_{}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+HashMap<K, V, Hash, Eq>::HashMap(std::size_t count) : HashMap()
+{
+	reserve(count);
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename InputIt> inline
+HashMap<K, V, Hash, Eq>::HashMap(InputIt first, InputIt last) : HashMap()
+{
+	insertBatch(first, last);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+HashMap<K, V, Hash, Eq>::HashMap(HashMap<K, V, Hash, Eq> const& orig) :
+	HashMap()
+{
+	maxLoadFactor_ = orig.maxLoadFactor_;
+	hash_ = orig.hash_;
+	equal_ = orig.equal_;
+	if (orig.capacity_ == 0)
+		return;
+
+	rehash(orig.capacity_);
+	std::memcpy(control_, orig.control_, capacity_ + GroupWidth);
+	for (std::size_t i = 0; i < capacity_; ++i) {
+		if (control_[i] == Empty)
+			continue;
+		try {
+			new (&slots_[i]) Slot(orig.slots_[i]);
+		} catch (...) {
+			// Only the slots before i were built; forget the rest.
+			for (std::size_t j = i; j < capacity_; ++j)
+				control_[j] = Empty;
+			throw;
+		}
+		++size_;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+HashMap<K, V, Hash, Eq>::HashMap(HashMap<K, V, Hash, Eq>&& other) :
+	HashMap()
+{
+	swap(*this, other);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+HashMap<K, V, Hash, Eq>& HashMap<K, V, Hash, Eq>::operator=(
+	HashMap<K, V, Hash, Eq> rhs)
+{
+	swap(*this, rhs);
+	return *this;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void swap(HashMap<K, V, Hash, Eq>& lhs, HashMap<K, V, Hash, Eq>& rhs)
+{
+	std::swap(lhs.control_, rhs.control_);
+	std::swap(lhs.slots_, rhs.slots_);
+	std::swap(lhs.capacity_, rhs.capacity_);
+	std::swap(lhs.size_, rhs.size_);
+	std::swap(lhs.growthLimit_, rhs.growthLimit_);
+	std::swap(lhs.maxLoadFactor_, rhs.maxLoadFactor_);
+	std::swap(lhs.hash_, rhs.hash_);
+	std::swap(lhs.equal_, rhs.equal_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+HashMap<K, V, Hash, Eq>::~HashMap()
+{
+	for (std::size_t i = 0; i < capacity_; ++i)
+		if (control_[i] != Empty)
+			slots_[i].~Slot();
+	::operator delete(slots_);
+	delete [] control_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void HashMap<K, V, Hash, Eq>::addValue(K key, V value)
+{
+	if (!findOrInsert(key, std::move(value)).second)
+		throw KeyError<K>{key, "HashMap"};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool HashMap<K, V, Hash, Eq>::insertOrAssign(K key, V value)
+{
+	std::pair<V&, bool> result = findOrInsert(key, std::move(value));
+	if (!result.second)
+		result.first = std::move(value);
+	return result.second;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename... Args> inline
+std::pair<V&, bool> HashMap<K, V, Hash, Eq>::tryEmplace(K key, Args&&... args)
+{
+	return findOrInsert(key, std::forward<Args>(args)...);
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Fn> inline
+V& HashMap<K, V, Hash, Eq>::upsert(K key, Fn fn)
+{
+	V& value = findOrInsert(key).first;
+	fn(value);
+	return value;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename... Args> inline
+std::pair<V&, bool> HashMap<K, V, Hash, Eq>::findOrInsert(K& key,
+	Args&&... args)
+{
+	std::size_t hash = hashOf(key);
+	std::size_t empty;
+	std::size_t index = findIndex(key, hash, empty);
+	if (index != NotFound)
+		return {slots_[index].value_, false};
+
+	// The miss found the slot to use; only a rehash sends it looking again.
+	Slot& slot = insertAbsent(std::move(key), V(std::forward<Args>(args)...),
+		hash, empty);
+	return {slot.value_, true};
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename InputIt> inline
+void HashMap<K, V, Hash, Eq>::insertBatch(InputIt first, InputIt last)
+{
+	reserve(size_ + batchSize(first, last));
+	for (; first != last; ++first)
+		insertOrAssign(first->first, first->second);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void HashMap<K, V, Hash, Eq>::removeValue(K const& key)
+{
+	std::size_t index = findIndex(key, hashOf(key));
+	if (index == NotFound)
+		throw KeyError<K>{key, "HashMap"};
+	eraseIndex(index);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V& HashMap<K, V, Hash, Eq>::getValue(K const& key) const
+{
+	std::size_t index = findIndex(key, hashOf(key));
+	if (index == NotFound)
+		throw KeyError<K>{key, "HashMap"};
+	return slots_[index].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q, typename> inline
+V& HashMap<K, V, Hash, Eq>::getValue(Q const& key) const
+{
+	std::size_t index = findIndex(key, hashOf(key));
+	if (index == NotFound)
+		throw KeyError<K>{key, "HashMap"};
+	return slots_[index].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t HashMap<K, V, Hash, Eq>::size() const
+{
+	return size_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool HashMap<K, V, Hash, Eq>::isEmpty() const
+{
+	return size_ == 0;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool HashMap<K, V, Hash, Eq>::contains(K const& key) const
+{
+	return findIndex(key, hashOf(key)) != NotFound;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q, typename> inline
+bool HashMap<K, V, Hash, Eq>::contains(Q const& key) const
+{
+	return findIndex(key, hashOf(key)) != NotFound;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V* HashMap<K, V, Hash, Eq>::find(K const& key)
+{
+	std::size_t index = findIndex(key, hashOf(key));
+	return index == NotFound ? nullptr : &slots_[index].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V const* HashMap<K, V, Hash, Eq>::find(K const& key) const
+{
+	std::size_t index = findIndex(key, hashOf(key));
+	return index == NotFound ? nullptr : &slots_[index].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q, typename> inline
+V* HashMap<K, V, Hash, Eq>::find(Q const& key)
+{
+	std::size_t index = findIndex(key, hashOf(key));
+	return index == NotFound ? nullptr : &slots_[index].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q, typename> inline
+V const* HashMap<K, V, Hash, Eq>::find(Q const& key) const
+{
+	std::size_t index = findIndex(key, hashOf(key));
+	return index == NotFound ? nullptr : &slots_[index].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::keys_view
+HashMap<K, V, Hash, Eq>::keys() const
+{
+	return keys_view{{this, nextFull(0)}, {this, capacity_}, size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::values_view
+HashMap<K, V, Hash, Eq>::values()
+{
+	return values_view{{this, nextFull(0)}, {this, capacity_}, size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::const_values_view
+HashMap<K, V, Hash, Eq>::values() const
+{
+	return const_values_view{{this, nextFull(0)}, {this, capacity_}, size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::items_view
+HashMap<K, V, Hash, Eq>::items()
+{
+	return items_view{{this, nextFull(0)}, {this, capacity_}, size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::const_items_view
+HashMap<K, V, Hash, Eq>::items() const
+{
+	return const_items_view{{this, nextFull(0)}, {this, capacity_}, size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Fn> inline
+void HashMap<K, V, Hash, Eq>::forEach(Fn fn)
+{
+	for (std::size_t i = 0; i < capacity_; ++i)
+		if (control_[i] != Empty)
+			fn(static_cast<K const&>(slots_[i].key_), slots_[i].value_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Fn> inline
+void HashMap<K, V, Hash, Eq>::forEach(Fn fn) const
+{
+	for (std::size_t i = 0; i < capacity_; ++i)
+		if (control_[i] != Empty)
+			fn(static_cast<K const&>(slots_[i].key_),
+				static_cast<V const&>(slots_[i].value_));
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void HashMap<K, V, Hash, Eq>::reserve(std::size_t count)
+{
+	std::size_t wanted = capacityFor(count);
+	if (wanted > capacity_)
+		rehash(wanted);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t HashMap<K, V, Hash, Eq>::capacity() const
+{
+	return capacity_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+float HashMap<K, V, Hash, Eq>::loadFactor() const
+{
+	if (capacity_ == 0)
+		return 0.0f;
+	return static_cast<float>(size_) / static_cast<float>(capacity_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+float HashMap<K, V, Hash, Eq>::maxLoadFactor() const
+{
+	return maxLoadFactor_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void HashMap<K, V, Hash, Eq>::maxLoadFactor(float loadFactor)
+{
+	if (loadFactor < 0.25f)
+		loadFactor = 0.25f;
+	if (loadFactor > 0.9375f)
+		loadFactor = 0.9375f;
+	maxLoadFactor_ = loadFactor;
+
+	if (capacity_ == 0)
+		return;
+	std::size_t wanted = capacityFor(size_);
+	if (wanted > capacity_)
+		rehash(wanted);
+	else
+		growthLimit_ = static_cast<std::size_t>(capacity_ * maxLoadFactor_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::iterator HashMap<K, V, Hash, Eq>::begin()
+{
+	return Iterator{this, nextFull(0)};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::iterator HashMap<K, V, Hash, Eq>::end()
+{
+	return Iterator{this, capacity_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::const_iterator
+HashMap<K, V, Hash, Eq>::begin() const
+{
+	return ConstIterator{this, nextFull(0)};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::const_iterator
+HashMap<K, V, Hash, Eq>::end() const
+{
+	return ConstIterator{this, capacity_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q> inline
+std::size_t HashMap<K, V, Hash, Eq>::hashOf(Q const& key) const
+{
+	// Fibonacci hashing spreads weak user hashes (e.g. the identity hash of
+	// integers) over every bit.
+	std::uint64_t hash = static_cast<std::uint64_t>(hash_(key));
+	hash *= 0x9E3779B97F4A7C15ull;
+	return static_cast<std::size_t>(hash ^ (hash >> 32));
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::uint64_t HashMap<K, V, Hash, Eq>::loadGroup(std::size_t index) const
+{
+	std::uint64_t group;
+	std::memcpy(&group, control_ + index, sizeof(group));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	group = __builtin_bswap64(group);
+#endif
+	return group;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q> inline
+std::size_t HashMap<K, V, Hash, Eq>::findIndex(
+	Q const& key, std::size_t hash) const
+{
+	std::size_t empty;
+	return findIndex(key, hash, empty);
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q> inline
+std::size_t HashMap<K, V, Hash, Eq>::findIndex(
+	Q const& key, std::size_t hash, std::size_t& empty) const
+{
+	empty = NotFound;
+	if (size_ == 0)
+		return NotFound;
+
+	const std::uint64_t lsbs = 0x0101010101010101ull;
+	const std::uint64_t msbs = 0x8080808080808080ull;
+	const std::uint64_t fragment = lsbs * (hash & 0x7F);
+	std::size_t mask = capacity_ - 1;
+	std::size_t position = (hash >> 7) & mask;
+
+	for (;;) {
+		std::uint64_t group = loadGroup(position);
+		// Bytes equal to the fragment become zero; the usual "has zero byte"
+		// trick flags them.  It can flag a byte just above a real match,
+		// which the key comparison below weeds out.
+		std::uint64_t diff = group ^ fragment;
+		std::uint64_t matches = (diff - lsbs) & ~diff & msbs;
+		std::uint64_t empties = group & msbs;
+		if (empties != 0)
+			// A key never lives past the first empty slot of its run.
+			matches &= (empties & (~empties + 1)) - 1;
+
+		while (matches != 0) {
+			std::size_t offset =
+				static_cast<std::size_t>(__builtin_ctzll(matches)) / 8;
+			std::size_t index = (position + offset) & mask;
+			if (equal_(slots_[index].key_, key))
+				return index;
+			matches &= matches - 1;
+		}
+
+		if (empties != 0) {
+			// The miss stopped at the group findEmpty() would stop at.
+			std::size_t offset =
+				static_cast<std::size_t>(__builtin_ctzll(empties)) / 8;
+			empty = (position + offset) & mask;
+			return NotFound;
+		}
+		position = (position + GroupWidth) & mask;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t HashMap<K, V, Hash, Eq>::findEmpty(std::size_t hash) const
+{
+	const std::uint64_t msbs = 0x8080808080808080ull;
+	std::size_t mask = capacity_ - 1;
+	std::size_t position = (hash >> 7) & mask;
+
+	for (;;) {
+		std::uint64_t empties = loadGroup(position) & msbs;
+		if (empties != 0) {
+			std::size_t offset =
+				static_cast<std::size_t>(__builtin_ctzll(empties)) / 8;
+			return (position + offset) & mask;
+		}
+		position = (position + GroupWidth) & mask;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void HashMap<K, V, Hash, Eq>::setControl(
+	std::size_t index, unsigned char control)
+{
+	control_[index] = control;
+	// The first group is mirrored past the end so a group load starting
+	// near the end of the table wraps around without a branch.
+	if (index < GroupWidth)
+		control_[capacity_ + index] = control;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::Slot&
+HashMap<K, V, Hash, Eq>::insertAbsent(K key, V value, std::size_t hash,
+	std::size_t empty)
+{
+	if (size_ + 1 > growthLimit_) {
+		rehash(capacityFor(size_ + 1));
+		empty = NotFound;
+	}
+
+	std::size_t index = empty != NotFound ? empty : findEmpty(hash);
+	new (&slots_[index]) Slot{std::move(key), std::move(value)};
+	setControl(index, static_cast<unsigned char>(hash & 0x7F));
+	++size_;
+	return slots_[index];
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void HashMap<K, V, Hash, Eq>::eraseIndex(std::size_t index)
+{
+	std::size_t mask = capacity_ - 1;
+	std::size_t hole = index;
+	slots_[hole].~Slot();
+
+	// Backward-shift deletion: walk the rest of the run and pull back every
+	// pair whose home slot is not between the hole and where it sits now.
+	for (std::size_t next = (hole + 1) & mask; control_[next] != Empty;
+			next = (next + 1) & mask) {
+		std::size_t home = (hashOf(slots_[next].key_) >> 7) & mask;
+		bool staysPut = hole <= next
+			? (hole < home && home <= next)
+			: (hole < home || home <= next);
+		if (staysPut)
+			continue;
+
+		new (&slots_[hole]) Slot(std::move(slots_[next]));
+		slots_[next].~Slot();
+		setControl(hole, control_[next]);
+		hole = next;
+	}
+
+	setControl(hole, Empty);
+	--size_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void HashMap<K, V, Hash, Eq>::rehash(std::size_t newCapacity)
+{
+	unsigned char* oldControl = control_;
+	Slot* oldSlots = slots_;
+	std::size_t oldCapacity = capacity_;
+
+	Slot* newSlots =
+		static_cast<Slot*>(::operator new(sizeof(Slot) * newCapacity));
+	unsigned char* newControl = nullptr;
+	try {
+		newControl = new unsigned char[newCapacity + GroupWidth];
+	} catch (...) {
+		::operator delete(newSlots);
+		throw;
+	}
+	std::memset(newControl, Empty, newCapacity + GroupWidth);
+
+	control_ = newControl;
+	slots_ = newSlots;
+	capacity_ = newCapacity;
+	growthLimit_ = static_cast<std::size_t>(newCapacity * maxLoadFactor_);
+	if (growthLimit_ >= newCapacity)
+		growthLimit_ = newCapacity - 1;
+
+	for (std::size_t i = 0; i < oldCapacity; ++i) {
+		if (oldControl[i] == Empty)
+			continue;
+		std::size_t hash = hashOf(oldSlots[i].key_);
+		std::size_t index = findEmpty(hash);
+		new (&slots_[index]) Slot(std::move(oldSlots[i]));
+		setControl(index, static_cast<unsigned char>(hash & 0x7F));
+		oldSlots[i].~Slot();
+	}
+
+	::operator delete(oldSlots);
+	delete [] oldControl;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t HashMap<K, V, Hash, Eq>::capacityFor(std::size_t count) const
+{
+	std::size_t capacity = GroupWidth;
+	while (static_cast<std::size_t>(capacity * maxLoadFactor_) < count ||
+			capacity <= count)
+		capacity <<= 1;
+	return capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t HashMap<K, V, Hash, Eq>::nextFull(std::size_t index) const
+{
+	while (index < capacity_ && control_[index] == Empty)
+		++index;
+	return index;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename S> inline
+HashMap<K, V, Hash, Eq>::SlotCursor<S>::SlotCursor(
+	HashMap const* map, std::size_t index) : map_{map}, index_{index}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename S> inline
+typename HashMap<K, V, Hash, Eq>::template SlotCursor<S>&
+HashMap<K, V, Hash, Eq>::SlotCursor<S>::operator++()
+{
+	index_ = map_->nextFull(index_ + 1);
+	return *this;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename S> inline
+S& HashMap<K, V, Hash, Eq>::SlotCursor<S>::operator*() const
+{
+	return map_->slots_[index_];
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename S> inline
+bool HashMap<K, V, Hash, Eq>::SlotCursor<S>::operator==(const SlotCursor& rhs) const
+{
+	return index_ == rhs.index_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+HashMap<K, V, Hash, Eq>::Iterator::Iterator(
+	HashMap const* map, std::size_t index) : map_{map}, index_{index}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::iterator&
+HashMap<K, V, Hash, Eq>::iterator::operator++()
+{
+	index_ = map_->nextFull(index_ + 1);
+	return *this;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::iterator
+HashMap<K, V, Hash, Eq>::iterator::operator++(int)
+{
+	Iterator old{*this};
+	++*this;
+	return old;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+const K& HashMap<K, V, Hash, Eq>::iterator::operator*() const
+{
+	return map_->slots_[index_].key_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+const K* HashMap<K, V, Hash, Eq>::iterator::operator->() const
+{
+	return &map_->slots_[index_].key_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool HashMap<K, V, Hash, Eq>::iterator::operator==(const iterator& rhs) const
+{
+	return map_ == rhs.map_ && index_ == rhs.index_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool HashMap<K, V, Hash, Eq>::iterator::operator!=(const iterator& rhs) const
+{
+	return !(*this == rhs);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+HashMap<K, V, Hash, Eq>::ConstIterator::ConstIterator(
+	HashMap const* map, std::size_t index) : map_{map}, index_{index}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::const_iterator&
+HashMap<K, V, Hash, Eq>::const_iterator::operator++()
+{
+	index_ = map_->nextFull(index_ + 1);
+	return *this;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename HashMap<K, V, Hash, Eq>::const_iterator
+HashMap<K, V, Hash, Eq>::const_iterator::operator++(int)
+{
+	ConstIterator old{*this};
+	++*this;
+	return old;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+const K& HashMap<K, V, Hash, Eq>::const_iterator::operator*() const
+{
+	return map_->slots_[index_].key_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+const K* HashMap<K, V, Hash, Eq>::const_iterator::operator->() const
+{
+	return &map_->slots_[index_].key_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool HashMap<K, V, Hash, Eq>::const_iterator::operator==(
+	const const_iterator& rhs) const
+{
+	return map_ == rhs.map_ && index_ == rhs.index_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool HashMap<K, V, Hash, Eq>::const_iterator::operator!=(
+	const const_iterator& rhs) const
+{
+	return !(*this == rhs);
+}
+
+#endif
@@ -0,0 +1,248 @@
+/**
+ * \file _lockfreequeue.hpp
+ * \brief Private implementation file for the lock-free queue.
+ */
+
+#ifndef _LOCK_FREE_QUEUE_HPP
+#define _LOCK_FREE_QUEUE_HPP 1
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+template <typename T>
+const std::size_t LockFreeQueue<T>::MaxFree;
+
+template <typename T> inline
+LockFreeQueue<T>::LockFreeQueue() :
+	head_{nullptr},
+	tail_{nullptr},
+	records_{nullptr},
+	numRecords_{0}
+{
+	ListNode* dummy = new ListNode{T(), {nullptr}, nullptr};
+	head_.store(dummy, std::memory_order_relaxed);
+	tail_.store(dummy, std::memory_order_relaxed);
+}
+
+template <typename T> inline
+LockFreeQueue<T>::~LockFreeQueue()
+{
+	ListNode* node = head_.load(std::memory_order_relaxed);
+	while (node != nullptr) {
+		ListNode* next = node->next_.load(std::memory_order_relaxed);
+		delete node;
+		node = next;
+	}
+
+	HazardRecord* record = records_.load(std::memory_order_relaxed);
+	while (record != nullptr) {
+		for (ListNode* list : {record->retired_, record->free_}) {
+			while (list != nullptr) {
+				ListNode* next = list->link_;
+				delete list;
+				list = next;
+			}
+		}
+		HazardRecord* next = record->next_;
+		delete record;
+		record = next;
+	}
+}
+
+template <typename T> inline
+typename LockFreeQueue<T>::HazardRecord* LockFreeQueue<T>::acquireRecord()
+{
+	for (HazardRecord* record = records_.load(std::memory_order_acquire);
+			record != nullptr; record = record->next_) {
+		bool inactive = false;
+		if (!record->active_.load(std::memory_order_relaxed) &&
+				record->active_.compare_exchange_strong(
+					inactive, true, std::memory_order_acquire))
+			return record;
+	}
+
+	HazardRecord* record = new HazardRecord{
+		{true}, {{nullptr}, {nullptr}}, nullptr, 0, nullptr, 0, nullptr};
+	HazardRecord* head = records_.load(std::memory_order_relaxed);
+	do {
+		record->next_ = head;
+	} while (!records_.compare_exchange_weak(
+		head, record, std::memory_order_release, std::memory_order_relaxed));
+	numRecords_.fetch_add(1, std::memory_order_relaxed);
+	return record;
+}
+
+template <typename T> inline
+void LockFreeQueue<T>::releaseRecord(HazardRecord* record)
+{
+	record->hazards_[0].store(nullptr, std::memory_order_release);
+	record->hazards_[1].store(nullptr, std::memory_order_release);
+	record->active_.store(false, std::memory_order_release);
+}
+
+template <typename T> inline
+typename LockFreeQueue<T>::ListNode* LockFreeQueue<T>::protect(
+	HazardRecord* record, std::size_t index,
+	const std::atomic<ListNode*>& source)
+{
+	ListNode* node = source.load(std::memory_order_acquire);
+	for (;;) {
+		record->hazards_[index].store(node, std::memory_order_seq_cst);
+		ListNode* again = source.load(std::memory_order_seq_cst);
+		if (again == node)
+			return node;
+		node = again;
+	}
+}
+
+template <typename T> inline
+typename LockFreeQueue<T>::ListNode* LockFreeQueue<T>::allocateNode(
+	HazardRecord* record, T& value)
+{
+	ListNode* node = record->free_;
+	if (node == nullptr)
+		return new ListNode{std::move(value), {nullptr}, nullptr};
+
+	record->free_ = node->link_;
+	--record->numFree_;
+	node->value_ = std::move(value);
+	node->next_.store(nullptr, std::memory_order_relaxed);
+	node->link_ = nullptr;
+	return node;
+}
+
+template <typename T> inline
+void LockFreeQueue<T>::retireNode(HazardRecord* record, ListNode* node)
+{
+	node->link_ = record->retired_;
+	record->retired_ = node;
+	++record->numRetired_;
+
+	// Scanning costs O(hazards); waiting for a multiple of that many retired
+	// nodes keeps reclamation amortised O(1) per pop.
+	std::size_t threshold =
+		4 * numRecords_.load(std::memory_order_relaxed) + 16;
+	if (record->numRetired_ >= threshold)
+		scan(record);
+}
+
+template <typename T> inline
+void LockFreeQueue<T>::scan(HazardRecord* record)
+{
+	std::vector<ListNode*> hazards;
+	for (HazardRecord* other = records_.load(std::memory_order_acquire);
+			other != nullptr; other = other->next_) {
+		for (std::size_t i = 0; i < 2; ++i) {
+			ListNode* hazard =
+				other->hazards_[i].load(std::memory_order_seq_cst);
+			if (hazard != nullptr)
+				hazards.push_back(hazard);
+		}
+	}
+	std::sort(hazards.begin(), hazards.end());
+
+	ListNode* stillHazardous = nullptr;
+	std::size_t numStillHazardous = 0;
+	ListNode* node = record->retired_;
+	while (node != nullptr) {
+		ListNode* next = node->link_;
+		if (std::binary_search(hazards.begin(), hazards.end(), node)) {
+			node->link_ = stillHazardous;
+			stillHazardous = node;
+			++numStillHazardous;
+		} else if (record->numFree_ < MaxFree) {
+			node->link_ = record->free_;
+			record->free_ = node;
+			++record->numFree_;
+		} else {
+			delete node;
+		}
+		node = next;
+	}
+	record->retired_ = stillHazardous;
+	record->numRetired_ = numStillHazardous;
+}
+
+template <typename T> inline
+void LockFreeQueue<T>::push(T value)
+{
+	HazardRecord* record = acquireRecord();
+	ListNode* node = allocateNode(record, value);
+
+	for (;;) {
+		ListNode* tail = protect(record, 0, tail_);
+		ListNode* next = tail->next_.load(std::memory_order_acquire);
+		if (tail != tail_.load(std::memory_order_acquire))
+			continue;
+
+		if (next != nullptr) {
+			// Another producer linked a node but has not swung tail_ yet.
+			tail_.compare_exchange_weak(tail, next, std::memory_order_release,
+				std::memory_order_relaxed);
+			continue;
+		}
+
+		if (tail->next_.compare_exchange_weak(next, node,
+				std::memory_order_release, std::memory_order_relaxed)) {
+			tail_.compare_exchange_strong(tail, node,
+				std::memory_order_release, std::memory_order_relaxed);
+			break;
+		}
+	}
+
+	releaseRecord(record);
+}
+
+template <typename T> inline
+bool LockFreeQueue<T>::tryPop(T& value)
+{
+	HazardRecord* record = acquireRecord();
+	ListNode* head;
+
+	for (;;) {
+		head = protect(record, 0, head_);
+		ListNode* tail = tail_.load(std::memory_order_acquire);
+		ListNode* next = protect(record, 1, head->next_);
+		if (head != head_.load(std::memory_order_acquire))
+			continue;
+
+		if (next == nullptr) {
+			releaseRecord(record);
+			return false;
+		}
+
+		if (head == tail) {
+			tail_.compare_exchange_weak(tail, next, std::memory_order_release,
+				std::memory_order_relaxed);
+			continue;
+		}
+
+		// Copy before the CAS: once head_ moves, next becomes the dummy and
+		// its value may be overwritten when it is recycled.
+		T candidate = next->value_;
+		if (head_.compare_exchange_weak(head, next, std::memory_order_release,
+				std::memory_order_relaxed)) {
+			value = std::move(candidate);
+			break;
+		}
+	}
+
+	record->hazards_[0].store(nullptr, std::memory_order_release);
+	record->hazards_[1].store(nullptr, std::memory_order_release);
+	retireNode(record, head);
+	releaseRecord(record);
+	return true;
+}
+
+template <typename T> inline
+bool LockFreeQueue<T>::isEmpty() const
+{
+	ListNode* head = head_.load(std::memory_order_acquire);
+	return head->next_.load(std::memory_order_acquire) == nullptr;
+}
+
+#endif
@@ -0,0 +1,369 @@
+/**
+ * \file _lrucache.hpp
+ * \brief Private implementation file of the least recently used cache.
+ */
+
+#ifndef _LRU_CACHE_HPP
+#define _LRU_CACHE_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "hashmap.hpp"
+#include "mapviews.hpp"
+
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::uint32_t LruCache<K, V, Hash, Eq>::None;
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+LruCache<K, V, Hash, Eq>::LruCache(std::size_t capacity) :
+	LruCache(capacity, weigher_type{})
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+LruCache<K, V, Hash, Eq>::LruCache(std::size_t capacity,
+	weigher_type weigher) :
+		entries_{},
+		index_{},
+		head_{None},
+		tail_{None},
+		weight_{0},
+		capacity_{capacity},
+		weigher_{std::move(weigher)},
+		listener_{},
+		hits_{0},
+		misses_{0},
+		evictions_{0}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+LruCache<K, V, Hash, Eq>::LruCache(LruCache<K, V, Hash, Eq> const& orig) :
+	entries_{orig.entries_},
+	index_{orig.index_},
+	head_{orig.head_},
+	tail_{orig.tail_},
+	weight_{orig.weight_},
+	capacity_{orig.capacity_},
+	weigher_{orig.weigher_},
+	listener_{orig.listener_},
+	hits_{orig.hits_},
+	misses_{orig.misses_},
+	evictions_{orig.evictions_}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+LruCache<K, V, Hash, Eq>::LruCache(LruCache<K, V, Hash, Eq>&& other) :
+	LruCache(0)
+{
+	swap(*this, other);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+LruCache<K, V, Hash, Eq>& LruCache<K, V, Hash, Eq>::operator=(
+	LruCache<K, V, Hash, Eq> rhs)
+{
+	swap(*this, rhs);
+	return *this;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void swap(LruCache<K, V, Hash, Eq>& lhs, LruCache<K, V, Hash, Eq>& rhs)
+{
+	std::swap(lhs.entries_, rhs.entries_);
+	swap(lhs.index_, rhs.index_);
+	std::swap(lhs.head_, rhs.head_);
+	std::swap(lhs.tail_, rhs.tail_);
+	std::swap(lhs.weight_, rhs.weight_);
+	std::swap(lhs.capacity_, rhs.capacity_);
+	std::swap(lhs.weigher_, rhs.weigher_);
+	std::swap(lhs.listener_, rhs.listener_);
+	std::swap(lhs.hits_, rhs.hits_);
+	std::swap(lhs.misses_, rhs.misses_);
+	std::swap(lhs.evictions_, rhs.evictions_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V* LruCache<K, V, Hash, Eq>::get(K const& key)
+{
+	std::uint32_t* found = index_.find(key);
+	if (found == nullptr) {
+		++misses_;
+		return nullptr;
+	}
+
+	++hits_;
+	if (*found != head_) {
+		unlink(*found);
+		linkFront(*found);
+	}
+	return &entries_[*found].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V const* LruCache<K, V, Hash, Eq>::peek(K const& key) const
+{
+	std::uint32_t const* found = index_.find(key);
+	return found == nullptr ? nullptr : &entries_[*found].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool LruCache<K, V, Hash, Eq>::contains(K const& key) const
+{
+	return index_.find(key) != nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void LruCache<K, V, Hash, Eq>::put(K key, V value)
+{
+	std::size_t weight = weigh(key, value);
+	std::uint32_t* found = index_.find(key);
+	if (weight > capacity_) {
+		// Evict the newcomer alone rather than everything it would displace.
+		// The value it replaces leaves the cache too, so it is evicted first.
+		if (found != nullptr) {
+			Entry& entry = entries_[*found];
+			if (listener_)
+				listener_(entry.key_, entry.value_);
+			++evictions_;
+			erase(*found);
+		}
+		if (listener_)
+			listener_(key, value);
+		++evictions_;
+		return;
+	}
+
+	if (found != nullptr) {
+		Entry& entry = entries_[*found];
+		entry.value_ = std::move(value);
+		weight_ = weight_ - entry.weight_ + weight;
+		entry.weight_ = weight;
+		if (*found != head_) {
+			unlink(*found);
+			linkFront(*found);
+		}
+	} else {
+		std::uint32_t index = static_cast<std::uint32_t>(entries_.size());
+		entries_.push_back(
+			Entry{std::move(key), std::move(value), weight, None, None});
+		try {
+			index_.addValue(entries_.back().key_, index);
+		} catch (...) {
+			entries_.pop_back();
+			throw;
+		}
+		linkFront(index);
+		weight_ += weight;
+	}
+	evict();
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool LruCache<K, V, Hash, Eq>::remove(K const& key)
+{
+	std::uint32_t const* found = index_.find(key);
+	if (found == nullptr)
+		return false;
+	erase(*found);
+	return true;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void LruCache<K, V, Hash, Eq>::clear()
+{
+	entries_.clear();
+	index_ = HashMap<K, std::uint32_t, Hash, Eq>{};
+	head_ = None;
+	tail_ = None;
+	weight_ = 0;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void LruCache<K, V, Hash, Eq>::setEvictionListener(listener_type listener)
+{
+	listener_ = std::move(listener);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t LruCache<K, V, Hash, Eq>::size() const
+{
+	return entries_.size();
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool LruCache<K, V, Hash, Eq>::isEmpty() const
+{
+	return entries_.empty();
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t LruCache<K, V, Hash, Eq>::weight() const
+{
+	return weight_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t LruCache<K, V, Hash, Eq>::capacity() const
+{
+	return capacity_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void LruCache<K, V, Hash, Eq>::setCapacity(std::size_t capacity)
+{
+	capacity_ = capacity;
+	evict();
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t LruCache<K, V, Hash, Eq>::hits() const
+{
+	return hits_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t LruCache<K, V, Hash, Eq>::misses() const
+{
+	return misses_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t LruCache<K, V, Hash, Eq>::evictions() const
+{
+	return evictions_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void LruCache<K, V, Hash, Eq>::resetCounters()
+{
+	hits_ = 0;
+	misses_ = 0;
+	evictions_ = 0;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename LruCache<K, V, Hash, Eq>::keys_view
+LruCache<K, V, Hash, Eq>::keys() const
+{
+	return keys_view{EntryCursor{entries_.data(), head_},
+		EntryCursor{entries_.data(), None}, entries_.size()};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename LruCache<K, V, Hash, Eq>::items_view
+LruCache<K, V, Hash, Eq>::items() const
+{
+	return items_view{EntryCursor{entries_.data(), head_},
+		EntryCursor{entries_.data(), None}, entries_.size()};
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Fn> inline
+void LruCache<K, V, Hash, Eq>::forEach(Fn fn) const
+{
+	for (std::uint32_t index = head_; index != None;
+			index = entries_[index].next_)
+		fn(entries_[index].key_, entries_[index].value_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename LruCache<K, V, Hash, Eq>::EntryCursor&
+LruCache<K, V, Hash, Eq>::EntryCursor::operator++()
+{
+	index_ = entries_[index_].next_;
+	return *this;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename LruCache<K, V, Hash, Eq>::Entry const&
+LruCache<K, V, Hash, Eq>::EntryCursor::operator*() const
+{
+	return entries_[index_];
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool LruCache<K, V, Hash, Eq>::EntryCursor::operator==(
+	const EntryCursor& rhs) const
+{
+	return index_ == rhs.index_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t LruCache<K, V, Hash, Eq>::weigh(K const& key,
+	V const& value) const
+{
+	return weigher_ ? weigher_(key, value) : 1;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void LruCache<K, V, Hash, Eq>::unlink(std::uint32_t index)
+{
+	Entry& entry = entries_[index];
+	if (entry.prev_ != None)
+		entries_[entry.prev_].next_ = entry.next_;
+	else
+		head_ = entry.next_;
+	if (entry.next_ != None)
+		entries_[entry.next_].prev_ = entry.prev_;
+	else
+		tail_ = entry.prev_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void LruCache<K, V, Hash, Eq>::linkFront(std::uint32_t index)
+{
+	Entry& entry = entries_[index];
+	entry.prev_ = None;
+	entry.next_ = head_;
+	if (head_ != None)
+		entries_[head_].prev_ = index;
+	else
+		tail_ = index;
+	head_ = index;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void LruCache<K, V, Hash, Eq>::erase(std::uint32_t index)
+{
+	unlink(index);
+	weight_ -= entries_[index].weight_;
+	index_.removeValue(entries_[index].key_);
+
+	// Fill the hole with the last entry and point its neighbours and its
+	// index slot at the new position.
+	std::uint32_t last = static_cast<std::uint32_t>(entries_.size() - 1);
+	if (index != last) {
+		entries_[index] = std::move(entries_[last]);
+		Entry& moved = entries_[index];
+		if (moved.prev_ != None)
+			entries_[moved.prev_].next_ = index;
+		else
+			head_ = index;
+		if (moved.next_ != None)
+			entries_[moved.next_].prev_ = index;
+		else
+			tail_ = index;
+		*index_.find(moved.key_) = index;
+	}
+	entries_.pop_back();
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void LruCache<K, V, Hash, Eq>::evict()
+{
+	while (weight_ > capacity_) {
+		std::uint32_t victim = tail_;
+		if (listener_)
+			listener_(entries_[victim].key_, entries_[victim].value_);
+		++evictions_;
+		erase(victim);
+	}
+}
+
+#endif
@@ -6,63 +6,217 @@
 #ifndef _NONHASH_MAP_HPP
 #define _NONHASH_MAP_HPP 1
 
-#include <utility>
+#include <algorithm>
 #include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
 
+#include "bloomfilter.hpp"
 #include "map.hpp"
-#include "deque.hpp"
+#include "mapviews.hpp"
 #include "../exceptions.hpp"
 
 
-template <typename K, typename V> inline
-NonHashMap<K, V>::NonHashMap() {}
+template <typename K, typename V>
+const std::size_t NonHashMap<K, V>::MinFilterCapacity;
 
 template <typename K, typename V> inline
-NonHashMap<K, V>::NonHashMap(NonHashMap<K, V> const& orig) 
+NonHashMap<K, V>::NonHashMap() :
+	keys_{},
+	readOptimised_{false},
+	filter_{},
+	filtered_{false}
+{
+}
+
+template <typename K, typename V> template <typename InputIt> inline
+NonHashMap<K, V>::NonHashMap(InputIt first, InputIt last) : NonHashMap()
 {
-	Deque<NonHashMap<K, V>::Key> tmp{orig.keys_};
-	keys_ = tmp;
+	insertBatch(first, last);
 }
 
 template <typename K, typename V> inline
-NonHashMap<K, V>::NonHashMap(NonHashMap<K, V>&& other) 
+NonHashMap<K, V>::NonHashMap(NonHashMap<K, V> const& orig) :
+	keys_{orig.keys_},
+	readOptimised_{orig.readOptimised_},
+	layoutKeys_{orig.layoutKeys_},
+	layoutIndex_{orig.layoutIndex_},
+	filter_{orig.filter_},
+	filtered_{orig.filtered_}
 {
-	#include <iostream>
+}
 
-	std::cout << "Move constructor" << std::endl;
+template <typename K, typename V> inline
+NonHashMap<K, V>::NonHashMap(NonHashMap<K, V>&& other) : NonHashMap()
+{
 	swap(*this, other);
 }
 
 template <typename K, typename V> inline
-NonHashMap<K, V>& NonHashMap<K, V>::operator=(NonHashMap<K, V> rhs) 
+NonHashMap<K, V>& NonHashMap<K, V>::operator=(NonHashMap<K, V> rhs)
 {
 	swap(*this, rhs);
 	return *this;
 }
 
 template <typename K, typename V> inline
-void swap(NonHashMap<K, V>& lhs, NonHashMap<K, V>& rhs) 
+void swap(NonHashMap<K, V>& lhs, NonHashMap<K, V>& rhs)
 {
-	swap(lhs.keys_, rhs.keys_);
+	std::swap(lhs.keys_, rhs.keys_);
+	std::swap(lhs.readOptimised_, rhs.readOptimised_);
+	std::swap(lhs.layoutKeys_, rhs.layoutKeys_);
+	std::swap(lhs.layoutIndex_, rhs.layoutIndex_);
+	swap(lhs.filter_, rhs.filter_);
+	std::swap(lhs.filtered_, rhs.filtered_);
 }
 
 template <typename K, typename V> inline
-void NonHashMap<K, V>::addValue(K key, V value) 
+void NonHashMap<K, V>::addValue(K key, V value)
 {
-	if (!contains(key))
-	 	keys_.append(Key{key, value});
-	 else
-	 	throw KeyError<K>{key, "NonHashMap"};
+	if (!findOrInsert(key, std::move(value)).second)
+		throw KeyError<K>{key, "NonHashMap"};
 }
 
 template <typename K, typename V> inline
-void NonHashMap<K, V>::removeValue(K) {}
+bool NonHashMap<K, V>::insertOrAssign(K key, V value)
+{
+	std::pair<V&, bool> result = findOrInsert(key, std::move(value));
+	if (!result.second)
+		result.first = std::move(value);
+	return result.second;
+}
+
+template <typename K, typename V> template <typename... Args> inline
+std::pair<V&, bool> NonHashMap<K, V>::tryEmplace(K key, Args&&... args)
+{
+	return findOrInsert(key, std::forward<Args>(args)...);
+}
+
+template <typename K, typename V> template <typename Fn> inline
+V& NonHashMap<K, V>::upsert(K key, Fn fn)
+{
+	V& value = findOrInsert(key).first;
+	fn(value);
+	return value;
+}
+
+template <typename K, typename V> template <typename... Args> inline
+std::pair<V&, bool> NonHashMap<K, V>::findOrInsert(K& key,
+	Args&&... args)
+{
+	std::size_t index = lowerBound(key);
+	if (index != keys_.size() && !(key < keys_[index].key_))
+		return {keys_[index].value_, false};
+
+	keys_.insert(keys_.begin() + index,
+		Key{std::move(key), V(std::forward<Args>(args)...)});
+	rebuildLayout();
+	if (filtered_)
+		filterKey(keys_[index].key_);
+	return {keys_[index].value_, true};
+}
+
+template <typename K, typename V> template <typename InputIt> inline
+void NonHashMap<K, V>::insert(InputIt first, InputIt last)
+{
+	std::vector<Key> added;
+	for (; first != last; ++first)
+		added.push_back(Key{first->first, first->second});
+	if (added.empty())
+		return;
+
+	auto byKey = [](Key const& lhs, Key const& rhs) {
+		return lhs.key_ < rhs.key_;
+	};
+	std::stable_sort(added.begin(), added.end(), byKey);
+
+	std::vector<Key> merged;
+	merged.reserve(keys_.size() + added.size());
+	std::merge(keys_.begin(), keys_.end(), added.begin(), added.end(),
+		std::back_inserter(merged), byKey);
+
+	// Sorted order puts any duplicate right next to its twin.
+	for (std::size_t i = 1; i < merged.size(); ++i)
+		if (!(merged[i - 1].key_ < merged[i].key_))
+			throw KeyError<K>{merged[i].key_, "NonHashMap"};
+
+	keys_.swap(merged);
+	rebuildLayout();
+	if (filtered_)
+		rebuildFilter();
+}
+
+template <typename K, typename V> template <typename InputIt> inline
+void NonHashMap<K, V>::insertBatch(InputIt first, InputIt last)
+{
+	std::vector<Key> added;
+	added.reserve(batchSize(first, last));
+	for (; first != last; ++first)
+		added.push_back(Key{first->first, first->second});
+	if (added.empty())
+		return;
+
+	std::stable_sort(added.begin(), added.end(),
+		[](Key const& lhs, Key const& rhs) {
+			return lhs.key_ < rhs.key_;
+		});
+
+	// A run of equal keys keeps its range order through the stable sort, so
+	// its last pair is the one that wins, over the map's pair as well.
+	std::vector<Key> merged;
+	merged.reserve(keys_.size() + added.size());
+	auto present = keys_.begin();
+	for (std::size_t i = 0; i < added.size(); ++i) {
+		if (i + 1 < added.size() && !(added[i].key_ < added[i + 1].key_))
+			continue;
+		for (; present != keys_.end() && present->key_ < added[i].key_;
+				++present)
+			merged.push_back(std::move(*present));
+		if (present != keys_.end() && !(added[i].key_ < present->key_))
+			++present;
+		merged.push_back(std::move(added[i]));
+	}
+	for (; present != keys_.end(); ++present)
+		merged.push_back(std::move(*present));
+
+	keys_.swap(merged);
+	rebuildLayout();
+	if (filtered_)
+		rebuildFilter();
+}
+
+template <typename K, typename V> inline
+void NonHashMap<K, V>::removeValue(K const& key)
+{
+	std::size_t index = find(key);
+	if (index == keys_.size())
+		throw KeyError<K>{key, "NonHashMap"};
+
+	keys_.erase(keys_.begin() + index);
+	rebuildLayout();
+}
 
 template <typename K, typename V> inline
-V& NonHashMap<K, V>::getValue(K) const
+V& NonHashMap<K, V>::getValue(K const& key) const
+{
+	std::size_t index = find(key);
+	if (index == keys_.size())
+		throw KeyError<K>{key, "NonHashMap"};
+
+	// Map hands out mutable values from a const lookup.
+	return const_cast<V&>(keys_[index].value_);
+}
+
+template <typename K, typename V> template <typename Q, typename> inline
+V& NonHashMap<K, V>::getValue(Q const& key) const
 {
-	V* a = new V;
-	return *a;
+	std::size_t index = find(key);
+	if (index == keys_.size())
+		throw KeyError<K>{key, "NonHashMap"};
+
+	// Map hands out mutable values from a const lookup.
+	return const_cast<V&>(keys_[index].value_);
 }
 
 template <typename K, typename V> inline
@@ -74,25 +228,422 @@ std::size_t NonHashMap<K, V>::size() const
 template <typename K, typename V> inline
 bool NonHashMap<K, V>::isEmpty() const
 {
-	return keys_.isEmpty(); 
+	return keys_.empty();
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::keys_view NonHashMap<K, V>::keys() const
+{
+	return keys_view{keys_.data(), keys_.data() + keys_.size(), keys_.size()};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::values_view NonHashMap<K, V>::values()
+{
+	return values_view{keys_.data(), keys_.data() + keys_.size(),
+		keys_.size()};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::const_values_view NonHashMap<K, V>::values() const
+{
+	return const_values_view{keys_.data(), keys_.data() + keys_.size(),
+		keys_.size()};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::items_view NonHashMap<K, V>::items()
+{
+	return items_view{keys_.data(), keys_.data() + keys_.size(), keys_.size()};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::const_items_view NonHashMap<K, V>::items() const
+{
+	return const_items_view{keys_.data(), keys_.data() + keys_.size(),
+		keys_.size()};
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void NonHashMap<K, V>::forEach(Fn fn)
+{
+	for (Key& key : keys_)
+		fn(static_cast<K const&>(key.key_), key.value_);
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void NonHashMap<K, V>::forEach(Fn fn) const
+{
+	for (Key const& key : keys_)
+		fn(key.key_, key.value_);
+}
+
+template <typename K, typename V> inline
+bool NonHashMap<K, V>::contains(K const& key) const
+{
+	return find(key) != keys_.size();
+}
+
+template <typename K, typename V> template <typename Q, typename> inline
+bool NonHashMap<K, V>::contains(Q const& key) const
+{
+	return find(key) != keys_.size();
+}
+
+template <typename K, typename V> inline
+void NonHashMap<K, V>::setReadOptimised(bool readOptimised)
+{
+	readOptimised_ = readOptimised;
+	rebuildLayout();
+}
+
+template <typename K, typename V> inline
+bool NonHashMap<K, V>::isReadOptimised() const
+{
+	return readOptimised_;
+}
+
+template <typename K, typename V> template <typename Hash> inline
+void NonHashMap<K, V>::enableBloomFilter(double falsePositiveRate)
+{
+	filter_ = BloomFilter<K, FilterHash>{0, falsePositiveRate,
+		FilterHash{&hashKey<Hash>}};
+	rebuildFilter();
+	filtered_ = true;
+}
+
+template <typename K, typename V> inline
+void NonHashMap<K, V>::disableBloomFilter()
+{
+	filter_ = BloomFilter<K, FilterHash>{};
+	filtered_ = false;
+}
+
+template <typename K, typename V> inline
+bool NonHashMap<K, V>::hasBloomFilter() const
+{
+	return filtered_;
+}
+
+template <typename K, typename V> inline
+bool NonHashMap<K, V>::mayContain(K const& key) const
+{
+	return !filtered_ || filter_.mayContain(key);
+}
+
+template <typename K, typename V> template <typename Q> inline
+bool NonHashMap<K, V>::mayContain(Q const&) const
+{
+	return true;
+}
+
+template <typename K, typename V> template <typename Q> inline
+std::size_t NonHashMap<K, V>::lowerBound(Q const& key) const
+{
+	std::size_t n = keys_.size();
+	if (n == 0)
+		return 0;
+
+	if (readOptimised_) {
+		// Walk the implicit tree; every step is a comparison and a shift.
+		std::size_t node = 1;
+		while (node <= n)
+			node = 2 * node + (layoutKeys_[node] < key);
+		// Undo the trailing right turns plus the final left turn to land on
+		// the last node where we went left, i.e. the lower bound.
+		node >>= __builtin_ffsll(~static_cast<long long>(node));
+		return node == 0 ? n : layoutIndex_[node];
+	}
+
+	// Branchless binary search: the loop count depends only on n, and the
+	// comparison feeds a conditional move rather than a branch.
+	Key const* base = keys_.data();
+	while (n > 1) {
+		std::size_t half = n / 2;
+		base = base[half - 1].key_ < key ? base + half : base;
+		n -= half;
+	}
+	return static_cast<std::size_t>(base - keys_.data()) + (base->key_ < key);
+}
+
+template <typename K, typename V> template <typename Q> inline
+std::size_t NonHashMap<K, V>::find(Q const& key) const
+{
+	if (!mayContain(key))
+		return keys_.size();
+
+	std::size_t index = lowerBound(key);
+	if (index != keys_.size() && key < keys_[index].key_)
+		return keys_.size();
+	return index;
+}
+
+template <typename K, typename V> template <typename Hash> inline
+std::size_t NonHashMap<K, V>::hashKey(K const& key)
+{
+	return Hash{}(key);
+}
+
+template <typename K, typename V> inline
+void NonHashMap<K, V>::filterKey(K const& key)
+{
+	filter_.add(key);
+	if (filter_.size() > filter_.capacity())
+		rebuildFilter();
+}
+
+template <typename K, typename V> inline
+void NonHashMap<K, V>::rebuildFilter()
+{
+	std::size_t capacity = 2 * keys_.size();
+	BloomFilter<K, FilterHash> filter{capacity < MinFilterCapacity
+		? MinFilterCapacity : capacity, filter_.falsePositiveRate(),
+		filter_.hashFunction()};
+	for (Key const& key : keys_)
+		filter.add(key.key_);
+	swap(filter_, filter);
+}
+
+template <typename K, typename V> inline
+void NonHashMap<K, V>::rebuildLayout()
+{
+	layoutKeys_.clear();
+	layoutIndex_.clear();
+	if (!readOptimised_ || keys_.empty())
+		return;
+
+	layoutKeys_.assign(keys_.size() + 1, keys_[0].key_);
+	layoutIndex_.assign(keys_.size() + 1, 0);
+	buildLayout(0, 1);
+}
+
+template <typename K, typename V> inline
+std::size_t NonHashMap<K, V>::buildLayout(std::size_t sorted, std::size_t node)
+{
+	if (node <= keys_.size()) {
+		sorted = buildLayout(sorted, 2 * node);
+		layoutKeys_[node] = keys_[sorted].key_;
+		layoutIndex_[node] = sorted++;
+		sorted = buildLayout(sorted, 2 * node + 1);
+	}
+	return sorted;
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::iterator NonHashMap<K, V>::begin()
+{
+	return Iterator{keys_.data()};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::iterator NonHashMap<K, V>::end()
+{
+	return Iterator{keys_.data() + keys_.size()};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::const_iterator NonHashMap<K, V>::begin() const
+{
+	return ConstIterator{keys_.data()};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::const_iterator NonHashMap<K, V>::end() const
+{
+	return ConstIterator{keys_.data() + keys_.size()};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::reverse_iterator NonHashMap<K, V>::rbegin()
+{
+	return ReverseIterator{keys_.data() + keys_.size()};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::reverse_iterator NonHashMap<K, V>::rend()
+{
+	return ReverseIterator{keys_.data()};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::const_reverse_iterator
+NonHashMap<K, V>::rbegin() const
+{
+	return ConstReverseIterator{keys_.data() + keys_.size()};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::const_reverse_iterator
+NonHashMap<K, V>::rend() const
+{
+	return ConstReverseIterator{keys_.data()};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::iterator& NonHashMap<K, V>::iterator::operator++()
+{
+	++current_;
+	return *this;
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::const_iterator&
+NonHashMap<K, V>::const_iterator::operator++()
+{
+	++current_;
+	return *this;
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::reverse_iterator&
+NonHashMap<K, V>::reverse_iterator::operator++()
+{
+	--current_;
+	return *this;
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::const_reverse_iterator&
+NonHashMap<K, V>::const_reverse_iterator::operator++()
+{
+	--current_;
+	return *this;
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::iterator
+NonHashMap<K, V>::iterator::operator++(int)
+{
+	Key const* old = current_++;
+	return Iterator{old};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::const_iterator
+NonHashMap<K, V>::const_iterator::operator++(int)
+{
+	Key const* old = current_++;
+	return ConstIterator{old};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::reverse_iterator
+NonHashMap<K, V>::reverse_iterator::operator++(int)
+{
+	Key const* old = current_--;
+	return ReverseIterator{old};
+}
+
+template <typename K, typename V> inline
+typename NonHashMap<K, V>::const_reverse_iterator
+NonHashMap<K, V>::const_reverse_iterator::operator++(int)
+{
+	Key const* old = current_--;
+	return ConstReverseIterator{old};
+}
+
+template <typename K, typename V> inline
+const K& NonHashMap<K, V>::iterator::operator*() const
+{
+	return current_->key_;
+}
+
+template <typename K, typename V> inline
+const K& NonHashMap<K, V>::const_iterator::operator*() const
+{
+	return current_->key_;
+}
+
+// Reverse iterators point one past the pair they refer to, so that rend()
+// never has to point before the start of the array.
+template <typename K, typename V> inline
+const K& NonHashMap<K, V>::reverse_iterator::operator*() const
+{
+	return (current_ - 1)->key_;
+}
+
+template <typename K, typename V> inline
+const K& NonHashMap<K, V>::const_reverse_iterator::operator*() const
+{
+	return (current_ - 1)->key_;
+}
+
+template <typename K, typename V> inline
+const K* NonHashMap<K, V>::iterator::operator->() const
+{
+	return &current_->key_;
+}
+
+template <typename K, typename V> inline
+const K* NonHashMap<K, V>::const_iterator::operator->() const
+{
+	return &current_->key_;
+}
+
+template <typename K, typename V> inline
+const K* NonHashMap<K, V>::reverse_iterator::operator->() const
+{
+	return &(current_ - 1)->key_;
+}
+
+template <typename K, typename V> inline
+const K* NonHashMap<K, V>::const_reverse_iterator::operator->() const
+{
+	return &(current_ - 1)->key_;
+}
+
+template <typename K, typename V> inline
+bool NonHashMap<K, V>::iterator::operator==(const iterator& rhs) const
+{
+	return current_ == rhs.current_;
+}
+
+template <typename K, typename V> inline
+bool NonHashMap<K, V>::const_iterator::operator==(
+	const const_iterator& rhs) const
+{
+	return current_ == rhs.current_;
+}
+
+template <typename K, typename V> inline
+bool NonHashMap<K, V>::reverse_iterator::operator==(
+	const reverse_iterator& rhs) const
+{
+	return current_ == rhs.current_;
+}
+
+template <typename K, typename V> inline
+bool NonHashMap<K, V>::const_reverse_iterator::operator==(
+	const const_reverse_iterator& rhs) const
+{
+	return current_ == rhs.current_;
+}
+
+template <typename K, typename V> inline
+bool NonHashMap<K, V>::iterator::operator!=(const iterator& rhs) const
+{
+	return !(*this == rhs);
 }
 
 template <typename K, typename V> inline
-Deque<K>* NonHashMap<K, V>::getKeys() const
+bool NonHashMap<K, V>::const_iterator::operator!=(
+	const const_iterator& rhs) const
 {
-	return new Deque<K>;
+	return !(*this == rhs);
 }
 
 template <typename K, typename V> inline
-Deque<V>* NonHashMap<K, V>::getValues() const
+bool NonHashMap<K, V>::reverse_iterator::operator!=(
+	const reverse_iterator& rhs) const
 {
-	return new Deque<V>;
+	return !(*this == rhs);
 }
 
 template <typename K, typename V> inline
-bool NonHashMap<K, V>::contains(K key) const
+bool NonHashMap<K, V>::const_reverse_iterator::operator!=(
+	const const_reverse_iterator& rhs) const
 {
-	return keys_.contains(Key{key, V()});
+	return !(*this == rhs);
 }
 
 template <typename K, typename V> inline
@@ -0,0 +1,599 @@
+/**
+ * \file _orderedhashmap.hpp
+ * \brief Private implementation file of the insertion-ordered hash map.
+ */
+
+#ifndef _ORDERED_HASH_MAP_HPP
+#define _ORDERED_HASH_MAP_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::size_t OrderedHashMap<K, V, Hash, Eq>::NotFound;
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::size_t OrderedHashMap<K, V, Hash, Eq>::Removed;
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::size_t OrderedHashMap<K, V, Hash, Eq>::MinIndexSize;
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+OrderedHashMap<K, V, Hash, Eq>::OrderedHashMap() :
+	slots_{nullptr},
+	hashes_{nullptr},
+	index_{nullptr},
+	indexSize_{0},
+	width_{0},
+	used_{0},
+	size_{0},
+	hash_{},
+	equal_{}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+OrderedHashMap<K, V, Hash, Eq>::OrderedHashMap(std::size_t count) :
+	OrderedHashMap()
+{
+	reserve(count);
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename InputIt> inline
+OrderedHashMap<K, V, Hash, Eq>::OrderedHashMap(InputIt first, InputIt last) :
+	OrderedHashMap()
+{
+	insertBatch(first, last);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+OrderedHashMap<K, V, Hash, Eq>::OrderedHashMap(
+	OrderedHashMap<K, V, Hash, Eq> const& orig) : OrderedHashMap()
+{
+	hash_ = orig.hash_;
+	equal_ = orig.equal_;
+	if (orig.size_ == 0)
+		return;
+
+	// Pairs are counted as they are built, so the destructor cleans up
+	// after a copy that throws.
+	rebuild(indexSizeFor(orig.size_));
+	for (std::size_t i = 0; i < orig.used_; ++i) {
+		if (orig.hashes_[i] == Removed)
+			continue;
+		new (&slots_[used_]) Slot(orig.slots_[i]);
+		hashes_[used_] = orig.hashes_[i];
+		place(hashes_[used_], used_);
+		++used_;
+		++size_;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+OrderedHashMap<K, V, Hash, Eq>::OrderedHashMap(
+	OrderedHashMap<K, V, Hash, Eq>&& other) : OrderedHashMap()
+{
+	swap(*this, other);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+OrderedHashMap<K, V, Hash, Eq>& OrderedHashMap<K, V, Hash, Eq>::operator=(
+	OrderedHashMap<K, V, Hash, Eq> rhs)
+{
+	swap(*this, rhs);
+	return *this;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void swap(OrderedHashMap<K, V, Hash, Eq>& lhs,
+	OrderedHashMap<K, V, Hash, Eq>& rhs)
+{
+	std::swap(lhs.slots_, rhs.slots_);
+	std::swap(lhs.hashes_, rhs.hashes_);
+	std::swap(lhs.index_, rhs.index_);
+	std::swap(lhs.indexSize_, rhs.indexSize_);
+	std::swap(lhs.width_, rhs.width_);
+	std::swap(lhs.used_, rhs.used_);
+	std::swap(lhs.size_, rhs.size_);
+	std::swap(lhs.hash_, rhs.hash_);
+	std::swap(lhs.equal_, rhs.equal_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+OrderedHashMap<K, V, Hash, Eq>::~OrderedHashMap()
+{
+	for (std::size_t i = 0; i < used_; ++i)
+		if (hashes_[i] != Removed)
+			slots_[i].~Slot();
+	::operator delete(slots_);
+	delete [] hashes_;
+	::operator delete(index_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void OrderedHashMap<K, V, Hash, Eq>::addValue(K key, V value)
+{
+	if (!findOrInsert(key, std::move(value)).second)
+		throw KeyError<K>{key, "OrderedHashMap"};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool OrderedHashMap<K, V, Hash, Eq>::insertOrAssign(K key, V value)
+{
+	std::pair<V&, bool> result = findOrInsert(key, std::move(value));
+	if (!result.second)
+		result.first = std::move(value);
+	return result.second;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename... Args> inline
+std::pair<V&, bool> OrderedHashMap<K, V, Hash, Eq>::tryEmplace(K key,
+	Args&&... args)
+{
+	return findOrInsert(key, std::forward<Args>(args)...);
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Fn> inline
+V& OrderedHashMap<K, V, Hash, Eq>::upsert(K key, Fn fn)
+{
+	V& value = findOrInsert(key).first;
+	fn(value);
+	return value;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename InputIt> inline
+void OrderedHashMap<K, V, Hash, Eq>::insertBatch(InputIt first, InputIt last)
+{
+	// Holes count, so the whole batch fits after at most one rebuild.
+	reserve(used_ + batchSize(first, last));
+	for (; first != last; ++first)
+		insertOrAssign(first->first, first->second);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void OrderedHashMap<K, V, Hash, Eq>::removeValue(K const& key)
+{
+	std::size_t hash = hashOf(key);
+	std::size_t position = findIndex(key, hash);
+	if (position == NotFound)
+		throw KeyError<K>{key, "OrderedHashMap"};
+
+	unplace(hash, position);
+	slots_[position].~Slot();
+	hashes_[position] = Removed;
+	--size_;
+	// Holes at the end are taken back at once, so a map used as a stack
+	// never needs compacting.
+	while (used_ > 0 && hashes_[used_ - 1] == Removed)
+		--used_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V& OrderedHashMap<K, V, Hash, Eq>::getValue(K const& key) const
+{
+	std::size_t position = findIndex(key, hashOf(key));
+	if (position == NotFound)
+		throw KeyError<K>{key, "OrderedHashMap"};
+	return slots_[position].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q, typename> inline
+V& OrderedHashMap<K, V, Hash, Eq>::getValue(Q const& key) const
+{
+	std::size_t position = findIndex(key, hashOf(key));
+	if (position == NotFound)
+		throw KeyError<K>{key, "OrderedHashMap"};
+	return slots_[position].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t OrderedHashMap<K, V, Hash, Eq>::size() const
+{
+	return size_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool OrderedHashMap<K, V, Hash, Eq>::isEmpty() const
+{
+	return size_ == 0;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool OrderedHashMap<K, V, Hash, Eq>::contains(K const& key) const
+{
+	return findIndex(key, hashOf(key)) != NotFound;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q, typename> inline
+bool OrderedHashMap<K, V, Hash, Eq>::contains(Q const& key) const
+{
+	return findIndex(key, hashOf(key)) != NotFound;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V* OrderedHashMap<K, V, Hash, Eq>::find(K const& key)
+{
+	std::size_t position = findIndex(key, hashOf(key));
+	return position == NotFound ? nullptr : &slots_[position].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V const* OrderedHashMap<K, V, Hash, Eq>::find(K const& key) const
+{
+	std::size_t position = findIndex(key, hashOf(key));
+	return position == NotFound ? nullptr : &slots_[position].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q, typename> inline
+V* OrderedHashMap<K, V, Hash, Eq>::find(Q const& key)
+{
+	std::size_t position = findIndex(key, hashOf(key));
+	return position == NotFound ? nullptr : &slots_[position].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q, typename> inline
+V const* OrderedHashMap<K, V, Hash, Eq>::find(Q const& key) const
+{
+	std::size_t position = findIndex(key, hashOf(key));
+	return position == NotFound ? nullptr : &slots_[position].value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename OrderedHashMap<K, V, Hash, Eq>::keys_view
+OrderedHashMap<K, V, Hash, Eq>::keys() const
+{
+	return keys_view{{this, nextFull(0)}, {this, used_}, size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename OrderedHashMap<K, V, Hash, Eq>::values_view
+OrderedHashMap<K, V, Hash, Eq>::values()
+{
+	return values_view{{this, nextFull(0)}, {this, used_}, size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename OrderedHashMap<K, V, Hash, Eq>::const_values_view
+OrderedHashMap<K, V, Hash, Eq>::values() const
+{
+	return const_values_view{{this, nextFull(0)}, {this, used_}, size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename OrderedHashMap<K, V, Hash, Eq>::items_view
+OrderedHashMap<K, V, Hash, Eq>::items()
+{
+	return items_view{{this, nextFull(0)}, {this, used_}, size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename OrderedHashMap<K, V, Hash, Eq>::const_items_view
+OrderedHashMap<K, V, Hash, Eq>::items() const
+{
+	return const_items_view{{this, nextFull(0)}, {this, used_}, size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Fn> inline
+void OrderedHashMap<K, V, Hash, Eq>::forEach(Fn fn)
+{
+	for (std::size_t i = 0; i < used_; ++i)
+		if (hashes_[i] != Removed)
+			fn(static_cast<K const&>(slots_[i].key_), slots_[i].value_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Fn> inline
+void OrderedHashMap<K, V, Hash, Eq>::forEach(Fn fn) const
+{
+	for (std::size_t i = 0; i < used_; ++i)
+		if (hashes_[i] != Removed)
+			fn(static_cast<K const&>(slots_[i].key_),
+				static_cast<V const&>(slots_[i].value_));
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void OrderedHashMap<K, V, Hash, Eq>::reserve(std::size_t count)
+{
+	std::size_t wanted = indexSizeFor(count);
+	if (wanted > indexSize_)
+		rebuild(wanted);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t OrderedHashMap<K, V, Hash, Eq>::capacity() const
+{
+	return usableFor(indexSize_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q> inline
+std::size_t OrderedHashMap<K, V, Hash, Eq>::hashOf(Q const& key) const
+{
+	// The same Fibonacci hashing as HashMap, as the home slot is taken from
+	// the low bits.
+	std::uint64_t hash = static_cast<std::uint64_t>(hash_(key));
+	hash *= 0x9E3779B97F4A7C15ull;
+	return static_cast<std::size_t>(hash ^ (hash >> 32)) >> 1;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Q> inline
+std::size_t OrderedHashMap<K, V, Hash, Eq>::findIndex(
+	Q const& key, std::size_t hash) const
+{
+	if (size_ == 0)
+		return NotFound;
+
+	switch (width_) {
+	case 1:
+		return findIn<std::uint8_t>(key, hash);
+	case 2:
+		return findIn<std::uint16_t>(key, hash);
+	case 4:
+		return findIn<std::uint32_t>(key, hash);
+	default:
+		return findIn<std::uint64_t>(key, hash);
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename T, typename Q> inline
+std::size_t OrderedHashMap<K, V, Hash, Eq>::findIn(
+	Q const& key, std::size_t hash) const
+{
+	T const* index = static_cast<T const*>(index_);
+	const T empty = static_cast<T>(-1);
+	std::size_t mask = indexSize_ - 1;
+
+	// The index is at most two thirds full, so every run ends.  Comparing
+	// the stored hashes first keeps most misses away from the keys.
+	for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+		T position = index[i];
+		if (position == empty)
+			return NotFound;
+		if (hashes_[position] == hash && equal_(slots_[position].key_, key))
+			return position;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void OrderedHashMap<K, V, Hash, Eq>::place(
+	std::size_t hash, std::size_t position)
+{
+	switch (width_) {
+	case 1:
+		placeIn<std::uint8_t>(hash, position);
+		break;
+	case 2:
+		placeIn<std::uint16_t>(hash, position);
+		break;
+	case 4:
+		placeIn<std::uint32_t>(hash, position);
+		break;
+	default:
+		placeIn<std::uint64_t>(hash, position);
+		break;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename T> inline
+void OrderedHashMap<K, V, Hash, Eq>::placeIn(
+	std::size_t hash, std::size_t position)
+{
+	T* index = static_cast<T*>(index_);
+	const T empty = static_cast<T>(-1);
+	std::size_t mask = indexSize_ - 1;
+	std::size_t i = hash & mask;
+	while (index[i] != empty)
+		i = (i + 1) & mask;
+	index[i] = static_cast<T>(position);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void OrderedHashMap<K, V, Hash, Eq>::unplace(
+	std::size_t hash, std::size_t position)
+{
+	switch (width_) {
+	case 1:
+		unplaceIn<std::uint8_t>(hash, position);
+		break;
+	case 2:
+		unplaceIn<std::uint16_t>(hash, position);
+		break;
+	case 4:
+		unplaceIn<std::uint32_t>(hash, position);
+		break;
+	default:
+		unplaceIn<std::uint64_t>(hash, position);
+		break;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename T> inline
+void OrderedHashMap<K, V, Hash, Eq>::unplaceIn(
+	std::size_t hash, std::size_t position)
+{
+	T* index = static_cast<T*>(index_);
+	const T empty = static_cast<T>(-1);
+	std::size_t mask = indexSize_ - 1;
+	std::size_t hole = hash & mask;
+	while (index[hole] != static_cast<T>(position))
+		hole = (hole + 1) & mask;
+
+	// Backward-shift deletion, as in HashMap, so lookups can still stop at
+	// the first empty slot.
+	for (std::size_t next = (hole + 1) & mask; index[next] != empty;
+			next = (next + 1) & mask) {
+		std::size_t home = hashes_[index[next]] & mask;
+		bool staysPut = hole <= next
+			? (hole < home && home <= next)
+			: (hole < home || home <= next);
+		if (staysPut)
+			continue;
+
+		index[hole] = index[next];
+		hole = next;
+	}
+
+	index[hole] = empty;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename... Args> inline
+std::pair<V&, bool> OrderedHashMap<K, V, Hash, Eq>::findOrInsert(K& key,
+	Args&&... args)
+{
+	std::size_t hash = hashOf(key);
+	std::size_t position = findIndex(key, hash);
+	if (position != NotFound)
+		return {slots_[position].value_, false};
+
+	V value(std::forward<Args>(args)...);
+	if (used_ == usableFor(indexSize_))
+		// Full, though maybe of holes: compact, and grow only if at least
+		// half of the new array would be taken.
+		rebuild(indexSizeFor(2 * size_ + 1));
+
+	position = used_;
+	new (&slots_[position]) Slot{std::move(key), std::move(value)};
+	hashes_[position] = hash;
+	place(hash, position);
+	++used_;
+	++size_;
+	return {slots_[position].value_, true};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void OrderedHashMap<K, V, Hash, Eq>::rebuild(std::size_t newIndexSize)
+{
+	Slot* oldSlots = slots_;
+	std::size_t* oldHashes = hashes_;
+	void* oldIndex = index_;
+	std::size_t oldUsed = used_;
+
+	std::size_t usable = usableFor(newIndexSize);
+	std::size_t width = widthFor(newIndexSize);
+	Slot* newSlots = static_cast<Slot*>(::operator new(sizeof(Slot) * usable));
+	std::size_t* newHashes = nullptr;
+	void* newIndex = nullptr;
+	try {
+		newHashes = new std::size_t[usable];
+		newIndex = ::operator new(newIndexSize * width);
+	} catch (...) {
+		delete [] newHashes;
+		::operator delete(newSlots);
+		throw;
+	}
+	std::memset(newIndex, 0xFF, newIndexSize * width);
+
+	slots_ = newSlots;
+	hashes_ = newHashes;
+	index_ = newIndex;
+	indexSize_ = newIndexSize;
+	width_ = width;
+	used_ = 0;
+
+	for (std::size_t i = 0; i < oldUsed; ++i) {
+		if (oldHashes[i] == Removed)
+			continue;
+		new (&slots_[used_]) Slot(std::move(oldSlots[i]));
+		oldSlots[i].~Slot();
+		hashes_[used_] = oldHashes[i];
+		place(oldHashes[i], used_);
+		++used_;
+	}
+
+	::operator delete(oldSlots);
+	delete [] oldHashes;
+	::operator delete(oldIndex);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t OrderedHashMap<K, V, Hash, Eq>::usableFor(std::size_t indexSize)
+{
+	return indexSize * 2 / 3;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t OrderedHashMap<K, V, Hash, Eq>::widthFor(std::size_t indexSize)
+{
+	// Every position is below usableFor(indexSize), so it never reaches
+	// the all-ones value that marks an empty slot.
+	if (indexSize - 1 <= 0xFF)
+		return 1;
+	if (indexSize - 1 <= 0xFFFF)
+		return 2;
+	if (indexSize - 1 <= 0xFFFFFFFFul)
+		return 4;
+	return 8;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t OrderedHashMap<K, V, Hash, Eq>::indexSizeFor(std::size_t count)
+{
+	std::size_t indexSize = MinIndexSize;
+	while (usableFor(indexSize) < count)
+		indexSize <<= 1;
+	return indexSize;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t OrderedHashMap<K, V, Hash, Eq>::nextFull(
+	std::size_t position) const
+{
+	while (position < used_ && hashes_[position] == Removed)
+		++position;
+	return position;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename S> inline
+OrderedHashMap<K, V, Hash, Eq>::SlotCursor<S>::SlotCursor(
+	OrderedHashMap const* map, std::size_t index) : map_{map}, index_{index}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename S> inline
+typename OrderedHashMap<K, V, Hash, Eq>::template SlotCursor<S>&
+OrderedHashMap<K, V, Hash, Eq>::SlotCursor<S>::operator++()
+{
+	index_ = map_->nextFull(index_ + 1);
+	return *this;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename S> inline
+S& OrderedHashMap<K, V, Hash, Eq>::SlotCursor<S>::operator*() const
+{
+	return map_->slots_[index_];
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename S> inline
+bool OrderedHashMap<K, V, Hash, Eq>::SlotCursor<S>::operator==(
+	const SlotCursor& rhs) const
+{
+	return index_ == rhs.index_;
+}
+
+#endif
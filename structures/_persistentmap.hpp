@@ -0,0 +1,784 @@
+/**
+ * \file _persistentmap.hpp
+ * \brief Private implementation file of the persistent hash trie map.
+ */
+
+#ifndef _PERSISTENT_MAP_HPP
+#define _PERSISTENT_MAP_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#include "mapviews.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename K, typename V, typename Hash, typename Eq>
+const unsigned PersistentMap<K, V, Hash, Eq>::Bits;
+
+template <typename K, typename V, typename Hash, typename Eq>
+const unsigned PersistentMap<K, V, Hash, Eq>::HashBits;
+
+template <typename K, typename V, typename Hash, typename Eq>
+const unsigned PersistentMap<K, V, Hash, Eq>::MaxDepth;
+
+template <typename K, typename V, typename Hash, typename Eq>
+const bool PersistentMap<K, V, Hash, Eq>::NothrowMove;
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::size_t PersistentMap<K, V, Hash, Eq>::None;
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq>::PersistentMap() :
+	root_{nullptr}, size_{0}, hash_{}, equal_{}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename InputIt> inline
+PersistentMap<K, V, Hash, Eq>::PersistentMap(InputIt first, InputIt last) :
+	PersistentMap()
+{
+	for (; first != last; ++first) {
+		K key = first->first;
+		V value = first->second;
+		assignInPlace(key, value);
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq>::PersistentMap(
+	PersistentMap<K, V, Hash, Eq> const& orig) :
+	root_{orig.root_}, size_{orig.size_}, hash_{orig.hash_},
+	equal_{orig.equal_}
+{
+	if (root_ != nullptr)
+		retain(root_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq>::PersistentMap(
+	PersistentMap<K, V, Hash, Eq>&& other) : PersistentMap()
+{
+	swap(*this, other);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq>& PersistentMap<K, V, Hash, Eq>::operator=(
+	PersistentMap<K, V, Hash, Eq> rhs)
+{
+	swap(*this, rhs);
+	return *this;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void swap(PersistentMap<K, V, Hash, Eq>& lhs,
+	PersistentMap<K, V, Hash, Eq>& rhs)
+{
+	std::swap(lhs.root_, rhs.root_);
+	std::swap(lhs.size_, rhs.size_);
+	std::swap(lhs.hash_, rhs.hash_);
+	std::swap(lhs.equal_, rhs.equal_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq>::~PersistentMap()
+{
+	if (root_ != nullptr)
+		release(root_, 0);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq>::PersistentMap(Node* root, std::size_t size,
+	Hash const& hash, Eq const& equal) :
+	root_{root}, size_{size}, hash_{hash}, equal_{equal}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq> PersistentMap<K, V, Hash, Eq>::with(K key,
+	V value) const
+{
+	bool added = false;
+	Node* root = insert(root_, 0, hashOf(key), key, value, false, added);
+	return PersistentMap(root, size_ + (added ? 1 : 0), hash_, equal_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq> PersistentMap<K, V, Hash, Eq>::without(
+	K const& key) const
+{
+	if (findEntry(key) == nullptr)
+		return *this;
+	Node* root = remove(root_, 0, hashOf(key), key, false);
+	return PersistentMap(root, size_ - 1, hash_, equal_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V const& PersistentMap<K, V, Hash, Eq>::getValue(K const& key) const
+{
+	Entry* entry = findEntry(key);
+	if (entry == nullptr)
+		throw KeyError<K>{key, "PersistentMap"};
+	return entry->value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V const* PersistentMap<K, V, Hash, Eq>::find(K const& key) const
+{
+	Entry* entry = findEntry(key);
+	return entry == nullptr ? nullptr : &entry->value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool PersistentMap<K, V, Hash, Eq>::contains(K const& key) const
+{
+	return findEntry(key) != nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t PersistentMap<K, V, Hash, Eq>::size() const
+{
+	return size_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool PersistentMap<K, V, Hash, Eq>::isEmpty() const
+{
+	return size_ == 0;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::Transient
+PersistentMap<K, V, Hash, Eq>::transient() const
+{
+	return Transient(*this);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::keys_view
+PersistentMap<K, V, Hash, Eq>::keys() const
+{
+	return keys_view{EntryCursor(root_), EntryCursor(), size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::values_view
+PersistentMap<K, V, Hash, Eq>::values() const
+{
+	return values_view{EntryCursor(root_), EntryCursor(), size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::items_view
+PersistentMap<K, V, Hash, Eq>::items() const
+{
+	return items_view{EntryCursor(root_), EntryCursor(), size_};
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Fn> inline
+void PersistentMap<K, V, Hash, Eq>::forEach(Fn fn) const
+{
+	if (root_ != nullptr)
+		visit(root_, 0, fn);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq>::Transient::Transient(
+	PersistentMap<K, V, Hash, Eq> const& map) : map_{map}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool PersistentMap<K, V, Hash, Eq>::Transient::insertOrAssign(K key, V value)
+{
+	return map_.assignInPlace(key, value);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void PersistentMap<K, V, Hash, Eq>::Transient::removeValue(K const& key)
+{
+	if (map_.findEntry(key) == nullptr)
+		throw KeyError<K>{key, "PersistentMap"};
+	map_.removeInPlace(key);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V const* PersistentMap<K, V, Hash, Eq>::Transient::find(K const& key) const
+{
+	return map_.find(key);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool PersistentMap<K, V, Hash, Eq>::Transient::contains(K const& key) const
+{
+	return map_.contains(key);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t PersistentMap<K, V, Hash, Eq>::Transient::size() const
+{
+	return map_.size();
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool PersistentMap<K, V, Hash, Eq>::Transient::isEmpty() const
+{
+	return map_.isEmpty();
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq>
+PersistentMap<K, V, Hash, Eq>::Transient::persistent() const
+{
+	return map_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq>::NodeBuilder::NodeBuilder(
+	std::uint32_t dataMap, std::uint32_t nodeMap, std::size_t entries,
+	std::size_t children) : node_{nullptr}, entries_{entries}, built_{0}
+{
+	void* memory = ::operator new(
+		childOffset(entries) + children * sizeof(Node*));
+	node_ = new (memory) Node(dataMap, nodeMap);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq>::NodeBuilder::~NodeBuilder()
+{
+	if (node_ == nullptr)
+		return;
+	Entry* entries = entriesOf(node_);
+	for (std::size_t i = 0; i < built_; ++i)
+		entries[i].~Entry();
+	node_->~Node();
+	::operator delete(node_);
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Key, typename Value> inline
+void PersistentMap<K, V, Hash, Eq>::NodeBuilder::add(Key&& key,
+	Value&& value)
+{
+	new (entriesOf(node_) + built_) Entry{std::forward<Key>(key),
+		std::forward<Value>(value)};
+	++built_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void PersistentMap<K, V, Hash, Eq>::NodeBuilder::take(Entry& entry,
+	bool steal)
+{
+	if (steal)
+		new (entriesOf(node_) + built_) Entry(std::move(entry));
+	else
+		new (entriesOf(node_) + built_) Entry(entry);
+	++built_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::Node**
+PersistentMap<K, V, Hash, Eq>::NodeBuilder::children() const
+{
+	return reinterpret_cast<Node**>(
+		reinterpret_cast<char*>(node_) + childOffset(entries_));
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::Node*
+PersistentMap<K, V, Hash, Eq>::NodeBuilder::release()
+{
+	Node* node = node_;
+	node_ = nullptr;
+	return node;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq>::EntryCursor::EntryCursor() :
+	nodes_{}, positions_{}, depth_{0}, entry_{nullptr}
+{
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+PersistentMap<K, V, Hash, Eq>::EntryCursor::EntryCursor(Node* root) :
+	EntryCursor()
+{
+	if (root == nullptr)
+		return;
+	nodes_[0] = root;
+	depth_ = 1;
+	advance();
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::EntryCursor&
+PersistentMap<K, V, Hash, Eq>::EntryCursor::operator++()
+{
+	advance();
+	return *this;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::Entry const&
+PersistentMap<K, V, Hash, Eq>::EntryCursor::operator*() const
+{
+	return *entry_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool PersistentMap<K, V, Hash, Eq>::EntryCursor::operator==(
+	const EntryCursor& rhs) const
+{
+	return entry_ == rhs.entry_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void PersistentMap<K, V, Hash, Eq>::EntryCursor::advance()
+{
+	// Each node's pairs come before its children, as in forEach().
+	while (depth_ > 0) {
+		Node* node = nodes_[depth_ - 1];
+		unsigned shift = (depth_ - 1) * Bits;
+		std::size_t& position = positions_[depth_ - 1];
+		std::size_t entries = entryCount(node, shift);
+		if (position < entries) {
+			entry_ = &entriesOf(node)[position++];
+			return;
+		}
+		if (position < entries + childCount(node)) {
+			nodes_[depth_] = childrenOf(node, shift)[position++ - entries];
+			positions_[depth_] = 0;
+			++depth_;
+			continue;
+		}
+		--depth_;
+	}
+	entry_ = nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t PersistentMap<K, V, Hash, Eq>::hashOf(K const& key) const
+{
+	// Fibonacci hashing, as in HashMap, so that every level sees well mixed
+	// bits even from the identity hash of integers.
+	std::uint64_t hash = static_cast<std::uint64_t>(hash_(key));
+	hash *= 0x9E3779B97F4A7C15ull;
+	return static_cast<std::size_t>(hash ^ (hash >> 32));
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::uint32_t PersistentMap<K, V, Hash, Eq>::bitOf(std::size_t hash,
+	unsigned shift)
+{
+	return std::uint32_t{1} << ((hash >> shift) & 31);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t PersistentMap<K, V, Hash, Eq>::indexOf(std::uint32_t map,
+	std::uint32_t bit)
+{
+	return static_cast<std::size_t>(__builtin_popcount(map & (bit - 1)));
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t PersistentMap<K, V, Hash, Eq>::entryCount(Node const* node,
+	unsigned shift)
+{
+	return shift >= HashBits ? node->dataMap_
+		: static_cast<std::size_t>(__builtin_popcount(node->dataMap_));
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t PersistentMap<K, V, Hash, Eq>::childCount(Node const* node)
+{
+	return static_cast<std::size_t>(__builtin_popcount(node->nodeMap_));
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool PersistentMap<K, V, Hash, Eq>::isLone(Node const* node, unsigned shift)
+{
+	return node->nodeMap_ == 0 && entryCount(node, shift) == 1;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t PersistentMap<K, V, Hash, Eq>::entryOffset()
+{
+	static_assert(alignof(Entry) <= alignof(std::max_align_t),
+		"nodes are allocated with operator new's alignment");
+	return (sizeof(Node) + alignof(Entry) - 1) / alignof(Entry)
+		* alignof(Entry);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t PersistentMap<K, V, Hash, Eq>::childOffset(std::size_t entries)
+{
+	std::size_t end = entryOffset() + entries * sizeof(Entry);
+	return (end + alignof(Node*) - 1) / alignof(Node*) * alignof(Node*);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::Entry*
+PersistentMap<K, V, Hash, Eq>::entriesOf(Node* node)
+{
+	return reinterpret_cast<Entry*>(
+		reinterpret_cast<char*>(node) + entryOffset());
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::Node**
+PersistentMap<K, V, Hash, Eq>::childrenOf(Node* node, unsigned shift)
+{
+	return reinterpret_cast<Node**>(reinterpret_cast<char*>(node)
+		+ childOffset(entryCount(node, shift)));
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::Entry*
+PersistentMap<K, V, Hash, Eq>::findEntry(K const& key) const
+{
+	std::size_t hash = hashOf(key);
+	Node* node = root_;
+	for (unsigned shift = 0; node != nullptr; shift += Bits) {
+		Entry* entries = entriesOf(node);
+		if (shift >= HashBits) {
+			for (std::size_t i = 0; i < node->dataMap_; ++i)
+				if (equal_(entries[i].key_, key))
+					return &entries[i];
+			return nullptr;
+		}
+
+		std::uint32_t bit = bitOf(hash, shift);
+		if ((node->dataMap_ & bit) != 0) {
+			Entry* entry = &entries[indexOf(node->dataMap_, bit)];
+			return equal_(entry->key_, key) ? entry : nullptr;
+		}
+		if ((node->nodeMap_ & bit) == 0)
+			return nullptr;
+		node = childrenOf(node, shift)[indexOf(node->nodeMap_, bit)];
+	}
+	return nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::Node*
+PersistentMap<K, V, Hash, Eq>::insert(Node* node, unsigned shift,
+	std::size_t hash, K& key, V& value, bool edit, bool& added) const
+{
+	if (node == nullptr) {
+		NodeBuilder built(bitOf(hash, shift), 0, 1, 0);
+		built.add(std::move(key), std::move(value));
+		added = true;
+		return built.release();
+	}
+
+	// A node is changed in place only if the caller hands over the sole
+	// hold on it; below the first shared node, every node is copied.
+	bool unique = edit && node->refs_.load(std::memory_order_acquire) == 1;
+	std::uint32_t dataMap = node->dataMap_;
+	std::uint32_t nodeMap = node->nodeMap_;
+	Entry* entries = entriesOf(node);
+	auto none = [](NodeBuilder&) {};
+	auto pair = [&](NodeBuilder& built) {
+		built.add(std::move(key), std::move(value));
+	};
+
+	std::size_t index = 0;
+	if (shift >= HashBits) {
+		while (index < dataMap && !equal_(entries[index].key_, key))
+			++index;
+		if (index == dataMap) {
+			added = true;
+			return rebuild(node, shift, edit, unique, dataMap + 1, 0, None,
+				dataMap, pair, None, None, nullptr);
+		}
+	} else {
+		std::uint32_t bit = bitOf(hash, shift);
+		if ((nodeMap & bit) != 0) {
+			std::size_t slot = indexOf(nodeMap, bit);
+			Node** children = childrenOf(node, shift);
+			Node* child = insert(children[slot], shift + Bits, hash, key,
+				value, unique, added);
+			if (unique) {
+				children[slot] = child;
+				return node;
+			}
+			try {
+				return rebuild(node, shift, edit, false, dataMap, nodeMap,
+					None, None, none, slot, slot, child);
+			} catch (...) {
+				release(child, shift + Bits);
+				throw;
+			}
+		}
+
+		if ((dataMap & bit) == 0) {
+			added = true;
+			return rebuild(node, shift, edit, unique, dataMap | bit, nodeMap,
+				None, indexOf(dataMap, bit), pair, None, None, nullptr);
+		}
+
+		index = indexOf(dataMap, bit);
+		if (!equal_(entries[index].key_, key)) {
+			// The pair already here and the new one move down into a child
+			// of their own.
+			added = true;
+			Node* child = merge(entries[index], hashOf(entries[index].key_),
+				key, value, hash, shift + Bits);
+			try {
+				return rebuild(node, shift, edit, unique, dataMap ^ bit,
+					nodeMap | bit, index, None, none, None,
+					indexOf(nodeMap | bit, bit), child);
+			} catch (...) {
+				release(child, shift + Bits);
+				throw;
+			}
+		}
+	}
+
+	added = false;
+	if (unique) {
+		entries[index].value_ = std::move(value);
+		return node;
+	}
+	return rebuild(node, shift, edit, false, dataMap, nodeMap, index, index,
+		[&](NodeBuilder& built) {
+			built.add(entries[index].key_, std::move(value));
+		}, None, None, nullptr);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::Node*
+PersistentMap<K, V, Hash, Eq>::remove(Node* node, unsigned shift,
+	std::size_t hash, K const& key, bool edit) const
+{
+	bool unique = edit && node->refs_.load(std::memory_order_acquire) == 1;
+	std::uint32_t dataMap = node->dataMap_;
+	std::uint32_t nodeMap = node->nodeMap_;
+	auto none = [](NodeBuilder&) {};
+
+	std::size_t index = 0;
+	std::uint32_t restData = 0;
+	std::uint32_t restNodes = nodeMap;
+	std::size_t dropChild = None;
+	if (shift >= HashBits) {
+		Entry* entries = entriesOf(node);
+		while (!equal_(entries[index].key_, key))
+			++index;
+		restData = dataMap - 1;
+	} else {
+		std::uint32_t bit = bitOf(hash, shift);
+		if ((nodeMap & bit) == 0) {
+			index = indexOf(dataMap, bit);
+			restData = dataMap ^ bit;
+		} else {
+			std::size_t slot = indexOf(nodeMap, bit);
+			Node** children = childrenOf(node, shift);
+			Node* child = children[slot];
+			unsigned below = shift + Bits;
+			if (isLone(child, below)) {
+				// The key is the child's only pair, so the child goes.
+				index = None;
+				restData = dataMap;
+				restNodes = nodeMap ^ bit;
+				dropChild = slot;
+			} else {
+				Node* result = remove(child, below, hash, key, unique);
+				bool pullUp = isLone(result, below);
+				auto pull = [&](NodeBuilder& built) {
+					built.take(entriesOf(result)[0], NothrowMove);
+				};
+				if (unique) {
+					// The removal is done once the child is in place; lifting
+					// a lone pair into this node only makes the trie smaller,
+					// so a failure to allocate for it is not passed on.
+					children[slot] = result;
+					if (!pullUp)
+						return node;
+					try {
+						return rebuild(node, shift, edit, true, dataMap | bit,
+							nodeMap ^ bit, None, indexOf(dataMap, bit), pull,
+							slot, None, nullptr);
+					} catch (...) {
+						return node;
+					}
+				}
+
+				Node* replacement;
+				try {
+					if (pullUp)
+						replacement = rebuild(node, shift, edit, false,
+							dataMap | bit, nodeMap ^ bit, None,
+							indexOf(dataMap, bit), pull, slot, None, nullptr);
+					else
+						replacement = rebuild(node, shift, edit, false,
+							dataMap, nodeMap, None, None, none, slot, slot,
+							result);
+				} catch (...) {
+					release(result, below);
+					throw;
+				}
+				if (pullUp)
+					release(result, below);
+				return replacement;
+			}
+		}
+	}
+
+	if (restData == 0 && restNodes == 0) {
+		// Only the root can be left empty: a parent takes a lone pair into
+		// itself rather than keep a child for it.
+		if (edit)
+			release(node, shift);
+		return nullptr;
+	}
+	return rebuild(node, shift, edit, unique, restData, restNodes, index, None,
+		none, dropChild, None, nullptr);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename PersistentMap<K, V, Hash, Eq>::Node*
+PersistentMap<K, V, Hash, Eq>::merge(Entry& entry, std::size_t entryHash,
+	K& key, V& value, std::size_t hash, unsigned shift) const
+{
+	if (shift >= HashBits) {
+		NodeBuilder built(2, 0, 2, 0);
+		built.take(entry, false);
+		built.add(std::move(key), std::move(value));
+		return built.release();
+	}
+
+	std::uint32_t entryBit = bitOf(entryHash, shift);
+	std::uint32_t bit = bitOf(hash, shift);
+	if (entryBit == bit) {
+		NodeBuilder built(0, bit, 0, 1);
+		built.children()[0] = merge(entry, entryHash, key, value, hash,
+			shift + Bits);
+		return built.release();
+	}
+
+	NodeBuilder built(entryBit | bit, 0, 2, 0);
+	if (entryBit < bit) {
+		built.take(entry, false);
+		built.add(std::move(key), std::move(value));
+	} else {
+		built.add(std::move(key), std::move(value));
+		built.take(entry, false);
+	}
+	return built.release();
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Add> inline
+typename PersistentMap<K, V, Hash, Eq>::Node*
+PersistentMap<K, V, Hash, Eq>::rebuild(Node* node, unsigned shift, bool edit,
+	bool unique, std::uint32_t dataMap, std::uint32_t nodeMap,
+	std::size_t dropEntry, std::size_t addEntry, Add add,
+	std::size_t dropChild, std::size_t addChild, Node* child)
+{
+	// Moving the pairs cannot throw, so a node that is moved from is always
+	// freed; one that is copied from is left whole if a copy throws.
+	bool steal = unique && NothrowMove;
+	std::size_t entries = entryCount(node, shift)
+		- (dropEntry != None ? 1 : 0) + (addEntry != None ? 1 : 0);
+	std::size_t children = childCount(node)
+		- (dropChild != None ? 1 : 0) + (addChild != None ? 1 : 0);
+	NodeBuilder built(dataMap, nodeMap, entries, children);
+
+	Entry* from = entriesOf(node);
+	for (std::size_t i = 0, k = 0; k < entries; ++k) {
+		if (i == dropEntry)
+			++i;
+		if (k == addEntry)
+			add(built);
+		else
+			built.take(from[i++], steal);
+	}
+
+	Node** to = built.children();
+	Node** source = childrenOf(node, shift);
+	for (std::size_t i = 0, k = 0; k < children; ++k) {
+		if (i == dropChild)
+			++i;
+		if (k == addChild) {
+			to[k] = child;
+		} else {
+			to[k] = source[i++];
+			if (!unique)
+				retain(to[k]);
+		}
+	}
+
+	Node* result = built.release();
+	if (unique) {
+		if (dropChild != None)
+			release(source[dropChild], shift + Bits);
+		freeNode(node, shift);
+	} else if (edit) {
+		release(node, shift);
+	}
+	return result;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool PersistentMap<K, V, Hash, Eq>::assignInPlace(K& key, V& value)
+{
+	bool added = false;
+	root_ = insert(root_, 0, hashOf(key), key, value, true, added);
+	if (added)
+		++size_;
+	return added;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void PersistentMap<K, V, Hash, Eq>::removeInPlace(K const& key)
+{
+	root_ = remove(root_, 0, hashOf(key), key, true);
+	--size_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Fn> inline
+void PersistentMap<K, V, Hash, Eq>::visit(Node* node, unsigned shift, Fn& fn)
+{
+	Entry* entries = entriesOf(node);
+	for (std::size_t i = 0, count = entryCount(node, shift); i < count; ++i)
+		fn(static_cast<K const&>(entries[i].key_),
+			static_cast<V const&>(entries[i].value_));
+	Node** children = childrenOf(node, shift);
+	for (std::size_t i = 0, count = childCount(node); i < count; ++i)
+		visit(children[i], shift + Bits, fn);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void PersistentMap<K, V, Hash, Eq>::retain(Node* node)
+{
+	node->refs_.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void PersistentMap<K, V, Hash, Eq>::release(Node* node, unsigned shift)
+{
+	if (node->refs_.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+	Node** children = childrenOf(node, shift);
+	for (std::size_t i = 0, count = childCount(node); i < count; ++i)
+		release(children[i], shift + Bits);
+	freeNode(node, shift);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void PersistentMap<K, V, Hash, Eq>::freeNode(Node* node, unsigned shift)
+{
+	Entry* entries = entriesOf(node);
+	for (std::size_t i = 0, count = entryCount(node, shift); i < count; ++i)
+		entries[i].~Entry();
+	node->~Node();
+	::operator delete(node);
+}
+
+#endif
@@ -0,0 +1,685 @@
+/**
+ * \file _rbtreemap.hpp
+ * \brief Private implementation file of the red-black tree map.
+ */
+
+#ifndef _RBTREE_MAP_HPP
+#define _RBTREE_MAP_HPP 1
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename K, typename V>
+const std::size_t RBTreeMap<K, V>::FirstChunk;
+
+template <typename K, typename V>
+const std::size_t RBTreeMap<K, V>::MaxChunk;
+
+template <typename K, typename V> inline
+RBTreeMap<K, V>::Node::Node(K&& key, V&& value, Node* parent) :
+	key_(std::move(key)), value_(std::move(value)), parent_{parent},
+	left_{nullptr}, right_{nullptr}, red_{true}
+{
+}
+
+template <typename K, typename V> inline
+RBTreeMap<K, V>::RBTreeMap() :
+	root_{nullptr}, size_{0}, free_{nullptr}, chunks_{}, capacity_{0}
+{
+}
+
+template <typename K, typename V> inline
+RBTreeMap<K, V>::RBTreeMap(RBTreeMap<K, V> const& orig) : RBTreeMap()
+{
+	if (orig.size_ == 0)
+		return;
+	// The delegated constructor has finished, so if a copy throws the
+	// destructor frees the chunk.
+	grow(orig.size_);
+	root_ = clone(orig.root_, nullptr);
+	size_ = orig.size_;
+}
+
+template <typename K, typename V> inline
+RBTreeMap<K, V>::RBTreeMap(RBTreeMap<K, V>&& other) : RBTreeMap()
+{
+	swap(*this, other);
+}
+
+template <typename K, typename V> inline
+RBTreeMap<K, V>& RBTreeMap<K, V>::operator=(RBTreeMap<K, V> rhs)
+{
+	swap(*this, rhs);
+	return *this;
+}
+
+template <typename K, typename V> inline
+void swap(RBTreeMap<K, V>& lhs, RBTreeMap<K, V>& rhs)
+{
+	std::swap(lhs.root_, rhs.root_);
+	std::swap(lhs.size_, rhs.size_);
+	std::swap(lhs.free_, rhs.free_);
+	std::swap(lhs.chunks_, rhs.chunks_);
+	std::swap(lhs.capacity_, rhs.capacity_);
+}
+
+template <typename K, typename V> inline
+RBTreeMap<K, V>::~RBTreeMap()
+{
+	destroy(root_);
+	for (void* chunk : chunks_)
+		::operator delete(chunk);
+}
+
+template <typename K, typename V> inline
+void RBTreeMap<K, V>::addValue(K key, V value)
+{
+	if (!findOrInsert(key, std::move(value)).second)
+		throw KeyError<K>{key, "RBTreeMap"};
+}
+
+template <typename K, typename V> inline
+bool RBTreeMap<K, V>::insertOrAssign(K key, V value)
+{
+	std::pair<V&, bool> result = findOrInsert(key, std::move(value));
+	if (!result.second)
+		result.first = std::move(value);
+	return result.second;
+}
+
+template <typename K, typename V> template <typename... Args> inline
+std::pair<V&, bool> RBTreeMap<K, V>::tryEmplace(K key, Args&&... args)
+{
+	return findOrInsert(key, std::forward<Args>(args)...);
+}
+
+template <typename K, typename V> template <typename Fn> inline
+V& RBTreeMap<K, V>::upsert(K key, Fn fn)
+{
+	V& value = findOrInsert(key).first;
+	fn(value);
+	return value;
+}
+
+template <typename K, typename V> template <typename... Args> inline
+std::pair<V&, bool> RBTreeMap<K, V>::findOrInsert(K& key,
+	Args&&... args)
+{
+	Node* parent = nullptr;
+	Node** link = &root_;
+	while (*link != nullptr) {
+		parent = *link;
+		if (key < parent->key_)
+			link = &parent->left_;
+		else if (parent->key_ < key)
+			link = &parent->right_;
+		else
+			return {parent->value_, false};
+	}
+
+	Node* node = allocate(std::move(key), V(std::forward<Args>(args)...),
+		parent);
+	*link = node;
+	insertFixup(node);
+	++size_;
+	return {node->value_, true};
+}
+
+template <typename K, typename V> inline
+void RBTreeMap<K, V>::removeValue(K const& key)
+{
+	Node* node = find(key);
+	if (node == nullptr)
+		throw KeyError<K>{key, "RBTreeMap"};
+	unlink(node);
+	release(node);
+	--size_;
+}
+
+template <typename K, typename V> inline
+V& RBTreeMap<K, V>::getValue(K const& key) const
+{
+	Node* node = find(key);
+	if (node == nullptr)
+		throw KeyError<K>{key, "RBTreeMap"};
+	return node->value_;
+}
+
+template <typename K, typename V> template <typename Q, typename> inline
+V& RBTreeMap<K, V>::getValue(Q const& key) const
+{
+	Node* node = find(key);
+	if (node == nullptr)
+		throw KeyError<K>{key, "RBTreeMap"};
+	return node->value_;
+}
+
+template <typename K, typename V> inline
+std::size_t RBTreeMap<K, V>::size() const
+{
+	return size_;
+}
+
+template <typename K, typename V> inline
+bool RBTreeMap<K, V>::isEmpty() const
+{
+	return size_ == 0;
+}
+
+template <typename K, typename V> inline
+bool RBTreeMap<K, V>::contains(K const& key) const
+{
+	return find(key) != nullptr;
+}
+
+template <typename K, typename V> template <typename Q, typename> inline
+bool RBTreeMap<K, V>::contains(Q const& key) const
+{
+	return find(key) != nullptr;
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::const_iterator RBTreeMap<K, V>::floor(K const& key) const
+{
+	Node const* best = nullptr;
+	for (Node const* node = root_; node != nullptr; ) {
+		if (key < node->key_) {
+			node = node->left_;
+		} else {
+			best = node;
+			node = node->right_;
+		}
+	}
+	return const_iterator{best};
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::const_iterator RBTreeMap<K, V>::ceiling(K const& key) const
+{
+	Node const* best = nullptr;
+	for (Node const* node = root_; node != nullptr; ) {
+		if (node->key_ < key) {
+			node = node->right_;
+		} else {
+			best = node;
+			node = node->left_;
+		}
+	}
+	return const_iterator{best};
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::keys_view RBTreeMap<K, V>::keys() const
+{
+	Node const* first = root_ == nullptr ? nullptr : minimum(root_);
+	return keys_view{first, nullptr, size_};
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::values_view RBTreeMap<K, V>::values()
+{
+	Node* first = root_ == nullptr ? nullptr : minimum(root_);
+	return values_view{first, nullptr, size_};
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::const_values_view RBTreeMap<K, V>::values() const
+{
+	Node const* first = root_ == nullptr ? nullptr : minimum(root_);
+	return const_values_view{first, nullptr, size_};
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::items_view RBTreeMap<K, V>::items()
+{
+	Node* first = root_ == nullptr ? nullptr : minimum(root_);
+	return items_view{first, nullptr, size_};
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::const_items_view RBTreeMap<K, V>::items() const
+{
+	Node const* first = root_ == nullptr ? nullptr : minimum(root_);
+	return const_items_view{first, nullptr, size_};
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void RBTreeMap<K, V>::forEach(Fn fn)
+{
+	if (root_ == nullptr)
+		return;
+	for (Node* node = minimum(root_); node != nullptr; node = successor(node))
+		fn(static_cast<K const&>(node->key_), node->value_);
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void RBTreeMap<K, V>::forEach(Fn fn) const
+{
+	if (root_ == nullptr)
+		return;
+	for (Node const* node = minimum<Node const>(root_); node != nullptr;
+			node = successor(node))
+		fn(node->key_, static_cast<V const&>(node->value_));
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::const_iterator RBTreeMap<K, V>::begin() const
+{
+	return const_iterator{root_ == nullptr ? nullptr : minimum(root_)};
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::const_iterator RBTreeMap<K, V>::end() const
+{
+	return const_iterator{nullptr};
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::const_reverse_iterator
+RBTreeMap<K, V>::rbegin() const
+{
+	return const_reverse_iterator{root_ == nullptr ? nullptr : maximum(root_)};
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::const_reverse_iterator
+RBTreeMap<K, V>::rend() const
+{
+	return const_reverse_iterator{nullptr};
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+NodeT* RBTreeMap<K, V>::minimum(NodeT* node)
+{
+	while (node->left_ != nullptr)
+		node = node->left_;
+	return node;
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+NodeT* RBTreeMap<K, V>::maximum(NodeT* node)
+{
+	while (node->right_ != nullptr)
+		node = node->right_;
+	return node;
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+NodeT* RBTreeMap<K, V>::successor(NodeT* node)
+{
+	if (node->right_ != nullptr)
+		return minimum<NodeT>(node->right_);
+	NodeT* parent = node->parent_;
+	while (parent != nullptr && node == parent->right_) {
+		node = parent;
+		parent = parent->parent_;
+	}
+	return parent;
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+NodeT* RBTreeMap<K, V>::predecessor(NodeT* node)
+{
+	if (node->left_ != nullptr)
+		return maximum<NodeT>(node->left_);
+	NodeT* parent = node->parent_;
+	while (parent != nullptr && node == parent->left_) {
+		node = parent;
+		parent = parent->parent_;
+	}
+	return parent;
+}
+
+template <typename K, typename V> template <typename Q> inline
+typename RBTreeMap<K, V>::Node* RBTreeMap<K, V>::find(Q const& key) const
+{
+	Node* node = root_;
+	while (node != nullptr) {
+		if (key < node->key_)
+			node = node->left_;
+		else if (node->key_ < key)
+			node = node->right_;
+		else
+			return node;
+	}
+	return nullptr;
+}
+
+template <typename K, typename V> inline
+bool RBTreeMap<K, V>::isRed(Node const* node)
+{
+	return node != nullptr && node->red_;
+}
+
+template <typename K, typename V> inline
+void RBTreeMap<K, V>::replaceChild(Node* node, Node* replacement)
+{
+	Node* parent = node->parent_;
+	if (parent == nullptr)
+		root_ = replacement;
+	else if (node == parent->left_)
+		parent->left_ = replacement;
+	else
+		parent->right_ = replacement;
+	if (replacement != nullptr)
+		replacement->parent_ = parent;
+}
+
+template <typename K, typename V> inline
+void RBTreeMap<K, V>::rotateLeft(Node* node)
+{
+	Node* child = node->right_;
+	node->right_ = child->left_;
+	if (child->left_ != nullptr)
+		child->left_->parent_ = node;
+	replaceChild(node, child);
+	child->left_ = node;
+	node->parent_ = child;
+}
+
+template <typename K, typename V> inline
+void RBTreeMap<K, V>::rotateRight(Node* node)
+{
+	Node* child = node->left_;
+	node->left_ = child->right_;
+	if (child->right_ != nullptr)
+		child->right_->parent_ = node;
+	replaceChild(node, child);
+	child->right_ = node;
+	node->parent_ = child;
+}
+
+template <typename K, typename V> inline
+void RBTreeMap<K, V>::insertFixup(Node* node)
+{
+	Node* parent;
+	while ((parent = node->parent_) != nullptr && parent->red_) {
+		// A red parent is never the root, so the grandparent exists.
+		Node* grandparent = parent->parent_;
+		if (parent == grandparent->left_) {
+			Node* uncle = grandparent->right_;
+			if (isRed(uncle)) {
+				parent->red_ = false;
+				uncle->red_ = false;
+				grandparent->red_ = true;
+				node = grandparent;
+				continue;
+			}
+			if (node == parent->right_) {
+				rotateLeft(parent);
+				node = parent;
+				parent = node->parent_;
+			}
+			parent->red_ = false;
+			grandparent->red_ = true;
+			rotateRight(grandparent);
+		} else {
+			Node* uncle = grandparent->left_;
+			if (isRed(uncle)) {
+				parent->red_ = false;
+				uncle->red_ = false;
+				grandparent->red_ = true;
+				node = grandparent;
+				continue;
+			}
+			if (node == parent->left_) {
+				rotateRight(parent);
+				node = parent;
+				parent = node->parent_;
+			}
+			parent->red_ = false;
+			grandparent->red_ = true;
+			rotateLeft(grandparent);
+		}
+	}
+	root_->red_ = false;
+}
+
+template <typename K, typename V> inline
+void RBTreeMap<K, V>::unlink(Node* node)
+{
+	bool removedRed = node->red_;
+	Node* child;
+	Node* parent;
+	if (node->left_ == nullptr) {
+		child = node->right_;
+		parent = node->parent_;
+		replaceChild(node, child);
+	} else if (node->right_ == nullptr) {
+		child = node->left_;
+		parent = node->parent_;
+		replaceChild(node, child);
+	} else {
+		// Relink the successor into node's place instead of copying its
+		// pair over, so iterators to the successor stay valid.
+		Node* next = minimum(node->right_);
+		removedRed = next->red_;
+		child = next->right_;
+		if (next->parent_ == node) {
+			parent = next;
+		} else {
+			parent = next->parent_;
+			replaceChild(next, child);
+			next->right_ = node->right_;
+			next->right_->parent_ = next;
+		}
+		replaceChild(node, next);
+		next->left_ = node->left_;
+		next->left_->parent_ = next;
+		next->red_ = node->red_;
+	}
+
+	if (!removedRed)
+		eraseFixup(child, parent);
+}
+
+template <typename K, typename V> inline
+void RBTreeMap<K, V>::eraseFixup(Node* node, Node* parent)
+{
+	while (node != root_ && !isRed(node)) {
+		// node's side is one black short, so its sibling is never null.
+		if (node == parent->left_) {
+			Node* sibling = parent->right_;
+			if (sibling->red_) {
+				sibling->red_ = false;
+				parent->red_ = true;
+				rotateLeft(parent);
+				sibling = parent->right_;
+			}
+			if (!isRed(sibling->left_) && !isRed(sibling->right_)) {
+				sibling->red_ = true;
+				node = parent;
+				parent = node->parent_;
+				continue;
+			}
+			if (!isRed(sibling->right_)) {
+				sibling->left_->red_ = false;
+				sibling->red_ = true;
+				rotateRight(sibling);
+				sibling = parent->right_;
+			}
+			sibling->red_ = parent->red_;
+			parent->red_ = false;
+			sibling->right_->red_ = false;
+			rotateLeft(parent);
+		} else {
+			Node* sibling = parent->left_;
+			if (sibling->red_) {
+				sibling->red_ = false;
+				parent->red_ = true;
+				rotateRight(parent);
+				sibling = parent->left_;
+			}
+			if (!isRed(sibling->left_) && !isRed(sibling->right_)) {
+				sibling->red_ = true;
+				node = parent;
+				parent = node->parent_;
+				continue;
+			}
+			if (!isRed(sibling->left_)) {
+				sibling->right_->red_ = false;
+				sibling->red_ = true;
+				rotateLeft(sibling);
+				sibling = parent->left_;
+			}
+			sibling->red_ = parent->red_;
+			parent->red_ = false;
+			sibling->left_->red_ = false;
+			rotateRight(parent);
+		}
+		node = root_;
+	}
+	if (node != nullptr)
+		node->red_ = false;
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::Node* RBTreeMap<K, V>::allocate(K&& key, V&& value,
+	Node* parent)
+{
+	if (free_ == nullptr) {
+		std::size_t count = capacity_ < FirstChunk ? FirstChunk : capacity_;
+		grow(count < MaxChunk ? count : MaxChunk);
+	}
+
+	FreeSlot* slot = free_;
+	free_ = slot->next_;
+	try {
+		return new (slot) Node(std::move(key), std::move(value), parent);
+	} catch (...) {
+		free_ = new (slot) FreeSlot{free_};
+		throw;
+	}
+}
+
+template <typename K, typename V> inline
+void RBTreeMap<K, V>::release(Node* node)
+{
+	node->~Node();
+	free_ = new (node) FreeSlot{free_};
+}
+
+template <typename K, typename V> inline
+void RBTreeMap<K, V>::grow(std::size_t count)
+{
+	// Make room in the list first, so that recording the chunk cannot
+	// throw and leak it.
+	chunks_.push_back(nullptr);
+	Node* chunk;
+	try {
+		chunk = static_cast<Node*>(::operator new(count * sizeof(Node)));
+	} catch (...) {
+		chunks_.pop_back();
+		throw;
+	}
+	chunks_.back() = chunk;
+	for (std::size_t i = count; i > 0; --i)
+		free_ = new (chunk + i - 1) FreeSlot{free_};
+	capacity_ += count;
+}
+
+template <typename K, typename V> inline
+typename RBTreeMap<K, V>::Node* RBTreeMap<K, V>::clone(Node const* node,
+	Node* parent)
+{
+	if (node == nullptr)
+		return nullptr;
+
+	K key{node->key_};
+	V value{node->value_};
+	Node* copy = allocate(std::move(key), std::move(value), parent);
+	copy->red_ = node->red_;
+	try {
+		copy->left_ = clone(node->left_, copy);
+		copy->right_ = clone(node->right_, copy);
+	} catch (...) {
+		destroy(copy);
+		throw;
+	}
+	return copy;
+}
+
+template <typename K, typename V> inline
+void RBTreeMap<K, V>::destroy(Node* node)
+{
+	// Only the pairs need destroying; the chunks are freed as a whole.
+	while (node != nullptr) {
+		destroy(node->right_);
+		Node* left = node->left_;
+		node->~Node();
+		node = left;
+	}
+}
+
+template <typename K, typename V> template <bool Forward> inline
+typename RBTreeMap<K, V>::template Iterator<Forward>&
+RBTreeMap<K, V>::Iterator<Forward>::operator++()
+{
+	current_ = Forward ? successor(current_) : predecessor(current_);
+	return *this;
+}
+
+template <typename K, typename V> template <bool Forward> inline
+typename RBTreeMap<K, V>::template Iterator<Forward>
+RBTreeMap<K, V>::Iterator<Forward>::operator++(int)
+{
+	Iterator old{*this};
+	++*this;
+	return old;
+}
+
+template <typename K, typename V> template <bool Forward> inline
+const K& RBTreeMap<K, V>::Iterator<Forward>::operator*() const
+{
+	return current_->key_;
+}
+
+template <typename K, typename V> template <bool Forward> inline
+const K* RBTreeMap<K, V>::Iterator<Forward>::operator->() const
+{
+	return &current_->key_;
+}
+
+template <typename K, typename V> template <bool Forward> inline
+bool RBTreeMap<K, V>::Iterator<Forward>::operator==(
+	const Iterator& rhs) const
+{
+	return current_ == rhs.current_;
+}
+
+template <typename K, typename V> template <bool Forward> inline
+bool RBTreeMap<K, V>::Iterator<Forward>::operator!=(
+	const Iterator& rhs) const
+{
+	return !(*this == rhs);
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+typename RBTreeMap<K, V>::template NodeCursor<NodeT>&
+RBTreeMap<K, V>::NodeCursor<NodeT>::operator++()
+{
+	node_ = successor(node_);
+	return *this;
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+NodeT& RBTreeMap<K, V>::NodeCursor<NodeT>::operator*() const
+{
+	return *node_;
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+bool RBTreeMap<K, V>::NodeCursor<NodeT>::operator==(
+	const NodeCursor& rhs) const
+{
+	return node_ == rhs.node_;
+}
+
+#endif
@@ -0,0 +1,572 @@
+/**
+ * \file _scapegoatmap.hpp
+ * \brief Private implementation file of the scapegoat tree map.
+ */
+
+#ifndef _SCAPEGOAT_MAP_HPP
+#define _SCAPEGOAT_MAP_HPP 1
+
+#include <cmath>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename K, typename V>
+constexpr double ScapegoatMap<K, V>::DefaultAlpha;
+
+template <typename K, typename V>
+const std::size_t ScapegoatMap<K, V>::FirstChunk;
+
+template <typename K, typename V>
+const std::size_t ScapegoatMap<K, V>::MaxChunk;
+
+template <typename K, typename V> inline
+ScapegoatMap<K, V>::Node::Node(K&& key, V&& value) :
+	key_(std::move(key)), value_(std::move(value)), left_{nullptr},
+	right_{nullptr}
+{
+}
+
+template <typename K, typename V> inline
+ScapegoatMap<K, V>::Node::Node(K const& key, V const& value) :
+	key_(key), value_(value), left_{nullptr}, right_{nullptr}
+{
+}
+
+template <typename K, typename V> inline
+ScapegoatMap<K, V>::ScapegoatMap(double alpha) :
+	root_{nullptr}, size_{0}, maxSize_{0}, alpha_{0}, inverseLogAlpha_{0},
+	free_{nullptr}, blocks_{}, capacity_{0}, scratch_{}
+{
+	setAlpha(alpha);
+}
+
+template <typename K, typename V> inline
+ScapegoatMap<K, V>::ScapegoatMap(ScapegoatMap<K, V> const& orig) :
+	ScapegoatMap(orig.alpha_)
+{
+	orig.collect(orig.root_, scratch_);
+	root_ = layout(scratch_, true);
+	scratch_.clear();
+	size_ = maxSize_ = capacity_ = orig.size_;
+}
+
+template <typename K, typename V> inline
+ScapegoatMap<K, V>::ScapegoatMap(ScapegoatMap<K, V>&& other) :
+	ScapegoatMap(other.alpha_)
+{
+	swap(*this, other);
+}
+
+template <typename K, typename V> inline
+ScapegoatMap<K, V>& ScapegoatMap<K, V>::operator=(ScapegoatMap<K, V> rhs)
+{
+	swap(*this, rhs);
+	return *this;
+}
+
+template <typename K, typename V> inline
+void swap(ScapegoatMap<K, V>& lhs, ScapegoatMap<K, V>& rhs)
+{
+	std::swap(lhs.root_, rhs.root_);
+	std::swap(lhs.size_, rhs.size_);
+	std::swap(lhs.maxSize_, rhs.maxSize_);
+	std::swap(lhs.alpha_, rhs.alpha_);
+	std::swap(lhs.inverseLogAlpha_, rhs.inverseLogAlpha_);
+	std::swap(lhs.free_, rhs.free_);
+	std::swap(lhs.blocks_, rhs.blocks_);
+	std::swap(lhs.capacity_, rhs.capacity_);
+	std::swap(lhs.scratch_, rhs.scratch_);
+}
+
+template <typename K, typename V> inline
+ScapegoatMap<K, V>::~ScapegoatMap()
+{
+	destroy(root_);
+	for (void* block : blocks_)
+		::operator delete(block);
+}
+
+template <typename K, typename V> inline
+void ScapegoatMap<K, V>::addValue(K key, V value)
+{
+	if (!findOrInsert(key, std::move(value)).second)
+		throw KeyError<K>{key, "ScapegoatMap"};
+}
+
+template <typename K, typename V> inline
+bool ScapegoatMap<K, V>::insertOrAssign(K key, V value)
+{
+	std::pair<V&, bool> result = findOrInsert(key, std::move(value));
+	if (!result.second)
+		result.first = std::move(value);
+	return result.second;
+}
+
+template <typename K, typename V> template <typename... Args> inline
+std::pair<V&, bool> ScapegoatMap<K, V>::tryEmplace(K key, Args&&... args)
+{
+	return findOrInsert(key, std::forward<Args>(args)...);
+}
+
+template <typename K, typename V> template <typename Fn> inline
+V& ScapegoatMap<K, V>::upsert(K key, Fn fn)
+{
+	V& value = findOrInsert(key).first;
+	fn(value);
+	return value;
+}
+
+template <typename K, typename V> template <typename... Args> inline
+std::pair<V&, bool> ScapegoatMap<K, V>::findOrInsert(K& key,
+	Args&&... args)
+{
+	// The path is kept in scratch_ so that the scapegoat can be found
+	// without parent links.
+	scratch_.clear();
+	Node** link = &root_;
+	while (*link != nullptr) {
+		Node* node = *link;
+		scratch_.push_back(node);
+		if (key < node->key_)
+			link = &node->left_;
+		else if (node->key_ < key)
+			link = &node->right_;
+		else
+			return {node->value_, false};
+	}
+
+	Node* child = allocate(std::move(key), V(std::forward<Args>(args)...));
+	*link = child;
+	++size_;
+	if (size_ > maxSize_)
+		maxSize_ = size_;
+	if (scratch_.size() <= depthLimit(size_))
+		return {child->value_, true};
+
+	// Rebuilding moves the pairs into new nodes, so the new pair is looked
+	// up again afterwards by a copy of its key.
+	K added = child->key_;
+
+	// Climb until some ancestor is out of alpha-balance; one must be, or
+	// the new node could not be this deep.
+	std::size_t childSize = 1;
+	for (std::size_t depth = scratch_.size(); depth > 0; --depth) {
+		Node* parent = scratch_[depth - 1];
+		Node* sibling = parent->left_ == child ? parent->right_ : parent->left_;
+		std::size_t parentSize = childSize + 1 + count(sibling);
+		if (childSize > alpha_ * parentSize) {
+			if (depth == 1) {
+				rebuild(&root_, parentSize);
+				maxSize_ = size_;
+			} else {
+				Node* grandparent = scratch_[depth - 2];
+				rebuild(grandparent->left_ == parent ? &grandparent->left_ :
+					&grandparent->right_, parentSize);
+			}
+			break;
+		}
+		childSize = parentSize;
+		child = parent;
+	}
+	return {find(added)->value_, true};
+}
+
+template <typename K, typename V> inline
+void ScapegoatMap<K, V>::removeValue(K const& key)
+{
+	Node** link = &root_;
+	while (*link != nullptr && (key < (*link)->key_ || (*link)->key_ < key))
+		link = key < (*link)->key_ ? &(*link)->left_ : &(*link)->right_;
+	Node* node = *link;
+	if (node == nullptr)
+		throw KeyError<K>{key, "ScapegoatMap"};
+
+	// Relink rather than move pairs, so nothing here can throw.
+	if (node->left_ == nullptr) {
+		*link = node->right_;
+	} else if (node->right_ == nullptr) {
+		*link = node->left_;
+	} else {
+		Node** nextLink = &node->right_;
+		while ((*nextLink)->left_ != nullptr)
+			nextLink = &(*nextLink)->left_;
+		Node* next = *nextLink;
+		*nextLink = next->right_;
+		next->left_ = node->left_;
+		next->right_ = node->right_;
+		*link = next;
+	}
+	release(node);
+	--size_;
+
+	if (size_ < alpha_ * maxSize_)
+		compact();
+}
+
+template <typename K, typename V> inline
+V& ScapegoatMap<K, V>::getValue(K const& key) const
+{
+	Node* node = find(key);
+	if (node == nullptr)
+		throw KeyError<K>{key, "ScapegoatMap"};
+	return node->value_;
+}
+
+template <typename K, typename V> template <typename Q, typename> inline
+V& ScapegoatMap<K, V>::getValue(Q const& key) const
+{
+	Node* node = find(key);
+	if (node == nullptr)
+		throw KeyError<K>{key, "ScapegoatMap"};
+	return node->value_;
+}
+
+template <typename K, typename V> inline
+std::size_t ScapegoatMap<K, V>::size() const
+{
+	return size_;
+}
+
+template <typename K, typename V> inline
+bool ScapegoatMap<K, V>::isEmpty() const
+{
+	return size_ == 0;
+}
+
+template <typename K, typename V> inline
+bool ScapegoatMap<K, V>::contains(K const& key) const
+{
+	return find(key) != nullptr;
+}
+
+template <typename K, typename V> template <typename Q, typename> inline
+bool ScapegoatMap<K, V>::contains(Q const& key) const
+{
+	return find(key) != nullptr;
+}
+
+template <typename K, typename V> inline
+double ScapegoatMap<K, V>::alpha() const
+{
+	return alpha_;
+}
+
+template <typename K, typename V> inline
+void ScapegoatMap<K, V>::setAlpha(double alpha)
+{
+	alpha_ = alpha < 0.5 ? 0.5 : alpha > 0.95 ? 0.95 : alpha;
+	inverseLogAlpha_ = 1 / std::log(1 / alpha_);
+}
+
+template <typename K, typename V> inline
+std::size_t ScapegoatMap<K, V>::height() const
+{
+	return levels(root_);
+}
+
+template <typename K, typename V> inline
+typename ScapegoatMap<K, V>::keys_view ScapegoatMap<K, V>::keys() const
+{
+	return keys_view{{root_, first()}, {root_, nullptr}, size_};
+}
+
+template <typename K, typename V> inline
+typename ScapegoatMap<K, V>::values_view ScapegoatMap<K, V>::values()
+{
+	return values_view{{root_, first()}, {root_, nullptr}, size_};
+}
+
+template <typename K, typename V> inline
+typename ScapegoatMap<K, V>::const_values_view
+ScapegoatMap<K, V>::values() const
+{
+	return const_values_view{{root_, first()}, {root_, nullptr}, size_};
+}
+
+template <typename K, typename V> inline
+typename ScapegoatMap<K, V>::items_view ScapegoatMap<K, V>::items()
+{
+	return items_view{{root_, first()}, {root_, nullptr}, size_};
+}
+
+template <typename K, typename V> inline
+typename ScapegoatMap<K, V>::const_items_view
+ScapegoatMap<K, V>::items() const
+{
+	return const_items_view{{root_, first()}, {root_, nullptr}, size_};
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void ScapegoatMap<K, V>::forEach(Fn fn)
+{
+	visit<Node>(root_, fn);
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void ScapegoatMap<K, V>::forEach(Fn fn) const
+{
+	visit<Node const>(root_, fn);
+}
+
+template <typename K, typename V> inline
+std::size_t ScapegoatMap<K, V>::depthLimit(std::size_t size) const
+{
+	return static_cast<std::size_t>(std::log(size) * inverseLogAlpha_);
+}
+
+template <typename K, typename V> inline
+typename ScapegoatMap<K, V>::Node* ScapegoatMap<K, V>::first() const
+{
+	Node* node = root_;
+	if (node != nullptr)
+		while (node->left_ != nullptr)
+			node = node->left_;
+	return node;
+}
+
+template <typename K, typename V> template <typename Q> inline
+typename ScapegoatMap<K, V>::Node* ScapegoatMap<K, V>::find(
+	Q const& key) const
+{
+	Node* node = root_;
+	while (node != nullptr) {
+		if (key < node->key_)
+			node = node->left_;
+		else if (node->key_ < key)
+			node = node->right_;
+		else
+			return node;
+	}
+	return nullptr;
+}
+
+// The tree's depth is logarithmic, so the recursive helpers below cannot
+// run deep.
+
+template <typename K, typename V> inline
+std::size_t ScapegoatMap<K, V>::count(Node const* node)
+{
+	if (node == nullptr)
+		return 0;
+	return 1 + count(node->left_) + count(node->right_);
+}
+
+template <typename K, typename V> inline
+std::size_t ScapegoatMap<K, V>::levels(Node const* node)
+{
+	if (node == nullptr)
+		return 0;
+	std::size_t left = levels(node->left_);
+	std::size_t right = levels(node->right_);
+	return 1 + (left < right ? right : left);
+}
+
+template <typename K, typename V> inline
+void ScapegoatMap<K, V>::collect(Node* node, std::vector<Node*>& nodes)
+{
+	if (node == nullptr)
+		return;
+	collect(node->left_, nodes);
+	nodes.push_back(node);
+	collect(node->right_, nodes);
+}
+
+template <typename K, typename V> template <typename NodeT, typename Fn>
+inline void ScapegoatMap<K, V>::visit(NodeT* node, Fn& fn)
+{
+	if (node == nullptr)
+		return;
+	visit<NodeT>(node->left_, fn);
+	fn(static_cast<K const&>(node->key_), node->value_);
+	visit<NodeT>(node->right_, fn);
+}
+
+template <typename K, typename V> inline
+typename ScapegoatMap<K, V>::Node* ScapegoatMap<K, V>::layout(
+	std::vector<Node*> const& nodes, bool copy)
+{
+	if (nodes.empty())
+		return nullptr;
+
+	// Each pending range of nodes becomes a subtree whose root is its
+	// middle node.  Taking ranges first in, first out puts the block in
+	// breadth-first order.
+	struct Range
+	{
+		std::size_t first_;
+		std::size_t last_;
+		Node** link_;
+	};
+	std::vector<Range> ranges;
+	ranges.reserve(nodes.size());
+	Node* block =
+		static_cast<Node*>(::operator new(nodes.size() * sizeof(Node)));
+
+	Node* root = nullptr;
+	std::size_t built = 0;
+	try {
+		blocks_.push_back(block);
+		ranges.push_back(Range{0, nodes.size(), &root});
+		for (std::size_t next = 0; next < ranges.size(); ++next) {
+			Range range = ranges[next];
+			std::size_t middle = range.first_ + (range.last_ - range.first_) / 2;
+			Node* from = nodes[middle];
+			Node* node = copy ?
+				new (block + built) Node(
+					static_cast<K const&>(from->key_),
+					static_cast<V const&>(from->value_)) :
+				new (block + built) Node(std::move_if_noexcept(from->key_),
+					std::move_if_noexcept(from->value_));
+			++built;
+			*range.link_ = node;
+			if (range.first_ < middle)
+				ranges.push_back(Range{range.first_, middle, &node->left_});
+			if (middle + 1 < range.last_)
+				ranges.push_back(Range{middle + 1, range.last_, &node->right_});
+		}
+	} catch (...) {
+		while (built > 0)
+			block[--built].~Node();
+		if (!blocks_.empty() && blocks_.back() == block)
+			blocks_.pop_back();
+		::operator delete(block);
+		throw;
+	}
+	return root;
+}
+
+template <typename K, typename V> inline
+void ScapegoatMap<K, V>::rebuild(Node** link, std::size_t count)
+{
+	// Compact once the unused slots, counting the ones this rebuild frees,
+	// outnumber the pairs.  The slack of one chunk keeps a freshly grown
+	// chunk from forcing a compaction on every rebuild.
+	if (capacity_ + count > 2 * size_ + MaxChunk) {
+		compact();
+		return;
+	}
+
+	scratch_.clear();
+	collect(*link, scratch_);
+	*link = layout(scratch_, false);
+	capacity_ += count;
+	for (Node* node : scratch_)
+		release(node);
+	scratch_.clear();
+}
+
+template <typename K, typename V> inline
+void ScapegoatMap<K, V>::compact()
+{
+	std::vector<void*> blocks;
+	blocks_.swap(blocks);
+
+	std::vector<Node*> nodes;
+	try {
+		nodes.reserve(size_);
+		collect(root_, nodes);
+		root_ = layout(nodes, false);
+	} catch (...) {
+		blocks_.swap(blocks);
+		throw;
+	}
+
+	for (Node* node : nodes)
+		node->~Node();
+	for (void* block : blocks)
+		::operator delete(block);
+	free_ = nullptr;
+	capacity_ = size_;
+	maxSize_ = size_;
+}
+
+template <typename K, typename V> inline
+typename ScapegoatMap<K, V>::Node* ScapegoatMap<K, V>::allocate(K&& key,
+	V&& value)
+{
+	if (free_ == nullptr) {
+		std::size_t count = size_ < FirstChunk ? FirstChunk :
+			size_ < MaxChunk ? size_ : MaxChunk;
+		// Make room in the list first, so that recording the chunk cannot
+		// throw and leak it.
+		blocks_.push_back(nullptr);
+		Node* chunk;
+		try {
+			chunk = static_cast<Node*>(::operator new(count * sizeof(Node)));
+		} catch (...) {
+			blocks_.pop_back();
+			throw;
+		}
+		blocks_.back() = chunk;
+		for (std::size_t i = count; i > 0; --i)
+			free_ = new (chunk + i - 1) FreeSlot{free_};
+		capacity_ += count;
+	}
+
+	FreeSlot* slot = free_;
+	free_ = slot->next_;
+	try {
+		return new (slot) Node(std::move(key), std::move(value));
+	} catch (...) {
+		free_ = new (slot) FreeSlot{free_};
+		throw;
+	}
+}
+
+template <typename K, typename V> inline
+void ScapegoatMap<K, V>::release(Node* node)
+{
+	node->~Node();
+	free_ = new (node) FreeSlot{free_};
+}
+
+template <typename K, typename V> inline
+void ScapegoatMap<K, V>::destroy(Node* node)
+{
+	if (node == nullptr)
+		return;
+	destroy(node->left_);
+	destroy(node->right_);
+	node->~Node();
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+typename ScapegoatMap<K, V>::template NodeCursor<NodeT>&
+ScapegoatMap<K, V>::NodeCursor<NodeT>::operator++()
+{
+	// The successor is the last node at which the search for the current
+	// key turns left.
+	NodeT* next = nullptr;
+	for (NodeT* node = root_; node != nullptr; ) {
+		if (node_->key_ < node->key_) {
+			next = node;
+			node = node->left_;
+		} else {
+			node = node->right_;
+		}
+	}
+	node_ = next;
+	return *this;
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+NodeT& ScapegoatMap<K, V>::NodeCursor<NodeT>::operator*() const
+{
+	return *node_;
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+bool ScapegoatMap<K, V>::NodeCursor<NodeT>::operator==(
+	const NodeCursor& rhs) const
+{
+	return node_ == rhs.node_;
+}
+
+#endif
@@ -0,0 +1,171 @@
+/**
+ * \file _slidingwindow.hpp
+ * \brief Private implementation file for the sliding window aggregates.
+ */
+
+#ifndef _SLIDING_WINDOW_HPP
+#define _SLIDING_WINDOW_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+
+#include "deque.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename T> inline
+void WindowMin<T>::add(T const& value)
+{
+	// Anything larger than the newcomer can never be the minimum again.
+	while (!candidates_.isEmpty() && value < candidates_.getTail())
+		candidates_.removeTail();
+	candidates_.append(value);
+}
+
+template <typename T> inline
+void WindowMin<T>::evict(T const& value)
+{
+	if (!candidates_.isEmpty() && !(candidates_.getHead() < value) &&
+			!(value < candidates_.getHead()))
+		candidates_.remove();
+}
+
+template <typename T> inline
+T WindowMin<T>::value() const
+{
+	return candidates_.getHead();
+}
+
+template <typename T> inline
+void WindowMax<T>::add(T const& value)
+{
+	while (!candidates_.isEmpty() && candidates_.getTail() < value)
+		candidates_.removeTail();
+	candidates_.append(value);
+}
+
+template <typename T> inline
+void WindowMax<T>::evict(T const& value)
+{
+	if (!candidates_.isEmpty() && !(candidates_.getHead() < value) &&
+			!(value < candidates_.getHead()))
+		candidates_.remove();
+}
+
+template <typename T> inline
+T WindowMax<T>::value() const
+{
+	return candidates_.getHead();
+}
+
+template <typename T> inline
+WindowSum<T>::WindowSum() : total_() {}
+
+template <typename T> inline
+void WindowSum<T>::add(T const& value)
+{
+	total_ += value;
+}
+
+template <typename T> inline
+void WindowSum<T>::evict(T const& value)
+{
+	total_ -= value;
+}
+
+template <typename T> inline
+T WindowSum<T>::value() const
+{
+	return total_;
+}
+
+template <typename T> inline
+WindowMean<T>::WindowMean() : total_(), count_{0} {}
+
+template <typename T> inline
+void WindowMean<T>::add(T const& value)
+{
+	total_ += value;
+	++count_;
+}
+
+template <typename T> inline
+void WindowMean<T>::evict(T const& value)
+{
+	total_ -= value;
+	--count_;
+}
+
+template <typename T> inline
+double WindowMean<T>::value() const
+{
+	if (count_ == 0)
+		throw IndexOutOfBoundsException(0, "SlidingWindow");
+	return static_cast<double>(total_) / static_cast<double>(count_);
+}
+
+template <typename T, typename Agg> inline
+SlidingWindow<T, Agg>::SlidingWindow(
+	std::size_t maxCount, std::uint64_t maxAge) :
+		samples_{},
+		aggregate_{},
+		maxCount_{maxCount},
+		maxAge_{maxAge}
+{
+}
+
+template <typename T, typename Agg> inline
+void SlidingWindow<T, Agg>::push(T value, std::uint64_t timestamp)
+{
+	samples_.append(Sample{value, timestamp});
+	aggregate_.add(value);
+
+	if (maxCount_ != 0)
+		while (samples_.size() > maxCount_)
+			evictOldest();
+	advance(timestamp);
+}
+
+template <typename T, typename Agg> inline
+void SlidingWindow<T, Agg>::advance(std::uint64_t now)
+{
+	if (maxAge_ == 0)
+		return;
+
+	while (!samples_.isEmpty() &&
+			samples_.getHead().timestamp_ + maxAge_ <= now)
+		evictOldest();
+}
+
+template <typename T, typename Agg> inline
+typename Agg::result_type SlidingWindow<T, Agg>::value() const
+{
+	return aggregate_.value();
+}
+
+template <typename T, typename Agg> inline
+std::size_t SlidingWindow<T, Agg>::size() const
+{
+	return samples_.size();
+}
+
+template <typename T, typename Agg> inline
+bool SlidingWindow<T, Agg>::isEmpty() const
+{
+	return samples_.isEmpty();
+}
+
+template <typename T, typename Agg> inline
+void SlidingWindow<T, Agg>::evictOldest()
+{
+	aggregate_.evict(samples_.getHead().value_);
+	samples_.remove();
+}
+
+template <typename T, typename Agg> inline
+bool SlidingWindow<T, Agg>::Sample::operator==(Sample const& s) const
+{
+	return timestamp_ == s.timestamp_ && value_ == s.value_;
+}
+
+#endif
@@ -0,0 +1,508 @@
+/**
+ * \file _smallmap.hpp
+ * \brief Private implementation file of the small map.
+ */
+
+#ifndef _SMALL_MAP_HPP
+#define _SMALL_MAP_HPP 1
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+#include "hashmap.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+const std::size_t SmallMap<K, V, N, Hash, Eq>::NotFound;
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+const bool SmallMap<K, V, N, Hash, Eq>::NothrowMove;
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+SmallMap<K, V, N, Hash, Eq>::SmallMap() :
+	keys_{},
+	values_{},
+	count_{0},
+	promoted_{false},
+	equal_{},
+	table_{}
+{
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename InputIt> inline
+SmallMap<K, V, N, Hash, Eq>::SmallMap(InputIt first, InputIt last) :
+	SmallMap()
+{
+	insertBatch(first, last);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+SmallMap<K, V, N, Hash, Eq>::SmallMap(SmallMap<K, V, N, Hash, Eq> const& orig) :
+	SmallMap()
+{
+	equal_ = orig.equal_;
+	if (orig.size() > N) {
+		table_ = orig.table_;
+		promoted_ = true;
+		return;
+	}
+
+	// Pairs are counted as they are built, so the destructor cleans up
+	// after a copy that throws.
+	orig.forEach([this](K const& key, V const& value) {
+		new (&valueAt(count_)) V(value);
+		try {
+			new (&keyAt(count_)) K(key);
+		} catch (...) {
+			valueAt(count_).~V();
+			throw;
+		}
+		++count_;
+	});
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+SmallMap<K, V, N, Hash, Eq>::SmallMap(SmallMap<K, V, N, Hash, Eq>&& other) :
+	SmallMap()
+{
+	swap(*this, other);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+SmallMap<K, V, N, Hash, Eq>& SmallMap<K, V, N, Hash, Eq>::operator=(
+	SmallMap<K, V, N, Hash, Eq> rhs)
+{
+	swap(*this, rhs);
+	return *this;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+void swap(SmallMap<K, V, N, Hash, Eq>& lhs, SmallMap<K, V, N, Hash, Eq>& rhs)
+{
+	SmallMap<K, V, N, Hash, Eq>& fewer = lhs.count_ < rhs.count_ ? lhs : rhs;
+	SmallMap<K, V, N, Hash, Eq>& more = lhs.count_ < rhs.count_ ? rhs : lhs;
+	std::size_t common = fewer.count_;
+	for (std::size_t i = 0; i < common; ++i) {
+		std::swap(lhs.keyAt(i), rhs.keyAt(i));
+		std::swap(lhs.valueAt(i), rhs.valueAt(i));
+	}
+	for (std::size_t i = common; i < more.count_; ++i) {
+		new (&fewer.valueAt(i)) V(std::move(more.valueAt(i)));
+		new (&fewer.keyAt(i)) K(std::move(more.keyAt(i)));
+		more.keyAt(i).~K();
+		more.valueAt(i).~V();
+	}
+
+	std::swap(lhs.count_, rhs.count_);
+	std::swap(lhs.promoted_, rhs.promoted_);
+	std::swap(lhs.equal_, rhs.equal_);
+	std::swap(lhs.table_, rhs.table_);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+SmallMap<K, V, N, Hash, Eq>::~SmallMap()
+{
+	clearInline();
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+void SmallMap<K, V, N, Hash, Eq>::addValue(K key, V value)
+{
+	if (!findOrInsert(key, std::move(value)).second)
+		throw KeyError<K>{key, "SmallMap"};
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+bool SmallMap<K, V, N, Hash, Eq>::insertOrAssign(K key, V value)
+{
+	std::pair<V&, bool> result = findOrInsert(key, std::move(value));
+	if (!result.second)
+		result.first = std::move(value);
+	return result.second;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename... Args> inline
+std::pair<V&, bool> SmallMap<K, V, N, Hash, Eq>::tryEmplace(K key,
+	Args&&... args)
+{
+	return findOrInsert(key, std::forward<Args>(args)...);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename Fn> inline
+V& SmallMap<K, V, N, Hash, Eq>::upsert(K key, Fn fn)
+{
+	V& value = findOrInsert(key).first;
+	fn(value);
+	return value;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename InputIt> inline
+void SmallMap<K, V, N, Hash, Eq>::insertBatch(InputIt first, InputIt last)
+{
+	if (!promoted_ && count_ + batchSize(first, last) > N)
+		promote();
+	if (promoted_) {
+		table_.insertBatch(first, last);
+		return;
+	}
+	for (; first != last; ++first)
+		insertOrAssign(first->first, first->second);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+void SmallMap<K, V, N, Hash, Eq>::removeValue(K const& key)
+{
+	if (promoted_) {
+		try {
+			table_.removeValue(key);
+		} catch (KeyError<K> const&) {
+			throw KeyError<K>{key, "SmallMap"};
+		}
+		return;
+	}
+
+	std::size_t index = findIndex(key);
+	if (index == NotFound)
+		throw KeyError<K>{key, "SmallMap"};
+
+	// Fill the hole with the last pair.
+	std::size_t last = count_ - 1;
+	if (index != last) {
+		keyAt(index) = std::move(keyAt(last));
+		valueAt(index) = std::move(valueAt(last));
+	}
+	keyAt(last).~K();
+	valueAt(last).~V();
+	--count_;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+V& SmallMap<K, V, N, Hash, Eq>::getValue(K const& key) const
+{
+	V* value = findValue(key);
+	if (value == nullptr)
+		throw KeyError<K>{key, "SmallMap"};
+	return *value;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename Q, typename> inline
+V& SmallMap<K, V, N, Hash, Eq>::getValue(Q const& key) const
+{
+	V* value = findValue(key);
+	if (value == nullptr)
+		throw KeyError<K>{key, "SmallMap"};
+	return *value;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+std::size_t SmallMap<K, V, N, Hash, Eq>::size() const
+{
+	return promoted_ ? table_.size() : count_;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+bool SmallMap<K, V, N, Hash, Eq>::isEmpty() const
+{
+	return size() == 0;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+bool SmallMap<K, V, N, Hash, Eq>::contains(K const& key) const
+{
+	return findValue(key) != nullptr;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename Q, typename> inline
+bool SmallMap<K, V, N, Hash, Eq>::contains(Q const& key) const
+{
+	return findValue(key) != nullptr;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+V* SmallMap<K, V, N, Hash, Eq>::find(K const& key)
+{
+	return findValue(key);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+V const* SmallMap<K, V, N, Hash, Eq>::find(K const& key) const
+{
+	return findValue(key);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename Q, typename> inline
+V* SmallMap<K, V, N, Hash, Eq>::find(Q const& key)
+{
+	return findValue(key);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename Q, typename> inline
+V const* SmallMap<K, V, N, Hash, Eq>::find(Q const& key) const
+{
+	return findValue(key);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+typename SmallMap<K, V, N, Hash, Eq>::keys_view
+SmallMap<K, V, N, Hash, Eq>::keys() const
+{
+	return keys_view{{this, 0, table_.items().begin()},
+		{this, count_, table_.items().end()}, size()};
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+typename SmallMap<K, V, N, Hash, Eq>::values_view
+SmallMap<K, V, N, Hash, Eq>::values()
+{
+	return values_view{{this, 0, table_.items().begin()},
+		{this, count_, table_.items().end()}, size()};
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+typename SmallMap<K, V, N, Hash, Eq>::const_values_view
+SmallMap<K, V, N, Hash, Eq>::values() const
+{
+	return const_values_view{{this, 0, table_.items().begin()},
+		{this, count_, table_.items().end()}, size()};
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+typename SmallMap<K, V, N, Hash, Eq>::items_view
+SmallMap<K, V, N, Hash, Eq>::items()
+{
+	return items_view{{this, 0, table_.items().begin()},
+		{this, count_, table_.items().end()}, size()};
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+typename SmallMap<K, V, N, Hash, Eq>::const_items_view
+SmallMap<K, V, N, Hash, Eq>::items() const
+{
+	return const_items_view{{this, 0, table_.items().begin()},
+		{this, count_, table_.items().end()}, size()};
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename Fn> inline
+void SmallMap<K, V, N, Hash, Eq>::forEach(Fn fn)
+{
+	if (promoted_) {
+		table_.forEach(fn);
+		return;
+	}
+	for (std::size_t i = 0; i < count_; ++i)
+		fn(static_cast<K const&>(keyAt(i)), valueAt(i));
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename Fn> inline
+void SmallMap<K, V, N, Hash, Eq>::forEach(Fn fn) const
+{
+	if (promoted_) {
+		table_.forEach(fn);
+		return;
+	}
+	for (std::size_t i = 0; i < count_; ++i)
+		fn(static_cast<K const&>(keyAt(i)),
+			static_cast<V const&>(valueAt(i)));
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+void SmallMap<K, V, N, Hash, Eq>::reserve(std::size_t count)
+{
+	if (count <= N && !promoted_)
+		return;
+	if (!promoted_)
+		promote();
+	table_.reserve(count);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+bool SmallMap<K, V, N, Hash, Eq>::isInline() const
+{
+	return !promoted_;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+K& SmallMap<K, V, N, Hash, Eq>::keyAt(std::size_t index) const
+{
+	return reinterpret_cast<K*>(&keys_)[index];
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+V& SmallMap<K, V, N, Hash, Eq>::valueAt(std::size_t index) const
+{
+	return reinterpret_cast<V*>(&values_)[index];
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename Q> inline
+std::size_t SmallMap<K, V, N, Hash, Eq>::findIndex(Q const& key) const
+{
+	for (std::size_t i = 0; i < count_; ++i)
+		if (equal_(keyAt(i), key))
+			return i;
+	return NotFound;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename Q> inline
+V* SmallMap<K, V, N, Hash, Eq>::findValue(Q const& key) const
+{
+	if (promoted_)
+		return const_cast<V*>(table_.find(key));
+	std::size_t index = findIndex(key);
+	return index == NotFound ? nullptr : &valueAt(index);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename... Args> inline
+std::pair<V&, bool> SmallMap<K, V, N, Hash, Eq>::findOrInsert(K& key,
+	Args&&... args)
+{
+	if (!promoted_) {
+		std::size_t index = findIndex(key);
+		if (index != NotFound)
+			return {valueAt(index), false};
+
+		if (count_ < N) {
+			new (&valueAt(count_)) V(std::forward<Args>(args)...);
+			try {
+				new (&keyAt(count_)) K(std::move(key));
+			} catch (...) {
+				valueAt(count_).~V();
+				throw;
+			}
+			++count_;
+			return {valueAt(count_ - 1), true};
+		}
+		promote();
+	}
+	return table_.tryEmplace(std::move(key), std::forward<Args>(args)...);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+void SmallMap<K, V, N, Hash, Eq>::promote()
+{
+	// Room for twice the inline pairs, so the table does not grow again
+	// straight away.  Every key is hashed before any pair is touched; with
+	// the room already made, insertAbsent() then calls neither Hash nor Eq,
+	// and whole pairs are copied if moving either half could throw, so the
+	// inline ones are intact until every pair is in the table.
+	table_.reserve(2 * N);
+	std::size_t hashes[N];
+	try {
+		for (std::size_t i = 0; i < count_; ++i)
+			hashes[i] = table_.hashOf(keyAt(i));
+		for (std::size_t i = 0; i < count_; ++i)
+			table_.insertAbsent(promoted(keyAt(i)), promoted(valueAt(i)),
+				hashes[i], Table::NotFound);
+	} catch (...) {
+		table_ = Table();
+		throw;
+	}
+	clearInline();
+	promoted_ = true;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename T> inline
+typename std::conditional<
+	SmallMap<K, V, N, Hash, Eq>::NothrowMove ||
+		!std::is_copy_constructible<T>::value,
+	T&&, T const&>::type
+SmallMap<K, V, N, Hash, Eq>::promoted(T& half)
+{
+	return std::move(half);
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+inline
+void SmallMap<K, V, N, Hash, Eq>::clearInline()
+{
+	for (std::size_t i = 0; i < count_; ++i) {
+		keyAt(i).~K();
+		valueAt(i).~V();
+	}
+	count_ = 0;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename ValueT> inline
+SmallMap<K, V, N, Hash, Eq>::SlotCursor<ValueT>::SlotCursor(MapT* map,
+	std::size_t index, TableIt it) : map_{map}, index_{index}, it_{it}
+{
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename ValueT> inline
+typename SmallMap<K, V, N, Hash, Eq>::template SlotCursor<ValueT>&
+SmallMap<K, V, N, Hash, Eq>::SlotCursor<ValueT>::operator++()
+{
+	if (map_->promoted_)
+		++it_;
+	else
+		++index_;
+	return *this;
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename ValueT> inline
+typename SmallMap<K, V, N, Hash, Eq>::template SlotRef<ValueT>
+SmallMap<K, V, N, Hash, Eq>::SlotCursor<ValueT>::operator*() const
+{
+	if (map_->promoted_) {
+		MapItem<K, ValueT> item = *it_;
+		return SlotRef<ValueT>{item.key, item.value};
+	}
+	return SlotRef<ValueT>{map_->keyAt(index_), map_->valueAt(index_)};
+}
+
+template <typename K, typename V, std::size_t N, typename Hash, typename Eq>
+template <typename ValueT> inline
+bool SmallMap<K, V, N, Hash, Eq>::SlotCursor<ValueT>::operator==(
+	const SlotCursor& rhs) const
+{
+	// Only one of the two positions ever moves.
+	return index_ == rhs.index_ && it_ == rhs.it_;
+}
+
+#endif
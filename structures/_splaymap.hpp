@@ -0,0 +1,459 @@
+/**
+ * \file _splaymap.hpp
+ * \brief Private implementation file of the splay tree map.
+ */
+
+#ifndef _SPLAY_MAP_HPP
+#define _SPLAY_MAP_HPP 1
+
+#include <cstddef>
+#include <utility>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename K, typename V> inline
+SplayMap<K, V>::Node::Node(K const& key, V const& value, Node* parent) :
+	key_(key), value_(value), parent_{parent}, left_{nullptr},
+	right_{nullptr}
+{
+}
+
+template <typename K, typename V> inline
+SplayMap<K, V>::Node::Node(K&& key, V&& value) :
+	key_(std::move(key)), value_(std::move(value)), parent_{nullptr},
+	left_{nullptr}, right_{nullptr}
+{
+}
+
+template <typename K, typename V> inline
+SplayMap<K, V>::SplayMap() : root_{nullptr}, size_{0}, readOnly_{false}
+{
+}
+
+template <typename K, typename V> inline
+SplayMap<K, V>::SplayMap(SplayMap<K, V> const& orig) : SplayMap()
+{
+	readOnly_ = orig.readOnly_;
+	if (orig.root_ == nullptr)
+		return;
+
+	// Walk both trees together: down into whichever child has not been
+	// copied yet, and back up through the parents once both have.  If a
+	// copy throws, the destructor frees what has been linked so far.
+	Node const* from = orig.root_;
+	root_ = new Node(from->key_, from->value_, nullptr);
+	Node* to = root_;
+	for (;;) {
+		if (from->left_ != nullptr && to->left_ == nullptr) {
+			from = from->left_;
+			to->left_ = new Node(from->key_, from->value_, to);
+			to = to->left_;
+		} else if (from->right_ != nullptr && to->right_ == nullptr) {
+			from = from->right_;
+			to->right_ = new Node(from->key_, from->value_, to);
+			to = to->right_;
+		} else if (from == orig.root_) {
+			break;
+		} else {
+			from = from->parent_;
+			to = to->parent_;
+		}
+	}
+	size_ = orig.size_;
+}
+
+template <typename K, typename V> inline
+SplayMap<K, V>::SplayMap(SplayMap<K, V>&& other) : SplayMap()
+{
+	swap(*this, other);
+}
+
+template <typename K, typename V> inline
+SplayMap<K, V>& SplayMap<K, V>::operator=(SplayMap<K, V> rhs)
+{
+	swap(*this, rhs);
+	return *this;
+}
+
+template <typename K, typename V> inline
+void swap(SplayMap<K, V>& lhs, SplayMap<K, V>& rhs)
+{
+	std::swap(lhs.root_, rhs.root_);
+	std::swap(lhs.size_, rhs.size_);
+	std::swap(lhs.readOnly_, rhs.readOnly_);
+}
+
+template <typename K, typename V> inline
+SplayMap<K, V>::~SplayMap()
+{
+	destroy(root_);
+}
+
+template <typename K, typename V> inline
+void SplayMap<K, V>::addValue(K key, V value)
+{
+	if (!findOrInsert(key, std::move(value)).second)
+		throw KeyError<K>{key, "SplayMap"};
+}
+
+template <typename K, typename V> inline
+bool SplayMap<K, V>::insertOrAssign(K key, V value)
+{
+	std::pair<V&, bool> result = findOrInsert(key, std::move(value));
+	if (!result.second)
+		result.first = std::move(value);
+	return result.second;
+}
+
+template <typename K, typename V> template <typename... Args> inline
+std::pair<V&, bool> SplayMap<K, V>::tryEmplace(K key, Args&&... args)
+{
+	return findOrInsert(key, std::forward<Args>(args)...);
+}
+
+template <typename K, typename V> template <typename Fn> inline
+V& SplayMap<K, V>::upsert(K key, Fn fn)
+{
+	V& value = findOrInsert(key).first;
+	fn(value);
+	return value;
+}
+
+template <typename K, typename V> template <typename... Args> inline
+std::pair<V&, bool> SplayMap<K, V>::findOrInsert(K& key,
+	Args&&... args)
+{
+	if (root_ == nullptr) {
+		root_ = new Node(std::move(key), V(std::forward<Args>(args)...));
+		++size_;
+		return {root_->value_, true};
+	}
+
+	root_ = splay(root_, key);
+	bool less = key < root_->key_;
+	if (!less && !(root_->key_ < key))
+		return {root_->value_, false};
+
+	// The old root is key's neighbour, so it and one of its subtrees go to
+	// one side of the new root and its other subtree to the other.
+	Node* node = new Node(std::move(key), V(std::forward<Args>(args)...));
+	if (less) {
+		node->left_ = root_->left_;
+		node->right_ = root_;
+		root_->left_ = nullptr;
+	} else {
+		node->right_ = root_->right_;
+		node->left_ = root_;
+		root_->right_ = nullptr;
+	}
+	if (node->left_ != nullptr)
+		node->left_->parent_ = node;
+	if (node->right_ != nullptr)
+		node->right_->parent_ = node;
+	root_ = node;
+	++size_;
+	return {node->value_, true};
+}
+
+template <typename K, typename V> inline
+void SplayMap<K, V>::removeValue(K const& key)
+{
+	if (root_ != nullptr)
+		root_ = splay(root_, key);
+	if (root_ == nullptr || key < root_->key_ || root_->key_ < key)
+		throw KeyError<K>{key, "SplayMap"};
+
+	// Every key on the left is less than key, so splaying for key there
+	// brings up its maximum, which has no right child to lose.
+	Node* removed = root_;
+	if (removed->left_ == nullptr) {
+		root_ = removed->right_;
+	} else {
+		removed->left_->parent_ = nullptr;
+		root_ = splay(removed->left_, key);
+		root_->right_ = removed->right_;
+	}
+	if (root_ != nullptr) {
+		root_->parent_ = nullptr;
+		if (root_->right_ != nullptr)
+			root_->right_->parent_ = root_;
+	}
+	delete removed;
+	--size_;
+}
+
+template <typename K, typename V> inline
+V& SplayMap<K, V>::getValue(K const& key) const
+{
+	Node* node = find(key);
+	if (node == nullptr)
+		throw KeyError<K>{key, "SplayMap"};
+	return node->value_;
+}
+
+template <typename K, typename V> template <typename Q, typename> inline
+V& SplayMap<K, V>::getValue(Q const& key) const
+{
+	Node* node = find(key);
+	if (node == nullptr)
+		throw KeyError<K>{key, "SplayMap"};
+	return node->value_;
+}
+
+template <typename K, typename V> inline
+std::size_t SplayMap<K, V>::size() const
+{
+	return size_;
+}
+
+template <typename K, typename V> inline
+bool SplayMap<K, V>::isEmpty() const
+{
+	return size_ == 0;
+}
+
+template <typename K, typename V> inline
+bool SplayMap<K, V>::contains(K const& key) const
+{
+	return find(key) != nullptr;
+}
+
+template <typename K, typename V> template <typename Q, typename> inline
+bool SplayMap<K, V>::contains(Q const& key) const
+{
+	return find(key) != nullptr;
+}
+
+template <typename K, typename V> inline
+void SplayMap<K, V>::setReadOnly(bool readOnly)
+{
+	readOnly_ = readOnly;
+}
+
+template <typename K, typename V> inline
+bool SplayMap<K, V>::isReadOnly() const
+{
+	return readOnly_;
+}
+
+template <typename K, typename V> inline
+typename SplayMap<K, V>::keys_view SplayMap<K, V>::keys() const
+{
+	return keys_view{first(), nullptr, size_};
+}
+
+template <typename K, typename V> inline
+typename SplayMap<K, V>::values_view SplayMap<K, V>::values()
+{
+	return values_view{first(), nullptr, size_};
+}
+
+template <typename K, typename V> inline
+typename SplayMap<K, V>::const_values_view SplayMap<K, V>::values() const
+{
+	return const_values_view{first(), nullptr, size_};
+}
+
+template <typename K, typename V> inline
+typename SplayMap<K, V>::items_view SplayMap<K, V>::items()
+{
+	return items_view{first(), nullptr, size_};
+}
+
+template <typename K, typename V> inline
+typename SplayMap<K, V>::const_items_view SplayMap<K, V>::items() const
+{
+	return const_items_view{first(), nullptr, size_};
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void SplayMap<K, V>::forEach(Fn fn)
+{
+	for (Node* node = first(); node != nullptr; node = successor(node))
+		fn(static_cast<K const&>(node->key_), node->value_);
+}
+
+template <typename K, typename V> template <typename Fn> inline
+void SplayMap<K, V>::forEach(Fn fn) const
+{
+	for (Node const* node = first(); node != nullptr; node = successor(node))
+		fn(node->key_, static_cast<V const&>(node->value_));
+}
+
+template <typename K, typename V> inline
+typename SplayMap<K, V>::Node* SplayMap<K, V>::first() const
+{
+	Node* node = root_;
+	if (node != nullptr)
+		while (node->left_ != nullptr)
+			node = node->left_;
+	return node;
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+NodeT* SplayMap<K, V>::successor(NodeT* node)
+{
+	if (node->right_ != nullptr) {
+		node = node->right_;
+		while (node->left_ != nullptr)
+			node = node->left_;
+		return node;
+	}
+	NodeT* parent = node->parent_;
+	while (parent != nullptr && node == parent->right_) {
+		node = parent;
+		parent = parent->parent_;
+	}
+	return parent;
+}
+
+template <typename K, typename V> template <typename Q> inline
+typename SplayMap<K, V>::Node* SplayMap<K, V>::splay(Node* root,
+	Q const& key)
+{
+	// Nodes passed on the way down are split off into a left tree (keys
+	// less than key) and a right tree (greater), each grown at one end:
+	// leftLast is the left tree's maximum and rightLast the right tree's
+	// minimum.  A zig-zig step rotates before linking.
+	Node* leftTree = nullptr;
+	Node* leftLast = nullptr;
+	Node* rightTree = nullptr;
+	Node* rightLast = nullptr;
+	Node* node = root;
+	for (;;) {
+		if (key < node->key_) {
+			Node* child = node->left_;
+			if (child == nullptr)
+				break;
+			if (key < child->key_) {
+				node->left_ = child->right_;
+				if (node->left_ != nullptr)
+					node->left_->parent_ = node;
+				child->right_ = node;
+				node->parent_ = child;
+				node = child;
+				if (node->left_ == nullptr)
+					break;
+			}
+			if (rightLast == nullptr)
+				rightTree = node;
+			else
+				rightLast->left_ = node;
+			node->parent_ = rightLast;
+			rightLast = node;
+			node = node->left_;
+		} else if (node->key_ < key) {
+			Node* child = node->right_;
+			if (child == nullptr)
+				break;
+			if (child->key_ < key) {
+				node->right_ = child->left_;
+				if (node->right_ != nullptr)
+					node->right_->parent_ = node;
+				child->left_ = node;
+				node->parent_ = child;
+				node = child;
+				if (node->right_ == nullptr)
+					break;
+			}
+			if (leftLast == nullptr)
+				leftTree = node;
+			else
+				leftLast->right_ = node;
+			node->parent_ = leftLast;
+			leftLast = node;
+			node = node->right_;
+		} else {
+			break;
+		}
+	}
+
+	// Hang node's own subtrees off the inner ends of the two trees, then
+	// the trees off node.
+	if (leftLast != nullptr) {
+		leftLast->right_ = node->left_;
+		if (node->left_ != nullptr)
+			node->left_->parent_ = leftLast;
+		node->left_ = leftTree;
+		leftTree->parent_ = node;
+	}
+	if (rightLast != nullptr) {
+		rightLast->left_ = node->right_;
+		if (node->right_ != nullptr)
+			node->right_->parent_ = rightLast;
+		node->right_ = rightTree;
+		rightTree->parent_ = node;
+	}
+	node->parent_ = nullptr;
+	return node;
+}
+
+template <typename K, typename V> template <typename Q> inline
+typename SplayMap<K, V>::Node* SplayMap<K, V>::find(Q const& key) const
+{
+	if (root_ == nullptr)
+		return nullptr;
+
+	if (readOnly_) {
+		Node* node = root_;
+		while (node != nullptr) {
+			if (key < node->key_)
+				node = node->left_;
+			else if (node->key_ < key)
+				node = node->right_;
+			else
+				return node;
+		}
+		return nullptr;
+	}
+
+	root_ = splay(root_, key);
+	if (key < root_->key_ || root_->key_ < key)
+		return nullptr;
+	return root_;
+}
+
+template <typename K, typename V> inline
+void SplayMap<K, V>::destroy(Node* node)
+{
+	// Rotate left children up until there are none, so every node is
+	// freed from a right spine without a stack.
+	while (node != nullptr) {
+		if (node->left_ != nullptr) {
+			Node* left = node->left_;
+			node->left_ = left->right_;
+			left->right_ = node;
+			node = left;
+		} else {
+			Node* right = node->right_;
+			delete node;
+			node = right;
+		}
+	}
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+typename SplayMap<K, V>::template NodeCursor<NodeT>&
+SplayMap<K, V>::NodeCursor<NodeT>::operator++()
+{
+	node_ = successor(node_);
+	return *this;
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+NodeT& SplayMap<K, V>::NodeCursor<NodeT>::operator*() const
+{
+	return *node_;
+}
+
+template <typename K, typename V> template <typename NodeT> inline
+bool SplayMap<K, V>::NodeCursor<NodeT>::operator==(
+	const NodeCursor& rhs) const
+{
+	return node_ == rhs.node_;
+}
+
+#endif
@@ -0,0 +1,498 @@
+/**
+ * \file _splitorderedmap.hpp
+ * \brief Private implementation file of the split-ordered lock-free map.
+ */
+
+#ifndef _SPLIT_ORDERED_MAP_HPP
+#define _SPLIT_ORDERED_MAP_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "map.hpp"
+#include "../exceptions.hpp"
+
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::size_t SplitOrderedMap<K, V, Hash, Eq>::NumSegments;
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::size_t SplitOrderedMap<K, V, Hash, Eq>::MaxLoad;
+
+template <typename K, typename V, typename Hash, typename Eq>
+const std::uint64_t SplitOrderedMap<K, V, Hash, Eq>::Idle;
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+SplitOrderedMap<K, V, Hash, Eq>::SplitOrderedMap() :
+	bucketCount_{2},
+	size_{0},
+	globalEpoch_{1},
+	records_{nullptr},
+	numRecords_{0},
+	hash_{},
+	equal_{}
+{
+	for (std::size_t i = 0; i < NumSegments; ++i)
+		segments_[i].store(nullptr, std::memory_order_relaxed);
+
+	// Bucket 0 is the root every other dummy is split from.
+	bucketSlot(0).store(new ListNode{0, {nullptr}, nullptr},
+		std::memory_order_release);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+SplitOrderedMap<K, V, Hash, Eq>::~SplitOrderedMap()
+{
+	// Nodes that are marked but still linked were never retired, so walking
+	// the list and then the limbo lists frees everything exactly once.
+	ListNode* node = bucketSlot(0).load(std::memory_order_relaxed);
+	while (node != nullptr) {
+		ListNode* next = unmarked(node->next_.load(std::memory_order_relaxed));
+		freeNode(node);
+		node = next;
+	}
+
+	for (std::size_t i = 0; i < NumSegments; ++i)
+		delete[] segments_[i].load(std::memory_order_relaxed);
+
+	EpochRecord* record = records_.load(std::memory_order_relaxed);
+	while (record != nullptr) {
+		for (ListNode* list : record->limbo_) {
+			while (list != nullptr) {
+				ListNode* next = list->link_;
+				freeNode(list);
+				list = next;
+			}
+		}
+		EpochRecord* next = record->next_;
+		delete record;
+		record = next;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void SplitOrderedMap<K, V, Hash, Eq>::addValue(K key, V value)
+{
+	EpochRecord* record = enter();
+	std::uint64_t hash = hashOf(key);
+	std::size_t count = bucketCount_.load(std::memory_order_acquire);
+	ListNode* head = bucketHead(record, hash & (count - 1));
+
+	DataNode* node = new DataNode{reverse(hash) | 1, key, std::move(value)};
+
+	std::atomic<ListNode*>* prev;
+	ListNode* curr;
+	for (;;) {
+		if (search(record, head, node->soKey_, &key, prev, curr)) {
+			leave(record);
+			delete node;
+			throw KeyError<K>{key, "SplitOrderedMap"};
+		}
+		node->next_.store(curr, std::memory_order_relaxed);
+		if (prev->compare_exchange_strong(curr, node,
+				std::memory_order_release, std::memory_order_relaxed))
+			break;
+	}
+
+	// Doubling only publishes the new count; the new buckets' dummies are
+	// spliced in lazily by the first operation that needs each one.
+	std::size_t size = size_.fetch_add(1, std::memory_order_relaxed) + 1;
+	if (size > MaxLoad * count && count < (std::size_t(1) << NumSegments))
+		bucketCount_.compare_exchange_strong(count, count * 2,
+			std::memory_order_release, std::memory_order_relaxed);
+	leave(record);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void SplitOrderedMap<K, V, Hash, Eq>::removeValue(K const& key)
+{
+	EpochRecord* record = enter();
+	std::uint64_t hash = hashOf(key);
+	std::uint64_t so = reverse(hash) | 1;
+	ListNode* head = bucketHead(record,
+		hash & (bucketCount_.load(std::memory_order_acquire) - 1));
+
+	std::atomic<ListNode*>* prev;
+	ListNode* curr;
+	for (;;) {
+		if (!search(record, head, so, &key, prev, curr)) {
+			leave(record);
+			throw KeyError<K>{key, "SplitOrderedMap"};
+		}
+
+		// Marking curr's own link is the linearisation point; whoever then
+		// unlinks it physically is the one who retires it.
+		ListNode* next = curr->next_.load(std::memory_order_acquire);
+		if (isMarked(next) || !curr->next_.compare_exchange_strong(next,
+				marked(next), std::memory_order_acq_rel,
+				std::memory_order_relaxed))
+			continue;
+
+		ListNode* expected = curr;
+		if (prev->compare_exchange_strong(expected, next,
+				std::memory_order_acq_rel, std::memory_order_relaxed))
+			retire(record, curr);
+		else
+			search(record, head, so, &key, prev, curr);
+		break;
+	}
+
+	size_.fetch_sub(1, std::memory_order_relaxed);
+	leave(record);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+V& SplitOrderedMap<K, V, Hash, Eq>::getValue(K const& key) const
+{
+	EpochRecord* record = enter();
+	std::uint64_t hash = hashOf(key);
+	ListNode* head = bucketHead(record,
+		hash & (bucketCount_.load(std::memory_order_acquire) - 1));
+
+	std::atomic<ListNode*>* prev;
+	ListNode* curr;
+	bool found = search(record, head, reverse(hash) | 1, &key, prev, curr);
+	leave(record);
+	if (!found)
+		throw KeyError<K>{key, "SplitOrderedMap"};
+	return static_cast<DataNode*>(curr)->value_;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool SplitOrderedMap<K, V, Hash, Eq>::find(K const& key, V& value) const
+{
+	EpochRecord* record = enter();
+	std::uint64_t hash = hashOf(key);
+	ListNode* head = bucketHead(record,
+		hash & (bucketCount_.load(std::memory_order_acquire) - 1));
+
+	std::atomic<ListNode*>* prev;
+	ListNode* curr;
+	bool found = search(record, head, reverse(hash) | 1, &key, prev, curr);
+	if (found)
+		value = static_cast<DataNode*>(curr)->value_;
+	leave(record);
+	return found;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t SplitOrderedMap<K, V, Hash, Eq>::size() const
+{
+	return size_.load(std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool SplitOrderedMap<K, V, Hash, Eq>::isEmpty() const
+{
+	return size() == 0;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool SplitOrderedMap<K, V, Hash, Eq>::contains(K const& key) const
+{
+	EpochRecord* record = enter();
+	std::uint64_t hash = hashOf(key);
+	ListNode* head = bucketHead(record,
+		hash & (bucketCount_.load(std::memory_order_acquire) - 1));
+
+	std::atomic<ListNode*>* prev;
+	ListNode* curr;
+	bool found = search(record, head, reverse(hash) | 1, &key, prev, curr);
+	leave(record);
+	return found;
+}
+
+template <typename K, typename V, typename Hash, typename Eq>
+template <typename Fn> inline
+void SplitOrderedMap<K, V, Hash, Eq>::forEach(Fn fn) const
+{
+	EpochRecord* record = enter();
+	ListNode* node = bucketSlot(0).load(std::memory_order_acquire);
+	try {
+		while (node != nullptr) {
+			ListNode* next = node->next_.load(std::memory_order_acquire);
+			if ((node->soKey_ & 1) != 0 && !isMarked(next)) {
+				DataNode const* data = static_cast<DataNode const*>(node);
+				fn(data->key_, data->value_);
+			}
+			node = unmarked(next);
+		}
+	} catch (...) {
+		leave(record);
+		throw;
+	}
+	leave(record);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::size_t SplitOrderedMap<K, V, Hash, Eq>::bucketCount() const
+{
+	return bucketCount_.load(std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename SplitOrderedMap<K, V, Hash, Eq>::EpochRecord*
+SplitOrderedMap<K, V, Hash, Eq>::enter() const
+{
+	EpochRecord* record = records_.load(std::memory_order_acquire);
+	for (; record != nullptr; record = record->next_) {
+		bool inactive = false;
+		if (!record->active_.load(std::memory_order_relaxed) &&
+				record->active_.compare_exchange_strong(
+					inactive, true, std::memory_order_acquire))
+			break;
+	}
+
+	if (record == nullptr) {
+		record = new EpochRecord{{true}, {Idle}, {nullptr, nullptr, nullptr},
+			{0, 0, 0}, 0, nullptr};
+		EpochRecord* head = records_.load(std::memory_order_relaxed);
+		do {
+			record->next_ = head;
+		} while (!records_.compare_exchange_weak(head, record,
+			std::memory_order_release, std::memory_order_relaxed));
+		numRecords_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Anything unlinked before this store was unreachable before the walk
+	// starts, so announcing a slightly stale epoch is still safe.
+	record->epoch_.store(globalEpoch_.load(std::memory_order_seq_cst),
+		std::memory_order_seq_cst);
+	return record;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void SplitOrderedMap<K, V, Hash, Eq>::leave(EpochRecord* record) const
+{
+	record->epoch_.store(Idle, std::memory_order_release);
+	record->active_.store(false, std::memory_order_release);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void SplitOrderedMap<K, V, Hash, Eq>::retire(
+	EpochRecord* record, ListNode* node) const
+{
+	// Tag with the epoch read after the unlink: only operations announced
+	// in that epoch or earlier can still hold the node.
+	std::uint64_t epoch = globalEpoch_.load(std::memory_order_seq_cst);
+	std::size_t slot = epoch % 3;
+	if (record->limboEpoch_[slot] != epoch) {
+		// The slot holds an epoch at least three behind, which is safe.
+		ListNode* list = record->limbo_[slot];
+		while (list != nullptr) {
+			ListNode* next = list->link_;
+			freeNode(list);
+			--record->numRetired_;
+			list = next;
+		}
+		record->limbo_[slot] = nullptr;
+		record->limboEpoch_[slot] = epoch;
+	}
+
+	node->link_ = record->limbo_[slot];
+	record->limbo_[slot] = node;
+	++record->numRetired_;
+
+	std::size_t threshold =
+		4 * numRecords_.load(std::memory_order_relaxed) + 16;
+	if (record->numRetired_ >= threshold) {
+		tryAdvance();
+		reclaim(record);
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void SplitOrderedMap<K, V, Hash, Eq>::tryAdvance() const
+{
+	std::uint64_t epoch = globalEpoch_.load(std::memory_order_seq_cst);
+	for (EpochRecord* record = records_.load(std::memory_order_acquire);
+			record != nullptr; record = record->next_) {
+		std::uint64_t seen = record->epoch_.load(std::memory_order_seq_cst);
+		if (seen != Idle && seen != epoch)
+			return;
+	}
+	globalEpoch_.compare_exchange_strong(epoch, epoch + 1,
+		std::memory_order_seq_cst);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void SplitOrderedMap<K, V, Hash, Eq>::reclaim(EpochRecord* record) const
+{
+	std::uint64_t epoch = globalEpoch_.load(std::memory_order_seq_cst);
+	for (std::size_t slot = 0; slot < 3; ++slot) {
+		if (record->limboEpoch_[slot] + 2 > epoch)
+			continue;
+		ListNode* list = record->limbo_[slot];
+		while (list != nullptr) {
+			ListNode* next = list->link_;
+			freeNode(list);
+			--record->numRetired_;
+			list = next;
+		}
+		record->limbo_[slot] = nullptr;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool SplitOrderedMap<K, V, Hash, Eq>::search(EpochRecord* record,
+	ListNode* head, std::uint64_t so, K const* key,
+	std::atomic<ListNode*>*& prev, ListNode*& curr) const
+{
+	for (;;) {
+		prev = &head->next_;
+		curr = prev->load(std::memory_order_acquire);
+
+		for (;;) {
+			if (curr == nullptr)
+				return false;
+
+			ListNode* next = curr->next_.load(std::memory_order_acquire);
+			if (isMarked(next)) {
+				// Help finish a removal; if prev changed, start over.
+				ListNode* expected = curr;
+				if (!prev->compare_exchange_strong(expected, unmarked(next),
+						std::memory_order_acq_rel, std::memory_order_relaxed))
+					break;
+				retire(record, curr);
+				curr = unmarked(next);
+				continue;
+			}
+
+			if (curr->soKey_ > so)
+				return false;
+			// Dummies have even keys and data nodes odd ones, so a dummy
+			// search (key == nullptr) can only match a dummy.
+			if (curr->soKey_ == so && (key == nullptr ||
+					equal_(static_cast<DataNode*>(curr)->key_, *key)))
+				return true;
+
+			prev = &curr->next_;
+			curr = next;
+		}
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename SplitOrderedMap<K, V, Hash, Eq>::ListNode*
+SplitOrderedMap<K, V, Hash, Eq>::bucketHead(
+	EpochRecord* record, std::size_t bucket) const
+{
+	std::atomic<ListNode*>& slot = bucketSlot(bucket);
+	ListNode* head = slot.load(std::memory_order_acquire);
+	if (head != nullptr)
+		return head;
+
+	// A bucket splits off from the bucket with its top bit cleared, and its
+	// dummy belongs somewhere inside that parent's run of the list.
+	std::size_t parent =
+		bucket & ~(std::size_t(1) << (63 - __builtin_clzll(bucket)));
+	ListNode* parentHead = bucketHead(record, parent);
+
+	ListNode* dummy = new ListNode{reverse(bucket), {nullptr}, nullptr};
+	std::atomic<ListNode*>* prev;
+	ListNode* curr;
+	for (;;) {
+		if (search(record, parentHead, dummy->soKey_, nullptr, prev, curr)) {
+			// Another thread spliced the same dummy in first.
+			delete dummy;
+			dummy = curr;
+			break;
+		}
+		dummy->next_.store(curr, std::memory_order_relaxed);
+		if (prev->compare_exchange_strong(curr, dummy,
+				std::memory_order_release, std::memory_order_relaxed))
+			break;
+	}
+
+	ListNode* expected = nullptr;
+	slot.compare_exchange_strong(expected, dummy,
+		std::memory_order_release, std::memory_order_relaxed);
+	return dummy;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::atomic<typename SplitOrderedMap<K, V, Hash, Eq>::ListNode*>&
+SplitOrderedMap<K, V, Hash, Eq>::bucketSlot(std::size_t bucket) const
+{
+	// Segment 0 holds buckets 0 and 1, segment s > 0 holds [2^s, 2^(s+1)).
+	std::size_t segment = bucket < 2 ? 0 : 63 - __builtin_clzll(bucket);
+	std::size_t offset =
+		bucket < 2 ? bucket : bucket - (std::size_t(1) << segment);
+
+	std::atomic<ListNode*>* table =
+		segments_[segment].load(std::memory_order_acquire);
+	if (table == nullptr) {
+		std::size_t length = segment == 0 ? 2 : std::size_t(1) << segment;
+		std::atomic<ListNode*>* fresh = new std::atomic<ListNode*>[length];
+		for (std::size_t i = 0; i < length; ++i)
+			fresh[i].store(nullptr, std::memory_order_relaxed);
+		if (segments_[segment].compare_exchange_strong(table, fresh,
+				std::memory_order_acq_rel, std::memory_order_acquire))
+			table = fresh;
+		else
+			delete[] fresh;
+	}
+	return table[offset];
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::uint64_t SplitOrderedMap<K, V, Hash, Eq>::hashOf(K const& key) const
+{
+	// Buckets are the low bits, so spread weak hashes over them; the top bit
+	// is cleared so that setting the low bit of the reversed hash is free.
+	std::uint64_t hash = static_cast<std::uint64_t>(hash_(key));
+	hash *= 0x9E3779B97F4A7C15ull;
+	hash ^= hash >> 32;
+	return hash & 0x7FFFFFFFFFFFFFFFull;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+std::uint64_t SplitOrderedMap<K, V, Hash, Eq>::reverse(std::uint64_t word)
+{
+	word = ((word >> 1) & 0x5555555555555555ull) |
+		((word & 0x5555555555555555ull) << 1);
+	word = ((word >> 2) & 0x3333333333333333ull) |
+		((word & 0x3333333333333333ull) << 2);
+	word = ((word >> 4) & 0x0F0F0F0F0F0F0F0Full) |
+		((word & 0x0F0F0F0F0F0F0F0Full) << 4);
+	word = ((word >> 8) & 0x00FF00FF00FF00FFull) |
+		((word & 0x00FF00FF00FF00FFull) << 8);
+	word = ((word >> 16) & 0x0000FFFF0000FFFFull) |
+		((word & 0x0000FFFF0000FFFFull) << 16);
+	return (word >> 32) | (word << 32);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+void SplitOrderedMap<K, V, Hash, Eq>::freeNode(ListNode* node)
+{
+	if ((node->soKey_ & 1) != 0)
+		delete static_cast<DataNode*>(node);
+	else
+		delete node;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+bool SplitOrderedMap<K, V, Hash, Eq>::isMarked(ListNode* node)
+{
+	return (reinterpret_cast<std::uintptr_t>(node) & 1) != 0;
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename SplitOrderedMap<K, V, Hash, Eq>::ListNode*
+SplitOrderedMap<K, V, Hash, Eq>::marked(ListNode* node)
+{
+	return reinterpret_cast<ListNode*>(
+		reinterpret_cast<std::uintptr_t>(node) | 1);
+}
+
+template <typename K, typename V, typename Hash, typename Eq> inline
+typename SplitOrderedMap<K, V, Hash, Eq>::ListNode*
+SplitOrderedMap<K, V, Hash, Eq>::unmarked(ListNode* node)
+{
+	return reinterpret_cast<ListNode*>(
+		reinterpret_cast<std::uintptr_t>(node) & ~std::uintptr_t(1));
+}
+
+#endif
@@ -0,0 +1,142 @@
+/**
+ * \file _spscring.hpp
+ * \brief Private implementation file for the single-producer single-consumer
+ *        ring buffer.
+ */
+
+#ifndef _SPSC_RING_HPP
+#define _SPSC_RING_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+
+template <typename T> inline
+SpscRing<T>::SpscRing(std::size_t capacity) :
+	slots_{nullptr},
+	mask_{0},
+	tail_{0},
+	cachedHead_{0},
+	head_{0},
+	cachedTail_{0}
+{
+	std::size_t rounded = 2;
+	while (rounded < capacity)
+		rounded <<= 1;
+
+	slots_ = new T[rounded];
+	mask_ = rounded - 1;
+}
+
+template <typename T> inline
+SpscRing<T>::~SpscRing()
+{
+	delete [] slots_;
+}
+
+template <typename T> inline
+bool SpscRing<T>::tryPush(T value)
+{
+	std::size_t tail = tail_.load(std::memory_order_relaxed);
+	if (tail - cachedHead_ > mask_) {
+		cachedHead_ = head_.load(std::memory_order_acquire);
+		if (tail - cachedHead_ > mask_)
+			return false;
+	}
+
+	slots_[tail & mask_] = std::move(value);
+	tail_.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+template <typename T> inline
+bool SpscRing<T>::tryPop(T& value)
+{
+	std::size_t head = head_.load(std::memory_order_relaxed);
+	if (head == cachedTail_) {
+		cachedTail_ = tail_.load(std::memory_order_acquire);
+		if (head == cachedTail_)
+			return false;
+	}
+
+	value = std::move(slots_[head & mask_]);
+	head_.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+template <typename T> inline
+typename SpscRing<T>::Span SpscRing<T>::reserve(std::size_t maxItems)
+{
+	std::size_t tail = tail_.load(std::memory_order_relaxed);
+	std::size_t free = mask_ + 1 - (tail - cachedHead_);
+	if (free < maxItems) {
+		cachedHead_ = head_.load(std::memory_order_acquire);
+		free = mask_ + 1 - (tail - cachedHead_);
+	}
+
+	std::size_t offset = tail & mask_;
+	std::size_t contiguous = mask_ + 1 - offset;
+	std::size_t count = maxItems;
+	if (count > free)
+		count = free;
+	if (count > contiguous)
+		count = contiguous;
+	return Span{slots_ + offset, count};
+}
+
+template <typename T> inline
+void SpscRing<T>::commit(std::size_t count)
+{
+	std::size_t tail = tail_.load(std::memory_order_relaxed);
+	tail_.store(tail + count, std::memory_order_release);
+}
+
+template <typename T> inline
+typename SpscRing<T>::Span SpscRing<T>::peek(std::size_t maxItems)
+{
+	std::size_t head = head_.load(std::memory_order_relaxed);
+	std::size_t available = cachedTail_ - head;
+	if (available < maxItems) {
+		cachedTail_ = tail_.load(std::memory_order_acquire);
+		available = cachedTail_ - head;
+	}
+
+	std::size_t offset = head & mask_;
+	std::size_t contiguous = mask_ + 1 - offset;
+	std::size_t count = maxItems;
+	if (count > available)
+		count = available;
+	if (count > contiguous)
+		count = contiguous;
+	return Span{slots_ + offset, count};
+}
+
+template <typename T> inline
+void SpscRing<T>::release(std::size_t count)
+{
+	std::size_t head = head_.load(std::memory_order_relaxed);
+	head_.store(head + count, std::memory_order_release);
+}
+
+template <typename T> inline
+std::size_t SpscRing<T>::size() const
+{
+	std::size_t tail = tail_.load(std::memory_order_acquire);
+	std::size_t head = head_.load(std::memory_order_acquire);
+	return tail > head ? tail - head : 0;
+}
+
+template <typename T> inline
+bool SpscRing<T>::isEmpty() const
+{
+	return size() == 0;
+}
+
+template <typename T> inline
+std::size_t SpscRing<T>::capacity() const
+{
+	return mask_ + 1;
+}
+
+#endif
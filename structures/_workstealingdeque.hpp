@@ -0,0 +1,163 @@
+/**
+ * \file _workstealingdeque.hpp
+ * \brief Private implementation file for the work-stealing deque.
+ */
+
+#ifndef _WORK_STEALING_DEQUE_HPP
+#define _WORK_STEALING_DEQUE_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+
+template <typename T> inline
+WorkStealingDeque<T>::Buffer::Buffer(std::size_t capacity, Buffer* retired) :
+	capacity_{capacity},
+	mask_{capacity - 1},
+	slots_{new std::atomic<T>[capacity]},
+	retired_{retired}
+{
+}
+
+template <typename T> inline
+WorkStealingDeque<T>::Buffer::~Buffer()
+{
+	delete [] slots_;
+}
+
+template <typename T> inline
+T WorkStealingDeque<T>::Buffer::get(std::int64_t index) const
+{
+	return slots_[static_cast<std::size_t>(index) & mask_].load(
+		std::memory_order_relaxed);
+}
+
+template <typename T> inline
+void WorkStealingDeque<T>::Buffer::put(std::int64_t index, T value)
+{
+	slots_[static_cast<std::size_t>(index) & mask_].store(
+		value, std::memory_order_relaxed);
+}
+
+template <typename T> inline
+typename WorkStealingDeque<T>::Buffer* WorkStealingDeque<T>::Buffer::grow(
+	std::int64_t top, std::int64_t bottom)
+{
+	Buffer* bigger = new Buffer{capacity_ * 2, this};
+	for (std::int64_t i = top; i < bottom; ++i)
+		bigger->put(i, get(i));
+	return bigger;
+}
+
+template <typename T> inline
+WorkStealingDeque<T>::WorkStealingDeque(std::size_t capacity) :
+	top_{0},
+	bottom_{0},
+	buffer_{nullptr}
+{
+	static_assert(std::is_trivially_copyable<T>::value,
+		"WorkStealingDeque requires a trivially copyable value type");
+
+	std::size_t rounded = 2;
+	while (rounded < capacity)
+		rounded <<= 1;
+	buffer_.store(new Buffer{rounded, nullptr}, std::memory_order_relaxed);
+}
+
+template <typename T> inline
+WorkStealingDeque<T>::~WorkStealingDeque()
+{
+	Buffer* current = buffer_.load(std::memory_order_relaxed);
+	while (current != nullptr) {
+		Buffer* retired = current->retired_;
+		delete current;
+		current = retired;
+	}
+}
+
+template <typename T> inline
+void WorkStealingDeque<T>::push(T value)
+{
+	std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+	std::int64_t top = top_.load(std::memory_order_acquire);
+	Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+
+	if (bottom - top > static_cast<std::int64_t>(buffer->capacity_) - 1) {
+		buffer = buffer->grow(top, bottom);
+		buffer_.store(buffer, std::memory_order_release);
+	}
+
+	buffer->put(bottom, value);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom_.store(bottom + 1, std::memory_order_relaxed);
+}
+
+template <typename T> inline
+bool WorkStealingDeque<T>::pop(T& value)
+{
+	std::int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+	Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+	bottom_.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	std::int64_t top = top_.load(std::memory_order_relaxed);
+
+	if (top > bottom) {
+		// Empty; undo the speculative decrement.
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	value = buffer->get(bottom);
+	if (top == bottom) {
+		// Last item: race the thieves for it.
+		bool won = top_.compare_exchange_strong(top, top + 1,
+			std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+		return won;
+	}
+	return true;
+}
+
+template <typename T> inline
+bool WorkStealingDeque<T>::steal(T& value)
+{
+	std::int64_t top = top_.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	std::int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+		return false;
+
+	Buffer* buffer = buffer_.load(std::memory_order_acquire);
+	T stolen = buffer->get(top);
+	if (!top_.compare_exchange_strong(top, top + 1,
+			std::memory_order_seq_cst, std::memory_order_relaxed))
+		return false;
+
+	value = stolen;
+	return true;
+}
+
+template <typename T> inline
+std::size_t WorkStealingDeque<T>::size() const
+{
+	std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+	std::int64_t top = top_.load(std::memory_order_relaxed);
+	return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
+}
+
+template <typename T> inline
+bool WorkStealingDeque<T>::isEmpty() const
+{
+	return size() == 0;
+}
+
+template <typename T> inline
+std::size_t WorkStealingDeque<T>::capacity() const
+{
+	return buffer_.load(std::memory_order_relaxed)->capacity_;
+}
+
+#endif
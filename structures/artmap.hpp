@@ -0,0 +1,510 @@
+/**
+ * \file artmap.hpp
+ * \brief Ordered mapping type backed by an adaptive radix tree.
+ */
+
+#ifndef ART_MAP_HPP
+#define ART_MAP_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+
+
+/**
+ * \brief The bytes of a key, in an order that agrees with the key's own:
+ *        comparing two keys' bytes one by one, unsigned, with a proper
+ *        prefix first, orders them as operator< does.
+ * \details Specialised for integers (big endian, sign bit flipped) and
+ *          std::string (its characters).  Other key types provide their own
+ *          specialisation with data() and size().
+ */
+template <typename K, typename = void>
+struct ArtKey;
+
+template <typename K>
+struct ArtKey<K, typename std::enable_if<std::is_integral<K>::value
+	&& !std::is_same<K, bool>::value>::type>
+{
+	explicit ArtKey(K key)
+	{
+		typedef typename std::make_unsigned<K>::type Bits;
+		Bits bits = static_cast<Bits>(key);
+		if (std::is_signed<K>::value)
+			bits ^= static_cast<Bits>(Bits{1} << (sizeof(K) * 8 - 1));
+		for (std::size_t i = sizeof(K); i > 0; --i) {
+			bytes_[i - 1] = static_cast<unsigned char>(bits & 0xFF);
+			bits = static_cast<Bits>(bits >> 4 >> 4);
+		}
+	}
+
+	unsigned char const* data() const { return bytes_; }
+
+	std::size_t size() const { return sizeof(K); }
+
+	unsigned char bytes_[sizeof(K)];
+};
+
+template <>
+struct ArtKey<std::string>
+{
+	explicit ArtKey(std::string const& key) :
+		data_{reinterpret_cast<unsigned char const*>(key.data())},
+		size_{key.size()}
+	{
+	}
+
+	unsigned char const* data() const { return data_; }
+
+	std::size_t size() const { return size_; }
+
+	unsigned char const* data_;
+	std::size_t size_;
+};
+
+/**
+ * \brief An ordered map that finds a key by its bytes rather than by
+ *        comparing it with other keys.
+ * \details Each inner node branches on one byte of the key and is one of
+ *          four sizes, grown and shrunk as children come and go: up to 4
+ *          and up to 16 children keep sorted byte and child arrays (the 16
+ *          bytes are matched all at once with SSE2 where available), up to
+ *          48 keep a 256 entry byte index into the children, and beyond
+ *          that a node holds all 256 child pointers.  Chains of single
+ *          children are compressed into a prefix on the node below, of
+ *          which the first MaxPrefix bytes are stored and the rest, when
+ *          a lookup needs them, read from a leaf of the subtree.
+ *
+ *          A lookup therefore costs one step per distinguishing byte plus
+ *          one full comparison at the leaf, however many keys share the
+ *          prefix, and keys come out in order, so unlike a hash map it
+ *          supports ordered iteration and prefix scans.  A key that is a
+ *          prefix of others is kept on the node where it ends.
+ *
+ *          K needs an ArtKey specialisation.
+ */
+template <typename K, typename V>
+class ArtMap : public Map<K, V>
+{
+private:
+	/**
+	 * \brief What every node starts with: its kind.
+	 */
+	struct Node;
+
+	/**
+	 * \brief A key-value pair.
+	 */
+	struct Leaf;
+
+	/**
+	 * \brief What every inner node holds besides its children.
+	 */
+	struct Inner;
+
+	/**
+	 * \brief Inner node with up to 4 children.
+	 */
+	struct Node4;
+
+	/**
+	 * \brief Inner node with up to 16 children.
+	 */
+	struct Node16;
+
+	/**
+	 * \brief Inner node with up to 48 children.
+	 */
+	struct Node48;
+
+	/**
+	 * \brief Inner node with a slot for every byte.
+	 */
+	struct Node256;
+
+	/**
+	 * \brief Walks the leaves in key order.
+	 */
+	template <typename LeafT>
+	class LeafCursor;
+
+public:
+	typedef MapView<LeafCursor<Leaf const>, KeyOf<K, V>> keys_view;
+	typedef MapView<LeafCursor<Leaf>, ValueOf<K, V>> values_view;
+	typedef MapView<LeafCursor<Leaf const>, ValueOf<K, V const>>
+		const_values_view;
+	typedef MapView<LeafCursor<Leaf>, ItemOf<K, V>> items_view;
+	typedef MapView<LeafCursor<Leaf const>, ItemOf<K, V const>>
+		const_items_view;
+
+	/**
+	 * \brief Default constructor.  Does not allocate.
+	 */
+	ArtMap();
+
+	/**
+	 * \brief Copy constructor.
+	 */
+	ArtMap(ArtMap<K, V> const& orig);
+
+	/**
+	 * \brief Move constructor.
+	 */
+	ArtMap(ArtMap<K, V>&& other);
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	ArtMap<K, V>& operator=(ArtMap<K, V> rhs);
+
+	/**
+	 * \brief Idiomatic swap function.
+	 */
+	template <typename KEY, typename VALUE>
+	friend void swap(ArtMap<KEY, VALUE>& lhs, ArtMap<KEY, VALUE>& rhs);
+
+	/**
+	 * \brief Frees every node.
+	 */
+	~ArtMap();
+
+	/**
+	 * \brief Adds a key-value pair to the map.
+	 * \throws KeyError if the key is already present.
+	 */
+	void addValue(K key, V value);
+
+	/**
+	 * \brief Sets the value of key, adding the pair if it is not present.
+	 * \return true if the pair was added, false if it was overwritten.
+	 */
+	bool insertOrAssign(K key, V value);
+
+	/**
+	 * \brief Adds key with a value constructed from args if it is absent,
+	 *        and otherwise leaves the map, and args, untouched.
+	 * \return The value of key, and whether it was added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> tryEmplace(K key, Args&&... args);
+
+	/**
+	 * \brief Calls fn(value) on the value of key, first adding a value
+	 *        initialised V if the key is absent.
+	 * \return The value of key.
+	 */
+	template <typename Fn>
+	V& upsert(K key, Fn fn);
+
+	/**
+	 * \brief Removes the value associated with a given key.
+	 * \throws KeyError if the key is not present.
+	 */
+	void removeValue(K const& key);
+
+	/**
+	 * \brief Gets the value associated with a key.
+	 * \throws KeyError if the key is not present.
+	 */
+	V& getValue(K const& key) const;
+
+	/**
+	 * \brief Gets a pointer to the value of key, or nullptr if it is absent.
+	 */
+	V* find(K const& key) const;
+
+	/**
+	 * \brief Gets the number of elements in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Calls fn(key, value), in key order, for every pair whose key's
+	 *        bytes start with the bytes of prefix; for std::string keys,
+	 *        every key that starts with prefix.
+	 * \details Only the subtree under the prefix is visited.
+	 */
+	template <typename Fn>
+	void forEachWithPrefix(K const& prefix, Fn fn) const;
+
+	/**
+	 * \brief Gets a view of every key, in key order.
+	 * \details Leaves have no links, so each step of a view searches down
+	 *          from the root, which costs a step per byte of the key.
+	 *          forEach() visits the tree directly.
+	 */
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every value, in key order.
+	 */
+	values_view values();
+
+	/**
+	 * \brief Gets a view of every value, in key order.
+	 */
+	const_values_view values() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair, in key order.
+	 */
+	items_view items();
+
+	/**
+	 * \brief Gets a view of every key-value pair, in key order.
+	 */
+	const_items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in key order.
+	 * \details fn must not add or remove pairs.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn);
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in key order.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+	/**
+	 * \brief Prefix bytes stored in an inner node.
+	 */
+	static const std::size_t MaxPrefix = 8;
+
+private:
+	/**
+	 * \brief Kinds of node.
+	 */
+	static const unsigned char LeafKind = 0;
+	static const unsigned char Kind4 = 1;
+	static const unsigned char Kind16 = 2;
+	static const unsigned char Kind48 = 3;
+	static const unsigned char Kind256 = 4;
+
+	struct Node
+	{
+		unsigned char kind_;
+	};
+
+	struct Leaf : Node
+	{
+		Leaf(K&& key, V&& value);
+		Leaf(K const& key, V const& value);
+
+		K key_;
+		V value_;
+	};
+
+	struct Inner : Node
+	{
+		std::uint16_t count_;
+		std::uint32_t prefixLength_;
+		unsigned char prefix_[MaxPrefix];
+		Leaf* end_;
+	};
+
+	struct Node4 : Inner
+	{
+		unsigned char bytes_[4];
+		Node* children_[4];
+	};
+
+	struct Node16 : Inner
+	{
+		unsigned char bytes_[16];
+		Node* children_[16];
+	};
+
+	struct Node48 : Inner
+	{
+		/**
+		 * \brief One more than the slot of each byte's child; 0 for none.
+		 */
+		unsigned char slots_[256];
+		Node* children_[48];
+	};
+
+	struct Node256 : Inner
+	{
+		Node* children_[256];
+	};
+
+	template <typename LeafT>
+	class LeafCursor
+	{
+	public:
+		/**
+		 * \brief Points at leaf of map; null is the end.
+		 */
+		LeafCursor(ArtMap const* map, LeafT* leaf) : map_{map}, leaf_{leaf}
+		{
+		}
+
+		/**
+		 * \brief Moves to the next leaf in key order.
+		 */
+		LeafCursor& operator++();
+
+		/**
+		 * \brief Gets the current leaf.
+		 */
+		LeafT& operator*() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const LeafCursor& rhs) const;
+
+	private:
+		ArtMap const* map_;
+		LeafT* leaf_;
+	};
+
+	/**
+	 * \brief Whether leaf holds the key with the given bytes.
+	 */
+	static bool matches(Leaf const* leaf, ArtKey<K> const& bytes);
+
+	/**
+	 * \brief Number of the stored prefix bytes of node that match bytes
+	 *        from depth on.
+	 */
+	static std::size_t checkPrefix(Inner const* node,
+		ArtKey<K> const& bytes, std::size_t depth);
+
+	/**
+	 * \brief Number of bytes of the whole prefix of node, stored or not,
+	 *        that match bytes from depth on.
+	 */
+	static std::size_t prefixMismatch(Inner* node, ArtKey<K> const& bytes,
+		std::size_t depth);
+
+	/**
+	 * \brief Link to the child of node for byte, or null if there is none.
+	 */
+	static Node** findChild(Inner* node, unsigned char byte);
+
+	/**
+	 * \brief First child of node for a byte greater than byte, which is
+	 *        then set to the child's byte; -1 asks for the first child.
+	 * \return The child, or null if there is none.
+	 */
+	static Node* nextChild(Inner* node, int& byte);
+
+	/**
+	 * \brief Last child of node, or null if it has none.
+	 */
+	static Node* lastChild(Inner* node);
+
+	/**
+	 * \brief The child array of node, of length entries; unused entries
+	 *        are null.
+	 */
+	static Node** children(Inner* node, std::size_t& length);
+
+	/**
+	 * \brief Leaf with the smallest key under node, or null if node is.
+	 */
+	static Leaf* minimum(Node* node);
+
+	/**
+	 * \brief Leaf after leaf in key order, or null.
+	 */
+	Leaf* successor(Leaf const* leaf) const;
+
+	/**
+	 * \brief Finds the leaf holding the key with the given bytes.
+	 */
+	Leaf* findLeaf(ArtKey<K> const& bytes) const;
+
+	/**
+	 * \brief Finds key with a single descent, adding it with a value
+	 *        constructed from args if it is absent.  key is only moved from
+	 *        when it is added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> findOrInsert(K& key, Args&&... args);
+
+	/**
+	 * \brief Constructs the leaf for key.  If that throws, key is left as
+	 *        it was.
+	 */
+	template <typename... Args>
+	static Leaf* newLeaf(K& key, Args&&... args);
+
+	/**
+	 * \brief Adds child for byte to the inner node at link, growing it into
+	 *        the next size if it is full.
+	 */
+	static void addChild(Node** link, unsigned char byte, Node* child);
+
+	/**
+	 * \brief Detaches the leaf holding the key with the given bytes from
+	 *        the tree under link.
+	 * \return The leaf, or null if the key is absent.
+	 */
+	static Leaf* detach(Node** link, ArtKey<K> const& bytes);
+
+	/**
+	 * \brief Removes the child for byte from the inner node at link,
+	 *        shrinking the node if it has become sparse and memory allows.
+	 */
+	static void removeChild(Node** link, unsigned char byte);
+
+	/**
+	 * \brief Replaces the inner node at link, once it holds a single leaf
+	 *        or child, by that leaf or child.
+	 */
+	static void collapse(Node** link);
+
+	/**
+	 * \brief Copies the header of from into to.
+	 */
+	static void copyHeader(Inner* to, Inner const* from);
+
+	/**
+	 * \brief Calls fn on each pair under node in key order.
+	 */
+	template <typename LeafT, typename Fn>
+	static void visit(Node* node, Fn& fn);
+
+	/**
+	 * \brief Stores a deep copy of the subtree under from in *to.  If that
+	 *        throws, *to holds the part copied so far.
+	 */
+	static void clone(Node* from, Node** to);
+
+	/**
+	 * \brief Frees the subtree under node.
+	 */
+	static void destroy(Node* node);
+
+	/**
+	 * \brief Frees one node, not its children.
+	 */
+	static void release(Node* node);
+
+	Node* root_;
+	std::size_t size_;
+};
+
+#include "_artmap.hpp"
+
+#endif
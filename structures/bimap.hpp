@@ -0,0 +1,246 @@
+/**
+ * \file bimap.hpp
+ * \brief Mapping type that can be looked up by key or by value.
+ */
+
+#ifndef BI_MAP_HPP
+#define BI_MAP_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "mapviews.hpp"
+
+
+/**
+ * \brief A one-to-one map with constant time lookups in both directions.
+ * \details Each pair is stored once, in a dense array.  Two open-addressing
+ *          tables of 32 bit entry indices, one hashed by key and one by
+ *          value, point into that array, so the reverse direction costs one
+ *          extra index table rather than a second copy of every pair.
+ *          Removing a pair moves the last pair into its place, so the
+ *          order of the views is not stable across removals.
+ *
+ *          Values are part of the index, so they are only ever handed out
+ *          const; replace() is the way to change the value of a key.  For
+ *          that reason BiMap does not derive from Map, whose getValue()
+ *          returns a mutable reference.
+ */
+template <typename K, typename V,
+	typename KeyHash = std::hash<K>, typename ValueHash = std::hash<V>,
+	typename KeyEq = std::equal_to<K>, typename ValueEq = std::equal_to<V>>
+class BiMap
+{
+private:
+	/**
+	 * \brief A pair plus both of its hashes.
+	 */
+	struct Entry;
+
+public:
+	typedef MapView<Entry const*, KeyOf<K, V>> keys_view;
+	typedef MapView<Entry const*, ValueOf<K, V const>> values_view;
+	typedef MapView<Entry const*, ItemOf<K, V const>> items_view;
+
+	/**
+	 * \brief Default constructor.  Does not allocate.
+	 */
+	BiMap();
+
+	/**
+	 * \brief Copy constructor.
+	 */
+	BiMap(BiMap<K, V, KeyHash, ValueHash, KeyEq, ValueEq> const& orig);
+
+	/**
+	 * \brief Move constructor.
+	 */
+	BiMap(BiMap<K, V, KeyHash, ValueHash, KeyEq, ValueEq>&& other);
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	BiMap<K, V, KeyHash, ValueHash, KeyEq, ValueEq>& operator=(
+		BiMap<K, V, KeyHash, ValueHash, KeyEq, ValueEq> rhs);
+
+	/**
+	 * \brief Idiomatic swap function.
+	 */
+	template <typename KEY, typename VALUE, typename KHASH, typename VHASH,
+		typename KEQ, typename VEQ>
+	friend void swap(BiMap<KEY, VALUE, KHASH, VHASH, KEQ, VEQ>& lhs,
+		BiMap<KEY, VALUE, KHASH, VHASH, KEQ, VEQ>& rhs);
+
+	/**
+	 * \brief We can use a default destructor because std::vector has its own
+	 *        destructor.
+	 */
+	~BiMap() = default;
+
+	/**
+	 * \brief Adds a key-value pair to the map.
+	 * \throws KeyError if either the key or the value is already present.
+	 */
+	void addValue(K key, V value);
+
+	/**
+	 * \brief Makes key and value a pair, first removing whichever pairs
+	 *        currently hold either of them.
+	 * \details Either the whole replacement happens or, if copying or
+	 *          allocating throws, the map is left unchanged.
+	 * \return The number of pairs that were displaced (0, 1 or 2).
+	 */
+	std::size_t replace(K key, V value);
+
+	/**
+	 * \brief Removes the pair holding a given key.
+	 * \throws KeyError if the key is not present.
+	 */
+	void removeValue(K const& key);
+
+	/**
+	 * \brief Removes the pair holding a given value.
+	 * \throws KeyError if the value is not present.
+	 */
+	void removeByValue(V const& value);
+
+	/**
+	 * \brief Gets the value paired with a key.  It cannot be changed in
+	 *        place, as that would leave the value index stale.
+	 * \throws KeyError if the key is not present.
+	 */
+	V const& getValue(K const& key) const;
+
+	/**
+	 * \brief Gets the key paired with a value.
+	 * \throws KeyError if the value is not present.
+	 */
+	K const& getKey(V const& value) const;
+
+	/**
+	 * \brief Gets the number of pairs in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Determines whether or not the value is present.
+	 */
+	bool containsValue(V const& value) const;
+
+	/**
+	 * \brief Makes room for count pairs without rehashing.
+	 */
+	void reserve(std::size_t count);
+
+	/**
+	 * \brief Gets a view of every key.
+	 */
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every value.
+	 */
+	values_view values() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair.
+	 */
+	items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair.
+	 * \details fn must not add or remove pairs.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+private:
+	struct Entry
+	{
+		K key_;
+		V value_;
+		std::size_t keyHash_;
+		std::size_t valueHash_;
+	};
+
+	/**
+	 * \brief Index table slot that holds no entry.
+	 */
+	static const std::uint32_t Empty = 0xFFFFFFFFu;
+
+	/**
+	 * \brief Spreads a user hash over every bit.
+	 */
+	static std::size_t mix(std::size_t hash);
+
+	/**
+	 * \brief Slot of table holding the entry that satisfies match, or the
+	 *        empty slot ending its probe run.  table must not be empty.
+	 */
+	template <typename Match>
+	std::size_t probe(std::vector<std::uint32_t> const& table,
+		std::size_t hash, Match match) const;
+
+	/**
+	 * \brief Index of the entry holding key, or Empty.
+	 */
+	std::uint32_t findKey(K const& key, std::size_t hash) const;
+
+	/**
+	 * \brief Index of the entry holding value, or Empty.
+	 */
+	std::uint32_t findValue(V const& value, std::size_t hash) const;
+
+	/**
+	 * \brief Slot of table pointing at entry.
+	 */
+	std::size_t slotOf(std::vector<std::uint32_t> const& table,
+		std::size_t hash, std::uint32_t entry) const;
+
+	/**
+	 * \brief Empties a slot and shifts the rest of its probe run back.
+	 */
+	void eraseSlot(std::vector<std::uint32_t>& table, std::size_t slot,
+		bool byValue);
+
+	/**
+	 * \brief Removes an entry from both tables and fills its hole in the
+	 *        array with the last entry.
+	 */
+	void eraseEntry(std::uint32_t entry);
+
+	/**
+	 * \brief Appends an entry and indexes it; room must already exist.
+	 */
+	void appendEntry(Entry&& entry);
+
+	/**
+	 * \brief Grows the tables and the array, if needed, so that count pairs
+	 *        fit.  Leaves the map unchanged if allocation throws.
+	 */
+	void makeRoom(std::size_t count);
+
+	std::vector<Entry> entries_;
+	std::vector<std::uint32_t> byKey_;
+	std::vector<std::uint32_t> byValue_;
+	KeyHash hashKey_;
+	ValueHash hashValue_;
+	KeyEq equalKey_;
+	ValueEq equalValue_;
+};
+
+#include "_bimap.hpp"
+
+#endif
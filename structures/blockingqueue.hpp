@@ -0,0 +1,216 @@
+/**
+ * \file blockingqueue.hpp
+ * \brief A bounded multi-producer multi-consumer blocking queue.
+ */
+
+#ifndef BLOCKING_QUEUE_HPP
+#define BLOCKING_QUEUE_HPP 1
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <iterator>
+#include <mutex>
+#include <type_traits>
+
+
+/**
+ * \brief A bounded FIFO queue safe for any number of producers and consumers.
+ * \details Backed by a preallocated ring in which every slot carries a
+ *          sequence number, so the try variants are lock-free and only a
+ *          thread that actually has to sleep ever touches the mutex.  The
+ *          batch variants claim a run of slots with a single CAS.
+ */
+template <typename T>
+class BlockingQueue
+{
+private:
+	/**
+	 * \brief A ring slot and its sequence number.
+	 */
+	struct Slot;
+
+public:
+	/**
+	 * \brief Constructs an empty queue.
+	 * \details The capacity is rounded up to a power of two.
+	 */
+	explicit BlockingQueue(std::size_t capacity);
+
+	/**
+	 * \brief The queue is shared between threads by reference only.
+	 */
+	BlockingQueue(const BlockingQueue<T>& orig) = delete;
+
+	/**
+	 * \brief The queue is shared between threads by reference only.
+	 */
+	BlockingQueue<T>& operator=(const BlockingQueue<T>& rhs) = delete;
+
+	/**
+	 * \brief Frees the ring.
+	 */
+	~BlockingQueue();
+
+	/**
+	 * \brief Adds a value, blocking while the queue is full.
+	 */
+	void push(T value);
+
+	/**
+	 * \brief Adds a value if there is room.
+	 * \return false if the queue was full.
+	 */
+	bool tryPush(T value);
+
+	/**
+	 * \brief Adds a value, blocking at most for the given duration.
+	 * \return false if the queue stayed full.
+	 */
+	template <typename Rep, typename Period>
+	bool tryPushFor(T value, const std::chrono::duration<Rep, Period>& timeout);
+
+	/**
+	 * \brief Removes and returns the oldest value, blocking while the queue
+	 *        is empty.
+	 */
+	T pop();
+
+	/**
+	 * \brief Removes the oldest value if there is one.
+	 * \return false if the queue was empty.
+	 */
+	bool tryPop(T& value);
+
+	/**
+	 * \brief Removes the oldest value, blocking at most for the given
+	 *        duration.
+	 * \return false if the queue stayed empty.
+	 */
+	template <typename Rep, typename Period>
+	bool tryPopFor(T& value, const std::chrono::duration<Rep, Period>& timeout);
+
+	/**
+	 * \brief Adds every value in [first, last), blocking while the queue is
+	 *        full.
+	 * \details The values are claimed in runs of free slots, one CAS per
+	 *          run; each run is contiguous in the queue, but another
+	 *          producer's values may land between two runs.  If copying a
+	 *          value could throw, the range is copied out before any slot is
+	 *          claimed, so a throw leaves the queue untouched.
+	 */
+	template <typename ForwardIt>
+	void pushBatch(ForwardIt first, ForwardIt last);
+
+	/**
+	 * \brief Adds as many values from [first, last) as currently fit, in one
+	 *        contiguous run.
+	 * \details As with pushBatch(), a throwing copy happens before any slot
+	 *          is claimed.
+	 * \return The number of values added.
+	 */
+	template <typename ForwardIt>
+	std::size_t tryPushBatch(ForwardIt first, ForwardIt last);
+
+	/**
+	 * \brief Removes up to maxItems values into out, blocking until at least
+	 *        one is available.
+	 * \return The number of values removed.
+	 */
+	template <typename OutputIt>
+	std::size_t popBatch(OutputIt out, std::size_t maxItems);
+
+	/**
+	 * \brief Removes up to maxItems values into out without blocking.
+	 * \return The number of values removed.
+	 */
+	template <typename OutputIt>
+	std::size_t tryPopBatch(OutputIt out, std::size_t maxItems);
+
+	/**
+	 * \brief Approximate number of values in the queue.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Approximate emptiness check.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Maximum number of values the queue can hold.
+	 */
+	std::size_t capacity() const;
+
+private:
+	struct Slot
+	{
+		std::atomic<std::size_t> sequence_;
+		T value_;
+	};
+
+	/**
+	 * \brief Claims up to maxItems consecutive free slots with one CAS.
+	 * \return The number of slots claimed; the first is at position.
+	 */
+	std::size_t claimForPush(std::size_t maxItems, std::size_t& position);
+
+	/**
+	 * \brief Claims up to maxItems consecutive full slots with one CAS.
+	 * \return The number of slots claimed; the first is at position.
+	 */
+	std::size_t claimForPop(std::size_t maxItems, std::size_t& position);
+
+	/**
+	 * \brief Whether assigning a value read through It to a slot cannot
+	 *        throw, so it can be done after the slot is claimed.
+	 */
+	template <typename It>
+	struct WritesNothrow : std::is_nothrow_assignable<T&,
+		typename std::iterator_traits<It>::reference>
+	{
+	};
+
+	/**
+	 * \brief Claims up to count slots and fills them from first, which is
+	 *        left past the last value pushed.
+	 * \return The number of values pushed.
+	 */
+	template <typename It>
+	std::size_t pushRun(It& first, std::size_t count);
+
+	/**
+	 * \brief Pushes count values from first, sleeping while the queue is
+	 *        full.
+	 */
+	template <typename It>
+	void pushAll(It first, std::size_t count);
+
+	/**
+	 * \brief Wakes sleeping consumers after values were published.
+	 */
+	void notifyConsumers(bool all);
+
+	/**
+	 * \brief Wakes sleeping producers after slots were released.
+	 */
+	void notifyProducers(bool all);
+
+	Slot* slots_;
+	std::size_t mask_;
+
+	// Producers and consumers each get their own cache line.
+	alignas(64) std::atomic<std::size_t> pushPosition_;
+	alignas(64) std::atomic<std::size_t> popPosition_;
+
+	alignas(64) std::atomic<std::size_t> pushWaiters_;
+	std::atomic<std::size_t> popWaiters_;
+	std::mutex mutex_;
+	std::condition_variable notFull_;
+	std::condition_variable notEmpty_;
+};
+
+#include "_blockingqueue.hpp"
+
+#endif
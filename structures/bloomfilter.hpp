@@ -0,0 +1,164 @@
+/**
+ * \file bloomfilter.hpp
+ * \brief Probabilistic set that answers "definitely absent" or "maybe
+ *        present".
+ */
+
+#ifndef BLOOM_FILTER_HPP
+#define BLOOM_FILTER_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+/**
+ * \brief A blocked Bloom filter: a key is never reported absent once it has
+ *        been added, and an absent key is reported present with roughly the
+ *        requested false positive rate.
+ * \details The bits are split into 64 byte blocks, each aligned to a cache
+ *          line.  A key's hash picks one block and then one bit in each of
+ *          its eight 64 bit words, so adding or testing a key touches a
+ *          single cache line, and the eight word tests are independent
+ *          lanes the compiler can vectorise.  Confining a key to one block
+ *          costs a little accuracy, which the sizing makes up for with a
+ *          few more bits per key.
+ *
+ *          A filter sized for capacity keys keeps to its rate until more
+ *          than capacity keys have been added; past that the rate climbs.
+ *          Keys cannot be removed.
+ */
+template <typename K, typename Hash = std::hash<K>>
+class BloomFilter
+{
+public:
+	/**
+	 * \brief Constructs a filter for capacity keys at the given false
+	 *        positive rate, clamped to [0.0001, 0.5].
+	 * \details A filter with no capacity allocates nothing and reports
+	 *          every key as maybe present.
+	 */
+	explicit BloomFilter(std::size_t capacity = 0,
+		double falsePositiveRate = DefaultFalsePositiveRate,
+		Hash hash = Hash());
+
+	/**
+	 * \brief Copy constructor.
+	 */
+	BloomFilter(BloomFilter<K, Hash> const& orig);
+
+	/**
+	 * \brief Move constructor.
+	 */
+	BloomFilter(BloomFilter<K, Hash>&& other);
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	BloomFilter<K, Hash>& operator=(BloomFilter<K, Hash> rhs);
+
+	/**
+	 * \brief Idiomatic swap function.
+	 */
+	template <typename KEY, typename HASH>
+	friend void swap(BloomFilter<KEY, HASH>& lhs, BloomFilter<KEY, HASH>& rhs);
+
+	/**
+	 * \brief We can use a default destructor because std::vector has its own
+	 *        destructor.
+	 */
+	~BloomFilter() = default;
+
+	/**
+	 * \brief Adds a key.
+	 */
+	void add(K const& key);
+
+	/**
+	 * \brief Determines whether the key may have been added.  false means
+	 *        it certainly was not.
+	 */
+	bool mayContain(K const& key) const;
+
+	/**
+	 * \brief Forgets every key, keeping the capacity.
+	 */
+	void clear();
+
+	/**
+	 * \brief Gets the number of calls to add() since construction or the
+	 *        last clear(), duplicates included.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Gets the number of keys the filter was sized for.
+	 */
+	std::size_t capacity() const;
+
+	/**
+	 * \brief Gets the false positive rate the filter was sized for.
+	 */
+	double falsePositiveRate() const;
+
+	/**
+	 * \brief Gets the number of bits in the filter.
+	 */
+	std::size_t bitCount() const;
+
+	/**
+	 * \brief Gets a copy of the hash function.
+	 */
+	Hash hashFunction() const;
+
+	/**
+	 * \brief False positive rate used when none is given.
+	 */
+	static constexpr double DefaultFalsePositiveRate = 0.01;
+
+private:
+	/**
+	 * \brief 64 bit words per block; a block fills one cache line.
+	 */
+	static const std::size_t BlockWords = 8;
+
+	/**
+	 * \brief Odd multipliers that each turn the low half of a hash into an
+	 *        independent bit position.
+	 */
+	static const std::uint32_t Salt[BlockWords];
+
+	/**
+	 * \brief Spreads a user hash over every bit.
+	 */
+	std::uint64_t hashOf(K const& key) const;
+
+	/**
+	 * \brief First word of the block a hash falls in.
+	 */
+	std::uint64_t* blockOf(std::uint64_t hash);
+
+	/**
+	 * \brief First word of the block a hash falls in.
+	 */
+	std::uint64_t const* blockOf(std::uint64_t hash) const;
+
+	/**
+	 * \brief Allocates blockCount_ zeroed blocks and finds the first
+	 *        cache line aligned word.
+	 */
+	void allocate();
+
+	std::vector<std::uint64_t> storage_;
+	std::size_t offset_;
+	std::size_t blockCount_;
+	std::size_t size_;
+	std::size_t capacity_;
+	double falsePositiveRate_;
+	Hash hash_;
+};
+
+#include "_bloomfilter.hpp"
+
+#endif
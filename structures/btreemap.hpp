@@ -0,0 +1,458 @@
+/**
+ * \file btreemap.hpp
+ * \brief Ordered mapping type backed by a B+ tree with wide nodes.
+ */
+
+#ifndef BTREE_MAP_HPP
+#define BTREE_MAP_HPP 1
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+
+
+/**
+ * \brief An ordered map that stays cache friendly at tens of millions of
+ *        keys.
+ * \details A B+ tree: inner nodes hold only separator keys, and every pair
+ *          lives in a leaf, with the leaves chained in key order so scans
+ *          never climb back up the tree.  Each node's keys form one
+ *          contiguous array of about 256 bytes (at least eight keys), so a
+ *          lookup touches a handful of cache lines per level and the tree
+ *          is only a few levels deep.  Within a node the position of a key
+ *          is found by counting the keys below it, a loop without
+ *          data-dependent branches that the compiler can vectorise.
+ *
+ *          K and V must be default constructible, since nodes hold fixed
+ *          arrays of them.  Iterators and views yield MapItems in key order
+ *          and are invalidated by any insertion or removal.
+ */
+template <typename K, typename V>
+class BTreeMap : public Map<K, V>
+{
+private:
+	/**
+	 * \brief Fields shared by inner nodes and leaves.
+	 */
+	struct Node;
+
+	/**
+	 * \brief Node holding separators and children.
+	 */
+	struct Inner;
+
+	/**
+	 * \brief Node holding pairs.
+	 */
+	struct Leaf;
+
+	/**
+	 * \brief A pair in a leaf, seen through references.
+	 */
+	template <typename ValueT>
+	struct SlotRef;
+
+	/**
+	 * \brief Walks the pairs leaf by leaf.
+	 */
+	template <typename ValueT>
+	class LeafCursor;
+
+public:
+	typedef MapView<LeafCursor<V const>, KeyOf<K, V>> keys_view;
+	typedef MapView<LeafCursor<V>, ValueOf<K, V>> values_view;
+	typedef MapView<LeafCursor<V const>, ValueOf<K, V const>>
+		const_values_view;
+	typedef MapView<LeafCursor<V>, ItemOf<K, V>> items_view;
+	typedef MapView<LeafCursor<V const>, ItemOf<K, V const>>
+		const_items_view;
+
+	typedef typename items_view::iterator iterator;
+	typedef typename const_items_view::iterator const_iterator;
+
+	/**
+	 * \brief Default constructor.  Does not allocate.
+	 */
+	BTreeMap();
+
+	/**
+	 * \brief Constructs a map from the pairs in [first, last) with
+	 *        insertBatch(), so a later pair wins over an earlier one with
+	 *        the same key.
+	 */
+	template <typename InputIt>
+	BTreeMap(InputIt first, InputIt last);
+
+	/**
+	 * \brief Copy constructor.  Rebuilds the tree bottom up.
+	 */
+	BTreeMap(BTreeMap<K, V> const& orig);
+
+	/**
+	 * \brief Move constructor.
+	 */
+	BTreeMap(BTreeMap<K, V>&& other);
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	BTreeMap<K, V>& operator=(BTreeMap<K, V> rhs);
+
+	/**
+	 * \brief Idiomatic swap function.
+	 */
+	template <typename KEY, typename VALUE>
+	friend void swap(BTreeMap<KEY, VALUE>& lhs, BTreeMap<KEY, VALUE>& rhs);
+
+	/**
+	 * \brief Frees every node.
+	 */
+	~BTreeMap();
+
+	/**
+	 * \brief Replaces the contents with the pairs in [first, last) in O(n).
+	 * \details The range holds std::pair<K, V> (or anything with first and
+	 *          second members) in strictly increasing key order.  Pairs are
+	 *          spread evenly over the fewest leaves that hold them and each
+	 *          level is built directly from the one below, so no key is ever
+	 *          compared against the tree.
+	 * \throws KeyError, leaving the map unchanged, on the first key that is
+	 *         not greater than the one before it.
+	 */
+	template <typename InputIt>
+	void bulkLoad(InputIt first, InputIt last);
+
+	/**
+	 * \brief Sets the value of every key in [first, last), adding the keys
+	 *        that are not present.
+	 * \details The range holds std::pair<K, V> (or anything with first and
+	 *          second members).  The result is that of insertOrAssign() on
+	 *          each pair in turn: a later pair wins over an earlier one with
+	 *          the same key and over the map.  A batch that is small next to
+	 *          the map is inserted pair by pair, in O(m log n).  A larger one
+	 *          need not be sorted, unlike for bulkLoad(): it is sorted once,
+	 *          merged with the pairs moved out of the tree and built as
+	 *          bulkLoad() builds, in O(m log m + n).  If that rebuild throws,
+	 *          the map is left empty.
+	 */
+	template <typename InputIt>
+	void insertBatch(InputIt first, InputIt last);
+
+	/**
+	 * \brief Adds a key-value pair to the map.
+	 * \throws KeyError if the key is already present.
+	 */
+	void addValue(K key, V value);
+
+	/**
+	 * \brief Sets the value of key, adding the pair if it is not present.
+	 * \return true if the pair was added, false if it was overwritten.
+	 */
+	bool insertOrAssign(K key, V value);
+
+	/**
+	 * \brief Adds key with a value constructed from args if it is absent,
+	 *        and otherwise leaves the map, and args, untouched.
+	 * \return The value of key, and whether it was added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> tryEmplace(K key, Args&&... args);
+
+	/**
+	 * \brief Calls fn(value) on the value of key, first adding a value
+	 *        initialised V if the key is absent.
+	 * \return The value of key.
+	 */
+	template <typename Fn>
+	V& upsert(K key, Fn fn);
+
+private:
+	/**
+	 * \brief Descends once to the leaf where key belongs and returns its
+	 *        value there; on a miss, constructs a value from args and
+	 *        shifts it into that leaf, splitting the leaf first if it is
+	 *        full.  key is only moved from when it is added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> findOrInsert(K& key, Args&&... args);
+
+public:
+	/**
+	 * \brief Removes the value associated with a given key.
+	 * \throws KeyError if the key is not present.
+	 */
+	void removeValue(K const& key);
+
+	/**
+	 * \brief Gets the value associated with a key.
+	 * \throws KeyError if the key is not present.
+	 */
+	V& getValue(K const& key) const;
+
+	/**
+	 * \brief Gets the value associated with the key equivalent to key,
+	 *        comparing the two directly rather than converting key to K.
+	 * \throws KeyError if the key is not present.
+	 */
+	template <typename Q, typename =
+		typename std::enable_if<IsOrderedLookup<K, Q>::value>::type>
+	V& getValue(Q const& key) const;
+
+	/**
+	 * \brief Gets the number of elements in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Determines whether or not a key equivalent to key is present,
+	 *        comparing the two directly rather than converting key to K.
+	 */
+	template <typename Q, typename =
+		typename std::enable_if<IsOrderedLookup<K, Q>::value>::type>
+	bool contains(Q const& key) const;
+
+	/**
+	 * \brief Gets the number of levels in the tree.
+	 */
+	std::size_t height() const;
+
+	/**
+	 * \brief Gets the first pair whose key is not less than key, or end().
+	 */
+	iterator lowerBound(K const& key);
+
+	/**
+	 * \brief Gets the first pair whose key is not less than key, or end().
+	 */
+	const_iterator lowerBound(K const& key) const;
+
+	/**
+	 * \brief Gets a view of every pair with lo <= key < hi, in key order.
+	 */
+	items_view range(K lo, K hi);
+
+	/**
+	 * \brief Gets a view of every pair with lo <= key < hi, in key order.
+	 */
+	const_items_view range(K lo, K hi) const;
+
+	/**
+	 * \brief Gets a view of every key, in key order.
+	 */
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every value, in key order.
+	 */
+	values_view values();
+
+	/**
+	 * \brief Gets a view of every value, in key order.
+	 */
+	const_values_view values() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair, in key order.
+	 */
+	items_view items();
+
+	/**
+	 * \brief Gets a view of every key-value pair, in key order.
+	 */
+	const_items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in key order.
+	 * \details fn must not add or remove pairs.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn);
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in key order.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+	/**
+	 * \brief Start of the map.
+	 */
+	iterator begin();
+
+	/**
+	 * \brief Termination of the map.
+	 */
+	iterator end();
+
+	/**
+	 * \brief Start of the map.
+	 */
+	const_iterator begin() const;
+
+	/**
+	 * \brief Termination of the map.
+	 */
+	const_iterator end() const;
+
+private:
+	/**
+	 * \brief Keys per node: about 256 bytes' worth, and at least eight.
+	 */
+	static const std::size_t Capacity =
+		256 / sizeof(K) < 8 ? 8 : (256 / sizeof(K)) & ~std::size_t(1);
+
+	/**
+	 * \brief Fewest keys a node other than the root may hold.
+	 */
+	static const std::size_t MinCount = Capacity / 2;
+
+	/**
+	 * \brief Deeper than any tree that fits in memory.
+	 */
+	static const std::size_t MaxHeight = 64;
+
+	/**
+	 * \brief insertBatch() inserts pair by pair rather than rebuilding when
+	 *        the map holds more than this many pairs per pair added.
+	 */
+	static const std::size_t SmallBatchRatio = 32;
+
+	struct Node
+	{
+		bool leaf_;
+		std::size_t count_;
+		K keys_[Capacity];
+	};
+
+	struct Inner : Node
+	{
+		Node* children_[Capacity + 1];
+	};
+
+	struct Leaf : Node
+	{
+		V values_[Capacity];
+		Leaf* next_;
+	};
+
+	template <typename ValueT>
+	struct SlotRef
+	{
+		K const& key_;
+		ValueT& value_;
+	};
+
+	template <typename ValueT>
+	class LeafCursor
+	{
+	public:
+		typedef typename std::conditional<std::is_const<ValueT>::value,
+			Leaf const, Leaf>::type LeafT;
+
+		/**
+		 * \brief Points at slot index of leaf, moving on to the next leaf
+		 *        if index is past its end.  A null leaf is the end.
+		 */
+		LeafCursor(LeafT* leaf, std::size_t index);
+
+		/**
+		 * \brief Moves to the next pair in key order.
+		 */
+		LeafCursor& operator++();
+
+		/**
+		 * \brief Gets the current pair.
+		 */
+		SlotRef<ValueT> operator*() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const LeafCursor& rhs) const;
+
+	private:
+		LeafT* leaf_;
+		std::size_t index_;
+	};
+
+	/**
+	 * \brief Number of keys in node less than key.
+	 */
+	template <typename Q>
+	static std::size_t lowerIndex(Node const* node, Q const& key);
+
+	/**
+	 * \brief Number of keys in node not greater than key, which is the
+	 *        child of an inner node to descend into.
+	 */
+	template <typename Q>
+	static std::size_t upperIndex(Node const* node, Q const& key);
+
+	/**
+	 * \brief Leaf that would hold key, recording the inner nodes and child
+	 *        slots on the way down if path is given.
+	 */
+	template <typename Q>
+	Leaf* descend(Q const& key, Inner** path, std::size_t* slots,
+		std::size_t& depth) const;
+
+	/**
+	 * \brief Moves the upper half of a full leaf into a new right sibling.
+	 */
+	Leaf* splitLeaf(Leaf* leaf);
+
+	/**
+	 * \brief Links right, whose keys start at separator, into the tree next
+	 *        to left, splitting ancestors as needed.
+	 */
+	void insertIntoParent(Inner** path, std::size_t* slots,
+		std::size_t depth, Node* left, K separator, Node* right);
+
+	/**
+	 * \brief Restores the minimum fill of a leaf after a removal.
+	 */
+	void fixLeaf(Inner** path, std::size_t* slots, std::size_t depth,
+		Leaf* leaf);
+
+	/**
+	 * \brief Restores the minimum fill of path[depth] after it lost a child.
+	 */
+	void fixInner(Inner** path, std::size_t* slots, std::size_t depth);
+
+	/**
+	 * \brief Removes keys_[index] and children_[index + 1] from an inner node.
+	 */
+	static void removeChild(Inner* node, std::size_t index);
+
+	/**
+	 * \brief Builds the tree from pairs in strictly increasing key order.
+	 */
+	void build(std::vector<std::pair<K, V>>& pairs);
+
+	/**
+	 * \brief Frees a subtree.
+	 */
+	static void destroy(Node* node);
+
+	Node* root_;
+	Leaf* first_;
+	std::size_t size_;
+};
+
+#include "_btreemap.hpp"
+
+#endif
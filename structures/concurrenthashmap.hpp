@@ -0,0 +1,205 @@
+/**
+ * \file concurrenthashmap.hpp
+ * \brief Hash map safe for concurrent lookups and updates.
+ */
+
+#ifndef CONCURRENT_HASH_MAP_HPP
+#define CONCURRENT_HASH_MAP_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "map.hpp"
+#include "hashmap.hpp"
+
+
+/**
+ * \brief A hash map split into independently locked shards.
+ * \details Each key belongs to exactly one shard, chosen from bits of its
+ *          hash that the shard's own HashMap does not use, and every shard
+ *          is guarded by its own reader/writer spin lock.  Lookups on
+ *          different shards never contend, and lookups on the same shard
+ *          only share a lock word.  The lock prefers writers so that a
+ *          read-heavy load cannot starve updates.
+ *
+ *          Operations on a single key are atomic.  size() and forEach() are
+ *          not a snapshot of the whole map when other threads are writing.
+ */
+template <typename K, typename V,
+	typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class ConcurrentHashMap : public Map<K, V>
+{
+private:
+	/**
+	 * \brief Reader/writer spin lock guarding one shard.
+	 */
+	class SharedSpinLock;
+
+	/**
+	 * \brief One lock and the pairs it guards.
+	 */
+	struct Shard;
+
+public:
+	/**
+	 * \brief Constructs a map with the given number of shards, rounded up to
+	 *        a power of two.
+	 */
+	explicit ConcurrentHashMap(std::size_t shardCount = 64);
+
+	/**
+	 * \brief Shards hold locks, so the map can be neither copied nor moved.
+	 */
+	ConcurrentHashMap(ConcurrentHashMap<K, V, Hash, Eq> const& orig) = delete;
+
+	/**
+	 * \brief Shards hold locks, so the map can be neither copied nor moved.
+	 */
+	ConcurrentHashMap<K, V, Hash, Eq>& operator=(
+		ConcurrentHashMap<K, V, Hash, Eq> const& rhs) = delete;
+
+	/**
+	 * \brief Frees every shard.  No other thread may be using the map.
+	 */
+	~ConcurrentHashMap();
+
+	/**
+	 * \brief Adds a key-value pair to the map.
+	 * \throws KeyError if the key is already present.
+	 */
+	void addValue(K key, V value);
+
+	/**
+	 * \brief Removes the value associated with a given key.
+	 * \throws KeyError if the key is not present.
+	 */
+	void removeValue(K const& key);
+
+	/**
+	 * \brief Gets the value associated with a key.
+	 * \details The reference is only safe to use while no other thread
+	 *          writes to the map; concurrent readers should use find().
+	 * \throws KeyError if the key is not present.
+	 */
+	V& getValue(K const& key) const;
+
+	/**
+	 * \brief Copies the value associated with key into value.
+	 * \return false, leaving value untouched, if the key is not present.
+	 */
+	bool find(K const& key, V& value) const;
+
+	/**
+	 * \brief Sets the value of key, adding the pair if it is not present.
+	 * \return true if the pair was added, false if it was overwritten.
+	 */
+	bool insertOrAssign(K key, V value);
+
+	/**
+	 * \brief Gets the value of key, first adding fn(key) if it is absent.
+	 * \details fn runs with no lock held, so it may use the map.  Threads
+	 *          that miss the same key at once may each call fn; the first
+	 *          value stored is kept and returned to all of them.
+	 */
+	template <typename Fn>
+	V computeIfAbsent(K key, Fn fn);
+
+	/**
+	 * \brief Gets the number of elements in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, one shard at a time.
+	 * \details Each shard is read-locked while it is visited, so fn must not
+	 *          touch the map.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+	/**
+	 * \brief Gets the number of shards.
+	 */
+	std::size_t shardCount() const;
+
+private:
+	class SharedSpinLock
+	{
+	public:
+		SharedSpinLock();
+
+		/**
+		 * \brief Takes the lock for reading.
+		 */
+		void lockShared();
+
+		/**
+		 * \brief Releases a read lock.
+		 */
+		void unlockShared();
+
+		/**
+		 * \brief Takes the lock for writing.
+		 */
+		void lock();
+
+		/**
+		 * \brief Releases the write lock.
+		 */
+		void unlock();
+
+	private:
+		/**
+		 * \brief Set while a writer holds the lock.
+		 */
+		static const std::uint32_t Writer = 1;
+
+		/**
+		 * \brief Set while a writer waits; keeps new readers out.
+		 */
+		static const std::uint32_t WriterWaiting = 2;
+
+		/**
+		 * \brief Added once per reader holding the lock.
+		 */
+		static const std::uint32_t Reader = 4;
+
+		std::atomic<std::uint32_t> state_;
+	};
+
+	struct Shard
+	{
+		mutable SharedSpinLock lock_;
+		HashMap<K, V, Hash, Eq> map_;
+		/**
+		 * \brief Keeps neighbouring shards' locks off this cache line.
+		 */
+		char padding_[64];
+	};
+
+	/**
+	 * \brief The shard that owns key.
+	 */
+	Shard& shardFor(K const& key) const;
+
+	Shard* shards_;
+	std::size_t shardMask_;
+	std::atomic<std::size_t> size_;
+	Hash hash_;
+};
+
+#include "_concurrenthashmap.hpp"
+
+#endif
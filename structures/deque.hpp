@@ -136,6 +136,11 @@ public:
 	 */
 	void remove(std::size_t n);
 
+	/**
+	 * \brief Removes the last item in the list.
+	 */
+	void removeTail();
+
 	/**
 	 * \brief Removes and returns a copy of the value of the first item 
 	 *        in the list.
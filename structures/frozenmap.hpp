@@ -0,0 +1,219 @@
+/**
+ * \file frozenmap.hpp
+ * \brief Immutable mapping type whose perfect hash is built at compile time.
+ */
+
+#ifndef FROZEN_MAP_HPP
+#define FROZEN_MAP_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+#include "mapviews.hpp"
+
+
+/**
+ * \brief Hash usable in constant expressions: integers and enums hash to
+ *        themselves, and FrozenMap mixes the bits.
+ */
+template <typename K>
+struct FrozenHash
+{
+	constexpr std::uint64_t operator()(K key) const
+	{
+		return static_cast<std::uint64_t>(key);
+	}
+};
+
+/**
+ * \brief Hashes the characters of a C string with 64 bit FNV-1a.
+ */
+template <>
+struct FrozenHash<char const*>
+{
+	constexpr std::uint64_t operator()(char const* key) const
+	{
+		std::uint64_t hash = 0xCBF29CE484222325ull;
+		for (; *key != '\0'; ++key)
+			hash = (hash ^ static_cast<unsigned char>(*key))
+				* 0x100000001B3ull;
+		return hash;
+	}
+};
+
+/**
+ * \brief Equality usable in constant expressions.
+ */
+template <typename K>
+struct FrozenEqual
+{
+	constexpr bool operator()(K const& lhs, K const& rhs) const
+	{
+		return lhs == rhs;
+	}
+};
+
+/**
+ * \brief Compares C strings by their characters.
+ */
+template <>
+struct FrozenEqual<char const*>
+{
+	constexpr bool operator()(char const* lhs, char const* rhs) const
+	{
+		for (; *lhs != '\0' && *lhs == *rhs; ++lhs, ++rhs)
+			;
+		return *lhs == *rhs;
+	}
+};
+
+/**
+ * \brief A map of exactly N pairs, fixed when it is constructed, that can
+ *        be built and looked up in constant expressions.
+ * \details Construction finds a minimal perfect hash for the keys with the
+ *          hash-and-displace method: the keys are grouped into N buckets
+ *          by their hash, and, largest bucket first, each bucket gets the
+ *          first seed that sends all of its keys to free slots.  A lookup
+ *          then costs one call to Hash, one read of the bucket's seed, and
+ *          one comparison against the only slot the key can be in.
+ *
+ *          Declared constexpr, the whole table is built by the compiler
+ *          and lives in read-only data: there is no startup cost and no
+ *          heap.  K and V must be literal types with default constructors,
+ *          and Hash and Eq must be usable in constant expressions;
+ *          FrozenHash and FrozenEqual cover integers, enums and C strings.
+ *          Being a literal type, FrozenMap does not derive from Map, whose
+ *          virtual destructor would rule that out.
+ */
+template <typename K, typename V, std::size_t N,
+	typename Hash = FrozenHash<K>, typename Eq = FrozenEqual<K>>
+class FrozenMap
+{
+private:
+	/**
+	 * \brief A key-value pair stored in the table.
+	 */
+	struct Slot;
+
+public:
+	static_assert(N > 0, "a FrozenMap needs at least one pair");
+
+	typedef MapView<Slot const*, KeyOf<K, V>> keys_view;
+	typedef MapView<Slot const*, ValueOf<K, V const>> values_view;
+	typedef MapView<Slot const*, ItemOf<K, V const>> items_view;
+
+	/**
+	 * \brief Builds the map from N pairs.
+	 * \throws KeyError if a key appears twice.  In a constant expression
+	 *         that is a compile error instead.
+	 */
+	constexpr FrozenMap(std::pair<K, V> const (&pairs)[N]);
+
+	/**
+	 * \brief Builds the map from a list of exactly N pairs.
+	 * \throws IndexOutOfBoundsException if the list does not hold N pairs.
+	 * \throws KeyError if a key appears twice.
+	 */
+	constexpr FrozenMap(std::initializer_list<std::pair<K, V>> pairs);
+
+	/**
+	 * \brief Gets a pointer to the value of key, or nullptr if it is absent.
+	 */
+	constexpr V const* find(K const& key) const;
+
+	/**
+	 * \brief Gets the value associated with a key.
+	 * \throws KeyError if the key is not present.
+	 */
+	constexpr V const& getValue(K const& key) const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	constexpr bool contains(K const& key) const;
+
+	/**
+	 * \brief Gets the number of pairs in the map, which is always N.
+	 */
+	constexpr std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty, which it never is.
+	 */
+	constexpr bool isEmpty() const;
+
+	/**
+	 * \brief Gets a view of every key, in table order.
+	 */
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every value, in table order.
+	 */
+	values_view values() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair, in table order.
+	 */
+	items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in table order.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+private:
+	struct Slot
+	{
+		K key_;
+		V value_;
+	};
+
+	/**
+	 * \brief Seeds tried for one bucket before giving up.
+	 */
+	static const std::uint64_t MaxAttempts = 1u << 20;
+
+	/**
+	 * \brief Spreads the bits of a hash; every bit of the input affects
+	 *        every bit of the output.
+	 */
+	static constexpr std::uint64_t mix(std::uint64_t hash);
+
+	/**
+	 * \brief Bucket of a mixed hash.
+	 */
+	static constexpr std::size_t bucketOf(std::uint64_t hash);
+
+	/**
+	 * \brief Slot of a mixed hash under a bucket's seed.
+	 */
+	static constexpr std::size_t slotOf(std::uint64_t hash,
+		std::uint64_t seed);
+
+	/**
+	 * \brief Finds the seeds and fills the slots from pairs[0, N).
+	 */
+	constexpr void build(std::pair<K, V> const* pairs);
+
+	Slot slots_[N];
+	std::uint64_t seeds_[N];
+	Hash hash_;
+	Eq equal_;
+};
+
+/**
+ * \brief Builds a FrozenMap, taking N from the number of pairs.
+ * \details constexpr auto map = makeFrozenMap<int, char const*>({
+ *              {1, "one"}, {2, "two"}});
+ */
+template <typename K, typename V, std::size_t N>
+constexpr FrozenMap<K, V, N> makeFrozenMap(
+	std::pair<K, V> const (&pairs)[N]);
+
+#include "_frozenmap.hpp"
+
+#endif
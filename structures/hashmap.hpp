@@ -0,0 +1,606 @@
+/**
+ * \file hashmap.hpp
+ * \brief Mapping type backed by a flat open-addressing hash table.
+ */
+
+#ifndef HASH_MAP_HPP
+#define HASH_MAP_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+
+
+/**
+ * \brief Transparent hash of strings: a std::string and a C string with the
+ *        same characters hash alike, so a HashMap<std::string, V,
+ *        StringHash, StringEqual> can be queried with a C string without
+ *        building a std::string.
+ */
+struct StringHash
+{
+	typedef void is_transparent;
+
+	std::size_t operator()(std::string const& key) const;
+
+	std::size_t operator()(char const* key) const;
+
+	/**
+	 * \brief Hashes size bytes eight at a time.
+	 */
+	static std::size_t hashBytes(char const* data, std::size_t size);
+};
+
+/**
+ * \brief Transparent equality of std::string and C strings.
+ */
+struct StringEqual
+{
+	typedef void is_transparent;
+
+	bool operator()(std::string const& lhs, std::string const& rhs) const;
+
+	bool operator()(std::string const& lhs, char const* rhs) const;
+
+	bool operator()(char const* lhs, std::string const& rhs) const;
+};
+
+/**
+ * \brief Whether a hash map of K can look up a Q as it is: Hash and Eq are
+ *        both transparent and accept a Q.
+ */
+template <typename K, typename Q, typename Hash, typename Eq,
+	typename = void>
+struct IsHashLookup : std::false_type
+{
+};
+
+template <typename K, typename Q, typename Hash, typename Eq>
+struct IsHashLookup<K, Q, Hash, Eq, typename VoidOf<
+	decltype(std::declval<Hash const&>()(std::declval<Q const&>())),
+	decltype(std::declval<Eq const&>()(
+		std::declval<K const&>(), std::declval<Q const&>()))>::type> :
+		std::integral_constant<bool,
+			IsTransparent<Hash>::value && IsTransparent<Eq>::value>
+{
+};
+
+
+/**
+ * \brief A hash map storing its pairs inline in one flat array.
+ * \details Every slot has a control byte holding either "empty" or seven
+ *          bits of the key's hash.  Lookups load the eight control bytes
+ *          starting at the key's home slot as a single word, match all of
+ *          them against the hash fragment at once, and only compare keys
+ *          whose fragment matches.  Collisions are resolved by linear
+ *          probing, and erasing shifts the following run back instead of
+ *          leaving tombstones, so a lookup can stop at the first empty slot.
+ */
+template <typename K, typename V,
+	typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class HashMap : public Map<K, V>
+{
+private:
+	/**
+	 * \brief SmallMap hashes its pairs before it moves them in with
+	 *        insertAbsent(), so a throwing Hash cannot strand them.
+	 */
+	template <typename, typename, std::size_t, typename, typename>
+	friend class SmallMap;
+
+	/**
+	 * \brief Forward iterator.
+	 */
+	class Iterator;
+
+	/**
+	 * \brief Constant forward iterator.
+	 */
+	class ConstIterator;
+
+	/**
+	 * \brief A key-value pair stored in the table.
+	 */
+	struct Slot;
+
+	/**
+	 * \brief Walks the full slots, yielding each as an S&.
+	 */
+	template <typename S>
+	class SlotCursor;
+
+public:
+	/**
+	 * \brief Default constructor.  Does not allocate.
+	 */
+	HashMap();
+
+	/**
+	 * \brief Constructs a map with room for count pairs.
+	 */
+	explicit HashMap(std::size_t count);
+
+	/**
+	 * \brief Constructs a map from the pairs in [first, last) with
+	 *        insertBatch(), so a later pair wins over an earlier one with
+	 *        the same key.
+	 */
+	template <typename InputIt>
+	HashMap(InputIt first, InputIt last);
+
+	/**
+	 * \brief Copy constructor.
+	 */
+	HashMap(HashMap<K, V, Hash, Eq> const& orig);
+
+	/**
+	 * \brief Move constructor.
+	 */
+	HashMap(HashMap<K, V, Hash, Eq>&& other);
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	HashMap<K, V, Hash, Eq>& operator=(HashMap<K, V, Hash, Eq> rhs);
+
+	/**
+	 * \brief Idiomatic swap function.
+	 */
+	template <typename KEY, typename VALUE, typename HASH, typename EQ>
+	friend void swap(HashMap<KEY, VALUE, HASH, EQ>& lhs,
+		HashMap<KEY, VALUE, HASH, EQ>& rhs);
+
+	/**
+	 * \brief Destroys every pair and frees the table.
+	 */
+	~HashMap();
+
+	/**
+	 * \brief Adds a key-value pair to the map.
+	 * \throws KeyError if the key is already present.
+	 */
+	void addValue(K key, V value);
+
+	/**
+	 * \brief Sets the value of key, adding the pair if it is not present.
+	 * \return true if the pair was added, false if it was overwritten.
+	 */
+	bool insertOrAssign(K key, V value);
+
+	/**
+	 * \brief Adds key with a value constructed from args if it is absent,
+	 *        and otherwise leaves the map, and args, untouched.
+	 * \return The value of key, and whether it was added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> tryEmplace(K key, Args&&... args);
+
+	/**
+	 * \brief Calls fn(value) on the value of key, first adding a value
+	 *        initialised V if the key is absent.
+	 * \return The value of key.
+	 */
+	template <typename Fn>
+	V& upsert(K key, Fn fn);
+
+private:
+	/**
+	 * \brief Probes once for key; a miss reports the first empty slot of
+	 *        its probe sequence, and a value constructed from args goes
+	 *        there unless the table has to grow first.  key is only moved
+	 *        from when it is added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> findOrInsert(K& key, Args&&... args);
+
+public:
+	/**
+	 * \brief Sets the value of every key in [first, last), adding the keys
+	 *        that are not present, reserving room for them first.
+	 * \details The range holds std::pair<K, V> (or anything with first and
+	 *          second members).  The result is that of insertOrAssign() on
+	 *          each pair in turn: a later pair wins over an earlier one with
+	 *          the same key and over the map.  When the range can be counted
+	 *          the table grows at most once.
+	 */
+	template <typename InputIt>
+	void insertBatch(InputIt first, InputIt last);
+
+	/**
+	 * \brief Removes the value associated with a given key.
+	 * \throws KeyError if the key is not present.
+	 */
+	void removeValue(K const& key);
+
+	/**
+	 * \brief Gets the value associated with a key.
+	 * \throws KeyError if the key is not present.
+	 */
+	V& getValue(K const& key) const;
+
+	/**
+	 * \brief Gets the value associated with the key equal to key, hashing
+	 *        and comparing key as it is rather than converting it to K.
+	 * \throws KeyError if the key is not present.
+	 */
+	template <typename Q, typename = typename std::enable_if<
+		IsHashLookup<K, Q, Hash, Eq>::value>::type>
+	V& getValue(Q const& key) const;
+
+	/**
+	 * \brief Gets the number of elements in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Determines whether or not a key equal to key is present,
+	 *        hashing and comparing key as it is.
+	 */
+	template <typename Q, typename = typename std::enable_if<
+		IsHashLookup<K, Q, Hash, Eq>::value>::type>
+	bool contains(Q const& key) const;
+
+	/**
+	 * \brief Gets a pointer to the value of key, or nullptr if it is absent.
+	 */
+	V* find(K const& key);
+
+	/**
+	 * \brief Gets a pointer to the value of key, or nullptr if it is absent.
+	 */
+	V const* find(K const& key) const;
+
+	/**
+	 * \brief Gets a pointer to the value of the key equal to key, or
+	 *        nullptr if it is absent, hashing and comparing key as it is.
+	 */
+	template <typename Q, typename = typename std::enable_if<
+		IsHashLookup<K, Q, Hash, Eq>::value>::type>
+	V* find(Q const& key);
+
+	/**
+	 * \brief Gets a pointer to the value of the key equal to key, or
+	 *        nullptr if it is absent, hashing and comparing key as it is.
+	 */
+	template <typename Q, typename = typename std::enable_if<
+		IsHashLookup<K, Q, Hash, Eq>::value>::type>
+	V const* find(Q const& key) const;
+
+	typedef MapView<SlotCursor<Slot const>, KeyOf<K, V>> keys_view;
+	typedef MapView<SlotCursor<Slot>, ValueOf<K, V>> values_view;
+	typedef MapView<SlotCursor<Slot const>, ValueOf<K, V const>>
+		const_values_view;
+	typedef MapView<SlotCursor<Slot>, ItemOf<K, V>> items_view;
+	typedef MapView<SlotCursor<Slot const>, ItemOf<K, V const>>
+		const_items_view;
+
+	/**
+	 * \brief Gets a view of every key, in table order.
+	 */
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every value, in table order.
+	 */
+	values_view values();
+
+	/**
+	 * \brief Gets a view of every value, in table order.
+	 */
+	const_values_view values() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair, in table order.
+	 */
+	items_view items();
+
+	/**
+	 * \brief Gets a view of every key-value pair, in table order.
+	 */
+	const_items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in table order.
+	 * \details Scans the control bytes directly, skipping the iterator
+	 *          machinery.  fn must not add or remove pairs.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn);
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in table order.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+	/**
+	 * \brief Grows the table so that count pairs fit without rehashing.
+	 */
+	void reserve(std::size_t count);
+
+	/**
+	 * \brief Gets the number of slots in the table.
+	 */
+	std::size_t capacity() const;
+
+	/**
+	 * \brief Gets the fraction of slots currently in use.
+	 */
+	float loadFactor() const;
+
+	/**
+	 * \brief Gets the load factor at which the table grows.
+	 */
+	float maxLoadFactor() const;
+
+	/**
+	 * \brief Sets the load factor at which the table grows.
+	 * \details Clamped to [0.25, 0.9375]; the table is grown immediately if
+	 *          it is already over the new limit.
+	 */
+	void maxLoadFactor(float loadFactor);
+
+	typedef Iterator iterator;
+	typedef ConstIterator const_iterator;
+
+	/**
+	 * \brief Start of the map.
+	 */
+	iterator begin();
+
+	/**
+	 * \brief Termination of the map.
+	 */
+	iterator end();
+
+	/**
+	 * \brief Start of the map.
+	 */
+	const_iterator begin() const;
+
+	/**
+	 * \brief Termination of the map.
+	 */
+	const_iterator end() const;
+
+private:
+	class Iterator : public std::iterator<std::forward_iterator_tag, K>
+	{
+	public:
+		/**
+		 * \brief Prefix increment operator overloading.
+		 */
+		Iterator& operator++();
+
+		/**
+		 * \brief Postfix increment operator overloading.
+		 */
+		Iterator operator++(int);
+
+		/**
+		 * \brief Dereferencing operator overloading.
+		 */
+		const K& operator*() const;
+
+		/**
+		 * \brief Member access operator overriding.
+		 */
+		const K* operator->() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const Iterator& rhs) const;
+
+		/**
+		 * \brief Inequality operator overriding.
+		 */
+		bool operator!=(const Iterator& rhs) const;
+
+	private:
+		friend class HashMap;
+		/**
+		 * \brief The default constructor.
+		 */
+		Iterator() = delete;
+		/**
+		 * \brief All iterators point at a full slot or at the end.
+		 */
+		Iterator(HashMap const* map, std::size_t index);
+
+		HashMap const* map_;
+		std::size_t index_;
+	};
+
+	class ConstIterator : public std::iterator<std::forward_iterator_tag, K>
+	{
+	public:
+		/**
+		 * \brief Prefix increment operator overloading.
+		 */
+		ConstIterator& operator++();
+
+		/**
+		 * \brief Postfix increment operator overloading.
+		 */
+		ConstIterator operator++(int);
+
+		/**
+		 * \brief Dereferencing operator overloading.
+		 */
+		const K& operator*() const;
+
+		/**
+		 * \brief Member access operator overriding.
+		 */
+		const K* operator->() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const ConstIterator& rhs) const;
+
+		/**
+		 * \brief Inequality operator overriding.
+		 */
+		bool operator!=(const ConstIterator& rhs) const;
+
+	private:
+		friend class HashMap;
+		/**
+		 * \brief The default constructor.
+		 */
+		ConstIterator() = delete;
+		/**
+		 * \brief All iterators point at a full slot or at the end.
+		 */
+		ConstIterator(HashMap const* map, std::size_t index);
+
+		HashMap const* map_;
+		std::size_t index_;
+	};
+
+	struct Slot
+	{
+		K key_;
+		V value_;
+	};
+
+	template <typename S>
+	class SlotCursor
+	{
+	public:
+		/**
+		 * \brief Cursors point at a full slot or at the end.
+		 */
+		SlotCursor(HashMap const* map, std::size_t index);
+
+		/**
+		 * \brief Moves to the next full slot.
+		 */
+		SlotCursor& operator++();
+
+		/**
+		 * \brief Gets the current slot.
+		 */
+		S& operator*() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const SlotCursor& rhs) const;
+
+	private:
+		HashMap const* map_;
+		std::size_t index_;
+	};
+
+	/**
+	 * \brief Number of control bytes matched at once.
+	 */
+	static const std::size_t GroupWidth = 8;
+
+	/**
+	 * \brief Control byte of a slot that holds nothing.
+	 */
+	static const unsigned char Empty = 0x80;
+
+	/**
+	 * \brief Sentinel index returned by lookups that miss.
+	 */
+	static const std::size_t NotFound = static_cast<std::size_t>(-1);
+
+	/**
+	 * \brief Mixes the user hash so that both the home slot (high bits) and
+	 *        the control fragment (low seven bits) are well distributed.
+	 */
+	template <typename Q>
+	std::size_t hashOf(Q const& key) const;
+
+	/**
+	 * \brief Loads the control bytes starting at index as one word.
+	 */
+	std::uint64_t loadGroup(std::size_t index) const;
+
+	/**
+	 * \brief Index of the slot holding key, or NotFound.
+	 */
+	template <typename Q>
+	std::size_t findIndex(Q const& key, std::size_t hash) const;
+
+	/**
+	 * \brief Index of the slot holding key, or NotFound, in which case
+	 *        empty is set to the slot findEmpty(hash) would return, or to
+	 *        NotFound if the map is empty.
+	 */
+	template <typename Q>
+	std::size_t findIndex(Q const& key, std::size_t hash,
+		std::size_t& empty) const;
+
+	/**
+	 * \brief Index of the first empty slot in the probe sequence of hash.
+	 */
+	std::size_t findEmpty(std::size_t hash) const;
+
+	/**
+	 * \brief Sets a control byte, keeping the mirrored tail in sync.
+	 */
+	void setControl(std::size_t index, unsigned char control);
+
+	/**
+	 * \brief Inserts a key known to be absent, growing first if needed.
+	 *        empty is the first empty slot of its probe sequence, or
+	 *        NotFound to have it looked up; it is ignored if the map grows.
+	 */
+	Slot& insertAbsent(K key, V value, std::size_t hash, std::size_t empty);
+
+	/**
+	 * \brief Erases a full slot and shifts its probe run back over it.
+	 */
+	void eraseIndex(std::size_t index);
+
+	/**
+	 * \brief Moves every pair into a fresh table of the given capacity.
+	 */
+	void rehash(std::size_t newCapacity);
+
+	/**
+	 * \brief Smallest power-of-two capacity that holds count pairs.
+	 */
+	std::size_t capacityFor(std::size_t count) const;
+
+	/**
+	 * \brief First full slot at or after index, or capacity_.
+	 */
+	std::size_t nextFull(std::size_t index) const;
+
+	unsigned char* control_;
+	Slot* slots_;
+	std::size_t capacity_;
+	std::size_t size_;
+	std::size_t growthLimit_;
+	float maxLoadFactor_;
+	Hash hash_;
+	Eq equal_;
+};
+
+#include "_hashmap.hpp"
+
+#endif
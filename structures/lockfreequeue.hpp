@@ -0,0 +1,142 @@
+/**
+ * \file lockfreequeue.hpp
+ * \brief An unbounded lock-free FIFO queue (Michael-Scott).
+ */
+
+#ifndef LOCK_FREE_QUEUE_HPP
+#define LOCK_FREE_QUEUE_HPP 1
+
+#include <atomic>
+#include <cstddef>
+
+
+/**
+ * \brief An unbounded FIFO queue safe for any number of producers and
+ *        consumers without locks.
+ * \details A singly linked list of nodes with a dummy head, as in the
+ *          Michael-Scott algorithm.  Dequeued nodes are protected by hazard
+ *          pointers: a node is only recycled once no thread has it marked,
+ *          and recycled nodes are kept on per-record free lists so steady
+ *          state traffic does not touch the allocator.  Each free list is
+ *          capped: a record that only pops never reuses its nodes, so past
+ *          the cap they go back to the heap for the producers to allocate.
+ */
+template <typename T>
+class LockFreeQueue
+{
+private:
+	/**
+	 * \brief Node of the queue.
+	 */
+	struct ListNode;
+
+	/**
+	 * \brief Per-thread hazard pointers plus private retired and free lists.
+	 */
+	struct HazardRecord;
+
+public:
+	/**
+	 * \brief Constructs an empty queue.
+	 */
+	LockFreeQueue();
+
+	/**
+	 * \brief The queue is shared between threads by reference only.
+	 */
+	LockFreeQueue(const LockFreeQueue<T>& orig) = delete;
+
+	/**
+	 * \brief The queue is shared between threads by reference only.
+	 */
+	LockFreeQueue<T>& operator=(const LockFreeQueue<T>& rhs) = delete;
+
+	/**
+	 * \brief Frees every node, including the recycled ones.
+	 * \pre No other thread is using the queue.
+	 */
+	~LockFreeQueue();
+
+	/**
+	 * \brief Adds a value to the back of the queue.
+	 */
+	void push(T value);
+
+	/**
+	 * \brief Removes the value at the front of the queue.
+	 * \return false if the queue was empty.
+	 */
+	bool tryPop(T& value);
+
+	/**
+	 * \brief Determines whether or not the queue is empty.
+	 */
+	bool isEmpty() const;
+
+private:
+	struct ListNode
+	{
+		T value_;
+		std::atomic<ListNode*> next_;
+		ListNode* link_;
+	};
+
+	struct HazardRecord
+	{
+		std::atomic<bool> active_;
+		std::atomic<ListNode*> hazards_[2];
+		ListNode* retired_;
+		std::size_t numRetired_;
+		ListNode* free_;
+		std::size_t numFree_;
+		HazardRecord* next_;
+	};
+
+	/**
+	 * \brief Claims a hazard record, allocating one if all are in use.
+	 */
+	HazardRecord* acquireRecord();
+
+	/**
+	 * \brief Hands a record back for other threads to claim.
+	 */
+	void releaseRecord(HazardRecord* record);
+
+	/**
+	 * \brief Publishes a hazard pointer and re-reads the source until the
+	 *        two agree.
+	 */
+	ListNode* protect(HazardRecord* record, std::size_t index,
+		const std::atomic<ListNode*>& source);
+
+	/**
+	 * \brief Takes a node from the record's free list or the heap.
+	 */
+	ListNode* allocateNode(HazardRecord* record, T& value);
+
+	/**
+	 * \brief Queues a node for recycling once no thread can see it.
+	 */
+	void retireNode(HazardRecord* record, ListNode* node);
+
+	/**
+	 * \brief Most nodes a record keeps on its free list.
+	 */
+	static const std::size_t MaxFree = 256;
+
+	/**
+	 * \brief Moves every retired node that no hazard pointer covers onto the
+	 *        record's free list, freeing those that do not fit under
+	 *        MaxFree.
+	 */
+	void scan(HazardRecord* record);
+
+	alignas(64) std::atomic<ListNode*> head_;
+	alignas(64) std::atomic<ListNode*> tail_;
+	alignas(64) std::atomic<HazardRecord*> records_;
+	std::atomic<std::size_t> numRecords_;
+};
+
+#include "_lockfreequeue.hpp"
+
+#endif
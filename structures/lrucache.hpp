@@ -0,0 +1,296 @@
+/**
+ * \file lrucache.hpp
+ * \brief Bounded cache that evicts the least recently used pair.
+ */
+
+#ifndef LRU_CACHE_HPP
+#define LRU_CACHE_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "hashmap.hpp"
+#include "mapviews.hpp"
+
+
+/**
+ * \brief A cache holding at most a fixed count, or a fixed total weight, of
+ *        key-value pairs, evicting the least recently used pair when full.
+ * \details Pairs live in one dense array and are threaded, most recent
+ *          first, onto a doubly linked recency list of 32 bit indices.  A
+ *          HashMap from key to index finds a pair, so get(), put() and
+ *          eviction are all O(1): a hit only relinks its entry at the head
+ *          of the list.  Removing a pair moves the last entry of the array
+ *          into its place.
+ *
+ *          By default every pair weighs 1 and the capacity is a count.
+ *          Given a weigher, each pair weighs whatever the weigher returns
+ *          for it when it is put, and the capacity bounds the total.
+ */
+template <typename K, typename V,
+	typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class LruCache
+{
+private:
+	/**
+	 * \brief A pair, its weight and its recency links.
+	 */
+	struct Entry;
+
+	/**
+	 * \brief Walks the entries from most to least recently used.
+	 */
+	class EntryCursor;
+
+public:
+	typedef std::function<std::size_t(K const&, V const&)> weigher_type;
+	typedef std::function<void(K const&, V&)> listener_type;
+
+	typedef MapView<EntryCursor, KeyOf<K, V>> keys_view;
+	typedef MapView<EntryCursor, ItemOf<K, V const>> items_view;
+
+	/**
+	 * \brief Constructs a cache holding at most capacity pairs.  Does not
+	 *        allocate.
+	 */
+	explicit LruCache(std::size_t capacity);
+
+	/**
+	 * \brief Constructs a cache whose pairs may weigh at most capacity in
+	 *        total, each pair weighing weigher(key, value).
+	 */
+	LruCache(std::size_t capacity, weigher_type weigher);
+
+	/**
+	 * \brief Copy constructor.  The copy keeps the recency order, the
+	 *        weigher, the listener and the counters.
+	 */
+	LruCache(LruCache<K, V, Hash, Eq> const& orig);
+
+	/**
+	 * \brief Move constructor.
+	 */
+	LruCache(LruCache<K, V, Hash, Eq>&& other);
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	LruCache<K, V, Hash, Eq>& operator=(LruCache<K, V, Hash, Eq> rhs);
+
+	/**
+	 * \brief Idiomatic swap function.
+	 */
+	template <typename KEY, typename VALUE, typename HASH, typename EQ>
+	friend void swap(LruCache<KEY, VALUE, HASH, EQ>& lhs,
+		LruCache<KEY, VALUE, HASH, EQ>& rhs);
+
+	/**
+	 * \brief We can use a default destructor because std::vector and
+	 *        HashMap have their own destructors.
+	 */
+	~LruCache() = default;
+
+	/**
+	 * \brief Gets a pointer to the value of key, or nullptr if it is absent,
+	 *        marking the pair most recently used.
+	 * \details Counts a hit or a miss.  The pointer is valid until the next
+	 *          put() or remove().  A value changed through it is not
+	 *          weighed again.
+	 */
+	V* get(K const& key);
+
+	/**
+	 * \brief Gets a pointer to the value of key, or nullptr if it is absent,
+	 *        without touching the recency order or the counters.
+	 */
+	V const* peek(K const& key) const;
+
+	/**
+	 * \brief Determines whether or not the key is present, without touching
+	 *        the recency order or the counters.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Associates value with key, replacing any value it had, and
+	 *        marks the pair most recently used.  Then evicts least recently
+	 *        used pairs until the cache is within its capacity.
+	 * \details A pair that on its own weighs more than the capacity is
+	 *          evicted straight away, after any old value of its key, and
+	 *          the other pairs are left alone.  Both count as evictions.
+	 */
+	void put(K key, V value);
+
+	/**
+	 * \brief Removes the pair holding key.  The eviction listener is not
+	 *        called.
+	 * \return Whether the key was present.
+	 */
+	bool remove(K const& key);
+
+	/**
+	 * \brief Removes every pair without calling the eviction listener.
+	 */
+	void clear();
+
+	/**
+	 * \brief Calls listener(key, value) for every evicted pair, just before
+	 *        it is destroyed.  The listener must not use the cache.
+	 */
+	void setEvictionListener(listener_type listener);
+
+	/**
+	 * \brief Gets the number of pairs in the cache.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the cache is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Gets the total weight of the pairs; the same as size() unless
+	 *        the cache has a weigher.
+	 */
+	std::size_t weight() const;
+
+	/**
+	 * \brief Gets the largest total weight the cache holds.
+	 */
+	std::size_t capacity() const;
+
+	/**
+	 * \brief Changes the capacity, evicting pairs if the cache no longer
+	 *        fits.
+	 */
+	void setCapacity(std::size_t capacity);
+
+	/**
+	 * \brief Gets the number of calls to get() that found their key.
+	 */
+	std::size_t hits() const;
+
+	/**
+	 * \brief Gets the number of calls to get() that did not.
+	 */
+	std::size_t misses() const;
+
+	/**
+	 * \brief Gets the number of pairs evicted to stay within the capacity.
+	 */
+	std::size_t evictions() const;
+
+	/**
+	 * \brief Resets the hit, miss and eviction counters to zero.
+	 */
+	void resetCounters();
+
+	/**
+	 * \brief Gets a view of every key, from most to least recently used.
+	 */
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair, from most to least
+	 *        recently used.
+	 */
+	items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, from most to least
+	 *        recently used.
+	 * \details fn must not use the cache.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+private:
+	struct Entry
+	{
+		K key_;
+		V value_;
+		std::size_t weight_;
+		std::uint32_t prev_;
+		std::uint32_t next_;
+	};
+
+	class EntryCursor
+	{
+	public:
+		/**
+		 * \brief Points at entries[index]; None is the end.
+		 */
+		EntryCursor(Entry const* entries, std::uint32_t index) :
+			entries_{entries}, index_{index}
+		{
+		}
+
+		/**
+		 * \brief Moves to the next less recently used entry.
+		 */
+		EntryCursor& operator++();
+
+		/**
+		 * \brief Gets the current entry.
+		 */
+		Entry const& operator*() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const EntryCursor& rhs) const;
+
+	private:
+		Entry const* entries_;
+		std::uint32_t index_;
+	};
+
+	/**
+	 * \brief Link that points at no entry.
+	 */
+	static const std::uint32_t None = 0xFFFFFFFFu;
+
+	/**
+	 * \brief Weight of a pair.
+	 */
+	std::size_t weigh(K const& key, V const& value) const;
+
+	/**
+	 * \brief Takes an entry out of the recency list.
+	 */
+	void unlink(std::uint32_t index);
+
+	/**
+	 * \brief Puts an entry at the head of the recency list.
+	 */
+	void linkFront(std::uint32_t index);
+
+	/**
+	 * \brief Removes an entry, moving the last entry into its place.
+	 */
+	void erase(std::uint32_t index);
+
+	/**
+	 * \brief Evicts from the tail until the weight is within the capacity.
+	 */
+	void evict();
+
+	std::vector<Entry> entries_;
+	HashMap<K, std::uint32_t, Hash, Eq> index_;
+	std::uint32_t head_;
+	std::uint32_t tail_;
+	std::size_t weight_;
+	std::size_t capacity_;
+	weigher_type weigher_;
+	listener_type listener_;
+	std::size_t hits_;
+	std::size_t misses_;
+	std::size_t evictions_;
+};
+
+#include "_lrucache.hpp"
+
+#endif
@@ -8,12 +8,91 @@
 
 #include <iterator>
 #include <cstddef>
+#include <type_traits>
+#include <utility>
 
-#include "deque.hpp"
+#include "mapviews.hpp"
+
+
+/**
+ * \brief Maps any list of types to void, for detecting members in partial
+ *        specialisations.
+ */
+template <typename...>
+struct VoidOf
+{
+	typedef void type;
+};
+
+/**
+ * \brief Whether an ordered map of K can look up a Q as it is: both
+ *        Q < K and K < Q compile without converting the Q to a K first.
+ * \details Numbers are left out and convert to K as any other argument
+ *          would, so that, say, an unsigned map looked up by an int literal
+ *          neither compares signed with unsigned nor takes 3.5 as a key
+ *          of its own rather than 3.
+ */
+template <typename K, typename Q, typename = void>
+struct IsOrderedLookup : std::false_type
+{
+};
+
+template <typename K, typename Q>
+struct IsOrderedLookup<K, Q, typename VoidOf<
+	typename std::enable_if<!std::is_arithmetic<Q>::value>::type,
+	decltype(std::declval<K const&>() < std::declval<Q const&>()),
+	decltype(std::declval<Q const&>() < std::declval<K const&>())>::type> :
+		std::true_type
+{
+};
+
+/**
+ * \brief Whether a function object accepts keys of any type, marked, as in
+ *        the standard library, by an is_transparent member type.
+ */
+template <typename Fn, typename = void>
+struct IsTransparent : std::false_type
+{
+};
+
+template <typename Fn>
+struct IsTransparent<Fn, typename VoidOf<typename Fn::is_transparent>::type> :
+	std::true_type
+{
+};
+
+/**
+ * \brief Number of elements in [first, last) if it can be counted without
+ *        consuming the range, otherwise 0; used to size storage up front.
+ */
+template <typename InputIt>
+std::size_t batchSize(InputIt first, InputIt last)
+{
+	typedef typename std::iterator_traits<InputIt>::iterator_category
+		Category;
+	if (!std::is_base_of<std::forward_iterator_tag, Category>::value)
+		return 0;
+	return static_cast<std::size_t>(std::distance(first, last));
+}
 
 
 /**
  * \brief Abstract base mapping class
+ * \details Enumeration is not virtual: each implementation provides keys(),
+ *          values() and items() views over its own storage (see MapView)
+ *          and a forEach(fn) that calls fn(key, value) for every pair.
+ *
+ *          Lookups take the key by reference, and implementations add
+ *          template overloads of getValue() and contains() that look up
+ *          any type comparable with K (ordered maps, see IsOrderedLookup)
+ *          or accepted by transparent Hash and Eq (hash maps, see
+ *          IsTransparent), so that, say, a std::string map is queried
+ *          with a C string without building a std::string.
+ *
+ *          Alongside addValue(), which throws on a duplicate key,
+ *          implementations offer insertOrAssign(), tryEmplace() and
+ *          upsert(), which find or add the key with a single search and
+ *          never throw for a key that is already present.
  */
 template <typename K, typename V>
 class Map
@@ -26,18 +105,20 @@ public:
 
 	/**
 	 * \brief Purely virtual function to add a value.
+	 * \details The pair is taken by value and moved into place, so
+	 *          callers passing rvalues never copy the key or the value.
 	 */
 	virtual void addValue(K key, V value) = 0;
 
 	/**
 	 * \brief Purely virtual function to remove a value.
 	 */
-	virtual void removeValue(K key) = 0;
+	virtual void removeValue(K const& key) = 0;
 
 	/**
 	 * \brief Purely virtual function to get a value.
 	 */
-	virtual V& getValue(K key) const = 0;
+	virtual V& getValue(K const& key) const = 0;
 
 	/**
 	 * \brief Purely virtual function to get the number of pairs in the map.
@@ -48,17 +129,6 @@ public:
 	 * \brief Purely virtual function to determine if the map is empty.
 	 */
 	virtual bool isEmpty() const = 0;
-
-	/**
-	 * \brief Purely virtual function to retrieve a list of all keys in the map.
-	 */
-	virtual Deque<K>* getKeys() const = 0;
-
-	/**
-	 * \brief Purely virtual function to retrieve a list of all of the values in
-	 *        the map.
-	 */
-	virtual Deque<V>* getValues() const = 0;
 };
 
 #endif
@@ -0,0 +1,208 @@
+/**
+ * \file mapviews.hpp
+ * \brief Lazy key, value and item views shared by the mapping types.
+ */
+
+#ifndef MAP_VIEWS_HPP
+#define MAP_VIEWS_HPP 1
+
+#include <cstddef>
+#include <iterator>
+
+
+/**
+ * \brief A key and its value, as yielded by a map's items() view.
+ */
+template <typename K, typename V>
+struct MapItem
+{
+	K const& key;
+	V& value;
+};
+
+/**
+ * \brief Projects a stored entry onto its key.
+ */
+template <typename K, typename V>
+struct KeyOf
+{
+	typedef K value_type;
+	typedef K const& reference;
+
+	template <typename Entry>
+	static reference get(Entry&& entry) { return entry.key_; }
+};
+
+/**
+ * \brief Projects a stored entry onto its value.
+ */
+template <typename K, typename V>
+struct ValueOf
+{
+	typedef V value_type;
+	typedef V& reference;
+
+	template <typename Entry>
+	static reference get(Entry&& entry) { return entry.value_; }
+};
+
+/**
+ * \brief Projects a stored entry onto a key-value item.
+ */
+template <typename K, typename V>
+struct ItemOf
+{
+	typedef MapItem<K, V> value_type;
+	typedef MapItem<K, V> reference;
+
+	template <typename Entry>
+	static reference get(Entry&& entry)
+	{
+		return MapItem<K, V>{entry.key_, entry.value_};
+	}
+};
+
+/**
+ * \brief A read-through view over a map's storage.
+ * \details Walks the map's own entries in place, so creating and iterating
+ *          a view never allocates.  EntryIt is the map's internal iterator
+ *          over entries with key_ and value_ members (dereferencing it may
+ *          also yield a proxy holding references); Projection picks what
+ *          each step yields.  A view is invalidated by any mutation of the
+ *          map, exactly like the map's iterators.
+ */
+template <typename EntryIt, typename Projection>
+class MapView
+{
+private:
+	/**
+	 * \brief Forward iterator over the view.
+	 */
+	class Iterator;
+
+public:
+	typedef Iterator iterator;
+	typedef Iterator const_iterator;
+
+	/**
+	 * \brief Constructs a view over [first, last), which holds size entries.
+	 */
+	MapView(EntryIt first, EntryIt last, std::size_t size);
+
+	/**
+	 * \brief Start of the view.
+	 */
+	iterator begin() const;
+
+	/**
+	 * \brief Termination of the view.
+	 */
+	iterator end() const;
+
+	/**
+	 * \brief Gets the number of entries in the view.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the view is empty.
+	 */
+	bool isEmpty() const;
+
+private:
+	class Iterator : public std::iterator<std::forward_iterator_tag,
+		typename Projection::value_type>
+	{
+	public:
+		/**
+		 * \brief Prefix increment operator overloading.
+		 */
+		Iterator& operator++() { ++current_; return *this; }
+
+		/**
+		 * \brief Postfix increment operator overloading.
+		 */
+		Iterator operator++(int)
+		{
+			Iterator old{*this};
+			++current_;
+			return old;
+		}
+
+		/**
+		 * \brief Dereferencing operator overloading.
+		 */
+		typename Projection::reference operator*() const
+		{
+			return Projection::get(*current_);
+		}
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const Iterator& rhs) const
+		{
+			return current_ == rhs.current_;
+		}
+
+		/**
+		 * \brief Inequality operator overriding.
+		 */
+		bool operator!=(const Iterator& rhs) const
+		{
+			return !(*this == rhs);
+		}
+
+	private:
+		friend class MapView;
+		/**
+		 * \brief The default constructor.
+		 */
+		Iterator() = delete;
+		/**
+		 * \brief All iterators wrap an entry iterator.
+		 */
+		explicit Iterator(EntryIt current) : current_(current) {}
+
+		EntryIt current_;
+	};
+
+	EntryIt first_;
+	EntryIt last_;
+	std::size_t size_;
+};
+
+template <typename EntryIt, typename Projection> inline
+MapView<EntryIt, Projection>::MapView(
+	EntryIt first, EntryIt last, std::size_t size) :
+		first_(first), last_(last), size_{size}
+{
+}
+
+template <typename EntryIt, typename Projection> inline
+typename MapView<EntryIt, Projection>::iterator
+MapView<EntryIt, Projection>::begin() const
+{
+	return Iterator{first_};
+}
+
+template <typename EntryIt, typename Projection> inline
+typename MapView<EntryIt, Projection>::iterator
+MapView<EntryIt, Projection>::end() const
+{
+	return Iterator{last_};
+}
+
+template <typename EntryIt, typename Projection> inline
+std::size_t MapView<EntryIt, Projection>::size() const
+{
+	return size_;
+}
+
+template <typename EntryIt, typename Projection> inline
+bool MapView<EntryIt, Projection>::isEmpty() const
+{
+	return size_ == 0;
+}
+
+#endif
@@ -6,10 +6,30 @@
 #ifndef NONHASH_MAP_HPP
 #define NONHASH_MAP_HPP 1
 
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bloomfilter.hpp"
 #include "map.hpp"
-#include "deque.hpp"
+#include "mapviews.hpp"
 
 
+/**
+ * \brief A map for keys that are ordered but not hashable.
+ * \details Pairs live in one contiguous array sorted by key, so lookups are
+ *          a branchless binary search.  In read-optimised mode the keys are
+ *          additionally kept in Eytzinger (breadth-first) order, which makes
+ *          the first levels of every search share the same few cache lines;
+ *          that layout is rebuilt on every mutation, so it suits maps that
+ *          are built once (ideally with insert()) and then only read.
+ *
+ *          An optional Bloom filter in front of the search answers most
+ *          lookups of absent keys without touching the pairs.
+ */
 template <typename K, typename V>
 class NonHashMap : public Map<K, V> {
 private:
@@ -38,12 +58,26 @@ private:
 	 */
 	struct Key;
 
+	/**
+	 * \brief Hashes keys for the Bloom filter with the function chosen by
+	 *        enableBloomFilter().
+	 */
+	struct FilterHash;
+
 public:
 	/**
 	 * \brief Default constructor.
 	 */
 	NonHashMap();
 
+	/**
+	 * \brief Constructs a map from the pairs in [first, last) with
+	 *        insertBatch(), so a later pair wins over an earlier one with
+	 *        the same key.
+	 */
+	template <typename InputIt>
+	NonHashMap(InputIt first, InputIt last);
+
 	/**
 	 * \brief Copy constructor.
 	 */
@@ -66,25 +100,93 @@ public:
 	friend void swap(NonHashMap<KEY, VALUE>& lhs, NonHashMap<KEY, VALUE>& rhs);
 
 	/**
-	 * \brief We can use a default destructor because Deque has its own
+	 * \brief We can use a default destructor because std::vector has its own
 	 *        destructor.
 	 */
 	~NonHashMap() = default;
 
 	/**
 	 * \brief Adds a key-value pair to the map.
+	 * \throws KeyError if the key is already present.
 	 */
 	void addValue(K key, V value);
 
+	/**
+	 * \brief Sets the value of key, adding the pair if it is not present.
+	 * \return true if the pair was added, false if it was overwritten.
+	 */
+	bool insertOrAssign(K key, V value);
+
+	/**
+	 * \brief Adds key with a value constructed from args if it is absent,
+	 *        and otherwise leaves the map, and args, untouched.
+	 * \return The value of key, and whether it was added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> tryEmplace(K key, Args&&... args);
+
+	/**
+	 * \brief Calls fn(value) on the value of key, first adding a value
+	 *        initialised V if the key is absent.
+	 * \return The value of key.
+	 */
+	template <typename Fn>
+	V& upsert(K key, Fn fn);
+
+private:
+	/**
+	 * \brief Binary-searches the sorted pairs once and returns the value
+	 *        found; on a miss, inserts a value constructed from args at the
+	 *        position the search stopped at, then relays the search layout
+	 *        and adds key to the filter.  key is only moved from when it is
+	 *        added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> findOrInsert(K& key, Args&&... args);
+
+public:
+	/**
+	 * \brief Adds every pair in [first, last) with a single sort and merge.
+	 * \details The range holds std::pair<K, V> (or anything with first and
+	 *          second members).  Nothing is added if any key is already
+	 *          present or appears twice in the range.
+	 * \throws KeyError on the first duplicate key.
+	 */
+	template <typename InputIt>
+	void insert(InputIt first, InputIt last);
+
+	/**
+	 * \brief Sets the value of every key in [first, last), adding the keys
+	 *        that are not present, with a single sort and merge.
+	 * \details The range holds std::pair<K, V> (or anything with first and
+	 *          second members).  The result is that of insertOrAssign() on
+	 *          each pair in turn: a later pair wins over an earlier one with
+	 *          the same key and over the map.  Costs O(m log m + n) for m
+	 *          pairs into a map of n, against O(m n) for m calls.
+	 */
+	template <typename InputIt>
+	void insertBatch(InputIt first, InputIt last);
+
 	/**
 	 * \brief Removes the value associated with a given key
+	 * \throws KeyError if the key is not present.
 	 */
-	void removeValue(K key);
+	void removeValue(K const& key);
 
 	/**
 	 * \brief Gets the value associated with a key.
+	 * \throws KeyError if the key is not present.
 	 */
-	V& getValue(K key) const;
+	V& getValue(K const& key) const;
+
+	/**
+	 * \brief Gets the value associated with the key equivalent to key,
+	 *        comparing the two directly rather than converting key to K.
+	 * \throws KeyError if the key is not present.
+	 */
+	template <typename Q, typename =
+		typename std::enable_if<IsOrderedLookup<K, Q>::value>::type>
+	V& getValue(Q const& key) const;
 
 	/**
 	 * \brief Gets the number of elements in the map.
@@ -99,17 +201,94 @@ public:
 	/**
 	 * \brief Determines whether or not the key is present.
 	 */
-	bool contains(K key) const;
+	bool contains(K const& key) const;
 
 	/**
-	 * \brief Gets a list of all keys in the map.
+	 * \brief Determines whether or not a key equivalent to key is present,
+	 *        comparing the two directly rather than converting key to K.
 	 */
-	Deque<K>* getKeys() const;
+	template <typename Q, typename =
+		typename std::enable_if<IsOrderedLookup<K, Q>::value>::type>
+	bool contains(Q const& key) const;
+
+	typedef MapView<Key const*, KeyOf<K, V>> keys_view;
+	typedef MapView<Key*, ValueOf<K, V>> values_view;
+	typedef MapView<Key const*, ValueOf<K, V const>> const_values_view;
+	typedef MapView<Key*, ItemOf<K, V>> items_view;
+	typedef MapView<Key const*, ItemOf<K, V const>> const_items_view;
 
 	/**
-	 * \brief Gets a list of all values in the map.
+	 * \brief Gets a view of every key, in key order.
 	 */
-	Deque<V>* getValues() const;
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every value, in key order.
+	 */
+	values_view values();
+
+	/**
+	 * \brief Gets a view of every value, in key order.
+	 */
+	const_values_view values() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair, in key order.
+	 */
+	items_view items();
+
+	/**
+	 * \brief Gets a view of every key-value pair, in key order.
+	 */
+	const_items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in key order.
+	 * \details fn must not add or remove pairs.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn);
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in key order.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+	/**
+	 * \brief Switches the Eytzinger search layout on or off.
+	 */
+	void setReadOptimised(bool readOptimised);
+
+	/**
+	 * \brief Determines whether or not the Eytzinger layout is in use.
+	 */
+	bool isReadOptimised() const;
+
+	/**
+	 * \brief Puts a Bloom filter with the given false positive rate in front
+	 *        of contains(), getValue() and removeValue(), so that most
+	 *        lookups of absent keys skip the search.
+	 * \details Only the filter hashes keys, with a default constructed Hash,
+	 *          so keys need not be hashable unless this is called.  The
+	 *          filter is sized for twice the pairs and rebuilt at twice the
+	 *          pairs whenever it fills up; removed keys linger in it, only
+	 *          costing false positives, until then.  addValue() needs the
+	 *          insertion point anyway, so it still searches.
+	 */
+	template <typename Hash = std::hash<K>>
+	void enableBloomFilter(double falsePositiveRate =
+		BloomFilter<K, FilterHash>::DefaultFalsePositiveRate);
+
+	/**
+	 * \brief Drops the Bloom filter, if there is one.
+	 */
+	void disableBloomFilter();
+
+	/**
+	 * \brief Determines whether or not a Bloom filter is in use.
+	 */
+	bool hasBloomFilter() const;
 
 	typedef Iterator iterator;
   	typedef ConstIterator const_iterator;
@@ -168,7 +347,7 @@ private:
 			/**
 			 * \brief Postfix increment operator overloading.
 			 */
-			Iterator operator++(int) const;
+			Iterator operator++(int);
 
 			/**
 			 * \brief Dereferencing operator overloading.
@@ -199,11 +378,11 @@ private:
 		    /**
 		     * \brief All iterators should have a current node.
 		     */
-		    Iterator(Key* key) : current_{key}
+		    Iterator(Key const* key) : current_{key}
 		    {
 		    }
 			
-			Key* current_;
+			Key const* current_;
 	};
 
 	class ConstIterator : public std::iterator<std::forward_iterator_tag, K>
@@ -217,7 +396,7 @@ private:
 			/**
 			 * \brief Postfix increment operator overloading.
 			 */
-			ConstIterator operator++(int) const;
+			ConstIterator operator++(int);
 
 			/**
 			 * \brief Dereferencing operator overloading.
@@ -248,11 +427,11 @@ private:
 		    /**
 		     * \brief All iterators should have a current node.
 		     */
-		    ConstIterator(Key* key) : current_{key}
+		    ConstIterator(Key const* key) : current_{key}
 		    {
 		    }
 			
-			Key* current_;
+			Key const* current_;
 	};
 
 	class ReverseIterator : public std::iterator<std::forward_iterator_tag, K>
@@ -266,7 +445,7 @@ private:
 			/**
 			 * \brief Postfix increment operator overloading.
 			 */
-			ReverseIterator operator++(int) const;
+			ReverseIterator operator++(int);
 
 			/**
 			 * \brief Dereferencing operator overloading.
@@ -297,11 +476,11 @@ private:
 		    /**
 		     * \brief All iterators should have a current node.
 		     */
-		    ReverseIterator(Key* key) : current_{key}
+		    ReverseIterator(Key const* key) : current_{key}
 		    {
 		    }
 			
-			Key* current_;
+			Key const* current_;
 	};
 
 	class ConstReverseIterator : 
@@ -316,7 +495,7 @@ private:
 		/**
 		 * \brief Postfix increment operator overloading.
 		 */
-		ConstReverseIterator operator++(int) const;
+		ConstReverseIterator operator++(int);
 
 		/**
 		 * \brief Dereferencing operator overloading.
@@ -347,11 +526,11 @@ private:
 	    /**
 	     * \brief All iterators should have a current node.
 	     */
-	    ConstReverseIterator(Key* key) : current_{key}
+	    ConstReverseIterator(Key const* key) : current_{key}
 	    {
 	    }
 		
-		Key* current_;
+		Key const* current_;
 	};
 
 	struct Key
@@ -361,7 +540,80 @@ private:
 		bool operator==(Key const& k) const;
 	};
 
-	Deque<Key> keys_;
+	struct FilterHash
+	{
+		std::size_t operator()(K const& key) const
+		{
+			return hash_(key);
+		}
+
+		std::size_t (*hash_)(K const&);
+	};
+
+	/**
+	 * \brief Fewest keys a Bloom filter is sized for.
+	 */
+	static const std::size_t MinFilterCapacity = 64;
+
+	/**
+	 * \brief Hashes key with a default constructed Hash.
+	 */
+	template <typename Hash>
+	static std::size_t hashKey(K const& key);
+
+	/**
+	 * \brief Adds a new key to the Bloom filter, rebuilding it if full.
+	 */
+	void filterKey(K const& key);
+
+	/**
+	 * \brief Replaces the Bloom filter with one sized for twice the pairs,
+	 *        with the same rate and hash, holding every key.
+	 */
+	void rebuildFilter();
+
+	/**
+	 * \brief Whether the Bloom filter, if any, lets key through.
+	 */
+	bool mayContain(K const& key) const;
+
+	/**
+	 * \brief The Bloom filter only hashes K, so other types always pass.
+	 */
+	template <typename Q>
+	bool mayContain(Q const& key) const;
+
+	/**
+	 * \brief Index of the first pair whose key is not less than key.
+	 */
+	template <typename Q>
+	std::size_t lowerBound(Q const& key) const;
+
+	/**
+	 * \brief Index of the pair holding key, or size() if it is absent.
+	 */
+	template <typename Q>
+	std::size_t find(Q const& key) const;
+
+	/**
+	 * \brief Rebuilds the Eytzinger copy of the keys after a mutation.
+	 */
+	void rebuildLayout();
+
+	/**
+	 * \brief Fills the Eytzinger arrays from the sorted pairs, in order.
+	 */
+	std::size_t buildLayout(std::size_t sorted, std::size_t node);
+
+	std::vector<Key> keys_;
+	bool readOptimised_;
+
+	// Eytzinger layout, 1-indexed: the children of node k are 2k and 2k+1.
+	std::vector<K> layoutKeys_;
+	std::vector<std::size_t> layoutIndex_;
+
+	BloomFilter<K, FilterHash> filter_;
+	bool filtered_;
 };
 
 #include "_nonhashmap.hpp"
@@ -0,0 +1,403 @@
+/**
+ * \file orderedhashmap.hpp
+ * \brief Mapping type that remembers insertion order, backed by a dense
+ *        array of pairs and a compact hash index.
+ */
+
+#ifndef ORDERED_HASH_MAP_HPP
+#define ORDERED_HASH_MAP_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+#include "hashmap.hpp"
+
+
+/**
+ * \brief A hash map that iterates in insertion order.
+ * \details The pairs live in one dense array in the order they were added,
+ *          next to a parallel array of their hashes.  A separate index of
+ *          1, 2, 4 or 8 byte slots, the narrowest that can number every
+ *          pair, maps hashes to positions in that array by linear probing.
+ *          Removing a pair leaves a hole in the array, which iteration
+ *          skips; the holes are squeezed out when the array next fills up.
+ *          Assigning to a key that is present keeps its place.
+ */
+template <typename K, typename V,
+	typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class OrderedHashMap : public Map<K, V>
+{
+private:
+	/**
+	 * \brief A key-value pair stored in the array.
+	 */
+	struct Slot;
+
+	/**
+	 * \brief Walks the pairs in insertion order, yielding each as an S&.
+	 */
+	template <typename S>
+	class SlotCursor;
+
+public:
+	/**
+	 * \brief Default constructor.  Does not allocate.
+	 */
+	OrderedHashMap();
+
+	/**
+	 * \brief Constructs a map with room for count pairs.
+	 */
+	explicit OrderedHashMap(std::size_t count);
+
+	/**
+	 * \brief Constructs a map from the pairs in [first, last) with
+	 *        insertBatch(), so a later pair wins over an earlier one with
+	 *        the same key, and the key keeps the place of its first pair.
+	 */
+	template <typename InputIt>
+	OrderedHashMap(InputIt first, InputIt last);
+
+	/**
+	 * \brief Copy constructor.  The copy has no holes.
+	 */
+	OrderedHashMap(OrderedHashMap<K, V, Hash, Eq> const& orig);
+
+	/**
+	 * \brief Move constructor.
+	 */
+	OrderedHashMap(OrderedHashMap<K, V, Hash, Eq>&& other);
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	OrderedHashMap<K, V, Hash, Eq>& operator=(
+		OrderedHashMap<K, V, Hash, Eq> rhs);
+
+	/**
+	 * \brief Idiomatic swap function.
+	 */
+	template <typename KEY, typename VALUE, typename HASH, typename EQ>
+	friend void swap(OrderedHashMap<KEY, VALUE, HASH, EQ>& lhs,
+		OrderedHashMap<KEY, VALUE, HASH, EQ>& rhs);
+
+	/**
+	 * \brief Destroys every pair and frees the arrays.
+	 */
+	~OrderedHashMap();
+
+	/**
+	 * \brief Adds a key-value pair at the end of the map.
+	 * \throws KeyError if the key is already present.
+	 */
+	void addValue(K key, V value);
+
+	/**
+	 * \brief Sets the value of key, adding the pair at the end if it is not
+	 *        present.
+	 * \return true if the pair was added, false if it was overwritten.
+	 */
+	bool insertOrAssign(K key, V value);
+
+	/**
+	 * \brief Adds key with a value constructed from args at the end if it
+	 *        is absent, and otherwise leaves the map, and args, untouched.
+	 * \return The value of key, and whether it was added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> tryEmplace(K key, Args&&... args);
+
+	/**
+	 * \brief Calls fn(value) on the value of key, first adding a value
+	 *        initialised V at the end if the key is absent.
+	 * \return The value of key.
+	 */
+	template <typename Fn>
+	V& upsert(K key, Fn fn);
+
+	/**
+	 * \brief Sets the value of every key in [first, last), adding the keys
+	 *        that are not present, reserving room for them first.
+	 * \details The result is that of insertOrAssign() on each pair in turn.
+	 *          When the range can be counted the arrays grow at most once.
+	 */
+	template <typename InputIt>
+	void insertBatch(InputIt first, InputIt last);
+
+	/**
+	 * \brief Removes the value associated with a given key.  The order of
+	 *        the other pairs is unchanged.
+	 * \throws KeyError if the key is not present.
+	 */
+	void removeValue(K const& key);
+
+	/**
+	 * \brief Gets the value associated with a key.
+	 * \throws KeyError if the key is not present.
+	 */
+	V& getValue(K const& key) const;
+
+	/**
+	 * \brief Gets the value associated with the key equal to key, hashing
+	 *        and comparing key as it is rather than converting it to K.
+	 * \throws KeyError if the key is not present.
+	 */
+	template <typename Q, typename = typename std::enable_if<
+		IsHashLookup<K, Q, Hash, Eq>::value>::type>
+	V& getValue(Q const& key) const;
+
+	/**
+	 * \brief Gets the number of elements in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Determines whether or not a key equal to key is present,
+	 *        hashing and comparing key as it is.
+	 */
+	template <typename Q, typename = typename std::enable_if<
+		IsHashLookup<K, Q, Hash, Eq>::value>::type>
+	bool contains(Q const& key) const;
+
+	/**
+	 * \brief Gets a pointer to the value of key, or nullptr if it is absent.
+	 */
+	V* find(K const& key);
+
+	/**
+	 * \brief Gets a pointer to the value of key, or nullptr if it is absent.
+	 */
+	V const* find(K const& key) const;
+
+	/**
+	 * \brief Gets a pointer to the value of the key equal to key, or
+	 *        nullptr if it is absent, hashing and comparing key as it is.
+	 */
+	template <typename Q, typename = typename std::enable_if<
+		IsHashLookup<K, Q, Hash, Eq>::value>::type>
+	V* find(Q const& key);
+
+	/**
+	 * \brief Gets a pointer to the value of the key equal to key, or
+	 *        nullptr if it is absent, hashing and comparing key as it is.
+	 */
+	template <typename Q, typename = typename std::enable_if<
+		IsHashLookup<K, Q, Hash, Eq>::value>::type>
+	V const* find(Q const& key) const;
+
+	typedef MapView<SlotCursor<Slot const>, KeyOf<K, V>> keys_view;
+	typedef MapView<SlotCursor<Slot>, ValueOf<K, V>> values_view;
+	typedef MapView<SlotCursor<Slot const>, ValueOf<K, V const>>
+		const_values_view;
+	typedef MapView<SlotCursor<Slot>, ItemOf<K, V>> items_view;
+	typedef MapView<SlotCursor<Slot const>, ItemOf<K, V const>>
+		const_items_view;
+
+	/**
+	 * \brief Gets a view of every key, in insertion order.
+	 */
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every value, in insertion order.
+	 */
+	values_view values();
+
+	/**
+	 * \brief Gets a view of every value, in insertion order.
+	 */
+	const_values_view values() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair, in insertion order.
+	 */
+	items_view items();
+
+	/**
+	 * \brief Gets a view of every key-value pair, in insertion order.
+	 */
+	const_items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in insertion order.
+	 * \details Walks the array directly.  fn must not add or remove pairs.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn);
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in insertion order.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+	/**
+	 * \brief Grows the arrays so that count pairs fit without growing
+	 *        again.
+	 */
+	void reserve(std::size_t count);
+
+	/**
+	 * \brief Gets the number of pairs, holes included, that fit in the
+	 *        array before it is next grown or compacted.
+	 */
+	std::size_t capacity() const;
+
+private:
+	struct Slot
+	{
+		K key_;
+		V value_;
+	};
+
+	template <typename S>
+	class SlotCursor
+	{
+	public:
+		/**
+		 * \brief Cursors point at a pair or at the end.
+		 */
+		SlotCursor(OrderedHashMap const* map, std::size_t index);
+
+		/**
+		 * \brief Moves to the next pair.
+		 */
+		SlotCursor& operator++();
+
+		/**
+		 * \brief Gets the current pair.
+		 */
+		S& operator*() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const SlotCursor& rhs) const;
+
+	private:
+		OrderedHashMap const* map_;
+		std::size_t index_;
+	};
+
+	/**
+	 * \brief Sentinel position returned by lookups that miss.
+	 */
+	static const std::size_t NotFound = static_cast<std::size_t>(-1);
+
+	/**
+	 * \brief Hash recorded for a hole in the array.  hashOf() never
+	 *        returns it.
+	 */
+	static const std::size_t Removed = static_cast<std::size_t>(-1);
+
+	/**
+	 * \brief Smallest index, so the array starts with room for five pairs.
+	 */
+	static const std::size_t MinIndexSize = 8;
+
+	/**
+	 * \brief Mixes the user hash over every bit and clears the top one, so
+	 *        it cannot be Removed.
+	 */
+	template <typename Q>
+	std::size_t hashOf(Q const& key) const;
+
+	/**
+	 * \brief Position of the pair holding key in the array, or NotFound.
+	 */
+	template <typename Q>
+	std::size_t findIndex(Q const& key, std::size_t hash) const;
+
+	/**
+	 * \brief findIndex() on an index of T slots.
+	 */
+	template <typename T, typename Q>
+	std::size_t findIn(Q const& key, std::size_t hash) const;
+
+	/**
+	 * \brief Points an empty slot in the probe run of hash at position.
+	 */
+	void place(std::size_t hash, std::size_t position);
+
+	/**
+	 * \brief place() on an index of T slots.
+	 */
+	template <typename T>
+	void placeIn(std::size_t hash, std::size_t position);
+
+	/**
+	 * \brief Clears the index slot that points at position and shifts its
+	 *        probe run back over it.
+	 */
+	void unplace(std::size_t hash, std::size_t position);
+
+	/**
+	 * \brief unplace() on an index of T slots.
+	 */
+	template <typename T>
+	void unplaceIn(std::size_t hash, std::size_t position);
+
+	/**
+	 * \brief Finds key with a single search, adding it at the end with a
+	 *        value constructed from args if it is absent.  key is only
+	 *        moved from when it is added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> findOrInsert(K& key, Args&&... args);
+
+	/**
+	 * \brief Moves every pair, in order and without the holes, into fresh
+	 *        arrays under an index of the given size.
+	 */
+	void rebuild(std::size_t newIndexSize);
+
+	/**
+	 * \brief Number of pairs an index of the given size numbers: two
+	 *        thirds of it, so probe runs stay short.
+	 */
+	static std::size_t usableFor(std::size_t indexSize);
+
+	/**
+	 * \brief Bytes in each slot of an index of the given size.
+	 */
+	static std::size_t widthFor(std::size_t indexSize);
+
+	/**
+	 * \brief Smallest power-of-two index size that numbers count pairs.
+	 */
+	static std::size_t indexSizeFor(std::size_t count);
+
+	/**
+	 * \brief First pair at or after position in the array, or used_.
+	 */
+	std::size_t nextFull(std::size_t position) const;
+
+	Slot* slots_;
+	std::size_t* hashes_;
+	void* index_;
+	std::size_t indexSize_;
+	std::size_t width_;
+	std::size_t used_;
+	std::size_t size_;
+	Hash hash_;
+	Eq equal_;
+};
+
+#include "_orderedhashmap.hpp"
+
+#endif
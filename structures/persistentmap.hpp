@@ -0,0 +1,536 @@
+/**
+ * \file persistentmap.hpp
+ * \brief Immutable, versioned mapping type backed by a hash array mapped
+ *        trie.
+ */
+
+#ifndef PERSISTENT_MAP_HPP
+#define PERSISTENT_MAP_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <type_traits>
+
+#include "mapviews.hpp"
+
+
+/**
+ * \brief A map that is never changed in place: with() and without() return
+ *        a new version and leave this one as it was.
+ * \details The pairs live in a hash array mapped trie.  Each node covers
+ *          five bits of the key's hash and holds two 32 bit maps, one of
+ *          the fragments whose pair sits in the node and one of those with
+ *          a child node, followed by just those pairs and children, in
+ *          fragment order; the place of a fragment is the number of bits
+ *          below it in its map.  Keys whose whole hashes collide share a
+ *          node below the last level, searched linearly.
+ *
+ *          A new version copies only the nodes on the path to the key,
+ *          about log32(n) of them, and shares every other node with the
+ *          version it came from, so copying a map is O(1) and keeping many
+ *          slightly different versions costs memory for the differences
+ *          only.  Nodes are reference counted, atomically, so versions can
+ *          be copied, read and destroyed on different threads.
+ *
+ *          For building a version out of many changes, a Transient applies
+ *          them in place to every node that no version shares yet, and
+ *          persistent() then hands out the result in O(1).
+ *
+ *          Having no addValue() or removeValue(), PersistentMap does not
+ *          derive from Map.
+ */
+template <typename K, typename V,
+	typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class PersistentMap
+{
+private:
+	/**
+	 * \brief A key-value pair stored in a node.
+	 */
+	struct Entry;
+
+	/**
+	 * \brief Header of a node; its pairs and then its children follow it
+	 *        in the same allocation.
+	 */
+	struct Node;
+
+	/**
+	 * \brief Constructs a node's pairs one at a time, freeing the node and
+	 *        the pairs built so far if it is dropped before release().
+	 */
+	class NodeBuilder;
+
+	/**
+	 * \brief Walks the pairs of the trie, depth first.
+	 */
+	class EntryCursor;
+
+public:
+	/**
+	 * \brief Gathers changes to a map in place, as far as no version
+	 *        shares the nodes they touch.
+	 */
+	class Transient;
+
+	typedef MapView<EntryCursor, KeyOf<K, V>> keys_view;
+	typedef MapView<EntryCursor, ValueOf<K, V const>> values_view;
+	typedef MapView<EntryCursor, ItemOf<K, V const>> items_view;
+
+	/**
+	 * \brief Default constructor.  Does not allocate.
+	 */
+	PersistentMap();
+
+	/**
+	 * \brief Constructs a map from the pairs in [first, last), so a later
+	 *        pair wins over an earlier one with the same key.
+	 * \details Built in place, as by a Transient.
+	 */
+	template <typename InputIt>
+	PersistentMap(InputIt first, InputIt last);
+
+	/**
+	 * \brief Copy constructor.  Shares every node, so costs O(1).
+	 */
+	PersistentMap(PersistentMap<K, V, Hash, Eq> const& orig);
+
+	/**
+	 * \brief Move constructor.
+	 */
+	PersistentMap(PersistentMap<K, V, Hash, Eq>&& other);
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	PersistentMap<K, V, Hash, Eq>& operator=(
+		PersistentMap<K, V, Hash, Eq> rhs);
+
+	/**
+	 * \brief Idiomatic swap function.
+	 */
+	template <typename KEY, typename VALUE, typename HASH, typename EQ>
+	friend void swap(PersistentMap<KEY, VALUE, HASH, EQ>& lhs,
+		PersistentMap<KEY, VALUE, HASH, EQ>& rhs);
+
+	/**
+	 * \brief Drops this version's hold on its nodes, freeing those no other
+	 *        version shares.
+	 */
+	~PersistentMap();
+
+	/**
+	 * \brief Gets a version in which key maps to value, whether or not it
+	 *        was present.
+	 */
+	PersistentMap<K, V, Hash, Eq> with(K key, V value) const;
+
+	/**
+	 * \brief Gets a version without key.  If key is absent, that is this
+	 *        version, shared.
+	 */
+	PersistentMap<K, V, Hash, Eq> without(K const& key) const;
+
+	/**
+	 * \brief Gets the value associated with a key.
+	 * \throws KeyError if the key is not present.
+	 */
+	V const& getValue(K const& key) const;
+
+	/**
+	 * \brief Gets a pointer to the value of key, or nullptr if it is absent.
+	 */
+	V const* find(K const& key) const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Gets the number of pairs in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Gets a Transient that starts from this version.
+	 */
+	Transient transient() const;
+
+	/**
+	 * \brief Gets a view of every key, in trie order.
+	 */
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every value, in trie order.
+	 */
+	values_view values() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair, in trie order.
+	 */
+	items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in trie order.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+private:
+	struct Entry
+	{
+		K key_;
+		V value_;
+	};
+
+	struct Node
+	{
+		Node(std::uint32_t dataMap, std::uint32_t nodeMap) :
+			refs_{1}, dataMap_{dataMap}, nodeMap_{nodeMap}
+		{
+		}
+
+		std::atomic<std::size_t> refs_;
+
+		/**
+		 * \brief Fragments with a pair in this node.  Below the last
+		 *        level, where every key has the same hash, the number of
+		 *        pairs instead.
+		 */
+		std::uint32_t dataMap_;
+
+		/**
+		 * \brief Fragments with a child node.
+		 */
+		std::uint32_t nodeMap_;
+	};
+
+	/**
+	 * \brief Hash bits each level consumes.
+	 */
+	static const unsigned Bits = 5;
+
+	/**
+	 * \brief Bits in a hash; levels at or below this shift hold collisions.
+	 */
+	static const unsigned HashBits = std::numeric_limits<std::size_t>::digits;
+
+	/**
+	 * \brief Most nodes on a path from the root, collision node included.
+	 */
+	static const unsigned MaxDepth = (HashBits + Bits - 1) / Bits + 1;
+
+	/**
+	 * \brief Whether pairs can be moved out of a node without a throw
+	 *        leaving it half emptied.
+	 */
+	static const bool NothrowMove =
+		std::is_nothrow_move_constructible<Entry>::value;
+
+	class NodeBuilder
+	{
+	public:
+		/**
+		 * \brief Allocates a node with room for entries pairs and children
+		 *        children.
+		 */
+		NodeBuilder(std::uint32_t dataMap, std::uint32_t nodeMap,
+			std::size_t entries, std::size_t children);
+
+		NodeBuilder(NodeBuilder const& orig) = delete;
+
+		NodeBuilder& operator=(NodeBuilder const& rhs) = delete;
+
+		~NodeBuilder();
+
+		/**
+		 * \brief Constructs the next pair from key and value.
+		 */
+		template <typename Key, typename Value>
+		void add(Key&& key, Value&& value);
+
+		/**
+		 * \brief Constructs the next pair from entry, moving it if steal.
+		 */
+		void take(Entry& entry, bool steal);
+
+		/**
+		 * \brief The node's children, for the caller to fill.
+		 */
+		Node** children() const;
+
+		/**
+		 * \brief Hands over the node, which must have all its pairs.
+		 */
+		Node* release();
+
+	private:
+		Node* node_;
+		std::size_t entries_;
+		std::size_t built_;
+	};
+
+	class EntryCursor
+	{
+	public:
+		/**
+		 * \brief The end of every trie.
+		 */
+		EntryCursor();
+
+		/**
+		 * \brief Points at the first pair under root.
+		 */
+		explicit EntryCursor(Node* root);
+
+		/**
+		 * \brief Moves to the next pair.
+		 */
+		EntryCursor& operator++();
+
+		/**
+		 * \brief Gets the current pair.
+		 */
+		Entry const& operator*() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const EntryCursor& rhs) const;
+
+	private:
+		/**
+		 * \brief Finds the next pair from the top of the stack on.
+		 */
+		void advance();
+
+		Node* nodes_[MaxDepth];
+
+		/**
+		 * \brief Next pair, then child, to visit in each node of the stack.
+		 */
+		std::size_t positions_[MaxDepth];
+		unsigned depth_;
+		Entry const* entry_;
+	};
+
+	/**
+	 * \brief Adopts root, which holds size pairs.
+	 */
+	PersistentMap(Node* root, std::size_t size, Hash const& hash,
+		Eq const& equal);
+
+	/**
+	 * \brief Spreads the bits of the user's hash over the whole word.
+	 */
+	std::size_t hashOf(K const& key) const;
+
+	/**
+	 * \brief The bit of a node's maps for hash at shift.
+	 */
+	static std::uint32_t bitOf(std::size_t hash, unsigned shift);
+
+	/**
+	 * \brief Place among the set bits of map of bit.
+	 */
+	static std::size_t indexOf(std::uint32_t map, std::uint32_t bit);
+
+	/**
+	 * \brief Number of pairs in node, which sits at shift.
+	 */
+	static std::size_t entryCount(Node const* node, unsigned shift);
+
+	/**
+	 * \brief Number of children of node.
+	 */
+	static std::size_t childCount(Node const* node);
+
+	/**
+	 * \brief Whether node, which sits at shift, holds a single pair and no
+	 *        children, so that its parent could hold the pair instead.
+	 */
+	static bool isLone(Node const* node, unsigned shift);
+
+	/**
+	 * \brief Byte offset of the pairs from the start of a node.
+	 */
+	static std::size_t entryOffset();
+
+	/**
+	 * \brief Byte offset of the children from the start of a node with
+	 *        entries pairs.
+	 */
+	static std::size_t childOffset(std::size_t entries);
+
+	/**
+	 * \brief The pairs of node.
+	 */
+	static Entry* entriesOf(Node* node);
+
+	/**
+	 * \brief The children of node, which sits at shift.
+	 */
+	static Node** childrenOf(Node* node, unsigned shift);
+
+	/**
+	 * \brief Finds the pair holding key, or null.
+	 */
+	Entry* findEntry(K const& key) const;
+
+	/**
+	 * \brief Gets the node that replaces node once key maps to value.
+	 * \details Where edit is set the caller hands over its hold on node,
+	 *          and node, when nothing else holds it, is changed in place
+	 *          or its pairs moved into the replacement; otherwise node is
+	 *          left as it was.  Either way the caller holds the result.
+	 */
+	Node* insert(Node* node, unsigned shift, std::size_t hash, K& key,
+		V& value, bool edit, bool& added) const;
+
+	/**
+	 * \brief Gets the node that replaces node once key, which must be
+	 *        present, is gone, or null if nothing is left; edit as for
+	 *        insert().
+	 */
+	Node* remove(Node* node, unsigned shift, std::size_t hash, K const& key,
+		bool edit) const;
+
+	/**
+	 * \brief A node, at shift, holding a copy of entry and the pair of key
+	 *        and value.
+	 */
+	Node* merge(Entry& entry, std::size_t entryHash, K& key, V& value,
+		std::size_t hash, unsigned shift) const;
+
+	/**
+	 * \brief Builds the node, with the given maps, that replaces node:
+	 *        node's pairs without the one at dropEntry and with one made
+	 *        by add(builder) at addEntry, and its children without the one
+	 *        at dropChild and with child at addChild.  An index of None
+	 *        skips that step.
+	 * \details When node is held by nothing else (unique), its pairs are
+	 *          moved if that cannot throw, node is freed, and so is the
+	 *          child at dropChild.  Otherwise the result shares node's
+	 *          children and, where edit is set, the caller's hold on node
+	 *          is dropped.
+	 */
+	template <typename Add>
+	static Node* rebuild(Node* node, unsigned shift, bool edit, bool unique,
+		std::uint32_t dataMap, std::uint32_t nodeMap, std::size_t dropEntry,
+		std::size_t addEntry, Add add, std::size_t dropChild,
+		std::size_t addChild, Node* child);
+
+	/**
+	 * \brief Sets key to value in this map, changing in place the nodes
+	 *        only it holds.
+	 * \return true if the pair was added.
+	 */
+	bool assignInPlace(K& key, V& value);
+
+	/**
+	 * \brief Removes key, which must be present, from this map, changing
+	 *        in place the nodes only it holds.
+	 */
+	void removeInPlace(K const& key);
+
+	/**
+	 * \brief Calls fn on each pair under node.
+	 */
+	template <typename Fn>
+	static void visit(Node* node, unsigned shift, Fn& fn);
+
+	/**
+	 * \brief Adds a hold on node.
+	 */
+	static void retain(Node* node);
+
+	/**
+	 * \brief Drops a hold on node, which sits at shift, freeing it and
+	 *        dropping its holds on its children if it was the last.
+	 */
+	static void release(Node* node, unsigned shift);
+
+	/**
+	 * \brief Frees node, which sits at shift, and its pairs, but not its
+	 *        children.
+	 */
+	static void freeNode(Node* node, unsigned shift);
+
+	/**
+	 * \brief An index of nothing, for rebuild().
+	 */
+	static const std::size_t None = static_cast<std::size_t>(-1);
+
+	Node* root_;
+	std::size_t size_;
+	Hash hash_;
+	Eq equal_;
+};
+
+template <typename K, typename V, typename Hash, typename Eq>
+class PersistentMap<K, V, Hash, Eq>::Transient
+{
+public:
+	/**
+	 * \brief Starts from map, sharing its nodes until they change.
+	 */
+	explicit Transient(PersistentMap<K, V, Hash, Eq> const& map);
+
+	/**
+	 * \brief Sets the value of key, adding the pair if it is not
+	 *        present.
+	 * \return true if the pair was added, false if it was overwritten.
+	 */
+	bool insertOrAssign(K key, V value);
+
+	/**
+	 * \brief Removes the value associated with a given key.
+	 * \throws KeyError if the key is not present.
+	 */
+	void removeValue(K const& key);
+
+	/**
+	 * \brief Gets a pointer to the value of key, or nullptr if it is
+	 *        absent.
+	 */
+	V const* find(K const& key) const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Gets the number of pairs in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Gets the map as it stands, in O(1).  Later changes to the
+	 *        Transient copy the nodes the result shares before
+	 *        changing them.
+	 */
+	PersistentMap<K, V, Hash, Eq> persistent() const;
+
+private:
+	PersistentMap<K, V, Hash, Eq> map_;
+};
+
+#include "_persistentmap.hpp"
+
+#endif
@@ -0,0 +1,462 @@
+/**
+ * \file rbtreemap.hpp
+ * \brief Ordered mapping type backed by a red-black tree.
+ */
+
+#ifndef RBTREE_MAP_HPP
+#define RBTREE_MAP_HPP 1
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+
+
+/**
+ * \brief An ordered map with worst case O(log n) updates and stable
+ *        iterators.
+ * \details Every pair lives in its own tree node, and nodes are relinked
+ *          rather than having their contents moved, so an iterator or
+ *          reference stays valid until its own pair is removed.  Nodes come
+ *          from a pool of chunks that grow geometrically; removed nodes are
+ *          recycled by later insertions, and the memory is only returned
+ *          when the map is destroyed.
+ *
+ *          Iterators yield keys in order, like NonHashMap's; the views
+ *          yield values and items.
+ */
+template <typename K, typename V>
+class RBTreeMap : public Map<K, V>
+{
+private:
+	/**
+	 * \brief A pair and its links.
+	 */
+	struct Node;
+
+	/**
+	 * \brief Key iterator, in order or in reverse.
+	 */
+	template <bool Forward>
+	class Iterator;
+
+	/**
+	 * \brief Walks the nodes in key order, for the views.
+	 */
+	template <typename NodeT>
+	class NodeCursor;
+
+public:
+	typedef Iterator<true> iterator;
+	typedef Iterator<true> const_iterator;
+	typedef Iterator<false> reverse_iterator;
+	typedef Iterator<false> const_reverse_iterator;
+
+	typedef MapView<NodeCursor<Node const>, KeyOf<K, V>> keys_view;
+	typedef MapView<NodeCursor<Node>, ValueOf<K, V>> values_view;
+	typedef MapView<NodeCursor<Node const>, ValueOf<K, V const>>
+		const_values_view;
+	typedef MapView<NodeCursor<Node>, ItemOf<K, V>> items_view;
+	typedef MapView<NodeCursor<Node const>, ItemOf<K, V const>>
+		const_items_view;
+
+	/**
+	 * \brief Default constructor.  Does not allocate.
+	 */
+	RBTreeMap();
+
+	/**
+	 * \brief Copy constructor.  Copies the tree's shape, colours included,
+	 *        into a single chunk.
+	 */
+	RBTreeMap(RBTreeMap<K, V> const& orig);
+
+	/**
+	 * \brief Move constructor.
+	 */
+	RBTreeMap(RBTreeMap<K, V>&& other);
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	RBTreeMap<K, V>& operator=(RBTreeMap<K, V> rhs);
+
+	/**
+	 * \brief Idiomatic swap function.
+	 */
+	template <typename KEY, typename VALUE>
+	friend void swap(RBTreeMap<KEY, VALUE>& lhs, RBTreeMap<KEY, VALUE>& rhs);
+
+	/**
+	 * \brief Destroys every pair and frees the pool.
+	 */
+	~RBTreeMap();
+
+	/**
+	 * \brief Adds a key-value pair to the map.
+	 * \throws KeyError if the key is already present.
+	 */
+	void addValue(K key, V value);
+
+	/**
+	 * \brief Sets the value of key, adding the pair if it is not present.
+	 * \return true if the pair was added, false if it was overwritten.
+	 */
+	bool insertOrAssign(K key, V value);
+
+	/**
+	 * \brief Adds key with a value constructed from args if it is absent,
+	 *        and otherwise leaves the map, and args, untouched.
+	 * \return The value of key, and whether it was added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> tryEmplace(K key, Args&&... args);
+
+	/**
+	 * \brief Calls fn(value) on the value of key, first adding a value
+	 *        initialised V if the key is absent.
+	 * \return The value of key.
+	 */
+	template <typename Fn>
+	V& upsert(K key, Fn fn);
+
+private:
+	/**
+	 * \brief Walks down once, keeping the link key would hang from; a miss
+	 *        links a node with a value constructed from args there and
+	 *        recolours upward, without searching again.  key is only moved
+	 *        from when it is added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> findOrInsert(K& key, Args&&... args);
+
+public:
+	/**
+	 * \brief Removes the value associated with a given key.
+	 * \throws KeyError if the key is not present.
+	 */
+	void removeValue(K const& key);
+
+	/**
+	 * \brief Gets the value associated with a key.
+	 * \throws KeyError if the key is not present.
+	 */
+	V& getValue(K const& key) const;
+
+	/**
+	 * \brief Gets the value associated with the key equivalent to key,
+	 *        comparing the two directly rather than converting key to K.
+	 * \throws KeyError if the key is not present.
+	 */
+	template <typename Q, typename =
+		typename std::enable_if<IsOrderedLookup<K, Q>::value>::type>
+	V& getValue(Q const& key) const;
+
+	/**
+	 * \brief Gets the number of elements in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Determines whether or not a key equivalent to key is present,
+	 *        comparing the two directly rather than converting key to K.
+	 */
+	template <typename Q, typename =
+		typename std::enable_if<IsOrderedLookup<K, Q>::value>::type>
+	bool contains(Q const& key) const;
+
+	/**
+	 * \brief Gets the greatest key not greater than key, or end().
+	 */
+	const_iterator floor(K const& key) const;
+
+	/**
+	 * \brief Gets the least key not less than key, or end().
+	 */
+	const_iterator ceiling(K const& key) const;
+
+	/**
+	 * \brief Gets a view of every key, in key order.
+	 */
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every value, in key order.
+	 */
+	values_view values();
+
+	/**
+	 * \brief Gets a view of every value, in key order.
+	 */
+	const_values_view values() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair, in key order.
+	 */
+	items_view items();
+
+	/**
+	 * \brief Gets a view of every key-value pair, in key order.
+	 */
+	const_items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in key order.
+	 * \details fn must not add or remove pairs.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn);
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in key order.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+	/**
+	 * \brief Start of the map.
+	 */
+	const_iterator begin() const;
+
+	/**
+	 * \brief Termination of the map.
+	 */
+	const_iterator end() const;
+
+	/**
+	 * \brief Last key of the map.
+	 */
+	const_reverse_iterator rbegin() const;
+
+	/**
+	 * \brief Termination of the reversed map.
+	 */
+	const_reverse_iterator rend() const;
+
+private:
+	struct Node
+	{
+		Node(K&& key, V&& value, Node* parent);
+
+		K key_;
+		V value_;
+		Node* parent_;
+		Node* left_;
+		Node* right_;
+		bool red_;
+	};
+
+	template <bool Forward>
+	class Iterator : public std::iterator<std::forward_iterator_tag, K>
+	{
+	public:
+		/**
+		 * \brief Prefix increment operator overloading.
+		 */
+		Iterator& operator++();
+
+		/**
+		 * \brief Postfix increment operator overloading.
+		 */
+		Iterator operator++(int);
+
+		/**
+		 * \brief Dereferencing operator overloading.
+		 */
+		const K& operator*() const;
+
+		/**
+		 * \brief Member access operator overriding.
+		 */
+		const K* operator->() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const Iterator& rhs) const;
+
+		/**
+		 * \brief Inequality operator overriding.
+		 */
+		bool operator!=(const Iterator& rhs) const;
+
+	private:
+		friend class RBTreeMap;
+		/**
+		 * \brief The default constructor.
+		 */
+		Iterator() = delete;
+		/**
+		 * \brief All iterators should have a current node; null is the end.
+		 */
+		Iterator(Node const* node) : current_{node}
+		{
+		}
+
+		Node const* current_;
+	};
+
+	template <typename NodeT>
+	class NodeCursor
+	{
+	public:
+		/**
+		 * \brief Points at node; null is the end.
+		 */
+		NodeCursor(NodeT* node) : node_{node}
+		{
+		}
+
+		/**
+		 * \brief Moves to the next node in key order.
+		 */
+		NodeCursor& operator++();
+
+		/**
+		 * \brief Gets the current node.
+		 */
+		NodeT& operator*() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const NodeCursor& rhs) const;
+
+	private:
+		NodeT* node_;
+	};
+
+	/**
+	 * \brief Storage for a node that is not in use.
+	 */
+	struct FreeSlot
+	{
+		FreeSlot* next_;
+	};
+
+	/**
+	 * \brief Nodes in the first chunk of the pool.
+	 */
+	static const std::size_t FirstChunk = 16;
+
+	/**
+	 * \brief Largest chunk the pool grows by.
+	 */
+	static const std::size_t MaxChunk = 4096;
+
+	/**
+	 * \brief Leftmost node of a non-empty subtree.
+	 */
+	template <typename NodeT>
+	static NodeT* minimum(NodeT* node);
+
+	/**
+	 * \brief Rightmost node of a non-empty subtree.
+	 */
+	template <typename NodeT>
+	static NodeT* maximum(NodeT* node);
+
+	/**
+	 * \brief Next node in key order, or null.
+	 */
+	template <typename NodeT>
+	static NodeT* successor(NodeT* node);
+
+	/**
+	 * \brief Previous node in key order, or null.
+	 */
+	template <typename NodeT>
+	static NodeT* predecessor(NodeT* node);
+
+	/**
+	 * \brief Node holding key, or null.
+	 */
+	template <typename Q>
+	Node* find(Q const& key) const;
+
+	/**
+	 * \brief Whether node is red; the null leaves are black.
+	 */
+	static bool isRed(Node const* node);
+
+	/**
+	 * \brief Puts replacement where node hangs from its parent.
+	 */
+	void replaceChild(Node* node, Node* replacement);
+
+	/**
+	 * \brief Rotates node's right child up into its place.
+	 */
+	void rotateLeft(Node* node);
+
+	/**
+	 * \brief Rotates node's left child up into its place.
+	 */
+	void rotateRight(Node* node);
+
+	/**
+	 * \brief Restores the red-black properties after node was linked in.
+	 */
+	void insertFixup(Node* node);
+
+	/**
+	 * \brief Unlinks node, moving its successor (not its pair) into its
+	 *        place if it has two children.
+	 */
+	void unlink(Node* node);
+
+	/**
+	 * \brief Restores the black height of the subtree at node, one short
+	 *        after an unlink.  node may be null, hence the parent.
+	 */
+	void eraseFixup(Node* node, Node* parent);
+
+	/**
+	 * \brief Constructs a node in a pooled slot.
+	 */
+	Node* allocate(K&& key, V&& value, Node* parent);
+
+	/**
+	 * \brief Destroys a node and returns its slot to the pool.
+	 */
+	void release(Node* node);
+
+	/**
+	 * \brief Adds a chunk of count slots to the free list.
+	 */
+	void grow(std::size_t count);
+
+	/**
+	 * \brief Copies a subtree, shape and colours included.
+	 */
+	Node* clone(Node const* node, Node* parent);
+
+	/**
+	 * \brief Destroys a subtree; the slots are freed with the pool.
+	 */
+	static void destroy(Node* node);
+
+	Node* root_;
+	std::size_t size_;
+	FreeSlot* free_;
+	std::vector<void*> chunks_;
+	std::size_t capacity_;
+};
+
+#include "_rbtreemap.hpp"
+
+#endif
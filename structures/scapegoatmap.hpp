@@ -0,0 +1,389 @@
+/**
+ * \file scapegoatmap.hpp
+ * \brief Ordered mapping type backed by a scapegoat tree.
+ */
+
+#ifndef SCAPEGOAT_MAP_HPP
+#define SCAPEGOAT_MAP_HPP 1
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+
+
+/**
+ * \brief An ordered map whose nodes carry nothing but a pair and two links.
+ * \details A scapegoat tree keeps no colour, size or parent in its nodes.
+ *          Instead, when an insertion lands deeper than log base 1/alpha of
+ *          the size, the highest ancestor whose larger child holds more than
+ *          alpha of its subtree is rebuilt into a perfectly balanced
+ *          subtree, and when removals shrink the map below alpha of its
+ *          largest size the whole tree is rebuilt.  Updates are amortised
+ *          O(log n) and lookups worst case O(log n).
+ *
+ *          A rebuilt subtree is laid out afresh in one contiguous block, in
+ *          breadth-first order, so the top levels of every rebuilt subtree
+ *          share cache lines.  Slots left behind are reused by insertions,
+ *          and the whole tree is compacted into a single block once more
+ *          than half the slots are unused.
+ *
+ *          Alpha lies in [0.5, 0.95].  Lower values keep the tree shallower
+ *          at the price of more frequent rebuilds; 0.5 insists on perfect
+ *          balance and 0.95 rarely rebuilds at all.
+ */
+template <typename K, typename V>
+class ScapegoatMap : public Map<K, V>
+{
+private:
+	/**
+	 * \brief A pair and its links.
+	 */
+	struct Node;
+
+	/**
+	 * \brief Walks the nodes in key order.
+	 */
+	template <typename NodeT>
+	class NodeCursor;
+
+public:
+	typedef MapView<NodeCursor<Node const>, KeyOf<K, V>> keys_view;
+	typedef MapView<NodeCursor<Node>, ValueOf<K, V>> values_view;
+	typedef MapView<NodeCursor<Node const>, ValueOf<K, V const>>
+		const_values_view;
+	typedef MapView<NodeCursor<Node>, ItemOf<K, V>> items_view;
+	typedef MapView<NodeCursor<Node const>, ItemOf<K, V const>>
+		const_items_view;
+
+	/**
+	 * \brief Constructs an empty map.  Does not allocate.
+	 * \details alpha is clamped to [0.5, 0.95].
+	 */
+	explicit ScapegoatMap(double alpha = DefaultAlpha);
+
+	/**
+	 * \brief Copy constructor.  Lays the copy out as one balanced block.
+	 */
+	ScapegoatMap(ScapegoatMap<K, V> const& orig);
+
+	/**
+	 * \brief Move constructor.
+	 */
+	ScapegoatMap(ScapegoatMap<K, V>&& other);
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	ScapegoatMap<K, V>& operator=(ScapegoatMap<K, V> rhs);
+
+	/**
+	 * \brief Idiomatic swap function.
+	 */
+	template <typename KEY, typename VALUE>
+	friend void swap(ScapegoatMap<KEY, VALUE>& lhs,
+		ScapegoatMap<KEY, VALUE>& rhs);
+
+	/**
+	 * \brief Destroys every pair and frees every block.
+	 */
+	~ScapegoatMap();
+
+	/**
+	 * \brief Adds a key-value pair to the map.
+	 * \throws KeyError if the key is already present.
+	 */
+	void addValue(K key, V value);
+
+	/**
+	 * \brief Sets the value of key, adding the pair if it is not present.
+	 * \return true if the pair was added, false if it was overwritten.
+	 */
+	bool insertOrAssign(K key, V value);
+
+	/**
+	 * \brief Adds key with a value constructed from args if it is absent,
+	 *        and otherwise leaves the map, and args, untouched.
+	 * \return The value of key, and whether it was added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> tryEmplace(K key, Args&&... args);
+
+	/**
+	 * \brief Calls fn(value) on the value of key, first adding a value
+	 *        initialised V if the key is absent.
+	 * \return The value of key.
+	 */
+	template <typename Fn>
+	V& upsert(K key, Fn fn);
+
+private:
+	/**
+	 * \brief Walks down once, recording the path in scratch_; a miss hangs
+	 *        a node with a value constructed from args at its end.  Only if
+	 *        that node lands too deep is the scapegoat rebuilt and the new
+	 *        pair looked up a second time.  key is only moved from when it
+	 *        is added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> findOrInsert(K& key, Args&&... args);
+
+public:
+	/**
+	 * \brief Removes the value associated with a given key.
+	 * \throws KeyError if the key is not present.
+	 */
+	void removeValue(K const& key);
+
+	/**
+	 * \brief Gets the value associated with a key.
+	 * \throws KeyError if the key is not present.
+	 */
+	V& getValue(K const& key) const;
+
+	/**
+	 * \brief Gets the value associated with the key equivalent to key,
+	 *        comparing the two directly rather than converting key to K.
+	 * \throws KeyError if the key is not present.
+	 */
+	template <typename Q, typename =
+		typename std::enable_if<IsOrderedLookup<K, Q>::value>::type>
+	V& getValue(Q const& key) const;
+
+	/**
+	 * \brief Gets the number of elements in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Determines whether or not a key equivalent to key is present,
+	 *        comparing the two directly rather than converting key to K.
+	 */
+	template <typename Q, typename =
+		typename std::enable_if<IsOrderedLookup<K, Q>::value>::type>
+	bool contains(Q const& key) const;
+
+	/**
+	 * \brief Gets the balance parameter.
+	 */
+	double alpha() const;
+
+	/**
+	 * \brief Changes the balance parameter, clamped to [0.5, 0.95].  The
+	 *        tree is not rebuilt until an update calls for it.
+	 */
+	void setAlpha(double alpha);
+
+	/**
+	 * \brief Gets the number of levels in the tree.
+	 */
+	std::size_t height() const;
+
+	/**
+	 * \brief Gets a view of every key, in key order.
+	 * \details Nodes have no parent links, so each step of a view searches
+	 *          down from the root: iterating a whole view is O(n log n).
+	 *          forEach() is O(n).
+	 */
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every value, in key order.
+	 */
+	values_view values();
+
+	/**
+	 * \brief Gets a view of every value, in key order.
+	 */
+	const_values_view values() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair, in key order.
+	 */
+	items_view items();
+
+	/**
+	 * \brief Gets a view of every key-value pair, in key order.
+	 */
+	const_items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in key order.
+	 * \details fn must not add or remove pairs.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn);
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in key order.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+	/**
+	 * \brief Balance parameter used when none is given.
+	 */
+	static constexpr double DefaultAlpha = 0.7;
+
+private:
+	struct Node
+	{
+		Node(K&& key, V&& value);
+		Node(K const& key, V const& value);
+
+		K key_;
+		V value_;
+		Node* left_;
+		Node* right_;
+	};
+
+	template <typename NodeT>
+	class NodeCursor
+	{
+	public:
+		/**
+		 * \brief Points at node of the tree under root; null is the end.
+		 */
+		NodeCursor(NodeT* root, NodeT* node) : root_{root}, node_{node}
+		{
+		}
+
+		/**
+		 * \brief Moves to the next node in key order.
+		 */
+		NodeCursor& operator++();
+
+		/**
+		 * \brief Gets the current node.
+		 */
+		NodeT& operator*() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const NodeCursor& rhs) const;
+
+	private:
+		NodeT* root_;
+		NodeT* node_;
+	};
+
+	/**
+	 * \brief Storage for a node that is not in use.
+	 */
+	struct FreeSlot
+	{
+		FreeSlot* next_;
+	};
+
+	/**
+	 * \brief Nodes in the first chunk for single insertions.
+	 */
+	static const std::size_t FirstChunk = 16;
+
+	/**
+	 * \brief Largest chunk for single insertions.
+	 */
+	static const std::size_t MaxChunk = 4096;
+
+	/**
+	 * \brief Deepest an insertion may land, for a map of size pairs,
+	 *        without calling for a rebuild.
+	 */
+	std::size_t depthLimit(std::size_t size) const;
+
+	/**
+	 * \brief Leftmost node, or null if the map is empty.
+	 */
+	Node* first() const;
+
+	/**
+	 * \brief Node holding key, or null.
+	 */
+	template <typename Q>
+	Node* find(Q const& key) const;
+
+	/**
+	 * \brief Number of nodes in a subtree.
+	 */
+	static std::size_t count(Node const* node);
+
+	/**
+	 * \brief Number of levels in a subtree.
+	 */
+	static std::size_t levels(Node const* node);
+
+	/**
+	 * \brief Appends a subtree's nodes to nodes in key order.
+	 */
+	static void collect(Node* node, std::vector<Node*>& nodes);
+
+	/**
+	 * \brief Calls fn on each pair of a subtree in key order.
+	 */
+	template <typename NodeT, typename Fn>
+	static void visit(NodeT* node, Fn& fn);
+
+	/**
+	 * \brief Builds a balanced tree of the pairs in nodes, which are in key
+	 *        order, in a new block.  Pairs are moved, unless moving could
+	 *        throw or copy is set, in which case they are copied.
+	 * \return The new root.  If anything throws, nothing has changed.
+	 */
+	Node* layout(std::vector<Node*> const& nodes, bool copy);
+
+	/**
+	 * \brief Rebuilds the subtree hanging from link, which holds count
+	 *        nodes, compacting the whole tree instead if too many slots are
+	 *        unused.
+	 */
+	void rebuild(Node** link, std::size_t count);
+
+	/**
+	 * \brief Rebuilds the whole tree into a single block and frees every
+	 *        other block.
+	 */
+	void compact();
+
+	/**
+	 * \brief Constructs a node in a free slot.
+	 */
+	Node* allocate(K&& key, V&& value);
+
+	/**
+	 * \brief Destroys a node and returns its slot to the free list.
+	 */
+	void release(Node* node);
+
+	/**
+	 * \brief Destroys every pair; the blocks are freed separately.
+	 */
+	static void destroy(Node* node);
+
+	Node* root_;
+	std::size_t size_;
+	std::size_t maxSize_;
+	double alpha_;
+	double inverseLogAlpha_;
+	FreeSlot* free_;
+	std::vector<void*> blocks_;
+	std::size_t capacity_;
+	std::vector<Node*> scratch_;
+};
+
+#include "_scapegoatmap.hpp"
+
+#endif
@@ -0,0 +1,213 @@
+/**
+ * \file slidingwindow.hpp
+ * \brief Rolling aggregates over a window of samples.
+ */
+
+#ifndef SLIDING_WINDOW_HPP
+#define SLIDING_WINDOW_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+
+#include "deque.hpp"
+
+
+/**
+ * \brief Rolling minimum, maintained as a monotonic deque.
+ * \details Every candidate is appended once and removed once, so adding and
+ *          evicting are amortised O(1).
+ */
+template <typename T>
+class WindowMin
+{
+public:
+	typedef T result_type;
+
+	/**
+	 * \brief Accounts for a new sample.
+	 */
+	void add(T const& value);
+
+	/**
+	 * \brief Accounts for the oldest sample leaving the window.
+	 */
+	void evict(T const& value);
+
+	/**
+	 * \brief The smallest sample in the window.
+	 */
+	T value() const;
+
+private:
+	Deque<T> candidates_;
+};
+
+/**
+ * \brief Rolling maximum, maintained as a monotonic deque.
+ */
+template <typename T>
+class WindowMax
+{
+public:
+	typedef T result_type;
+
+	/**
+	 * \brief Accounts for a new sample.
+	 */
+	void add(T const& value);
+
+	/**
+	 * \brief Accounts for the oldest sample leaving the window.
+	 */
+	void evict(T const& value);
+
+	/**
+	 * \brief The largest sample in the window.
+	 */
+	T value() const;
+
+private:
+	Deque<T> candidates_;
+};
+
+/**
+ * \brief Rolling sum, maintained as a running total.
+ */
+template <typename T>
+class WindowSum
+{
+public:
+	typedef T result_type;
+
+	/**
+	 * \brief Starts the total at T().
+	 */
+	WindowSum();
+
+	/**
+	 * \brief Accounts for a new sample.
+	 */
+	void add(T const& value);
+
+	/**
+	 * \brief Accounts for the oldest sample leaving the window.
+	 */
+	void evict(T const& value);
+
+	/**
+	 * \brief The sum of the samples in the window.
+	 */
+	T value() const;
+
+private:
+	T total_;
+};
+
+/**
+ * \brief Rolling arithmetic mean, maintained as a running total and count.
+ */
+template <typename T>
+class WindowMean
+{
+public:
+	typedef double result_type;
+
+	/**
+	 * \brief Starts with an empty window.
+	 */
+	WindowMean();
+
+	/**
+	 * \brief Accounts for a new sample.
+	 */
+	void add(T const& value);
+
+	/**
+	 * \brief Accounts for the oldest sample leaving the window.
+	 */
+	void evict(T const& value);
+
+	/**
+	 * \brief The mean of the samples in the window.
+	 */
+	double value() const;
+
+private:
+	T total_;
+	std::size_t count_;
+};
+
+/**
+ * \brief A window over the most recent samples with an O(1) amortised
+ *        aggregate.
+ * \details Samples are evicted once there are more than maxCount of them,
+ *          or once they are maxAge older than the newest timestamp seen
+ *          (either limit may be zero to disable it).  Agg is one of
+ *          WindowMin, WindowMax, WindowSum, WindowMean or any class with the
+ *          same add/evict/value interface.
+ */
+template <typename T, typename Agg>
+class SlidingWindow
+{
+private:
+	/**
+	 * \brief A sample and the time it was taken.
+	 */
+	struct Sample;
+
+public:
+	/**
+	 * \brief Constructs an empty window.
+	 */
+	explicit SlidingWindow(std::size_t maxCount, std::uint64_t maxAge = 0);
+
+	/**
+	 * \brief Adds a sample and evicts whatever falls out of the window.
+	 */
+	void push(T value, std::uint64_t timestamp = 0);
+
+	/**
+	 * \brief Evicts samples that have aged out by the given time, without
+	 *        adding a new one.
+	 */
+	void advance(std::uint64_t now);
+
+	/**
+	 * \brief The current aggregate.
+	 * \throws IndexOutOfBoundsException if the aggregate is undefined for an
+	 *         empty window (min, max and mean).
+	 */
+	typename Agg::result_type value() const;
+
+	/**
+	 * \brief Gets the number of samples in the window.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the window is empty.
+	 */
+	bool isEmpty() const;
+
+private:
+	struct Sample
+	{
+		T value_;
+		std::uint64_t timestamp_;
+		bool operator==(Sample const& s) const;
+	};
+
+	/**
+	 * \brief Removes the oldest sample.
+	 */
+	void evictOldest();
+
+	Deque<Sample> samples_;
+	Agg aggregate_;
+	std::size_t maxCount_;
+	std::uint64_t maxAge_;
+};
+
+#include "_slidingwindow.hpp"
+
+#endif
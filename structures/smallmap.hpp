@@ -0,0 +1,389 @@
+/**
+ * \file smallmap.hpp
+ * \brief Mapping type that keeps a few pairs inline and turns into a hash
+ *        map when it outgrows them.
+ */
+
+#ifndef SMALL_MAP_HPP
+#define SMALL_MAP_HPP 1
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+#include "hashmap.hpp"
+
+
+/**
+ * \brief A map that stores up to N pairs inside the object itself.
+ * \details While it holds N pairs or fewer, the keys sit in one inline
+ *          array and the values in another, and lookups compare the key
+ *          against each stored key in turn; a map that stays that small
+ *          never allocates.  Adding a pair beyond N moves every pair into a
+ *          HashMap, which serves all later operations.  A map that has been
+ *          promoted stays a hash map even if it shrinks again, so a size
+ *          hovering around N does not move the pairs back and forth; a copy
+ *          of it is inline again.  Iteration order is unspecified.
+ */
+template <typename K, typename V, std::size_t N = 8,
+	typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class SmallMap : public Map<K, V>
+{
+	static_assert(N > 0, "SmallMap needs room for at least one pair");
+
+private:
+	typedef HashMap<K, V, Hash, Eq> Table;
+
+	/**
+	 * \brief A stored key and a reference to its value.
+	 */
+	template <typename ValueT>
+	struct SlotRef;
+
+	/**
+	 * \brief Walks the inline pairs, or the table once promoted.
+	 */
+	template <typename ValueT>
+	class SlotCursor;
+
+public:
+	/**
+	 * \brief Default constructor.  Does not allocate.
+	 */
+	SmallMap();
+
+	/**
+	 * \brief Constructs a map from the pairs in [first, last) with
+	 *        insertBatch(), so a later pair wins over an earlier one with
+	 *        the same key.
+	 */
+	template <typename InputIt>
+	SmallMap(InputIt first, InputIt last);
+
+	/**
+	 * \brief Copy constructor.  The copy is inline if the pairs fit.
+	 */
+	SmallMap(SmallMap<K, V, N, Hash, Eq> const& orig);
+
+	/**
+	 * \brief Move constructor.
+	 */
+	SmallMap(SmallMap<K, V, N, Hash, Eq>&& other);
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	SmallMap<K, V, N, Hash, Eq>& operator=(SmallMap<K, V, N, Hash, Eq> rhs);
+
+	/**
+	 * \brief Idiomatic swap function.  Inline pairs are swapped one by one.
+	 */
+	template <typename KEY, typename VALUE, std::size_t SIZE, typename HASH,
+		typename EQ>
+	friend void swap(SmallMap<KEY, VALUE, SIZE, HASH, EQ>& lhs,
+		SmallMap<KEY, VALUE, SIZE, HASH, EQ>& rhs);
+
+	/**
+	 * \brief Destroys every pair.
+	 */
+	~SmallMap();
+
+	/**
+	 * \brief Adds a key-value pair to the map.
+	 * \throws KeyError if the key is already present.
+	 */
+	void addValue(K key, V value);
+
+	/**
+	 * \brief Sets the value of key, adding the pair if it is not present.
+	 * \return true if the pair was added, false if it was overwritten.
+	 */
+	bool insertOrAssign(K key, V value);
+
+	/**
+	 * \brief Adds key with a value constructed from args if it is absent,
+	 *        and otherwise leaves the map, and args, untouched.
+	 * \return The value of key, and whether it was added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> tryEmplace(K key, Args&&... args);
+
+	/**
+	 * \brief Calls fn(value) on the value of key, first adding a value
+	 *        initialised V if the key is absent.
+	 * \return The value of key.
+	 */
+	template <typename Fn>
+	V& upsert(K key, Fn fn);
+
+	/**
+	 * \brief Sets the value of every key in [first, last), adding the keys
+	 *        that are not present.
+	 * \details The result is that of insertOrAssign() on each pair in turn.
+	 *          A range that can be counted and would not fit inline
+	 *          promotes the map first, and then goes to
+	 *          HashMap::insertBatch().
+	 */
+	template <typename InputIt>
+	void insertBatch(InputIt first, InputIt last);
+
+	/**
+	 * \brief Removes the value associated with a given key.
+	 * \throws KeyError if the key is not present.
+	 */
+	void removeValue(K const& key);
+
+	/**
+	 * \brief Gets the value associated with a key.
+	 * \throws KeyError if the key is not present.
+	 */
+	V& getValue(K const& key) const;
+
+	/**
+	 * \brief Gets the value associated with the key equal to key, hashing
+	 *        and comparing key as it is rather than converting it to K.
+	 * \throws KeyError if the key is not present.
+	 */
+	template <typename Q, typename = typename std::enable_if<
+		IsHashLookup<K, Q, Hash, Eq>::value>::type>
+	V& getValue(Q const& key) const;
+
+	/**
+	 * \brief Gets the number of elements in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Determines whether or not a key equal to key is present,
+	 *        hashing and comparing key as it is.
+	 */
+	template <typename Q, typename = typename std::enable_if<
+		IsHashLookup<K, Q, Hash, Eq>::value>::type>
+	bool contains(Q const& key) const;
+
+	/**
+	 * \brief Gets a pointer to the value of key, or nullptr if it is absent.
+	 */
+	V* find(K const& key);
+
+	/**
+	 * \brief Gets a pointer to the value of key, or nullptr if it is absent.
+	 */
+	V const* find(K const& key) const;
+
+	/**
+	 * \brief Gets a pointer to the value of the key equal to key, or
+	 *        nullptr if it is absent, hashing and comparing key as it is.
+	 */
+	template <typename Q, typename = typename std::enable_if<
+		IsHashLookup<K, Q, Hash, Eq>::value>::type>
+	V* find(Q const& key);
+
+	/**
+	 * \brief Gets a pointer to the value of the key equal to key, or
+	 *        nullptr if it is absent, hashing and comparing key as it is.
+	 */
+	template <typename Q, typename = typename std::enable_if<
+		IsHashLookup<K, Q, Hash, Eq>::value>::type>
+	V const* find(Q const& key) const;
+
+	typedef MapView<SlotCursor<V const>, KeyOf<K, V>> keys_view;
+	typedef MapView<SlotCursor<V>, ValueOf<K, V>> values_view;
+	typedef MapView<SlotCursor<V const>, ValueOf<K, V const>>
+		const_values_view;
+	typedef MapView<SlotCursor<V>, ItemOf<K, V>> items_view;
+	typedef MapView<SlotCursor<V const>, ItemOf<K, V const>>
+		const_items_view;
+
+	/**
+	 * \brief Gets a view of every key.
+	 */
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every value.
+	 */
+	values_view values();
+
+	/**
+	 * \brief Gets a view of every value.
+	 */
+	const_values_view values() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair.
+	 */
+	items_view items();
+
+	/**
+	 * \brief Gets a view of every key-value pair.
+	 */
+	const_items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair.  fn must not add or
+	 *        remove pairs.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn);
+
+	/**
+	 * \brief Calls fn(key, value) for every pair.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+	/**
+	 * \brief Promotes the map at once if count pairs would not fit inline,
+	 *        and has the table make room for them.
+	 */
+	void reserve(std::size_t count);
+
+	/**
+	 * \brief Determines whether the pairs are still stored inline.
+	 */
+	bool isInline() const;
+
+private:
+	template <typename ValueT>
+	struct SlotRef
+	{
+		K const& key_;
+		ValueT& value_;
+	};
+
+	template <typename ValueT>
+	class SlotCursor
+	{
+	public:
+		typedef typename std::conditional<std::is_const<ValueT>::value,
+			SmallMap const, SmallMap>::type MapT;
+		typedef typename std::conditional<std::is_const<ValueT>::value,
+			typename Table::const_items_view,
+			typename Table::items_view>::type::iterator TableIt;
+
+		/**
+		 * \brief Points at inline pair index, or at it in the table once
+		 *        the map is promoted.
+		 */
+		SlotCursor(MapT* map, std::size_t index, TableIt it);
+
+		/**
+		 * \brief Moves to the next pair.
+		 */
+		SlotCursor& operator++();
+
+		/**
+		 * \brief Gets the current pair.
+		 */
+		SlotRef<ValueT> operator*() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const SlotCursor& rhs) const;
+
+	private:
+		MapT* map_;
+		std::size_t index_;
+		TableIt it_;
+	};
+
+	/**
+	 * \brief Sentinel index returned by lookups that miss.
+	 */
+	static const std::size_t NotFound = static_cast<std::size_t>(-1);
+
+	/**
+	 * \brief Whether promote() may move pairs: only when neither the key
+	 *        nor the value can throw while moving, since a throw on one
+	 *        half would strand the other in the table.
+	 */
+	static const bool NothrowMove =
+		std::is_nothrow_move_constructible<K>::value &&
+		std::is_nothrow_move_constructible<V>::value;
+
+	/**
+	 * \brief Hands half of an inline pair to promote(): moved if
+	 *        NothrowMove, or if it cannot be copied, and otherwise copied.
+	 */
+	template <typename T>
+	static typename std::conditional<
+		NothrowMove || !std::is_copy_constructible<T>::value,
+		T&&, T const&>::type
+	promoted(T& half);
+
+	/**
+	 * \brief The inline key at index.
+	 */
+	K& keyAt(std::size_t index) const;
+
+	/**
+	 * \brief The inline value at index.
+	 */
+	V& valueAt(std::size_t index) const;
+
+	/**
+	 * \brief Index of the inline key equal to key, or NotFound.
+	 * \details A plain scan of the key array: for N this small it beats
+	 *          hashing, and the keys are packed apart from the values so
+	 *          it touches as few cache lines as possible.  Unlike ArtMap's
+	 *          SSE2 search of a node's key bytes, it has to go through Eq,
+	 *          which may do anything, so it is not vectorised by hand.
+	 */
+	template <typename Q>
+	std::size_t findIndex(Q const& key) const;
+
+	/**
+	 * \brief Pointer to the value of key, inline or in the table, or
+	 *        nullptr.
+	 */
+	template <typename Q>
+	V* findValue(Q const& key) const;
+
+	/**
+	 * \brief Finds key with a single search, adding it with a value
+	 *        constructed from args if it is absent, and promoting the map
+	 *        first if it is full.  key is only moved from when it is added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> findOrInsert(K& key, Args&&... args);
+
+	/**
+	 * \brief Moves the inline pairs into the table.  If Hash, or copying
+	 *        pairs that cannot be moved without a throw, throws, the map is
+	 *        left inline and unchanged.
+	 */
+	void promote();
+
+	/**
+	 * \brief Destroys the inline pairs.
+	 */
+	void clearInline();
+
+	mutable typename std::aligned_storage<sizeof(K) * N, alignof(K)>::type
+		keys_;
+	mutable typename std::aligned_storage<sizeof(V) * N, alignof(V)>::type
+		values_;
+	std::size_t count_;
+	bool promoted_;
+	Eq equal_;
+	Table table_;
+};
+
+#include "_smallmap.hpp"
+
+#endif
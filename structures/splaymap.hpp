@@ -0,0 +1,302 @@
+/**
+ * \file splaymap.hpp
+ * \brief Ordered mapping type that adapts to skewed access patterns.
+ */
+
+#ifndef SPLAY_MAP_HPP
+#define SPLAY_MAP_HPP 1
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "map.hpp"
+#include "mapviews.hpp"
+
+
+/**
+ * \brief An ordered map that moves each key it looks up to the root.
+ * \details A splay tree: every access restructures the path to the key so
+ *          that the key ends up at the root, which makes a small set of hot
+ *          keys cost only a few comparisons each while the cost of any
+ *          sequence of operations stays amortised O(log n).  Splaying is
+ *          top-down, in one pass and without recursion, and nothing in the
+ *          map recurses, so even a degenerate tree cannot overflow the
+ *          stack.
+ *
+ *          Because lookups restructure the tree, they are writes.  In
+ *          read-only mode lookups leave the tree alone, so any number of
+ *          threads may call getValue() and contains() concurrently as long
+ *          as no thread mutates the map.
+ */
+template <typename K, typename V>
+class SplayMap : public Map<K, V>
+{
+private:
+	/**
+	 * \brief A pair and its links.
+	 */
+	struct Node;
+
+	/**
+	 * \brief Walks the nodes in key order.
+	 */
+	template <typename NodeT>
+	class NodeCursor;
+
+public:
+	typedef MapView<NodeCursor<Node const>, KeyOf<K, V>> keys_view;
+	typedef MapView<NodeCursor<Node>, ValueOf<K, V>> values_view;
+	typedef MapView<NodeCursor<Node const>, ValueOf<K, V const>>
+		const_values_view;
+	typedef MapView<NodeCursor<Node>, ItemOf<K, V>> items_view;
+	typedef MapView<NodeCursor<Node const>, ItemOf<K, V const>>
+		const_items_view;
+
+	/**
+	 * \brief Default constructor.
+	 */
+	SplayMap();
+
+	/**
+	 * \brief Copy constructor.  Copies the tree's shape.
+	 */
+	SplayMap(SplayMap<K, V> const& orig);
+
+	/**
+	 * \brief Move constructor.
+	 */
+	SplayMap(SplayMap<K, V>&& other);
+
+	/**
+	 * \brief Assignment operator.
+	 */
+	SplayMap<K, V>& operator=(SplayMap<K, V> rhs);
+
+	/**
+	 * \brief Idiomatic swap function.
+	 */
+	template <typename KEY, typename VALUE>
+	friend void swap(SplayMap<KEY, VALUE>& lhs, SplayMap<KEY, VALUE>& rhs);
+
+	/**
+	 * \brief Frees every node.
+	 */
+	~SplayMap();
+
+	/**
+	 * \brief Adds a key-value pair to the map.
+	 * \throws KeyError if the key is already present.
+	 */
+	void addValue(K key, V value);
+
+	/**
+	 * \brief Sets the value of key, adding the pair if it is not present.
+	 * \return true if the pair was added, false if it was overwritten.
+	 */
+	bool insertOrAssign(K key, V value);
+
+	/**
+	 * \brief Adds key with a value constructed from args if it is absent,
+	 *        and otherwise leaves the map, and args, untouched.
+	 * \return The value of key, and whether it was added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> tryEmplace(K key, Args&&... args);
+
+	/**
+	 * \brief Calls fn(value) on the value of key, first adding a value
+	 *        initialised V if the key is absent.
+	 * \return The value of key.
+	 */
+	template <typename Fn>
+	V& upsert(K key, Fn fn);
+
+private:
+	/**
+	 * \brief Splays key, or the neighbour it would sit next to, to the
+	 *        root; a miss then splits the tree around a new root holding a
+	 *        value constructed from args, so either way there is one splay.
+	 *        key is only moved from when it is added.
+	 */
+	template <typename... Args>
+	std::pair<V&, bool> findOrInsert(K& key, Args&&... args);
+
+public:
+	/**
+	 * \brief Removes the value associated with a given key.
+	 * \throws KeyError if the key is not present.
+	 */
+	void removeValue(K const& key);
+
+	/**
+	 * \brief Gets the value associated with a key, splaying it to the root
+	 *        unless the map is read-only.
+	 * \throws KeyError if the key is not present.
+	 */
+	V& getValue(K const& key) const;
+
+	/**
+	 * \brief Gets the value associated with the key equivalent to key,
+	 *        comparing the two directly rather than converting key to K.
+	 * \throws KeyError if the key is not present.
+	 */
+	template <typename Q, typename =
+		typename std::enable_if<IsOrderedLookup<K, Q>::value>::type>
+	V& getValue(Q const& key) const;
+
+	/**
+	 * \brief Gets the number of elements in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Determines whether or not the key is present, splaying it (or
+	 *        its neighbour) to the root unless the map is read-only.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Determines whether or not a key equivalent to key is present,
+	 *        comparing the two directly rather than converting key to K.
+	 */
+	template <typename Q, typename =
+		typename std::enable_if<IsOrderedLookup<K, Q>::value>::type>
+	bool contains(Q const& key) const;
+
+	/**
+	 * \brief Switches read-only mode, in which lookups do not splay, on or
+	 *        off.
+	 */
+	void setReadOnly(bool readOnly);
+
+	/**
+	 * \brief Determines whether or not lookups leave the tree alone.
+	 */
+	bool isReadOnly() const;
+
+	/**
+	 * \brief Gets a view of every key, in key order.
+	 */
+	keys_view keys() const;
+
+	/**
+	 * \brief Gets a view of every value, in key order.
+	 */
+	values_view values();
+
+	/**
+	 * \brief Gets a view of every value, in key order.
+	 */
+	const_values_view values() const;
+
+	/**
+	 * \brief Gets a view of every key-value pair, in key order.
+	 */
+	items_view items();
+
+	/**
+	 * \brief Gets a view of every key-value pair, in key order.
+	 */
+	const_items_view items() const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in key order.
+	 * \details fn must not add, remove or look up pairs.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn);
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in key order.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+private:
+	struct Node
+	{
+		Node(K const& key, V const& value, Node* parent);
+		Node(K&& key, V&& value);
+
+		K key_;
+		V value_;
+		Node* parent_;
+		Node* left_;
+		Node* right_;
+	};
+
+	template <typename NodeT>
+	class NodeCursor
+	{
+	public:
+		/**
+		 * \brief Points at node; null is the end.
+		 */
+		NodeCursor(NodeT* node) : node_{node}
+		{
+		}
+
+		/**
+		 * \brief Moves to the next node in key order.
+		 */
+		NodeCursor& operator++();
+
+		/**
+		 * \brief Gets the current node.
+		 */
+		NodeT& operator*() const;
+
+		/**
+		 * \brief Equality operator overriding.
+		 */
+		bool operator==(const NodeCursor& rhs) const;
+
+	private:
+		NodeT* node_;
+	};
+
+	/**
+	 * \brief Leftmost node, or null if the map is empty.
+	 */
+	Node* first() const;
+
+	/**
+	 * \brief Next node in key order, or null.
+	 */
+	template <typename NodeT>
+	static NodeT* successor(NodeT* node);
+
+	/**
+	 * \brief Brings the node holding key, or the last node on its search
+	 *        path, to the root of the non-empty tree rooted at root.
+	 * \return The new root.
+	 */
+	template <typename Q>
+	static Node* splay(Node* root, Q const& key);
+
+	/**
+	 * \brief Node holding key, found by splaying or, in read-only mode, by
+	 *        a plain search.  Null if the key is not present.
+	 */
+	template <typename Q>
+	Node* find(Q const& key) const;
+
+	/**
+	 * \brief Frees a subtree without recursing.
+	 */
+	static void destroy(Node* node);
+
+	mutable Node* root_;
+	std::size_t size_;
+	bool readOnly_;
+};
+
+#include "_splaymap.hpp"
+
+#endif
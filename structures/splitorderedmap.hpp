@@ -0,0 +1,271 @@
+/**
+ * \file splitorderedmap.hpp
+ * \brief Lock-free hash map built on a single split-ordered linked list.
+ */
+
+#ifndef SPLIT_ORDERED_MAP_HPP
+#define SPLIT_ORDERED_MAP_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "map.hpp"
+
+
+/**
+ * \brief A hash map whose operations are all lock-free (Shalev-Shavit).
+ * \details Every pair lives in one lock-free sorted linked list, ordered by
+ *          the bit-reversed hash of its key.  Buckets are only shortcuts: a
+ *          bucket is a dummy node marking where its keys start in the list.
+ *          Doubling the bucket count splits each bucket in two simply by
+ *          inserting a new dummy in the middle of its run, so growing never
+ *          moves an element.  The bucket table is a set of segments that are
+ *          allocated on demand and never reallocated.
+ *
+ *          Unlinked nodes are reclaimed with epoch-based reclamation: every
+ *          operation announces the global epoch it started in, and a node is
+ *          only freed once the epoch has advanced twice past its removal,
+ *          which guarantees that no operation can still be looking at it.
+ */
+template <typename K, typename V,
+	typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class SplitOrderedMap : public Map<K, V>
+{
+private:
+	/**
+	 * \brief Node of the list; bucket dummies are bare ListNodes.
+	 */
+	struct ListNode;
+
+	/**
+	 * \brief A ListNode that also holds a key-value pair.
+	 */
+	struct DataNode;
+
+	/**
+	 * \brief An announced epoch plus the nodes its owner has retired.
+	 */
+	struct EpochRecord;
+
+public:
+	/**
+	 * \brief Constructs an empty map with two buckets.
+	 */
+	SplitOrderedMap();
+
+	/**
+	 * \brief The map is shared between threads by reference only.
+	 */
+	SplitOrderedMap(SplitOrderedMap<K, V, Hash, Eq> const& orig) = delete;
+
+	/**
+	 * \brief The map is shared between threads by reference only.
+	 */
+	SplitOrderedMap<K, V, Hash, Eq>& operator=(
+		SplitOrderedMap<K, V, Hash, Eq> const& rhs) = delete;
+
+	/**
+	 * \brief Frees every node, segment and epoch record.
+	 * \pre No other thread is using the map.
+	 */
+	~SplitOrderedMap();
+
+	/**
+	 * \brief Adds a key-value pair to the map.
+	 * \throws KeyError if the key is already present.
+	 */
+	void addValue(K key, V value);
+
+	/**
+	 * \brief Removes the value associated with a given key.
+	 * \throws KeyError if the key is not present.
+	 */
+	void removeValue(K const& key);
+
+	/**
+	 * \brief Gets the value associated with a key.
+	 * \details The reference is only safe to use while no other thread
+	 *          removes the key; concurrent readers should use find().
+	 * \throws KeyError if the key is not present.
+	 */
+	V& getValue(K const& key) const;
+
+	/**
+	 * \brief Copies the value associated with key into value.
+	 * \return false, leaving value untouched, if the key is not present.
+	 */
+	bool find(K const& key, V& value) const;
+
+	/**
+	 * \brief Gets the number of elements in the map.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Determines whether or not the map is empty.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Determines whether or not the key is present.
+	 */
+	bool contains(K const& key) const;
+
+	/**
+	 * \brief Calls fn(key, value) for every pair, in split order.
+	 * \details Pairs added or removed during the walk may or may not be
+	 *          seen.  fn must not touch the map.
+	 */
+	template <typename Fn>
+	void forEach(Fn fn) const;
+
+	/**
+	 * \brief Gets the current number of buckets.
+	 */
+	std::size_t bucketCount() const;
+
+private:
+	struct ListNode
+	{
+		/**
+		 * \brief Bit-reversed hash; odd for data nodes, even for dummies.
+		 */
+		std::uint64_t soKey_;
+		/**
+		 * \brief Successor, with the low bit set once this node is deleted.
+		 */
+		std::atomic<ListNode*> next_;
+		/**
+		 * \brief Chains the node in a limbo list once it is retired.
+		 */
+		ListNode* link_;
+	};
+
+	struct DataNode : ListNode
+	{
+		DataNode(std::uint64_t soKey, K const& key, V&& value) :
+			ListNode{soKey, {nullptr}, nullptr},
+			key_(key),
+			value_(std::move(value))
+		{
+		}
+
+		K key_;
+		V value_;
+	};
+
+	struct EpochRecord
+	{
+		std::atomic<bool> active_;
+		std::atomic<std::uint64_t> epoch_;
+		ListNode* limbo_[3];
+		std::uint64_t limboEpoch_[3];
+		std::size_t numRetired_;
+		EpochRecord* next_;
+	};
+
+	/**
+	 * \brief Number of bucket segments; segment s > 0 holds 2^s buckets.
+	 */
+	static const std::size_t NumSegments = 48;
+
+	/**
+	 * \brief Average number of pairs per bucket before the table doubles.
+	 */
+	static const std::size_t MaxLoad = 2;
+
+	/**
+	 * \brief Epoch announced by a record whose owner is not in the map.
+	 */
+	static const std::uint64_t Idle = 0;
+
+	/**
+	 * \brief Claims an epoch record and announces the current epoch in it.
+	 */
+	EpochRecord* enter() const;
+
+	/**
+	 * \brief Announces that the record's owner has left the map.
+	 */
+	void leave(EpochRecord* record) const;
+
+	/**
+	 * \brief Queues an unlinked node for freeing two epochs from now.
+	 */
+	void retire(EpochRecord* record, ListNode* node) const;
+
+	/**
+	 * \brief Advances the global epoch if every thread has seen it.
+	 */
+	void tryAdvance() const;
+
+	/**
+	 * \brief Frees the record's limbo lists that no thread can reach.
+	 */
+	void reclaim(EpochRecord* record) const;
+
+	/**
+	 * \brief Finds the first node at or after so (and key, for data nodes)
+	 *        in the list starting at head, unlinking deleted nodes on the way.
+	 * \return true if curr is the node sought; otherwise curr is its
+	 *         successor-to-be and prev the link to swing.
+	 */
+	bool search(EpochRecord* record, ListNode* head, std::uint64_t so,
+		K const* key, std::atomic<ListNode*>*& prev, ListNode*& curr) const;
+
+	/**
+	 * \brief Gets the dummy of a bucket, creating it if needed.
+	 */
+	ListNode* bucketHead(EpochRecord* record, std::size_t bucket) const;
+
+	/**
+	 * \brief Gets the table slot of a bucket, allocating its segment.
+	 */
+	std::atomic<ListNode*>& bucketSlot(std::size_t bucket) const;
+
+	/**
+	 * \brief Mixes the user hash into 63 bits.
+	 */
+	std::uint64_t hashOf(K const& key) const;
+
+	/**
+	 * \brief Reverses the bits of a 64 bit word.
+	 */
+	static std::uint64_t reverse(std::uint64_t word);
+
+	/**
+	 * \brief Frees a node of either kind.
+	 */
+	static void freeNode(ListNode* node);
+
+	/**
+	 * \brief Determines whether or not a link carries the deleted mark.
+	 */
+	static bool isMarked(ListNode* node);
+
+	/**
+	 * \brief Sets the deleted mark on a link.
+	 */
+	static ListNode* marked(ListNode* node);
+
+	/**
+	 * \brief Strips the deleted mark from a link.
+	 */
+	static ListNode* unmarked(ListNode* node);
+
+	mutable std::atomic<std::atomic<ListNode*>*> segments_[NumSegments];
+	std::atomic<std::size_t> bucketCount_;
+	std::atomic<std::size_t> size_;
+	alignas(64) mutable std::atomic<std::uint64_t> globalEpoch_;
+	mutable std::atomic<EpochRecord*> records_;
+	mutable std::atomic<std::size_t> numRecords_;
+	Hash hash_;
+	Eq equal_;
+};
+
+#include "_splitorderedmap.hpp"
+
+#endif
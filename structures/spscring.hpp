@@ -0,0 +1,131 @@
+/**
+ * \file spscring.hpp
+ * \brief A lock-free single-producer single-consumer ring buffer.
+ */
+
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP 1
+
+#include <atomic>
+#include <cstddef>
+
+
+/**
+ * \brief A bounded FIFO for exactly one producer thread and one consumer
+ *        thread.
+ * \details Each side owns its index on its own cache line and keeps a cached
+ *          copy of the other side's index, so the shared lines are only read
+ *          when the cached view says the ring is full (or empty).  Besides
+ *          the element-wise tryPush/tryPop, reserve/commit and peek/release
+ *          hand out contiguous spans of the ring so batches can be written
+ *          and read in place.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+	/**
+	 * \brief A contiguous run of slots inside the ring.
+	 */
+	struct Span
+	{
+		T* data;
+		std::size_t size;
+
+		T* begin() const { return data; }
+		T* end() const { return data + size; }
+		T& operator[](std::size_t index) const { return data[index]; }
+	};
+
+	/**
+	 * \brief Constructs an empty ring.
+	 * \details The capacity is rounded up to a power of two.
+	 */
+	explicit SpscRing(std::size_t capacity);
+
+	/**
+	 * \brief The ring is shared between threads by reference only.
+	 */
+	SpscRing(const SpscRing<T>& orig) = delete;
+
+	/**
+	 * \brief The ring is shared between threads by reference only.
+	 */
+	SpscRing<T>& operator=(const SpscRing<T>& rhs) = delete;
+
+	/**
+	 * \brief Frees the ring.
+	 */
+	~SpscRing();
+
+	/**
+	 * \brief Adds a value if there is room.  Producer only.
+	 * \return false if the ring was full.
+	 */
+	bool tryPush(T value);
+
+	/**
+	 * \brief Removes the oldest value if there is one.  Consumer only.
+	 * \return false if the ring was empty.
+	 */
+	bool tryPop(T& value);
+
+	/**
+	 * \brief Returns up to maxItems contiguous free slots.  Producer only.
+	 * \details The span is shorter than requested when the ring is nearly
+	 *          full or the free region wraps; it is empty when the ring is
+	 *          full.  Nothing is visible to the consumer until commit().
+	 */
+	Span reserve(std::size_t maxItems);
+
+	/**
+	 * \brief Publishes the first count slots of the last reserve().
+	 */
+	void commit(std::size_t count);
+
+	/**
+	 * \brief Returns up to maxItems contiguous readable slots.  Consumer
+	 *        only.
+	 * \details Slots stay owned by the consumer until release().
+	 */
+	Span peek(std::size_t maxItems);
+
+	/**
+	 * \brief Hands the first count slots of the last peek() back to the
+	 *        producer.
+	 */
+	void release(std::size_t count);
+
+	/**
+	 * \brief Approximate number of values in the ring.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Approximate emptiness check.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Maximum number of values the ring can hold.
+	 */
+	std::size_t capacity() const;
+
+private:
+	T* slots_;
+	std::size_t mask_;
+
+	// Producer cache line: its own index plus its view of the consumer.
+	alignas(64) std::atomic<std::size_t> tail_;
+	std::size_t cachedHead_;
+
+	// Consumer cache line: its own index plus its view of the producer.
+	alignas(64) std::atomic<std::size_t> head_;
+	std::size_t cachedTail_;
+
+	char padding_[64 - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+};
+
+#include "_spscring.hpp"
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * \file workstealingdeque.hpp
+ * \brief A lock-free work-stealing deque (Chase-Lev).
+ */
+
+#ifndef WORK_STEALING_DEQUE_HPP
+#define WORK_STEALING_DEQUE_HPP 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * \brief A lock-free deque owned by a single thread and stolen from by many.
+ * \details The owning thread pushes and pops at the bottom, any other thread
+ *          may steal from the top.  The backing circular array grows on
+ *          demand; retired arrays are kept alive until the deque is destroyed
+ *          so that a thief that still holds one never reads freed memory.
+ *          T must be trivially copyable (typically a task pointer).
+ */
+template <typename T>
+class WorkStealingDeque
+{
+private:
+	/**
+	 * \brief Circular array backing the deque.
+	 */
+	struct Buffer;
+
+public:
+	/**
+	 * \brief Constructs an empty deque.
+	 * \details The capacity is rounded up to a power of two.
+	 */
+	explicit WorkStealingDeque(std::size_t capacity = 64);
+
+	/**
+	 * \brief The deque is shared between threads by reference only.
+	 */
+	WorkStealingDeque(const WorkStealingDeque<T>& orig) = delete;
+
+	/**
+	 * \brief The deque is shared between threads by reference only.
+	 */
+	WorkStealingDeque<T>& operator=(const WorkStealingDeque<T>& rhs) = delete;
+
+	/**
+	 * \brief Frees the current and all retired buffers.
+	 */
+	~WorkStealingDeque();
+
+	/**
+	 * \brief Pushes a value onto the bottom.  Owner thread only.
+	 */
+	void push(T value);
+
+	/**
+	 * \brief Pops the most recently pushed value.  Owner thread only.
+	 * \return false if the deque was empty.
+	 */
+	bool pop(T& value);
+
+	/**
+	 * \brief Steals the oldest value.  Safe from any thread.
+	 * \return false if the deque was empty or another thread won the race
+	 *         for the last item.
+	 */
+	bool steal(T& value);
+
+	/**
+	 * \brief Approximate number of items; exact when called by the owner
+	 *        with no concurrent thieves.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * \brief Approximate emptiness check.
+	 */
+	bool isEmpty() const;
+
+	/**
+	 * \brief Capacity of the current backing array.
+	 */
+	std::size_t capacity() const;
+
+private:
+	struct Buffer
+	{
+		Buffer(std::size_t capacity, Buffer* retired);
+		~Buffer();
+
+		T get(std::int64_t index) const;
+		void put(std::int64_t index, T value);
+		Buffer* grow(std::int64_t top, std::int64_t bottom);
+
+		std::size_t capacity_;
+		std::size_t mask_;
+		std::atomic<T>* slots_;
+		Buffer* retired_;
+	};
+
+	// top_ and bottom_ live on separate cache lines; thieves hammer the first
+	// while the owner hammers the second.
+	alignas(64) std::atomic<std::int64_t> top_;
+	alignas(64) std::atomic<std::int64_t> bottom_;
+	std::atomic<Buffer*> buffer_;
+};
+
+#include "_workstealingdeque.hpp"
+
+#endif
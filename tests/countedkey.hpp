@@ -0,0 +1,46 @@
+/**
+ * \file countedkey.hpp
+ * \brief An int key that counts its comparisons, for tests that pin how
+ *        many searches an ordered map makes.
+ */
+
+#ifndef COUNTED_KEY_HPP
+#define COUNTED_KEY_HPP 1
+
+#include <cstddef>
+#include <ostream>
+
+
+/**
+ * \brief An int whose operator< calls are counted.
+ */
+struct CountedKey
+{
+	CountedKey(int value = 0) : value_{value}
+	{
+	}
+
+	/**
+	 * \brief Comparisons made so far.
+	 */
+	static std::size_t& comparisons()
+	{
+		static std::size_t count = 0;
+		return count;
+	}
+
+	int value_;
+};
+
+inline bool operator<(CountedKey const& lhs, CountedKey const& rhs)
+{
+	++CountedKey::comparisons();
+	return lhs.value_ < rhs.value_;
+}
+
+inline std::ostream& operator<<(std::ostream& out, CountedKey const& key)
+{
+	return out << key.value_;
+}
+
+#endif
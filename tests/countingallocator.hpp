@@ -0,0 +1,70 @@
+/**
+ * \file countingallocator.hpp
+ * \brief An allocator that counts its allocations, for tests that check a
+ *        lookup builds no key.
+ */
+
+#ifndef COUNTING_ALLOCATOR_HPP
+#define COUNTING_ALLOCATOR_HPP 1
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+
+/**
+ * \brief std::allocator that counts every allocate() call, over all
+ *        element types.
+ */
+template <typename T>
+struct CountingAllocator
+{
+	typedef T value_type;
+
+	CountingAllocator() = default;
+
+	template <typename U>
+	CountingAllocator(CountingAllocator<U> const&)
+	{
+	}
+
+	T* allocate(std::size_t count)
+	{
+		++allocations();
+		return std::allocator<T>().allocate(count);
+	}
+
+	void deallocate(T* memory, std::size_t count)
+	{
+		std::allocator<T>().deallocate(memory, count);
+	}
+
+	/**
+	 * \brief Allocations made so far.
+	 */
+	static std::size_t& allocations()
+	{
+		static std::size_t count = 0;
+		return count;
+	}
+};
+
+template <typename T, typename U>
+bool operator==(CountingAllocator<T> const&, CountingAllocator<U> const&)
+{
+	return true;
+}
+
+template <typename T, typename U>
+bool operator!=(CountingAllocator<T> const&, CountingAllocator<U> const&)
+{
+	return false;
+}
+
+/**
+ * \brief A string whose heap buffers are counted.
+ */
+typedef std::basic_string<char, std::char_traits<char>,
+	CountingAllocator<char>> CountedString;
+
+#endif
@@ -0,0 +1,313 @@
+#include <climits>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/artmap.hpp"
+#include "../exceptions.hpp"
+
+
+/**
+ * \brief A random key of up to 5 characters from a small alphabet, so keys
+ *        often share prefixes and are prefixes of each other; some start
+ *        with a prefix longer than a node stores.
+ */
+static std::string randomKey()
+{
+	std::string key = std::rand() % 4 == 0 ? "longer/than/eight" : "";
+	for (int length = std::rand() % 6; length > 0; --length)
+		key += static_cast<char>('a' + std::rand() % 4);
+	return key;
+}
+
+TEST(ArtMapTest, constructor)
+{
+	ArtMap<std::string, int> map;
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(false, map.contains(""));
+	EXPECT_EQ(nullptr, map.find("a"));
+	EXPECT_EQ(0, map.keys().size());
+}
+
+TEST(ArtMapTest, copyAndMove)
+{
+	ArtMap<std::string, int> map;
+	for (int i = 0; i < 1000; ++i)
+		map.addValue(std::to_string(i), i);
+
+	ArtMap<std::string, int> copy{map};
+	map.removeValue("5");
+	EXPECT_EQ(1000, copy.size());
+	EXPECT_EQ(5, copy.getValue("5"));
+	EXPECT_EQ(false, map.contains("5"));
+
+	ArtMap<std::string, int> moved{std::move(copy)};
+	EXPECT_EQ(1000, moved.size());
+	EXPECT_EQ(0, copy.size());
+
+	copy = map;
+	EXPECT_EQ(999, copy.size());
+	EXPECT_EQ(false, copy.contains("5"));
+	EXPECT_EQ(500, copy.getValue("500"));
+}
+
+TEST(ArtMapTest, addGetRemove)
+{
+	ArtMap<std::string, std::string> map;
+	map.addValue("two", "2");
+	map.addValue("one", "1");
+	EXPECT_THROW(map.addValue("one", "uno"), KeyError<std::string>);
+	EXPECT_EQ("1", map.getValue("one"));
+
+	map.getValue("two") = "deux";
+	EXPECT_EQ("deux", map.getValue("two"));
+	EXPECT_EQ("deux", *map.find("two"));
+
+	map.removeValue("one");
+	EXPECT_EQ(false, map.contains("one"));
+	EXPECT_THROW(map.getValue("one"), KeyError<std::string>);
+	EXPECT_THROW(map.removeValue("one"), KeyError<std::string>);
+	EXPECT_THROW(map.removeValue("tw"), KeyError<std::string>);
+	map.removeValue("two");
+	EXPECT_EQ(true, map.isEmpty());
+}
+
+TEST(ArtMapTest, keysThatArePrefixesOfOthers)
+{
+	ArtMap<std::string, int> map;
+	const char* words[] = {"abc", "a", "", "ab", "abd", "b"};
+	for (int i = 0; i < 6; ++i)
+		map.addValue(words[i], i);
+	for (int i = 0; i < 6; ++i)
+		EXPECT_EQ(i, map.getValue(words[i]));
+	EXPECT_EQ(false, map.contains("abcd"));
+	EXPECT_EQ(false, map.contains("ac"));
+
+	std::vector<std::string> expected = {"", "a", "ab", "abc", "abd", "b"};
+	std::vector<std::string> keys(map.keys().begin(), map.keys().end());
+	EXPECT_EQ(expected, keys);
+
+	map.removeValue("ab");
+	map.removeValue("");
+	EXPECT_EQ(0, map.getValue("abc"));
+	EXPECT_EQ(1, map.getValue("a"));
+	EXPECT_EQ(false, map.contains(""));
+	expected = {"a", "abc", "abd", "b"};
+	keys.assign(map.keys().begin(), map.keys().end());
+	EXPECT_EQ(expected, keys);
+}
+
+TEST(ArtMapTest, longSharedPrefixes)
+{
+	// The shared part is longer than a node stores, so lookups have to
+	// check the rest of it at the leaf, and splits read it from a leaf.
+	const std::string base = "https://example.com/a/very/long/path/";
+	ArtMap<std::string, int> map;
+	map.addValue(base + "x", 1);
+	map.addValue(base + "y", 2);
+	EXPECT_EQ(false, map.contains("https://example.org/a/very/long/path/x"));
+	EXPECT_EQ(nullptr, map.find(base));
+
+	map.addValue("https://example.com/a/other", 3);
+	map.addValue(base, 4);
+	map.addValue("https://example.com/a/very/long/pat", 5);
+	EXPECT_EQ(1, map.getValue(base + "x"));
+	EXPECT_EQ(2, map.getValue(base + "y"));
+	EXPECT_EQ(3, map.getValue("https://example.com/a/other"));
+	EXPECT_EQ(4, map.getValue(base));
+	EXPECT_EQ(5, map.getValue("https://example.com/a/very/long/pat"));
+
+	map.removeValue("https://example.com/a/other");
+	map.removeValue(base);
+	map.removeValue("https://example.com/a/very/long/pat");
+	EXPECT_EQ(1, map.getValue(base + "x"));
+	EXPECT_EQ(false, map.contains("https://example.com/a/very/long/patx"));
+	map.addValue("https://example.com/b", 6);
+	EXPECT_EQ(2, map.getValue(base + "y"));
+	EXPECT_EQ(6, map.getValue("https://example.com/b"));
+	EXPECT_EQ(3, map.size());
+}
+
+TEST(ArtMapTest, nodesGrowAndShrink)
+{
+	// Every byte under one node takes it through all four sizes and back.
+	ArtMap<std::string, int> map;
+	for (int b = 0; b < 256; ++b) {
+		map.addValue(std::string("k") + static_cast<char>(b), b);
+		for (int c = 0; c <= b; c += 17)
+			ASSERT_EQ(c, map.getValue(std::string("k") + static_cast<char>(c)));
+	}
+	EXPECT_EQ(256, map.size());
+
+	int expected = 0;
+	map.forEach([&](std::string const& key, int const& value) {
+		EXPECT_EQ(expected, static_cast<unsigned char>(key[1]));
+		EXPECT_EQ(expected++, value);
+	});
+	EXPECT_EQ(256, expected);
+
+	for (int b = 255; b >= 0; --b) {
+		map.removeValue(std::string("k") + static_cast<char>(b));
+		EXPECT_EQ(static_cast<std::size_t>(b), map.size());
+		for (int c = 0; c < b; c += 13)
+			ASSERT_EQ(c, map.getValue(std::string("k") + static_cast<char>(c)));
+	}
+	EXPECT_EQ(true, map.isEmpty());
+}
+
+TEST(ArtMapTest, integerKeysAreOrdered)
+{
+	ArtMap<int, int> map;
+	const int keys[] = {5, -1, INT_MIN, 0, INT_MAX, -300, 256, 255};
+	for (int key : keys)
+		map.addValue(key, key / 2);
+
+	std::vector<int> expected = {INT_MIN, -300, -1, 0, 5, 255, 256, INT_MAX};
+	std::vector<int> sorted(map.keys().begin(), map.keys().end());
+	EXPECT_EQ(expected, sorted);
+	EXPECT_EQ(-150, map.getValue(-300));
+	EXPECT_EQ(false, map.contains(1));
+
+	ArtMap<unsigned char, int> bytes;
+	bytes.addValue(200, 1);
+	bytes.addValue(3, 2);
+	EXPECT_EQ(3, *bytes.keys().begin());
+}
+
+TEST(ArtMapTest, matchesReferenceUnderRandomOperations)
+{
+	ArtMap<std::string, int> map;
+	std::map<std::string, int> reference;
+	std::srand(29);
+
+	for (int i = 0; i < 30000; ++i) {
+		std::string key = randomKey();
+		if (std::rand() % 3 != 0) {
+			if (reference.count(key) == 0) {
+				reference[key] = i;
+				map.addValue(key, i);
+			}
+		} else if (reference.count(key) == 1) {
+			reference.erase(key);
+			map.removeValue(key);
+		} else {
+			EXPECT_EQ(false, map.contains(key));
+		}
+	}
+	EXPECT_EQ(reference.size(), map.size());
+
+	auto expected = reference.begin();
+	for (auto item : map.items()) {
+		EXPECT_EQ(expected->first, item.key);
+		EXPECT_EQ(expected->second, item.value);
+		++expected;
+	}
+	EXPECT_EQ(true, expected == reference.end());
+
+	for (auto const& pair : reference)
+		map.removeValue(pair.first);
+	EXPECT_EQ(true, map.isEmpty());
+
+	ArtMap<long, int> numbers;
+	std::map<long, int> numberReference;
+	for (int i = 0; i < 20000; ++i) {
+		long key = static_cast<long>(std::rand() % 5000) * 70001 - 150000000;
+		if (std::rand() % 3 != 0) {
+			numberReference[key] = i;
+			numbers.insertOrAssign(key, i);
+		} else if (numberReference.erase(key) == 1) {
+			numbers.removeValue(key);
+		}
+	}
+	EXPECT_EQ(numberReference.size(), numbers.size());
+	auto number = numberReference.begin();
+	numbers.forEach([&](long const& key, int const& value) {
+		EXPECT_EQ(number->first, key);
+		EXPECT_EQ(number->second, value);
+		++number;
+	});
+}
+
+TEST(ArtMapTest, forEachWithPrefix)
+{
+	ArtMap<std::string, int> map;
+	const char* words[] = {"car", "card", "care", "cart", "cat", "do", "ca"};
+	for (int i = 0; i < 7; ++i)
+		map.addValue(words[i], i);
+
+	std::vector<std::string> found;
+	auto collect = [&](std::string const& key, int const&) {
+		found.push_back(key);
+	};
+	map.forEachWithPrefix("car", collect);
+	EXPECT_EQ((std::vector<std::string>{"car", "card", "care", "cart"}),
+		found);
+
+	found.clear();
+	map.forEachWithPrefix("ca", collect);
+	EXPECT_EQ(6, found.size());
+	EXPECT_EQ("ca", found.front());
+
+	found.clear();
+	map.forEachWithPrefix("", collect);
+	EXPECT_EQ(7, found.size());
+
+	found.clear();
+	map.forEachWithPrefix("carts", collect);
+	map.forEachWithPrefix("b", collect);
+	map.forEachWithPrefix("cb", collect);
+	EXPECT_EQ(true, found.empty());
+	map.forEachWithPrefix("d", collect);
+	EXPECT_EQ((std::vector<std::string>{"do"}), found);
+}
+
+TEST(ArtMapTest, insertOrAssignTryEmplaceUpsert)
+{
+	ArtMap<std::string, int> map;
+	EXPECT_EQ(true, map.insertOrAssign("one", 1));
+	EXPECT_EQ(false, map.insertOrAssign("one", 11));
+	EXPECT_EQ(11, map.getValue("one"));
+
+	std::pair<int&, bool> added = map.tryEmplace("two", 2);
+	EXPECT_EQ(true, added.second);
+	EXPECT_EQ(2, added.first);
+	std::pair<int&, bool> present = map.tryEmplace("two", 22);
+	EXPECT_EQ(false, present.second);
+	present.first = 20;
+	EXPECT_EQ(20, map.getValue("two"));
+
+	std::string words[] = {"a", "b", "a", "c", "a", "b"};
+	for (std::string const& word : words)
+		map.upsert(word, [](int& count) { ++count; });
+	EXPECT_EQ(3, map.getValue("a"));
+	EXPECT_EQ(2, map.getValue("b"));
+	EXPECT_EQ(1, map.getValue("c"));
+	EXPECT_EQ(21, map.upsert("two", [](int& value) { ++value; }));
+	EXPECT_EQ(5, map.size());
+}
+
+TEST(ArtMapTest, viewsAndForEach)
+{
+	ArtMap<int, int> map;
+	for (int i = 9; i >= 0; --i)
+		map.addValue(i, i * 10);
+
+	int expected = 0;
+	for (int key : map.keys())
+		EXPECT_EQ(expected++, key);
+	EXPECT_EQ(10, expected);
+	for (int& value : map.values())
+		value += 1;
+	int sum = 0;
+	map.forEach([&](int const& key, int const& value) {
+		EXPECT_EQ(key * 10 + 1, value);
+		sum += value;
+	});
+	EXPECT_EQ(460, sum);
+	EXPECT_EQ(10, map.items().size());
+}
@@ -0,0 +1,188 @@
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+#include "../structures/bimap.hpp"
+#include "../exceptions.hpp"
+
+
+TEST(BiMapTest, constructor)
+{
+	BiMap<int, std::string> map;
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(false, map.contains(1));
+	EXPECT_EQ(false, map.containsValue("one"));
+}
+
+TEST(BiMapTest, copyConstructor)
+{
+	BiMap<int, std::string> map;
+	map.addValue(1, "one");
+	BiMap<int, std::string> copy{map};
+
+	map.addValue(2, "two");
+	EXPECT_EQ(1, copy.size());
+	EXPECT_EQ(1, copy.getKey("one"));
+	EXPECT_EQ(false, copy.containsValue("two"));
+}
+
+TEST(BiMapTest, moveAndSwap)
+{
+	BiMap<int, std::string> map;
+	map.addValue(1, "one");
+	BiMap<int, std::string> moved{std::move(map)};
+	EXPECT_EQ("one", moved.getValue(1));
+
+	BiMap<int, std::string> other;
+	swap(moved, other);
+	EXPECT_EQ(0, moved.size());
+	EXPECT_EQ(1, other.getKey("one"));
+}
+
+TEST(BiMapTest, lookupsBothWays)
+{
+	BiMap<int, std::string> map;
+	map.addValue(1, "one");
+	map.addValue(2, "two");
+
+	EXPECT_EQ("one", map.getValue(1));
+	EXPECT_EQ(2, map.getKey("two"));
+	EXPECT_THROW(map.getValue(3), KeyError<int>);
+	EXPECT_THROW(map.getKey("three"), KeyError<std::string>);
+}
+
+TEST(BiMapTest, addValueRejectsEitherDuplicate)
+{
+	BiMap<int, std::string> map;
+	map.addValue(1, "one");
+	EXPECT_THROW(map.addValue(1, "uno"), KeyError<int>);
+	EXPECT_THROW(map.addValue(11, "one"), KeyError<std::string>);
+	EXPECT_EQ(1, map.size());
+	EXPECT_EQ(false, map.contains(11));
+}
+
+TEST(BiMapTest, removeBothWays)
+{
+	BiMap<int, std::string> map;
+	map.addValue(1, "one");
+	map.addValue(2, "two");
+	map.addValue(3, "three");
+
+	map.removeValue(1);
+	EXPECT_EQ(false, map.containsValue("one"));
+	map.removeByValue("three");
+	EXPECT_EQ(false, map.contains(3));
+	EXPECT_EQ(1, map.size());
+	EXPECT_EQ(2, map.getKey("two"));
+	EXPECT_THROW(map.removeValue(1), KeyError<int>);
+	EXPECT_THROW(map.removeByValue("one"), KeyError<std::string>);
+}
+
+TEST(BiMapTest, replace)
+{
+	BiMap<int, std::string> map;
+	map.addValue(1, "one");
+	map.addValue(2, "two");
+
+	EXPECT_EQ(0, map.replace(1, "one"));
+	EXPECT_EQ(0, map.replace(3, "three"));
+	EXPECT_EQ(1, map.replace(1, "uno"));
+	EXPECT_EQ(false, map.containsValue("one"));
+	EXPECT_EQ(1, map.getKey("uno"));
+
+	// Pairs 1<->uno and 2<->two both give way to 1<->two.
+	EXPECT_EQ(2, map.replace(1, "two"));
+	EXPECT_EQ(2, map.size());
+	EXPECT_EQ("two", map.getValue(1));
+	EXPECT_EQ(false, map.contains(2));
+	EXPECT_EQ(false, map.containsValue("uno"));
+	EXPECT_EQ(3, map.getKey("three"));
+}
+
+TEST(BiMapTest, valuesOnlyChangeThroughReplace)
+{
+	// A value written in place would leave the value index stale.
+	BiMap<int, std::string> map;
+	static_assert(std::is_same<std::string const&,
+		decltype(map.getValue(1))>::value, "values are handed out const");
+
+	map.addValue(1, "one");
+	map.replace(1, "uno");
+	EXPECT_EQ("uno", map.getValue(1));
+	EXPECT_EQ(1, map.getKey("uno"));
+	EXPECT_THROW(map.getKey("one"), KeyError<std::string>);
+}
+
+TEST(BiMapTest, views)
+{
+	BiMap<int, int> map;
+	for (int i = 0; i < 10; ++i)
+		map.addValue(i, i * 10);
+
+	int keySum = 0;
+	for (int key : map.keys())
+		keySum += key;
+	EXPECT_EQ(45, keySum);
+	for (auto item : map.items())
+		EXPECT_EQ(item.key * 10, item.value);
+
+	int valueSum = 0;
+	map.forEach([&](int const&, int const& value) { valueSum += value; });
+	EXPECT_EQ(450, valueSum);
+	EXPECT_EQ(10, map.values().size());
+}
+
+TEST(BiMapTest, matchesReferenceUnderRandomOperations)
+{
+	BiMap<int, int> map;
+	std::map<int, int> forward;
+	std::map<int, int> backward;
+	std::srand(3);
+
+	for (int i = 0; i < 20000; ++i) {
+		int key = std::rand() % 300;
+		int value = std::rand() % 300;
+		int action = std::rand() % 3;
+		if (action == 0) {
+			if (forward.count(key) == 1) {
+				backward.erase(forward[key]);
+				forward.erase(key);
+				map.removeValue(key);
+			}
+		} else if (action == 1) {
+			if (forward.count(key) == 0 && backward.count(value) == 0) {
+				forward[key] = value;
+				backward[value] = key;
+				map.addValue(key, value);
+			}
+		} else {
+			std::size_t displaced = 0;
+			bool paired = forward.count(key) == 1 && forward[key] == value;
+			if (!paired && forward.count(key) == 1) {
+				backward.erase(forward[key]);
+				forward.erase(key);
+				++displaced;
+			}
+			if (!paired && backward.count(value) == 1) {
+				forward.erase(backward[value]);
+				backward.erase(value);
+				++displaced;
+			}
+			forward[key] = value;
+			backward[value] = key;
+			EXPECT_EQ(displaced, map.replace(key, value));
+		}
+	}
+
+	EXPECT_EQ(forward.size(), map.size());
+	for (auto const& pair : forward) {
+		EXPECT_EQ(pair.second, map.getValue(pair.first));
+		EXPECT_EQ(pair.first, map.getKey(pair.second));
+	}
+}
@@ -0,0 +1,202 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/blockingqueue.hpp"
+
+
+TEST(BlockingQueueTest, constructor)
+{
+	BlockingQueue<int> queue{5};
+	EXPECT_EQ(true, queue.isEmpty());
+	EXPECT_EQ(0, queue.size());
+	EXPECT_EQ(8, queue.capacity());
+}
+
+TEST(BlockingQueueTest, fifoOrder)
+{
+	BlockingQueue<std::string> queue{4};
+	queue.push("a");
+	queue.push("b");
+	EXPECT_EQ(true, queue.tryPush("c"));
+
+	EXPECT_EQ("a", queue.pop());
+	std::string value;
+	EXPECT_EQ(true, queue.tryPop(value));
+	EXPECT_EQ("b", value);
+	EXPECT_EQ("c", queue.pop());
+	EXPECT_EQ(true, queue.isEmpty());
+}
+
+TEST(BlockingQueueTest, tryPushFull)
+{
+	BlockingQueue<int> queue{2};
+	EXPECT_EQ(true, queue.tryPush(1));
+	EXPECT_EQ(true, queue.tryPush(2));
+	EXPECT_EQ(false, queue.tryPush(3));
+	EXPECT_EQ(2, queue.size());
+}
+
+TEST(BlockingQueueTest, tryPopEmpty)
+{
+	BlockingQueue<int> queue{2};
+	int value = 0;
+	EXPECT_EQ(false, queue.tryPop(value));
+}
+
+TEST(BlockingQueueTest, timeouts)
+{
+	BlockingQueue<int> queue{2};
+	int value = 0;
+	EXPECT_EQ(false, queue.tryPopFor(value, std::chrono::milliseconds(5)));
+
+	queue.push(1);
+	queue.push(2);
+	EXPECT_EQ(false, queue.tryPushFor(3, std::chrono::milliseconds(5)));
+	EXPECT_EQ(true, queue.tryPopFor(value, std::chrono::milliseconds(5)));
+	EXPECT_EQ(1, value);
+}
+
+TEST(BlockingQueueTest, batches)
+{
+	BlockingQueue<int> queue{8};
+	int values[5] = {1, 2, 3, 4, 5};
+	queue.pushBatch(values, values + 5);
+	EXPECT_EQ(5, queue.size());
+
+	int more[6] = {6, 7, 8, 9, 10, 11};
+	EXPECT_EQ(3, queue.tryPushBatch(more, more + 6));
+
+	int out[10] = {0};
+	EXPECT_EQ(4, queue.popBatch(out, 4));
+	EXPECT_EQ(4, queue.tryPopBatch(out + 4, 10));
+	EXPECT_EQ(0, queue.tryPopBatch(out, 10));
+
+	for (int i = 0; i < 8; ++i)
+		EXPECT_EQ(i + 1, out[i]);
+}
+
+/**
+ * \brief A value whose copies throw when it is negative.
+ */
+struct Fragile
+{
+	Fragile(int value = 0) : value_{value} {}
+
+	Fragile(Fragile const& orig) : value_{orig.value_}
+	{
+		if (value_ < 0)
+			throw std::runtime_error("copy");
+	}
+
+	Fragile(Fragile&& other) noexcept = default;
+
+	Fragile& operator=(Fragile const& rhs)
+	{
+		if (rhs.value_ < 0)
+			throw std::runtime_error("copy");
+		value_ = rhs.value_;
+		return *this;
+	}
+
+	Fragile& operator=(Fragile&& rhs) noexcept = default;
+
+	int value_;
+};
+
+TEST(BlockingQueueTest, throwingBatchClaimsNothing)
+{
+	BlockingQueue<Fragile> queue{8};
+	std::vector<Fragile> values;
+	for (int value : {1, 2, -3, 4})
+		values.emplace_back(value);
+	EXPECT_THROW(queue.pushBatch(values.begin(), values.end()),
+		std::runtime_error);
+	EXPECT_THROW(queue.tryPushBatch(values.begin(), values.end()),
+		std::runtime_error);
+	EXPECT_EQ(0, queue.size());
+
+	// Had slots been claimed and left unpublished, this pop would hang.
+	values[2] = Fragile{3};
+	queue.pushBatch(values.begin(), values.end());
+	Fragile out[4];
+	EXPECT_EQ(4, queue.popBatch(out, 4));
+	for (int i = 0; i < 4; ++i)
+		EXPECT_EQ(i + 1, out[i].value_);
+}
+
+TEST(BlockingQueueTest, pushBlocksUntilPop)
+{
+	BlockingQueue<int> queue{2};
+	queue.push(1);
+	queue.push(2);
+
+	std::thread producer([&]() { queue.push(3); });
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	EXPECT_EQ(1, queue.pop());
+	producer.join();
+
+	EXPECT_EQ(2, queue.pop());
+	EXPECT_EQ(3, queue.pop());
+}
+
+TEST(BlockingQueueTest, multipleProducersAndConsumers)
+{
+	const int perProducer = 5000;
+	const int producers = 3;
+	const int consumers = 3;
+	const int total = perProducer * producers;
+	BlockingQueue<int> queue{16};
+	std::vector<std::atomic<int>> seen(total);
+	for (auto& count : seen)
+		count.store(0);
+	std::atomic<int> consumed{0};
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; ++p) {
+		threads.emplace_back([&, p]() {
+			int batch[4];
+			int i = 0;
+			while (i < perProducer) {
+				if (i % 2 == 0 && i + 4 <= perProducer) {
+					for (int j = 0; j < 4; ++j)
+						batch[j] = p * perProducer + i + j;
+					queue.pushBatch(batch, batch + 4);
+					i += 4;
+				} else {
+					queue.push(p * perProducer + i);
+					++i;
+				}
+			}
+		});
+	}
+	for (int c = 0; c < consumers; ++c) {
+		threads.emplace_back([&]() {
+			int batch[8];
+			int value;
+			while (consumed.load() < total) {
+				std::size_t n = queue.tryPopBatch(batch, 8);
+				for (std::size_t j = 0; j < n; ++j)
+					seen[batch[j]].fetch_add(1);
+				consumed.fetch_add(static_cast<int>(n));
+				if (n == 0 && queue.tryPopFor(
+						value, std::chrono::milliseconds(1))) {
+					seen[value].fetch_add(1);
+					consumed.fetch_add(1);
+				}
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	for (int i = 0; i < total; ++i)
+		EXPECT_EQ(1, seen[i].load());
+}
@@ -0,0 +1,82 @@
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+#include "../structures/bloomfilter.hpp"
+
+
+TEST(BloomFilterTest, constructor)
+{
+	BloomFilter<int> filter{1000};
+	EXPECT_EQ(0, filter.size());
+	EXPECT_EQ(1000, filter.capacity());
+	EXPECT_EQ(0.01, filter.falsePositiveRate());
+	EXPECT_EQ(0, filter.bitCount() % 512);
+	EXPECT_EQ(false, filter.mayContain(1));
+
+	// Without a capacity nothing can be ruled out.
+	BloomFilter<int> empty;
+	EXPECT_EQ(0, empty.bitCount());
+	EXPECT_EQ(true, empty.mayContain(1));
+	empty.add(1);
+	EXPECT_EQ(1, empty.size());
+}
+
+TEST(BloomFilterTest, rateIsClamped)
+{
+	BloomFilter<int> loose{10, 0.9};
+	EXPECT_EQ(0.5, loose.falsePositiveRate());
+	BloomFilter<int> tight{10, 0};
+	EXPECT_EQ(0.0001, tight.falsePositiveRate());
+}
+
+TEST(BloomFilterTest, noFalseNegatives)
+{
+	BloomFilter<std::string> filter{5000};
+	for (int i = 0; i < 5000; ++i)
+		filter.add(std::to_string(i));
+	for (int i = 0; i < 5000; ++i)
+		EXPECT_EQ(true, filter.mayContain(std::to_string(i)));
+	EXPECT_EQ(5000, filter.size());
+}
+
+TEST(BloomFilterTest, falsePositiveRateIsMet)
+{
+	const double rates[] = {0.1, 0.01, 0.001};
+	for (double rate : rates) {
+		BloomFilter<int> filter{20000, rate};
+		for (int i = 0; i < 20000; ++i)
+			filter.add(i * 3);
+
+		int falsePositives = 0;
+		const int trials = 200000;
+		for (int i = 0; i < trials; ++i)
+			falsePositives += filter.mayContain(-1 - i);
+		EXPECT_LE(static_cast<double>(falsePositives) / trials, rate);
+	}
+}
+
+TEST(BloomFilterTest, copyMoveAndClear)
+{
+	BloomFilter<int> filter{100};
+	for (int i = 0; i < 100; ++i)
+		filter.add(i);
+
+	BloomFilter<int> copy{filter};
+	filter.clear();
+	EXPECT_EQ(0, filter.size());
+	EXPECT_EQ(false, filter.mayContain(5));
+	EXPECT_EQ(100, copy.size());
+	for (int i = 0; i < 100; ++i)
+		EXPECT_EQ(true, copy.mayContain(i));
+
+	BloomFilter<int> moved{std::move(copy)};
+	EXPECT_EQ(true, moved.mayContain(42));
+	EXPECT_EQ(0, copy.bitCount());
+
+	copy = moved;
+	EXPECT_EQ(true, copy.mayContain(42));
+	EXPECT_EQ(moved.bitCount(), copy.bitCount());
+}
@@ -0,0 +1,404 @@
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/btreemap.hpp"
+#include "../exceptions.hpp"
+#include "countedkey.hpp"
+#include "countingallocator.hpp"
+
+
+TEST(BTreeMapTest, constructor)
+{
+	BTreeMap<int, std::string> map;
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(0, map.height());
+	EXPECT_EQ(true, map.begin() == map.end());
+}
+
+TEST(BTreeMapTest, copyAndMove)
+{
+	BTreeMap<int, std::string> map;
+	for (int i = 0; i < 1000; ++i)
+		map.addValue(i, std::to_string(i));
+
+	BTreeMap<int, std::string> copy{map};
+	map.removeValue(5);
+	EXPECT_EQ(1000, copy.size());
+	EXPECT_EQ("5", copy.getValue(5));
+
+	BTreeMap<int, std::string> moved{std::move(copy)};
+	EXPECT_EQ(1000, moved.size());
+	EXPECT_EQ(0, copy.size());
+
+	copy = moved;
+	EXPECT_EQ(1000, copy.size());
+	EXPECT_EQ("999", copy.getValue(999));
+}
+
+TEST(BTreeMapTest, addGetRemove)
+{
+	BTreeMap<int, std::string> map;
+	map.addValue(2, "two");
+	map.addValue(1, "one");
+	EXPECT_THROW(map.addValue(1, "uno"), KeyError<int>);
+	EXPECT_EQ("one", map.getValue(1));
+
+	map.getValue(2) = "deux";
+	EXPECT_EQ("deux", map.getValue(2));
+
+	map.removeValue(1);
+	EXPECT_EQ(false, map.contains(1));
+	EXPECT_THROW(map.getValue(1), KeyError<int>);
+	EXPECT_THROW(map.removeValue(1), KeyError<int>);
+
+	map.removeValue(2);
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(0, map.height());
+}
+
+TEST(BTreeMapTest, numbersConvertToTheKey)
+{
+	// Enough keys for several levels, looked up by int.
+	BTreeMap<std::size_t, int> map;
+	for (int i = 0; i < 2000; ++i)
+		map.addValue(i * 2, i);
+	for (int i = 0; i < 2000; ++i) {
+		ASSERT_EQ(i, map.getValue(i * 2));
+		ASSERT_EQ(false, map.contains(i * 2 + 1));
+	}
+	EXPECT_THROW(map.getValue(1), KeyError<std::size_t>);
+}
+
+TEST(BTreeMapTest, stringLookupBuildsNoKey)
+{
+	// Long keys, so each one allocates, over more than one leaf.
+	BTreeMap<CountedString, int> map;
+	std::string prefix(40, 'k');
+	for (int i = 0; i < 100; ++i)
+		map.addValue((prefix + std::to_string(i)).c_str(), i);
+
+	std::string hit = prefix + "42";
+	std::string miss = prefix + "420";
+	std::size_t before = CountingAllocator<char>::allocations();
+	EXPECT_EQ(42, map.getValue(hit.c_str()));
+	EXPECT_EQ(false, map.contains(miss.c_str()));
+	EXPECT_THROW(map.getValue(miss.c_str()), KeyError<CountedString>);
+	EXPECT_EQ(before, CountingAllocator<char>::allocations());
+}
+
+TEST(BTreeMapTest, updatesDescendOnce)
+{
+	BTreeMap<CountedKey, int> map;
+	for (int i = 0; i < 5000; ++i)
+		map.addValue(CountedKey{i * 2}, i);
+
+	// An update costs what a lookup of the same key costs, even when the
+	// miss splits a full leaf.
+	for (int key : {0, 1, 4001, 9998, 9999}) {
+		CountedKey::comparisons() = 0;
+		bool present = map.contains(CountedKey{key});
+		std::size_t lookup = CountedKey::comparisons();
+		CountedKey::comparisons() = 0;
+		EXPECT_EQ(!present, map.tryEmplace(CountedKey{key}, -key).second);
+		EXPECT_EQ(lookup, CountedKey::comparisons());
+	}
+	EXPECT_EQ(5003, map.size());
+	EXPECT_EQ(-4001, map.getValue(CountedKey{4001}));
+}
+
+TEST(BTreeMapTest, tryEmplaceLeavesArgsOnHit)
+{
+	BTreeMap<int, std::unique_ptr<int>> map;
+	for (int i = 0; i < 100; ++i)
+		map.tryEmplace(i, std::unique_ptr<int>{new int(i)});
+
+	std::unique_ptr<int> spare{new int(-1)};
+	EXPECT_EQ(false, map.tryEmplace(50, std::move(spare)).second);
+	ASSERT_NE(nullptr, spare);
+	EXPECT_EQ(-1, *spare);
+	EXPECT_EQ(50, *map.getValue(50));
+}
+
+TEST(BTreeMapTest, matchesReferenceUnderRandomOperations)
+{
+	// std::string keys give the narrowest nodes, so the tree grows deep
+	// enough to split and merge inner nodes.
+	BTreeMap<std::string, int> map;
+	std::map<std::string, int> reference;
+	std::srand(7);
+
+	for (int i = 0; i < 40000; ++i) {
+		int number = std::rand() % 4000;
+		std::string key = std::to_string(number);
+		if (std::rand() % 5 < 3) {
+			if (reference.count(key) == 0) {
+				reference[key] = number;
+				map.addValue(key, number);
+			}
+		} else if (reference.count(key) == 1) {
+			reference.erase(key);
+			map.removeValue(key);
+		}
+	}
+	EXPECT_LE(3, map.height());
+	EXPECT_EQ(reference.size(), map.size());
+
+	auto expected = reference.begin();
+	for (auto item : map) {
+		EXPECT_EQ(expected->first, item.key);
+		EXPECT_EQ(expected->second, item.value);
+		++expected;
+	}
+	EXPECT_EQ(true, expected == reference.end());
+
+	for (auto const& pair : reference)
+		map.removeValue(pair.first);
+	EXPECT_EQ(true, map.isEmpty());
+}
+
+TEST(BTreeMapTest, bulkLoad)
+{
+	std::vector<std::pair<int, int>> pairs;
+	for (int i = 0; i < 100000; ++i)
+		pairs.push_back(std::make_pair(i * 2, i));
+
+	BTreeMap<int, int> map;
+	map.addValue(-1, -1);
+	map.bulkLoad(pairs.begin(), pairs.end());
+	EXPECT_EQ(100000, map.size());
+	EXPECT_EQ(false, map.contains(-1));
+	EXPECT_EQ(false, map.contains(3));
+	EXPECT_EQ(4321, map.getValue(8642));
+
+	int expected = 0;
+	for (int key : map.keys()) {
+		EXPECT_EQ(expected, key);
+		expected += 2;
+	}
+
+	// The loaded tree must take further updates.
+	for (int i = 0; i < 100000; i += 3)
+		map.removeValue(i * 2);
+	for (int i = 0; i < 1000; ++i)
+		map.addValue(i * 2 + 1, 0);
+	EXPECT_EQ(100000 - 33334 + 1000, map.size());
+}
+
+TEST(BTreeMapTest, bulkLoadRejectsUnsortedInput)
+{
+	BTreeMap<int, int> map;
+	map.addValue(1, 1);
+	std::vector<std::pair<int, int>> unsorted{{1, 1}, {3, 3}, {2, 2}};
+	std::vector<std::pair<int, int>> duplicated{{1, 1}, {1, 2}};
+	EXPECT_THROW(map.bulkLoad(unsorted.begin(), unsorted.end()),
+		KeyError<int>);
+	EXPECT_THROW(map.bulkLoad(duplicated.begin(), duplicated.end()),
+		KeyError<int>);
+	EXPECT_EQ(1, map.size());
+	EXPECT_EQ(1, map.getValue(1));
+}
+
+TEST(BTreeMapTest, insertBatch)
+{
+	std::vector<std::pair<int, int>> pairs;
+	for (int i = 0; i < 1000; ++i)
+		pairs.push_back(std::make_pair((i * 7919) % 500, i));
+	BTreeMap<int, int> map(pairs.begin(), pairs.end());
+
+	// Each key's last pair wins.
+	EXPECT_EQ(500, map.size());
+	for (auto const& pair : pairs)
+		EXPECT_EQ(true, map.contains(pair.first));
+	for (std::size_t i = 500; i < pairs.size(); ++i)
+		EXPECT_EQ(pairs[i].second, map.getValue(pairs[i].first));
+
+	std::pair<int, int> more[3] = {
+		std::make_pair(-1, 1), std::make_pair(0, 2), std::make_pair(-1, 3)};
+	map.insertBatch(more, more + 3);
+	EXPECT_EQ(501, map.size());
+	EXPECT_EQ(3, map.getValue(-1));
+	EXPECT_EQ(2, map.getValue(0));
+	EXPECT_EQ(pairs[999].second, map.getValue(pairs[999].first));
+
+	map.insertBatch(more, more);
+	EXPECT_EQ(501, map.size());
+
+	// A batch this large next to the map rebuilds it, moving its pairs.
+	BTreeMap<int, std::string> words;
+	for (int i = 0; i < 300; i += 2)
+		words.addValue(i, std::to_string(i));
+	std::vector<std::pair<int, std::string>> odd;
+	for (int i = 1; i < 300; i += 4)
+		odd.push_back(std::make_pair(i, "odd"));
+	odd.push_back(std::make_pair(4, "four"));
+	words.insertBatch(odd.begin(), odd.end());
+	EXPECT_EQ(225, words.size());
+	EXPECT_EQ("four", words.getValue(4));
+	EXPECT_EQ("odd", words.getValue(297));
+	EXPECT_EQ("298", words.getValue(298));
+	int previous = -1;
+	for (int key : words.keys()) {
+		EXPECT_LT(previous, key);
+		EXPECT_NE(3, key % 4);
+		previous = key;
+	}
+}
+
+TEST(BTreeMapTest, insertBatchSmallGoesPairByPair)
+{
+	BTreeMap<CountedKey, int> map;
+	for (int i = 0; i < 3200; ++i)
+		map.addValue(CountedKey{i * 2}, i);
+	std::vector<std::pair<CountedKey, int>> pairs;
+	for (int i = 0; i <= 10; ++i)
+		pairs.push_back(std::make_pair(CountedKey{i * 640 + 1}, -i));
+	pairs.push_back(std::make_pair(CountedKey{642}, 7));
+	pairs.push_back(std::make_pair(CountedKey{1}, 8));
+
+	// The last pair sorts after every present key, so rebuilding would
+	// compare each of them on the merge; a descent per pair, scanning each
+	// node's keys, compares under half as many.
+	CountedKey::comparisons() = 0;
+	map.insertBatch(pairs.begin(), pairs.end());
+	EXPECT_GT(1600u, CountedKey::comparisons());
+	EXPECT_EQ(3211, map.size());
+	EXPECT_EQ(7, map.getValue(CountedKey{642}));
+	EXPECT_EQ(8, map.getValue(CountedKey{1}));
+	EXPECT_EQ(-9, map.getValue(CountedKey{5761}));
+	int previous = -1;
+	for (CountedKey const& key : map.keys()) {
+		EXPECT_LT(previous, key.value_);
+		previous = key.value_;
+	}
+}
+
+/**
+ * \brief An int whose copies and moves throw, once armed, for the value
+ *        marked -1.
+ */
+struct Brittle
+{
+	static bool armed;
+
+	Brittle(int value = 0) : value_{value}
+	{
+	}
+
+	Brittle(Brittle const& other) : value_{other.value_}
+	{
+		check();
+	}
+
+	Brittle& operator=(Brittle const& other)
+	{
+		value_ = other.value_;
+		check();
+		return *this;
+	}
+
+	void check() const
+	{
+		if (armed && value_ == -1)
+			throw std::runtime_error("brittle");
+	}
+
+	int value_;
+};
+
+bool Brittle::armed = false;
+
+TEST(BTreeMapTest, insertBatchEmptiesOnThrow)
+{
+	BTreeMap<int, Brittle> map;
+	for (int i = 0; i < 100; ++i)
+		map.addValue(i, Brittle{i == 50 ? -1 : i});
+	std::vector<std::pair<int, Brittle>> pairs;
+	for (int i = 100; i < 200; ++i)
+		pairs.push_back(std::make_pair(i, Brittle{i}));
+
+	// The rebuild moves the pairs out of the leaves before it can fail, so
+	// a throw leaves nothing to restore.
+	Brittle::armed = true;
+	EXPECT_THROW(map.insertBatch(pairs.begin(), pairs.end()),
+		std::runtime_error);
+	Brittle::armed = false;
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(false, map.contains(0));
+
+	map.insertBatch(pairs.begin(), pairs.end());
+	EXPECT_EQ(100, map.size());
+	EXPECT_EQ(150, map.getValue(150).value_);
+}
+
+TEST(BTreeMapTest, lowerBound)
+{
+	BTreeMap<int, int> map;
+	for (int i = 0; i < 1000; ++i)
+		map.addValue(i * 10, i);
+
+	EXPECT_EQ(0, (*map.lowerBound(-5)).key);
+	EXPECT_EQ(500, (*map.lowerBound(500)).key);
+	EXPECT_EQ(510, (*map.lowerBound(501)).key);
+	EXPECT_EQ(true, map.lowerBound(9991) == map.end());
+
+	BTreeMap<int, int> const& constMap = map;
+	EXPECT_EQ(51, (*constMap.lowerBound(505)).value);
+}
+
+TEST(BTreeMapTest, range)
+{
+	BTreeMap<int, int> map;
+	for (int i = 0; i < 1000; ++i)
+		map.addValue(i, i);
+
+	auto middle = map.range(100, 600);
+	EXPECT_EQ(500, middle.size());
+	int expected = 100;
+	for (auto item : middle)
+		EXPECT_EQ(expected++, item.key);
+	EXPECT_EQ(600, expected);
+
+	EXPECT_EQ(1000, map.range(-100, 5000).size());
+	EXPECT_EQ(0, map.range(600, 100).size());
+	EXPECT_EQ(true, map.range(2000, 3000).isEmpty());
+
+	for (auto item : map.range(0, 10))
+		item.value = -1;
+	BTreeMap<int, int> const& constMap = map;
+	int sum = 0;
+	for (auto item : constMap.range(0, 20))
+		sum += item.value;
+	EXPECT_EQ(-10 + 145, sum);
+}
+
+TEST(BTreeMapTest, viewsAndForEach)
+{
+	BTreeMap<int, int> map;
+	for (int i = 9; i >= 0; --i)
+		map.addValue(i, i * 10);
+
+	int previous = -1;
+	for (int key : map.keys()) {
+		EXPECT_LT(previous, key);
+		previous = key;
+	}
+	for (int& value : map.values())
+		value += 1;
+	int sum = 0;
+	map.forEach([&](int const& key, int const& value) {
+		EXPECT_EQ(key * 10 + 1, value);
+		sum += value;
+	});
+	EXPECT_EQ(460, sum);
+	EXPECT_EQ(10, map.items().size());
+}
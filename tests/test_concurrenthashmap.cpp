@@ -0,0 +1,163 @@
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/concurrenthashmap.hpp"
+#include "../exceptions.hpp"
+
+
+TEST(ConcurrentHashMapTest, constructor)
+{
+	ConcurrentHashMap<int, int> map{10};
+	EXPECT_EQ(16, map.shardCount());
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(false, map.contains(1));
+}
+
+TEST(ConcurrentHashMapTest, mapOperations)
+{
+	ConcurrentHashMap<std::string, int> map;
+	map.addValue("one", 1);
+	map.addValue("two", 2);
+	EXPECT_THROW(map.addValue("one", 11), KeyError<std::string>);
+
+	EXPECT_EQ(2, map.size());
+	EXPECT_EQ(1, map.getValue("one"));
+	EXPECT_THROW(map.getValue("three"), KeyError<std::string>);
+
+	map.removeValue("one");
+	EXPECT_EQ(false, map.contains("one"));
+	EXPECT_THROW(map.removeValue("one"), KeyError<std::string>);
+	EXPECT_EQ(1, map.size());
+}
+
+TEST(ConcurrentHashMapTest, find)
+{
+	ConcurrentHashMap<int, std::string> map;
+	map.addValue(5, "hello");
+
+	std::string value = "unchanged";
+	EXPECT_EQ(false, map.find(6, value));
+	EXPECT_EQ("unchanged", value);
+	EXPECT_EQ(true, map.find(5, value));
+	EXPECT_EQ("hello", value);
+}
+
+TEST(ConcurrentHashMapTest, insertOrAssign)
+{
+	ConcurrentHashMap<int, int> map;
+	EXPECT_EQ(true, map.insertOrAssign(1, 10));
+	EXPECT_EQ(false, map.insertOrAssign(1, 20));
+	EXPECT_EQ(20, map.getValue(1));
+	EXPECT_EQ(1, map.size());
+}
+
+TEST(ConcurrentHashMapTest, computeIfAbsent)
+{
+	ConcurrentHashMap<int, int> map;
+	int calls = 0;
+	auto square = [&](int key) { ++calls; return key * key; };
+
+	EXPECT_EQ(49, map.computeIfAbsent(7, square));
+	EXPECT_EQ(49, map.computeIfAbsent(7, square));
+	EXPECT_EQ(1, calls);
+	EXPECT_EQ(1, map.size());
+}
+
+TEST(ConcurrentHashMapTest, forEach)
+{
+	ConcurrentHashMap<int, int> map{4};
+	for (int i = 0; i < 100; ++i)
+		map.addValue(i, i * 2);
+
+	int sum = 0;
+	std::size_t count = 0;
+	map.forEach([&](int const& key, int const& value) {
+		EXPECT_EQ(key * 2, value);
+		sum += key;
+		++count;
+	});
+	EXPECT_EQ(100, count);
+	EXPECT_EQ(99 * 100 / 2, sum);
+}
+
+TEST(ConcurrentHashMapTest, concurrentDisjointWriters)
+{
+	const int threads = 4;
+	const int perThread = 2000;
+	ConcurrentHashMap<int, int> map{8};
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; ++t)
+		workers.emplace_back([&, t]() {
+			for (int i = 0; i < perThread; ++i)
+				map.addValue(t * perThread + i, t);
+			for (int i = 0; i < perThread; i += 2)
+				map.removeValue(t * perThread + i);
+		});
+	for (std::thread& worker : workers)
+		worker.join();
+
+	EXPECT_EQ(threads * perThread / 2, map.size());
+	for (int t = 0; t < threads; ++t)
+		for (int i = 0; i < perThread; ++i)
+			EXPECT_EQ(i % 2 == 1, map.contains(t * perThread + i));
+}
+
+TEST(ConcurrentHashMapTest, computeIfAbsentKeepsOneValuePerKey)
+{
+	const int threads = 4;
+	const int keys = 500;
+	ConcurrentHashMap<int, int> map;
+	std::atomic<int> calls{0};
+
+	// Each thread computes its own value, so every caller seeing the same
+	// one shows that a single value was stored.
+	std::vector<std::vector<int>> seen(threads, std::vector<int>(keys));
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; ++t)
+		workers.emplace_back([&, t]() {
+			for (int key = 0; key < keys; ++key)
+				seen[t][key] = map.computeIfAbsent(key, [&](int k) {
+					calls.fetch_add(1);
+					return k * threads + t;
+				});
+		});
+	for (std::thread& worker : workers)
+		worker.join();
+
+	EXPECT_LE(keys, calls.load());
+	EXPECT_EQ(keys, map.size());
+	for (int key = 0; key < keys; ++key) {
+		int value = map.getValue(key);
+		EXPECT_EQ(key, value / threads);
+		for (int t = 0; t < threads; ++t)
+			EXPECT_EQ(value, seen[t][key]);
+	}
+}
+
+TEST(ConcurrentHashMapTest, readersSeeWholeValues)
+{
+	ConcurrentHashMap<int, std::string> map{2};
+	map.addValue(0, std::string(64, 'a'));
+	std::atomic<bool> done{false};
+
+	std::thread writer([&]() {
+		for (int i = 0; i < 2000; ++i)
+			map.insertOrAssign(0, std::string(64, i % 2 == 0 ? 'b' : 'a'));
+		done.store(true);
+	});
+
+	std::string value;
+	while (!done.load()) {
+		ASSERT_EQ(true, map.find(0, value));
+		EXPECT_EQ(std::string(64, value[0]), value);
+		std::this_thread::yield();
+	}
+	writer.join();
+}
@@ -235,6 +235,44 @@ TEST(DequeTest, removeSpecificNonEmptyList)
 	EXPECT_EQ(4, list[2]);
 }
 
+TEST(DequeTest, removeSpecificEnds)
+{
+	int initarray[3] = {1, 2, 3};
+	Deque<int> list(initarray, 3);
+	list.remove(2);
+	EXPECT_EQ(2, list.getTail());
+	list.remove(0);
+	EXPECT_EQ(2, list.getHead());
+	list.remove(0);
+	EXPECT_EQ(true, list.isEmpty());
+}
+
+TEST(DequeTest, removeTailEmptyList)
+{
+	Deque<int> list;
+
+	EXPECT_THROW(list.removeTail(), IndexOutOfBoundsException);
+}
+
+TEST(DequeTest, removeTailNonEmptyList)
+{
+	int initarray[3] = {1, 2, 3};
+	Deque<int> list(initarray, 3);
+	list.removeTail();
+	EXPECT_EQ(2, list.size());
+	EXPECT_EQ(2, list.getTail());
+
+	list.removeTail();
+	list.removeTail();
+	EXPECT_EQ(true, list.isEmpty());
+	EXPECT_THROW(list.getHead(), IndexOutOfBoundsException);
+	EXPECT_THROW(list.getTail(), IndexOutOfBoundsException);
+
+	list.append(4);
+	EXPECT_EQ(4, list.getHead());
+	EXPECT_EQ(4, list.getTail());
+}
+
 TEST(DequeTest, removeOutOfRange) 
 {
 	int initarray[5] = {1, 2, 3, 4, 5};
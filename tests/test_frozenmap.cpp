@@ -0,0 +1,98 @@
+#include <cstddef>
+#include <ostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/frozenmap.hpp"
+#include "../exceptions.hpp"
+
+
+enum class Colour { Red, Green, Blue, Cyan, Magenta, Yellow };
+
+std::ostream& operator<<(std::ostream& out, Colour colour)
+{
+	return out << static_cast<int>(colour);
+}
+
+constexpr auto colourNames = makeFrozenMap<Colour, char const*>({
+	{Colour::Red, "red"}, {Colour::Green, "green"}, {Colour::Blue, "blue"},
+	{Colour::Cyan, "cyan"}, {Colour::Magenta, "magenta"},
+	{Colour::Yellow, "yellow"}});
+
+constexpr FrozenMap<char const*, int, 8> commands{
+	{"add", 1}, {"commit", 2}, {"diff", 3}, {"log", 4},
+	{"merge", 5}, {"pull", 6}, {"push", 7}, {"status", 8}};
+
+// Both tables, and lookups in them, are constant expressions.
+static_assert(colourNames.size() == 6, "six colours");
+static_assert(colourNames.contains(Colour::Cyan), "cyan is present");
+static_assert(commands.getValue("push") == 7, "push is command 7");
+static_assert(!commands.contains("rebase"), "rebase is absent");
+static_assert(*commands.find("status") == 8, "status is command 8");
+
+TEST(FrozenMapTest, constantLookups)
+{
+	EXPECT_EQ(std::string{"magenta"}, colourNames.getValue(Colour::Magenta));
+	EXPECT_EQ(6, colourNames.size());
+	EXPECT_EQ(false, colourNames.isEmpty());
+
+	// A key built at runtime, so that lookups compare characters.
+	std::string diff{"diff"};
+	EXPECT_EQ(3, commands.getValue(diff.c_str()));
+	EXPECT_EQ(nullptr, commands.find("dif"));
+	EXPECT_THROW(commands.getValue("blame"), KeyError<char const*>);
+}
+
+TEST(FrozenMapTest, runtimeConstruction)
+{
+	FrozenMap<int, int, 3> map{{10, 1}, {20, 2}, {30, 3}};
+	EXPECT_EQ(2, map.getValue(20));
+	EXPECT_EQ(false, map.contains(40));
+
+	auto build = [](std::initializer_list<std::pair<int, int>> pairs) {
+		return FrozenMap<int, int, 3>{pairs};
+	};
+	EXPECT_THROW(build({{1, 1}, {2, 2}}), IndexOutOfBoundsException);
+	EXPECT_THROW(build({{1, 1}, {2, 2}, {1, 3}}), KeyError<int>);
+}
+
+TEST(FrozenMapTest, everyKeyFindsItsOwnSlot)
+{
+	std::pair<int, int> pairs[1000];
+	for (int i = 0; i < 1000; ++i)
+		pairs[i] = std::make_pair(i * 7919, i);
+	auto map = makeFrozenMap(pairs);
+
+	for (int i = 0; i < 1000; ++i) {
+		EXPECT_EQ(i, map.getValue(i * 7919));
+		EXPECT_EQ(false, map.contains(i * 7919 + 1));
+	}
+
+	std::set<int> seen;
+	for (auto item : map.items()) {
+		EXPECT_EQ(item.key, item.value * 7919);
+		seen.insert(item.value);
+	}
+	EXPECT_EQ(1000u, seen.size());
+}
+
+TEST(FrozenMapTest, viewsAndForEach)
+{
+	std::set<std::string> names;
+	for (char const* name : colourNames.values())
+		names.insert(name);
+	EXPECT_EQ((std::set<std::string>{"blue", "cyan", "green", "magenta",
+		"red", "yellow"}), names);
+
+	int total = 0;
+	commands.forEach([&](char const* name, int id) {
+		EXPECT_EQ(id, commands.getValue(name));
+		total += id;
+	});
+	EXPECT_EQ(36, total);
+	EXPECT_EQ(8, commands.keys().size());
+}
@@ -0,0 +1,367 @@
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/hashmap.hpp"
+#include "../exceptions.hpp"
+
+
+/**
+ * \brief Sends every key to the same home slot to exercise long probe runs.
+ */
+struct CollidingHash
+{
+	std::size_t operator()(int) const { return 42; }
+};
+
+TEST(HashMapTest, constructor)
+{
+	HashMap<int, std::string> map;
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(0, map.capacity());
+	EXPECT_EQ(false, map.contains(1));
+}
+
+TEST(HashMapTest, reservingConstructor)
+{
+	HashMap<int, int> map{100};
+	EXPECT_EQ(128, map.capacity());
+	for (int i = 0; i < 100; ++i)
+		map.addValue(i, i);
+	EXPECT_EQ(128, map.capacity());
+}
+
+TEST(HashMapTest, copyConstructor)
+{
+	HashMap<int, std::string> map;
+	map.addValue(5, "hello");
+	HashMap<int, std::string> copy{map};
+
+	EXPECT_EQ(copy.size(), map.size());
+	EXPECT_EQ("hello", copy.getValue(5));
+	map.addValue(6, "hi");
+	EXPECT_NE(copy.size(), map.size());
+	EXPECT_EQ(false, copy.contains(6));
+}
+
+TEST(HashMapTest, moveConstructor)
+{
+	HashMap<int, std::string> map;
+	map.addValue(5, "hello");
+	HashMap<int, std::string> moved{std::move(map)};
+
+	EXPECT_EQ(1, moved.size());
+	EXPECT_EQ("hello", moved.getValue(5));
+}
+
+TEST(HashMapTest, assignment)
+{
+	HashMap<int, std::string> map;
+	map.addValue(5, "hello");
+	HashMap<int, std::string> result;
+	result = map;
+
+	EXPECT_EQ(result.size(), map.size());
+	map.addValue(6, "hi");
+	EXPECT_NE(result.size(), map.size());
+}
+
+TEST(HashMapTest, swap)
+{
+	HashMap<int, std::string> map1;
+	map1.addValue(5, "hello");
+	HashMap<int, std::string> map2;
+	map2.addValue(6, "hi");
+	map2.addValue(7, "bye");
+
+	swap(map1, map2);
+	EXPECT_EQ(2, map1.size());
+	EXPECT_EQ(1, map2.size());
+}
+
+TEST(HashMapTest, addValuePresent)
+{
+	HashMap<int, std::string> map;
+	map.addValue(5, "hello");
+	EXPECT_THROW(map.addValue(5, "goodbye"), KeyError<int>);
+	EXPECT_EQ("hello", map.getValue(5));
+}
+
+TEST(HashMapTest, getValue)
+{
+	HashMap<std::string, int> map;
+	map.addValue("one", 1);
+	map.addValue("two", 2);
+
+	EXPECT_EQ(1, map.getValue("one"));
+	map.getValue("two") = 22;
+	EXPECT_EQ(22, map.getValue("two"));
+	EXPECT_THROW(map.getValue("three"), KeyError<std::string>);
+}
+
+TEST(HashMapTest, find)
+{
+	HashMap<int, std::string> map;
+	map.addValue(5, "hello");
+
+	std::string* value = map.find(5);
+	ASSERT_NE(nullptr, value);
+	*value = "goodbye";
+	EXPECT_EQ("goodbye", map.getValue(5));
+	EXPECT_EQ(nullptr, map.find(6));
+}
+
+TEST(HashMapTest, heterogeneousLookup)
+{
+	EXPECT_EQ(StringHash()(std::string("a key past eight bytes")),
+		StringHash()("a key past eight bytes"));
+
+	HashMap<std::string, int, StringHash, StringEqual> map;
+	map.addValue("one", 1);
+	map.addValue("a key past eight bytes", 2);
+
+	// C strings are hashed and compared as they are.
+	EXPECT_EQ(1, map.getValue("one"));
+	EXPECT_EQ(true, map.contains("a key past eight bytes"));
+	EXPECT_EQ(false, map.contains("two"));
+	ASSERT_NE(nullptr, map.find("one"));
+	*map.find("one") = 11;
+	EXPECT_EQ(11, map.getValue(std::string("one")));
+	EXPECT_THROW(map.getValue("two"), KeyError<std::string>);
+}
+
+/**
+ * \brief std::hash<int>, counting its calls.
+ */
+struct CountingHash
+{
+	static std::size_t calls;
+
+	std::size_t operator()(int key) const
+	{
+		++calls;
+		return std::hash<int>()(key);
+	}
+};
+
+std::size_t CountingHash::calls = 0;
+
+TEST(HashMapTest, updatesHashOnce)
+{
+	// With room reserved, no rehash adds calls of its own.
+	HashMap<int, int, CountingHash> map{100};
+	CountingHash::calls = 0;
+	EXPECT_EQ(true, map.insertOrAssign(1, 10));
+	EXPECT_EQ(false, map.insertOrAssign(1, 11));
+	EXPECT_EQ(true, map.tryEmplace(2, 20).second);
+	EXPECT_EQ(false, map.tryEmplace(2, 22).second);
+	EXPECT_EQ(3, map.upsert(3, [](int& value) { value += 3; }));
+	EXPECT_EQ(12, map.upsert(1, [](int& value) { ++value; }));
+	EXPECT_EQ(6, CountingHash::calls);
+	EXPECT_EQ(20, map.getValue(2));
+}
+
+TEST(HashMapTest, tryEmplaceLeavesArgsOnHit)
+{
+	HashMap<std::string, std::unique_ptr<int>> map;
+	std::unique_ptr<int> first{new int(1)};
+	EXPECT_EQ(true, map.tryEmplace("key", std::move(first)).second);
+	EXPECT_EQ(nullptr, first);
+
+	std::unique_ptr<int> second{new int(2)};
+	std::pair<std::unique_ptr<int>&, bool> hit =
+		map.tryEmplace("key", std::move(second));
+	EXPECT_EQ(false, hit.second);
+	ASSERT_NE(nullptr, second);
+	EXPECT_EQ(2, *second);
+	EXPECT_EQ(1, *hit.first);
+}
+
+TEST(HashMapTest, insertBatchGrowsOnce)
+{
+	HashMap<int, int, CountingHash> map;
+	for (int i = 0; i < 10; ++i)
+		map.addValue(i, i);
+	std::vector<std::pair<int, int>> pairs;
+	for (int i = 5; i < 1005; ++i)
+		pairs.push_back(std::make_pair(i, -i));
+	pairs.push_back(std::make_pair(5, 5));
+
+	// Each pair hashes once, and the single rehash hashes the ten pairs
+	// already present; growing step by step would rehash them every time.
+	std::size_t before = map.capacity();
+	CountingHash::calls = 0;
+	map.insertBatch(pairs.begin(), pairs.end());
+	EXPECT_LT(before, map.capacity());
+	EXPECT_EQ(pairs.size() + 10, CountingHash::calls);
+	EXPECT_EQ(1005, map.size());
+	EXPECT_EQ(0, map.getValue(0));
+	EXPECT_EQ(5, map.getValue(5));
+	EXPECT_EQ(-1004, map.getValue(1004));
+
+	// A batch that fits does not grow the table at all.
+	before = map.capacity();
+	CountingHash::calls = 0;
+	map.insertBatch(pairs.begin(), pairs.begin() + 100);
+	EXPECT_EQ(before, map.capacity());
+	EXPECT_EQ(100, CountingHash::calls);
+	EXPECT_EQ(-5, map.getValue(5));
+}
+
+TEST(HashMapTest, removeValue)
+{
+	HashMap<int, std::string> map;
+	map.addValue(5, "hello");
+	map.addValue(6, "hi");
+	map.removeValue(5);
+
+	EXPECT_EQ(1, map.size());
+	EXPECT_EQ(false, map.contains(5));
+	EXPECT_EQ(true, map.contains(6));
+	EXPECT_THROW(map.removeValue(5), KeyError<int>);
+}
+
+TEST(HashMapTest, growsAndKeepsEverything)
+{
+	HashMap<int, int> map;
+	for (int i = 0; i < 10000; ++i)
+		map.addValue(i, i * 2);
+
+	EXPECT_EQ(10000, map.size());
+	EXPECT_LE(map.loadFactor(), map.maxLoadFactor());
+	for (int i = 0; i < 10000; ++i)
+		EXPECT_EQ(i * 2, map.getValue(i));
+	EXPECT_EQ(false, map.contains(10000));
+}
+
+TEST(HashMapTest, collidingKeysSurviveRemoval)
+{
+	HashMap<int, int, CollidingHash> map;
+	for (int i = 0; i < 20; ++i)
+		map.addValue(i, i);
+
+	// Removing from the middle of the single run must shift the tail back.
+	for (int i = 0; i < 20; i += 3)
+		map.removeValue(i);
+	for (int i = 0; i < 20; ++i)
+		EXPECT_EQ(i % 3 != 0, map.contains(i));
+
+	map.addValue(3, 33);
+	EXPECT_EQ(33, map.getValue(3));
+}
+
+TEST(HashMapTest, matchesReferenceUnderRandomOperations)
+{
+	HashMap<int, int> map;
+	std::map<int, int> reference;
+	std::srand(7);
+
+	for (int i = 0; i < 20000; ++i) {
+		int key = std::rand() % 500;
+		if (std::rand() % 3 == 0) {
+			if (reference.erase(key) == 1)
+				map.removeValue(key);
+			else
+				EXPECT_THROW(map.removeValue(key), KeyError<int>);
+		} else if (reference.find(key) == reference.end()) {
+			reference[key] = i;
+			map.addValue(key, i);
+		}
+	}
+
+	EXPECT_EQ(reference.size(), map.size());
+	for (auto const& pair : reference)
+		EXPECT_EQ(pair.second, map.getValue(pair.first));
+}
+
+TEST(HashMapTest, reserve)
+{
+	HashMap<int, int> map;
+	map.reserve(1000);
+	std::size_t capacity = map.capacity();
+	EXPECT_LE(1000, map.maxLoadFactor() * capacity);
+
+	for (int i = 0; i < 1000; ++i)
+		map.addValue(i, i);
+	EXPECT_EQ(capacity, map.capacity());
+}
+
+TEST(HashMapTest, maxLoadFactor)
+{
+	HashMap<int, int> map;
+	for (int i = 0; i < 100; ++i)
+		map.addValue(i, i);
+
+	map.maxLoadFactor(0.25f);
+	EXPECT_FLOAT_EQ(0.25f, map.maxLoadFactor());
+	EXPECT_LE(map.loadFactor(), 0.25f);
+	for (int i = 0; i < 100; ++i)
+		EXPECT_EQ(true, map.contains(i));
+
+	map.maxLoadFactor(2.0f);
+	EXPECT_FLOAT_EQ(0.9375f, map.maxLoadFactor());
+}
+
+TEST(HashMapTest, iteration)
+{
+	HashMap<int, int> map;
+	for (int i = 0; i < 50; ++i)
+		map.addValue(i, i);
+
+	int sum = 0;
+	std::size_t count = 0;
+	for (int key : map) {
+		sum += key;
+		++count;
+	}
+	EXPECT_EQ(50, count);
+	EXPECT_EQ(49 * 50 / 2, sum);
+}
+
+TEST(HashMapTest, views)
+{
+	HashMap<int, int> map;
+	EXPECT_EQ(true, map.keys().isEmpty());
+	for (int i = 0; i < 50; ++i)
+		map.addValue(i, i * 10);
+
+	int keySum = 0;
+	for (int key : map.keys())
+		keySum += key;
+	EXPECT_EQ(49 * 50 / 2, keySum);
+	EXPECT_EQ(50, map.values().size());
+
+	for (int& value : map.values())
+		value += 1;
+	for (auto item : map.items())
+		EXPECT_EQ(item.key * 10 + 1, item.value);
+
+	HashMap<int, int> const& constMap = map;
+	int valueSum = 0;
+	for (int const& value : constMap.values())
+		valueSum += value;
+	EXPECT_EQ(10 * 49 * 50 / 2 + 50, valueSum);
+}
+
+TEST(HashMapTest, forEach)
+{
+	HashMap<int, int> map;
+	for (int i = 0; i < 50; ++i)
+		map.addValue(i, i);
+
+	map.forEach([](int const& key, int& value) { value = key * 2; });
+	std::size_t count = 0;
+	HashMap<int, int> const& constMap = map;
+	constMap.forEach([&](int const& key, int const& value) {
+		EXPECT_EQ(key * 2, value);
+		++count;
+	});
+	EXPECT_EQ(50, count);
+}
@@ -0,0 +1,96 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/lockfreequeue.hpp"
+
+
+TEST(LockFreeQueueTest, constructor)
+{
+	LockFreeQueue<int> queue;
+	EXPECT_EQ(true, queue.isEmpty());
+}
+
+TEST(LockFreeQueueTest, fifoOrder)
+{
+	LockFreeQueue<std::string> queue;
+	queue.push("a");
+	queue.push("b");
+	queue.push("c");
+	EXPECT_EQ(false, queue.isEmpty());
+
+	std::string value;
+	EXPECT_EQ(true, queue.tryPop(value));
+	EXPECT_EQ("a", value);
+	EXPECT_EQ(true, queue.tryPop(value));
+	EXPECT_EQ("b", value);
+	EXPECT_EQ(true, queue.tryPop(value));
+	EXPECT_EQ("c", value);
+	EXPECT_EQ(false, queue.tryPop(value));
+	EXPECT_EQ(true, queue.isEmpty());
+}
+
+TEST(LockFreeQueueTest, recyclesNodes)
+{
+	LockFreeQueue<int> queue;
+	int value = 0;
+	// Far more operations than the retire threshold so nodes are recycled.
+	for (int round = 0; round < 100; ++round) {
+		for (int i = 0; i < 50; ++i)
+			queue.push(round * 50 + i);
+		for (int i = 0; i < 50; ++i) {
+			EXPECT_EQ(true, queue.tryPop(value));
+			EXPECT_EQ(round * 50 + i, value);
+		}
+	}
+	EXPECT_EQ(true, queue.isEmpty());
+}
+
+TEST(LockFreeQueueTest, multipleProducersAndConsumers)
+{
+	const int perProducer = 10000;
+	const int producers = 3;
+	const int consumers = 3;
+	const int total = perProducer * producers;
+	LockFreeQueue<int> queue;
+	std::vector<std::atomic<int>> seen(total);
+	for (auto& count : seen)
+		count.store(0);
+	std::atomic<int> consumed{0};
+	std::atomic<bool> ordered{true};
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; ++p)
+		threads.emplace_back([&, p]() {
+			for (int i = 0; i < perProducer; ++i)
+				queue.push(p * perProducer + i);
+		});
+	for (int c = 0; c < consumers; ++c)
+		threads.emplace_back([&]() {
+			// Values from one producer must come out in the order pushed.
+			std::vector<int> last(producers, -1);
+			int value;
+			while (consumed.load() < total) {
+				if (!queue.tryPop(value)) {
+					std::this_thread::yield();
+					continue;
+				}
+				int producer = value / perProducer;
+				if (value <= last[producer])
+					ordered.store(false);
+				last[producer] = value;
+				seen[value].fetch_add(1);
+				consumed.fetch_add(1);
+			}
+		});
+
+	for (auto& thread : threads)
+		thread.join();
+
+	EXPECT_EQ(true, ordered.load());
+	for (int i = 0; i < total; ++i)
+		EXPECT_EQ(1, seen[i].load());
+}
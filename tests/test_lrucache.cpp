@@ -0,0 +1,212 @@
+#include <cstddef>
+#include <cstdlib>
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/lrucache.hpp"
+
+
+TEST(LruCacheTest, constructor)
+{
+	LruCache<int, std::string> cache{3};
+	EXPECT_EQ(0, cache.size());
+	EXPECT_EQ(true, cache.isEmpty());
+	EXPECT_EQ(3, cache.capacity());
+	EXPECT_EQ(0, cache.weight());
+	EXPECT_EQ(nullptr, cache.get(1));
+	EXPECT_EQ(1, cache.misses());
+}
+
+TEST(LruCacheTest, evictsLeastRecentlyUsed)
+{
+	LruCache<int, std::string> cache{3};
+	cache.put(1, "one");
+	cache.put(2, "two");
+	cache.put(3, "three");
+	ASSERT_NE(nullptr, cache.get(1));
+	EXPECT_EQ("one", *cache.get(1));
+
+	cache.put(4, "four");
+	EXPECT_EQ(3, cache.size());
+	EXPECT_EQ(false, cache.contains(2));
+	EXPECT_EQ(1, cache.evictions());
+
+	// peek() does not make 3 recent, so it goes next.
+	EXPECT_EQ("three", *cache.peek(3));
+	cache.put(5, "five");
+	EXPECT_EQ(false, cache.contains(3));
+
+	std::vector<int> order;
+	for (int key : cache.keys())
+		order.push_back(key);
+	EXPECT_EQ((std::vector<int>{5, 4, 1}), order);
+	EXPECT_EQ(2, cache.hits());
+	EXPECT_EQ(0, cache.misses());
+}
+
+TEST(LruCacheTest, putReplacesAndRefreshes)
+{
+	LruCache<int, std::string> cache{2};
+	cache.put(1, "one");
+	cache.put(2, "two");
+	cache.put(1, "uno");
+	cache.put(3, "three");
+	EXPECT_EQ(2, cache.size());
+	EXPECT_EQ("uno", *cache.get(1));
+	EXPECT_EQ(nullptr, cache.get(2));
+
+	*cache.get(3) = "tres";
+	EXPECT_EQ("tres", *cache.peek(3));
+	EXPECT_EQ(true, cache.remove(3));
+	EXPECT_EQ(false, cache.remove(3));
+	EXPECT_EQ(1, cache.size());
+	EXPECT_EQ(1, cache.evictions());
+
+	cache.resetCounters();
+	EXPECT_EQ(0, cache.hits());
+	EXPECT_EQ(0, cache.misses());
+	EXPECT_EQ(0, cache.evictions());
+}
+
+TEST(LruCacheTest, weighedCapacityAndListener)
+{
+	LruCache<int, std::string> cache{10,
+		[](int const&, std::string const& value) { return value.size(); }};
+	std::vector<std::pair<int, std::string>> evicted;
+	cache.setEvictionListener([&](int const& key, std::string& value) {
+		evicted.emplace_back(key, std::move(value));
+	});
+
+	cache.put(1, "aaaa");
+	cache.put(2, "bbbb");
+	EXPECT_EQ(8, cache.weight());
+	cache.put(3, "cc");
+	EXPECT_EQ(10, cache.weight());
+	EXPECT_EQ(true, evicted.empty());
+
+	cache.put(4, "d");
+	EXPECT_EQ(1u, evicted.size());
+	EXPECT_EQ(1, evicted[0].first);
+	EXPECT_EQ("aaaa", evicted[0].second);
+	EXPECT_EQ(7, cache.weight());
+
+	// Heavier than the whole capacity: evicted on the spot.
+	cache.put(5, "eeeeeeeeeeee");
+	EXPECT_EQ(false, cache.contains(5));
+	EXPECT_EQ(5, evicted.back().first);
+	EXPECT_EQ(7, cache.weight());
+
+	cache.setCapacity(3);
+	EXPECT_EQ(3, cache.weight());
+	EXPECT_EQ(2, cache.size());
+	EXPECT_EQ(3, cache.evictions());
+
+	// remove() and clear() are not evictions.
+	cache.remove(3);
+	cache.clear();
+	EXPECT_EQ(3u, evicted.size());
+	EXPECT_EQ(0, cache.weight());
+	EXPECT_EQ(true, cache.isEmpty());
+	cache.put(6, "f");
+	EXPECT_EQ("f", *cache.get(6));
+}
+
+TEST(LruCacheTest, oversizedPutEvictsOldValue)
+{
+	LruCache<int, std::string> cache{10,
+		[](int const&, std::string const& value) { return value.size(); }};
+	std::vector<std::pair<int, std::string>> evicted;
+	cache.setEvictionListener([&](int const& key, std::string& value) {
+		evicted.emplace_back(key, std::move(value));
+	});
+	cache.put(1, "aaaa");
+	cache.put(2, "bb");
+
+	// The old value leaves the cache before the newcomer does.
+	cache.put(1, "aaaaaaaaaaaa");
+	ASSERT_EQ(2u, evicted.size());
+	EXPECT_EQ(std::make_pair(1, std::string("aaaa")), evicted[0]);
+	EXPECT_EQ(std::make_pair(1, std::string("aaaaaaaaaaaa")), evicted[1]);
+	EXPECT_EQ(2, cache.evictions());
+	EXPECT_EQ(false, cache.contains(1));
+	EXPECT_EQ(1, cache.size());
+	EXPECT_EQ(2, cache.weight());
+}
+
+TEST(LruCacheTest, copyAndMove)
+{
+	LruCache<int, int> cache{100};
+	for (int i = 0; i < 150; ++i)
+		cache.put(i, i * i);
+
+	LruCache<int, int> copy{cache};
+	cache.put(1000, 0);
+	EXPECT_EQ(100, copy.size());
+	EXPECT_EQ(true, copy.contains(50));
+	EXPECT_EQ(50, copy.evictions());
+	EXPECT_EQ(false, copy.contains(1000));
+
+	LruCache<int, int> moved{std::move(copy)};
+	EXPECT_EQ(100, moved.size());
+	EXPECT_EQ(0, copy.size());
+
+	copy = cache;
+	EXPECT_EQ(true, copy.contains(1000));
+	EXPECT_EQ(false, copy.contains(50));
+	EXPECT_EQ(1000, *copy.keys().begin());
+}
+
+TEST(LruCacheTest, matchesReferenceUnderRandomOperations)
+{
+	// A list of pairs, most recent first, is the obvious LRU cache.
+	const std::size_t capacity = 64;
+	LruCache<int, int> cache{capacity};
+	std::list<std::pair<int, int>> reference;
+	std::size_t hits = 0;
+	std::srand(41);
+
+	for (int i = 0; i < 50000; ++i) {
+		int key = std::rand() % 200;
+		auto found = reference.begin();
+		while (found != reference.end() && found->first != key)
+			++found;
+
+		int action = std::rand() % 4;
+		if (action < 2) {
+			int* value = cache.get(key);
+			ASSERT_EQ(found != reference.end(), value != nullptr);
+			if (value != nullptr) {
+				++hits;
+				EXPECT_EQ(found->second, *value);
+				reference.splice(reference.begin(), reference, found);
+			}
+		} else if (action == 2) {
+			cache.put(key, i);
+			if (found != reference.end())
+				reference.erase(found);
+			reference.emplace_front(key, i);
+			if (reference.size() > capacity)
+				reference.pop_back();
+		} else {
+			EXPECT_EQ(found != reference.end(), cache.remove(key));
+			if (found != reference.end())
+				reference.erase(found);
+		}
+	}
+	ASSERT_EQ(reference.size(), cache.size());
+
+	auto expected = reference.begin();
+	for (auto item : cache.items()) {
+		EXPECT_EQ(expected->first, item.key);
+		EXPECT_EQ(expected->second, item.value);
+		++expected;
+	}
+	std::size_t visited = 0;
+	cache.forEach([&](int const&, int const&) { ++visited; });
+	EXPECT_EQ(reference.size(), visited);
+	EXPECT_EQ(hits, cache.hits());
+}
@@ -1,12 +1,20 @@
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
 
 #include "../structures/nonhashmap.hpp"
 #include "../exceptions.hpp"
+#include "countedkey.hpp"
+#include "countingallocator.hpp"
 
 
 TEST(NonHashMapTest, constructor)
@@ -93,3 +101,335 @@ TEST(NonHashMapTest, containsNotPresent)
 	map.addValue(6, "hello");
 	EXPECT_EQ(false, map.contains(5));
 }
+
+TEST(NonHashMapTest, getValue)
+{
+	NonHashMap<std::string, int> map;
+	map.addValue("two", 2);
+	map.addValue("one", 1);
+
+	EXPECT_EQ(1, map.getValue("one"));
+	map.getValue("two") = 22;
+	EXPECT_EQ(22, map.getValue("two"));
+	EXPECT_THROW(map.getValue("three"), KeyError<std::string>);
+}
+
+TEST(NonHashMapTest, numbersConvertToTheKey)
+{
+	// An int literal against unsigned keys, and a double against int keys,
+	// convert to K as they always did.
+	NonHashMap<std::size_t, int> sizes;
+	sizes.addValue(1, 10);
+	EXPECT_EQ(true, sizes.contains(1));
+	EXPECT_EQ(10, sizes.getValue(1));
+	EXPECT_EQ(false, sizes.contains(2));
+
+	NonHashMap<int, int> ints;
+	ints.addValue(3, 30);
+	EXPECT_EQ(true, ints.contains(3.5));
+	EXPECT_EQ(30, ints.getValue(3.9));
+}
+
+TEST(NonHashMapTest, stringLookupBuildsNoKey)
+{
+	// Long enough not to fit in the string itself, so each key allocates.
+	NonHashMap<CountedString, int> map;
+	map.addValue("alpha, longer than any short string buffer", 1);
+	map.addValue("omega, longer than any short string buffer", 2);
+	map.setReadOptimised(true);
+
+	std::size_t before = CountingAllocator<char>::allocations();
+	EXPECT_EQ(2, map.getValue("omega, longer than any short string buffer"));
+	EXPECT_EQ(true, map.contains("alpha, longer than any short string buffer"));
+	EXPECT_EQ(false, map.contains("gamma, longer than any short string buffer"));
+	EXPECT_THROW(map.getValue("gamma, longer than any short string buffer"),
+		KeyError<CountedString>);
+	EXPECT_EQ(before, CountingAllocator<char>::allocations());
+}
+
+TEST(NonHashMapTest, updatesSearchOnce)
+{
+	std::vector<std::pair<CountedKey, int>> pairs;
+	for (int i = 0; i < 1024; ++i)
+		pairs.push_back(std::make_pair(CountedKey{i * 2}, i));
+	NonHashMap<CountedKey, int> map{pairs.begin(), pairs.end()};
+
+	// The search is branchless, so its cost depends only on the size: an
+	// update costs exactly what a lookup of the same key does.
+	for (int key : {512, 513, 0, 2047, 2048}) {
+		CountedKey::comparisons() = 0;
+		bool present = map.contains(CountedKey{key});
+		std::size_t lookup = CountedKey::comparisons();
+		CountedKey::comparisons() = 0;
+		EXPECT_EQ(!present, map.insertOrAssign(CountedKey{key}, -key));
+		EXPECT_EQ(lookup, CountedKey::comparisons());
+	}
+	EXPECT_EQ(-512, map.getValue(CountedKey{512}));
+	EXPECT_EQ(1027, map.size());
+}
+
+TEST(NonHashMapTest, tryEmplaceLeavesArgsOnHit)
+{
+	// The filter is on, so a hit goes past it before the search.
+	NonHashMap<std::string, std::unique_ptr<int>> map;
+	map.setReadOptimised(true);
+	map.tryEmplace("key", std::unique_ptr<int>{new int(1)});
+
+	std::unique_ptr<int> spare{new int(2)};
+	EXPECT_EQ(false, map.tryEmplace("key", std::move(spare)).second);
+	ASSERT_NE(nullptr, spare);
+	EXPECT_EQ(2, *spare);
+	EXPECT_EQ(1, *map.getValue("key"));
+}
+
+TEST(NonHashMapTest, removeValue)
+{
+	NonHashMap<int, std::string> map;
+	map.addValue(5, "hello");
+	map.addValue(6, "hi");
+	map.removeValue(5);
+
+	EXPECT_EQ(1, map.size());
+	EXPECT_EQ(false, map.contains(5));
+	EXPECT_EQ(true, map.contains(6));
+	EXPECT_THROW(map.removeValue(5), KeyError<int>);
+}
+
+TEST(NonHashMapTest, iteratesInKeyOrder)
+{
+	NonHashMap<int, int> map;
+	int keys[6] = {4, 1, 5, 9, 2, 6};
+	for (int key : keys)
+		map.addValue(key, key * 10);
+
+	int sorted[6] = {1, 2, 4, 5, 6, 9};
+	std::size_t i = 0;
+	for (int key : map)
+		EXPECT_EQ(sorted[i++], key);
+	EXPECT_EQ(6, i);
+
+	for (auto it = map.rbegin(); it != map.rend(); ++it)
+		EXPECT_EQ(sorted[--i], *it);
+}
+
+TEST(NonHashMapTest, views)
+{
+	NonHashMap<int, std::string> map;
+	EXPECT_EQ(true, map.items().isEmpty());
+	map.addValue(3, "c");
+	map.addValue(1, "a");
+	map.addValue(2, "b");
+
+	std::ostringstream keys;
+	for (int key : map.keys())
+		keys << key;
+	EXPECT_EQ("123", keys.str());
+
+	for (std::string& value : map.values())
+		value += "!";
+	std::ostringstream items;
+	for (auto item : map.items())
+		items << item.key << item.value;
+	EXPECT_EQ("1a!2b!3c!", items.str());
+	EXPECT_EQ(3, map.values().size());
+}
+
+TEST(NonHashMapTest, forEach)
+{
+	NonHashMap<int, int> map;
+	for (int i = 5; i > 0; --i)
+		map.addValue(i, 0);
+
+	map.forEach([](int const& key, int& value) { value = key * key; });
+	std::ostringstream out;
+	NonHashMap<int, int> const& constMap = map;
+	constMap.forEach([&](int const& key, int const& value) {
+		out << key << ":" << value << " ";
+	});
+	EXPECT_EQ("1:1 2:4 3:9 4:16 5:25 ", out.str());
+}
+
+TEST(NonHashMapTest, bulkInsert)
+{
+	NonHashMap<int, std::string> map;
+	map.addValue(3, "three");
+	std::pair<int, std::string> pairs[3] = {
+		std::make_pair(5, "five"),
+		std::make_pair(1, "one"),
+		std::make_pair(4, "four")};
+	map.insert(pairs, pairs + 3);
+
+	EXPECT_EQ(4, map.size());
+	EXPECT_EQ("one", map.getValue(1));
+	EXPECT_EQ("three", map.getValue(3));
+	EXPECT_EQ(1, *map.begin());
+}
+
+TEST(NonHashMapTest, bulkInsertDuplicates)
+{
+	NonHashMap<int, int> map;
+	map.addValue(3, 3);
+	std::pair<int, int> clash[2] = {std::make_pair(1, 1), std::make_pair(3, 3)};
+	std::pair<int, int> twice[2] = {std::make_pair(7, 1), std::make_pair(7, 2)};
+
+	EXPECT_THROW(map.insert(clash, clash + 2), KeyError<int>);
+	EXPECT_THROW(map.insert(twice, twice + 2), KeyError<int>);
+	EXPECT_EQ(1, map.size());
+	EXPECT_EQ(false, map.contains(1));
+}
+
+TEST(NonHashMapTest, insertBatchMergesInOrder)
+{
+	NonHashMap<int, std::string> map;
+	for (int i = 0; i < 20; i += 2)
+		map.addValue(i, "map");
+	map.setReadOptimised(true);
+
+	std::vector<std::pair<int, std::string>> pairs{
+		{25, "first"}, {-1, "batch"}, {7, "batch"}, {4, "first"},
+		{25, "last"}, {4, "last"}, {19, "batch"}};
+	map.insertBatch(pairs.begin(), pairs.end());
+
+	// The merge interleaves the batch with the map, keeping the last pair
+	// of each run of equal keys, over the map's own.
+	std::vector<int> expected{-1, 0, 2, 4, 6, 7, 8, 10, 12, 14, 16, 18, 19,
+		25};
+	std::vector<int> keys;
+	for (int key : map.keys())
+		keys.push_back(key);
+	EXPECT_EQ(expected, keys);
+	EXPECT_EQ("last", map.getValue(4));
+	EXPECT_EQ("last", map.getValue(25));
+	EXPECT_EQ("batch", map.getValue(7));
+	EXPECT_EQ("map", map.getValue(6));
+
+	// The layout and filter are rebuilt to match.
+	for (int i = -2; i < 27; ++i)
+		EXPECT_EQ(std::find(expected.begin(), expected.end(), i) !=
+			expected.end(), map.contains(i));
+
+	map.insertBatch(pairs.begin(), pairs.begin());
+	EXPECT_EQ(expected.size(), map.size());
+}
+
+TEST(NonHashMapTest, readOptimised)
+{
+	NonHashMap<int, int> map;
+	for (int i = 0; i < 100; i += 2)
+		map.addValue(i, i);
+	map.setReadOptimised(true);
+	EXPECT_EQ(true, map.isReadOptimised());
+
+	for (int i = -1; i < 101; ++i)
+		EXPECT_EQ(i >= 0 && i < 100 && i % 2 == 0, map.contains(i));
+
+	map.addValue(51, 51);
+	map.removeValue(50);
+	EXPECT_EQ(51, map.getValue(51));
+	EXPECT_EQ(false, map.contains(50));
+
+	map.setReadOptimised(false);
+	EXPECT_EQ(true, map.contains(51));
+}
+
+TEST(NonHashMapTest, matchesReferenceUnderRandomOperations)
+{
+	NonHashMap<int, int> plain;
+	NonHashMap<int, int> layout;
+	layout.setReadOptimised(true);
+	NonHashMap<int, int> filtered;
+	filtered.enableBloomFilter();
+	std::map<int, int> reference;
+	std::srand(11);
+
+	for (int i = 0; i < 3000; ++i) {
+		int key = std::rand() % 300;
+		if (std::rand() % 3 == 0) {
+			if (reference.erase(key) == 1) {
+				plain.removeValue(key);
+				layout.removeValue(key);
+				filtered.removeValue(key);
+			}
+		} else if (reference.find(key) == reference.end()) {
+			reference[key] = i;
+			plain.addValue(key, i);
+			layout.addValue(key, i);
+			filtered.addValue(key, i);
+		}
+	}
+
+	EXPECT_EQ(reference.size(), plain.size());
+	for (int key = 0; key < 300; ++key) {
+		bool present = reference.find(key) != reference.end();
+		EXPECT_EQ(present, plain.contains(key));
+		EXPECT_EQ(present, layout.contains(key));
+		EXPECT_EQ(present, filtered.contains(key));
+		if (present) {
+			EXPECT_EQ(reference[key], plain.getValue(key));
+			EXPECT_EQ(reference[key], layout.getValue(key));
+			EXPECT_EQ(reference[key], filtered.getValue(key));
+		}
+	}
+}
+
+/**
+ * \brief A key that is ordered but has no std::hash.
+ */
+struct Point
+{
+	int x;
+	int y;
+
+	bool operator<(Point const& rhs) const
+	{
+		return x < rhs.x || (x == rhs.x && y < rhs.y);
+	}
+};
+
+std::ostream& operator<<(std::ostream& out, Point const& point)
+{
+	return out << "(" << point.x << ", " << point.y << ")";
+}
+
+struct PointHash
+{
+	std::size_t operator()(Point const& point) const
+	{
+		return static_cast<std::size_t>(point.x) * 31 + point.y;
+	}
+};
+
+TEST(NonHashMapTest, bloomFilter)
+{
+	NonHashMap<Point, int> map;
+	for (int i = 0; i < 100; ++i)
+		map.addValue(Point{i, -i - 1}, i);
+	EXPECT_EQ(false, map.hasBloomFilter());
+
+	map.enableBloomFilter<PointHash>(0.001);
+	EXPECT_EQ(true, map.hasBloomFilter());
+	for (int i = 0; i < 1000; ++i)
+		map.addValue(Point{i, i}, i);
+	EXPECT_THROW(map.addValue(Point{5, 5}, 0), KeyError<Point>);
+
+	for (int i = 0; i < 1000; ++i) {
+		EXPECT_EQ(true, map.contains(Point{i, i}));
+		EXPECT_EQ(i < 100, map.contains(Point{i, -i - 1}));
+		EXPECT_EQ(false, map.contains(Point{i, i + 1}));
+	}
+	map.removeValue(Point{7, 7});
+	EXPECT_EQ(false, map.contains(Point{7, 7}));
+	EXPECT_THROW(map.getValue(Point{7, 7}), KeyError<Point>);
+
+	NonHashMap<Point, int> copy{map};
+	EXPECT_EQ(true, copy.hasBloomFilter());
+	EXPECT_EQ(9, copy.getValue(Point{9, 9}));
+
+	std::pair<Point, int> more[] = {{Point{-1, -1}, 1}, {Point{-2, -2}, 2}};
+	copy.insert(more, more + 2);
+	EXPECT_EQ(2, copy.getValue(Point{-2, -2}));
+
+	copy.disableBloomFilter();
+	EXPECT_EQ(false, copy.hasBloomFilter());
+	EXPECT_EQ(1, copy.getValue(Point{-1, -1}));
+}
@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/orderedhashmap.hpp"
+#include "../exceptions.hpp"
+
+
+/**
+ * \brief Sends every key to one of four hashes, so probe runs are long.
+ */
+struct FewHashes
+{
+	std::size_t operator()(int key) const
+	{
+		return static_cast<std::size_t>(key % 4);
+	}
+};
+
+/**
+ * \brief The keys of map, in iteration order.
+ */
+template <typename Map>
+static std::vector<int> keysOf(Map const& map)
+{
+	std::vector<int> keys;
+	for (int key : map.keys())
+		keys.push_back(key);
+	return keys;
+}
+
+TEST(OrderedHashMapTest, constructor)
+{
+	OrderedHashMap<std::string, int> map;
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(0, map.capacity());
+	EXPECT_EQ(false, map.contains("a"));
+	EXPECT_EQ(nullptr, map.find("a"));
+	EXPECT_EQ(true, map.keys().begin() == map.keys().end());
+
+	OrderedHashMap<std::string, int> sized{100};
+	EXPECT_LE(100, sized.capacity());
+	EXPECT_EQ(true, sized.isEmpty());
+}
+
+TEST(OrderedHashMapTest, copyAndMove)
+{
+	OrderedHashMap<int, std::string> map;
+	for (int i = 0; i < 1000; ++i)
+		map.addValue(i, std::to_string(i));
+	map.removeValue(3);
+
+	OrderedHashMap<int, std::string> copy{map};
+	map.removeValue(5);
+	EXPECT_EQ(999, copy.size());
+	EXPECT_EQ("5", copy.getValue(5));
+	EXPECT_EQ(false, copy.contains(3));
+	EXPECT_EQ(keysOf(map).size() + 1, keysOf(copy).size());
+	EXPECT_EQ(4, keysOf(copy)[3]);
+
+	OrderedHashMap<int, std::string> moved{std::move(copy)};
+	EXPECT_EQ(999, moved.size());
+	EXPECT_EQ(0, copy.size());
+
+	copy = map;
+	EXPECT_EQ(998, copy.size());
+	EXPECT_EQ(false, copy.contains(5));
+	EXPECT_EQ(keysOf(map), keysOf(copy));
+}
+
+TEST(OrderedHashMapTest, addGetRemove)
+{
+	OrderedHashMap<std::string, std::string> map;
+	map.addValue("two", "2");
+	map.addValue("one", "1");
+	EXPECT_THROW(map.addValue("one", "uno"), KeyError<std::string>);
+	EXPECT_EQ("1", map.getValue("one"));
+
+	map.getValue("two") = "deux";
+	EXPECT_EQ("deux", map.getValue("two"));
+	EXPECT_EQ("deux", *map.find("two"));
+
+	map.removeValue("one");
+	EXPECT_EQ(false, map.contains("one"));
+	EXPECT_THROW(map.getValue("one"), KeyError<std::string>);
+	EXPECT_THROW(map.removeValue("one"), KeyError<std::string>);
+	map.removeValue("two");
+	EXPECT_EQ(true, map.isEmpty());
+}
+
+TEST(OrderedHashMapTest, keepsInsertionOrder)
+{
+	OrderedHashMap<int, int> map;
+	const int keys[] = {42, 7, -3, 100, 0, 19};
+	for (int key : keys)
+		map.addValue(key, key);
+	EXPECT_EQ((std::vector<int>{42, 7, -3, 100, 0, 19}), keysOf(map));
+
+	// Assigning keeps the place; removing and adding again moves to the end.
+	map.insertOrAssign(7, 70);
+	map.removeValue(-3);
+	map.addValue(-3, 3);
+	map.removeValue(42);
+	EXPECT_EQ((std::vector<int>{7, 100, 0, 19, -3}), keysOf(map));
+	EXPECT_EQ(70, map.getValue(7));
+
+	std::vector<int> values(map.values().begin(), map.values().end());
+	EXPECT_EQ((std::vector<int>{70, 100, 0, 19, 3}), values);
+}
+
+TEST(OrderedHashMapTest, holesAreCompacted)
+{
+	OrderedHashMap<int, int> map;
+	for (int i = 0; i < 100; ++i)
+		map.addValue(i, i);
+	std::size_t capacity = map.capacity();
+
+	// A sliding window of 100 keys churns through the array without growing
+	// it; every fill squeezes the holes out.
+	for (int i = 100; i < 10000; ++i) {
+		map.removeValue(i - 100);
+		map.addValue(i, i);
+	}
+	EXPECT_EQ(capacity, map.capacity());
+	EXPECT_EQ(100, map.size());
+	std::vector<int> keys = keysOf(map);
+	for (int i = 0; i < 100; ++i)
+		ASSERT_EQ(9900 + i, keys[i]);
+
+	// Removing from the end takes the space back at once.
+	for (int i = 9999; i >= 9950; --i)
+		map.removeValue(i);
+	for (int i = 0; i < 50; ++i)
+		map.addValue(-i, i);
+	EXPECT_EQ(capacity, map.capacity());
+	EXPECT_EQ(9949, keysOf(map)[49]);
+	EXPECT_EQ(0, keysOf(map)[50]);
+}
+
+TEST(OrderedHashMapTest, indexWidensAsItGrows)
+{
+	// Past 170 and 43690 pairs the index slots widen to 2 and then 4 bytes.
+	OrderedHashMap<int, int> map;
+	for (int i = 0; i < 50000; ++i) {
+		map.addValue(i * 7, i);
+		if (i == 150 || i == 200 || i == 40000) {
+			for (int j = 0; j <= i; j += 37)
+				ASSERT_EQ(j, map.getValue(j * 7));
+		}
+	}
+	EXPECT_EQ(50000, map.size());
+	for (int i = 0; i < 50000; ++i)
+		ASSERT_EQ(i, map.getValue(i * 7));
+	EXPECT_EQ(false, map.contains(1));
+
+	int expected = 0;
+	map.forEach([&](int const& key, int const& value) {
+		EXPECT_EQ(expected * 7, key);
+		EXPECT_EQ(expected++, value);
+	});
+}
+
+TEST(OrderedHashMapTest, collidingHashes)
+{
+	OrderedHashMap<int, int, FewHashes> map;
+	for (int i = 0; i < 200; ++i)
+		map.addValue(i, i * 2);
+	for (int i = 0; i < 200; i += 3)
+		map.removeValue(i);
+	for (int i = 0; i < 200; ++i) {
+		if (i % 3 == 0)
+			ASSERT_EQ(false, map.contains(i));
+		else
+			ASSERT_EQ(i * 2, map.getValue(i));
+	}
+	for (int i = 0; i < 200; i += 3)
+		map.addValue(i, i);
+	EXPECT_EQ(200, map.size());
+	EXPECT_EQ(1, keysOf(map)[0]);
+	EXPECT_EQ(198, keysOf(map)[199]);
+}
+
+TEST(OrderedHashMapTest, heterogeneousLookup)
+{
+	OrderedHashMap<std::string, int, StringHash, StringEqual> map;
+	map.addValue("one", 1);
+	map.addValue("two", 2);
+	EXPECT_EQ(2, map.getValue("two"));
+	EXPECT_EQ(true, map.contains("one"));
+	EXPECT_EQ(nullptr, map.find("three"));
+	EXPECT_THROW(map.getValue("three"), KeyError<std::string>);
+}
+
+TEST(OrderedHashMapTest, rangeConstructorAndInsertBatch)
+{
+	std::vector<std::pair<std::string, int>> pairs = {
+		{"b", 1}, {"a", 2}, {"b", 3}, {"c", 4}};
+	OrderedHashMap<std::string, int> map{pairs.begin(), pairs.end()};
+	EXPECT_EQ(3, map.size());
+	EXPECT_EQ(3, map.getValue("b"));
+	EXPECT_EQ("b", *map.keys().begin());
+
+	std::map<std::string, int> more = {{"a", 20}, {"d", 5}, {"e", 6}};
+	map.insertBatch(more.begin(), more.end());
+	std::vector<std::string> keys(map.keys().begin(), map.keys().end());
+	EXPECT_EQ((std::vector<std::string>{"b", "a", "c", "d", "e"}), keys);
+	EXPECT_EQ(20, map.getValue("a"));
+}
+
+TEST(OrderedHashMapTest, insertOrAssignTryEmplaceUpsert)
+{
+	OrderedHashMap<std::string, int> map;
+	EXPECT_EQ(true, map.insertOrAssign("one", 1));
+	EXPECT_EQ(false, map.insertOrAssign("one", 11));
+	EXPECT_EQ(11, map.getValue("one"));
+
+	std::pair<int&, bool> added = map.tryEmplace("two", 2);
+	EXPECT_EQ(true, added.second);
+	EXPECT_EQ(2, added.first);
+	std::pair<int&, bool> present = map.tryEmplace("two", 22);
+	EXPECT_EQ(false, present.second);
+	present.first = 20;
+	EXPECT_EQ(20, map.getValue("two"));
+
+	std::string words[] = {"a", "b", "a", "c", "a", "b"};
+	for (std::string const& word : words)
+		map.upsert(word, [](int& count) { ++count; });
+	EXPECT_EQ(3, map.getValue("a"));
+	EXPECT_EQ(2, map.getValue("b"));
+	EXPECT_EQ(1, map.getValue("c"));
+	EXPECT_EQ(21, map.upsert("two", [](int& value) { ++value; }));
+	EXPECT_EQ(5, map.size());
+}
+
+TEST(OrderedHashMapTest, matchesReferenceUnderRandomOperations)
+{
+	// The reference keeps the keys in order in a vector.
+	OrderedHashMap<int, int> map;
+	std::vector<std::pair<int, int>> reference;
+	std::srand(37);
+
+	for (int i = 0; i < 20000; ++i) {
+		int key = std::rand() % 600;
+		auto found = std::find_if(reference.begin(), reference.end(),
+			[&](std::pair<int, int> const& pair) { return pair.first == key; });
+		if (std::rand() % 3 != 0) {
+			if (found == reference.end())
+				reference.push_back({key, i});
+			else
+				found->second = i;
+			map.insertOrAssign(key, i);
+		} else if (found != reference.end()) {
+			reference.erase(found);
+			map.removeValue(key);
+		} else {
+			EXPECT_EQ(false, map.contains(key));
+		}
+	}
+	ASSERT_EQ(reference.size(), map.size());
+
+	auto expected = reference.begin();
+	for (auto item : map.items()) {
+		EXPECT_EQ(expected->first, item.key);
+		EXPECT_EQ(expected->second, item.value);
+		++expected;
+	}
+	EXPECT_EQ(true, expected == reference.end());
+}
+
+TEST(OrderedHashMapTest, viewsAndForEach)
+{
+	OrderedHashMap<int, int> map;
+	for (int i = 9; i >= 0; --i)
+		map.addValue(i, i * 10);
+
+	int expected = 9;
+	for (int key : map.keys())
+		EXPECT_EQ(expected--, key);
+	EXPECT_EQ(-1, expected);
+	for (int& value : map.values())
+		value += 1;
+	int sum = 0;
+	map.forEach([&](int const& key, int& value) {
+		EXPECT_EQ(key * 10 + 1, value);
+		sum += value;
+	});
+	EXPECT_EQ(460, sum);
+	EXPECT_EQ(10, map.items().size());
+
+	OrderedHashMap<int, int> const& constant = map;
+	int first = -1;
+	for (auto item : constant.items()) {
+		first = item.key;
+		break;
+	}
+	EXPECT_EQ(9, first);
+}
@@ -0,0 +1,259 @@
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/persistentmap.hpp"
+#include "../exceptions.hpp"
+
+
+/**
+ * \brief Sends every key to one of four hashes, so most keys share a hash
+ *        with others and end up in collision nodes.
+ */
+struct FourHashes
+{
+	std::size_t operator()(int key) const
+	{
+		return static_cast<std::size_t>(key % 4);
+	}
+};
+
+/**
+ * \brief The pairs of map, sorted.
+ */
+template <typename Map>
+static std::map<int, int> contents(Map const& map)
+{
+	std::map<int, int> pairs;
+	map.forEach([&](int const& key, int const& value) {
+		pairs[key] = value;
+	});
+	return pairs;
+}
+
+TEST(PersistentMapTest, constructor)
+{
+	PersistentMap<std::string, int> map;
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(false, map.contains("a"));
+	EXPECT_EQ(nullptr, map.find("a"));
+	EXPECT_EQ(0, map.keys().size());
+	EXPECT_EQ(true, map.keys().begin() == map.keys().end());
+}
+
+TEST(PersistentMapTest, withAndWithoutLeaveEarlierVersions)
+{
+	PersistentMap<std::string, int> empty;
+	PersistentMap<std::string, int> one = empty.with("one", 1);
+	PersistentMap<std::string, int> two = one.with("two", 2);
+	PersistentMap<std::string, int> changed = two.with("one", 11);
+	PersistentMap<std::string, int> removed = changed.without("two");
+
+	EXPECT_EQ(0, empty.size());
+	EXPECT_EQ(1, one.size());
+	EXPECT_EQ(1, one.getValue("one"));
+	EXPECT_EQ(false, one.contains("two"));
+	EXPECT_EQ(2, two.size());
+	EXPECT_EQ(1, two.getValue("one"));
+	EXPECT_EQ(2, changed.size());
+	EXPECT_EQ(11, changed.getValue("one"));
+	EXPECT_EQ(1, removed.size());
+	EXPECT_EQ(11, removed.getValue("one"));
+	EXPECT_THROW(removed.getValue("two"), KeyError<std::string>);
+
+	PersistentMap<std::string, int> same = removed.without("three");
+	EXPECT_EQ(&removed.getValue("one"), &same.getValue("one"));
+	EXPECT_EQ(true, removed.without("one").isEmpty());
+}
+
+TEST(PersistentMapTest, versionsShareUnchangedNodes)
+{
+	PersistentMap<int, int> map;
+	for (int i = 0; i < 5000; ++i)
+		map = map.with(i, i);
+
+	// Only the pairs on the path to the changed key are copied.
+	PersistentMap<int, int> next = map.with(5000, 5000).without(17);
+	std::size_t shared = 0;
+	for (int i = 0; i < 5000; ++i)
+		if (next.find(i) == map.find(i))
+			++shared;
+	EXPECT_LE(4900, shared);
+	EXPECT_EQ(nullptr, next.find(17));
+	EXPECT_EQ(17, map.getValue(17));
+	EXPECT_EQ(5000, next.size());
+}
+
+TEST(PersistentMapTest, copyAndMove)
+{
+	PersistentMap<int, std::string> map;
+	for (int i = 0; i < 1000; ++i)
+		map = map.with(i, std::to_string(i));
+
+	PersistentMap<int, std::string> copy{map};
+	EXPECT_EQ(&map.getValue(5), &copy.getValue(5));
+	map = map.without(5);
+	EXPECT_EQ(1000, copy.size());
+	EXPECT_EQ("5", copy.getValue(5));
+
+	PersistentMap<int, std::string> moved{std::move(copy)};
+	EXPECT_EQ(1000, moved.size());
+	EXPECT_EQ(0, copy.size());
+
+	copy = map;
+	EXPECT_EQ(999, copy.size());
+	EXPECT_EQ(false, copy.contains(5));
+}
+
+TEST(PersistentMapTest, collidingHashes)
+{
+	PersistentMap<int, int, FourHashes> map;
+	for (int i = 0; i < 100; ++i)
+		map = map.with(i, i * 2);
+	EXPECT_EQ(100, map.size());
+	for (int i = 0; i < 100; ++i)
+		ASSERT_EQ(i * 2, map.getValue(i));
+	EXPECT_EQ(false, map.contains(100));
+
+	PersistentMap<int, int, FourHashes> odd = map;
+	for (int i = 0; i < 100; i += 2)
+		odd = odd.without(i);
+	EXPECT_EQ(50, odd.size());
+	EXPECT_EQ(false, odd.contains(10));
+	EXPECT_EQ(22, odd.getValue(11));
+	EXPECT_EQ(100, map.size());
+
+	// Down to one key per hash, and then none.
+	for (int i = 5; i < 100; i += 2)
+		odd = odd.without(i);
+	EXPECT_EQ(2, odd.size());
+	EXPECT_EQ(6, odd.getValue(3));
+	EXPECT_EQ(true, odd.without(1).without(3).isEmpty());
+}
+
+TEST(PersistentMapTest, transientBuildsInPlace)
+{
+	PersistentMap<int, std::string> base;
+	base = base.with(1, "one");
+
+	PersistentMap<int, std::string>::Transient transient = base.transient();
+	for (int i = 0; i < 2000; ++i)
+		transient.insertOrAssign(i, std::to_string(i));
+	EXPECT_EQ(false, transient.insertOrAssign(1, "uno"));
+	EXPECT_EQ(2000, transient.size());
+	EXPECT_EQ("uno", *transient.find(1));
+	EXPECT_EQ(1, base.size());
+	EXPECT_EQ("one", base.getValue(1));
+
+	PersistentMap<int, std::string> built = transient.persistent();
+	transient.removeValue(7);
+	transient.insertOrAssign(1, "eins");
+	EXPECT_THROW(transient.removeValue(7), KeyError<int>);
+	EXPECT_EQ(false, transient.contains(7));
+	EXPECT_EQ(2000, built.size());
+	EXPECT_EQ("7", built.getValue(7));
+	EXPECT_EQ("uno", built.getValue(1));
+	EXPECT_EQ("eins", transient.persistent().getValue(1));
+
+	for (int i = 0; i < 2000; ++i)
+		if (i != 7)
+			transient.removeValue(i);
+	EXPECT_EQ(true, transient.isEmpty());
+	EXPECT_EQ(2000, built.size());
+}
+
+TEST(PersistentMapTest, rangeConstructor)
+{
+	std::vector<std::pair<std::string, int>> pairs = {
+		{"a", 1}, {"b", 2}, {"a", 3}};
+	PersistentMap<std::string, int> map{pairs.begin(), pairs.end()};
+	EXPECT_EQ(2, map.size());
+	EXPECT_EQ(3, map.getValue("a"));
+	EXPECT_EQ(2, map.getValue("b"));
+}
+
+TEST(PersistentMapTest, matchesReferenceUnderRandomOperations)
+{
+	// Every version is kept, and checked at the end against the reference
+	// it was made alongside.
+	std::srand(31);
+	std::vector<PersistentMap<int, int>> versions(1);
+	std::vector<std::map<int, int>> references(1);
+	PersistentMap<int, int, FourHashes>::Transient colliding =
+		PersistentMap<int, int, FourHashes>().transient();
+	std::map<int, int> collidingReference;
+
+	for (int i = 0; i < 4000; ++i) {
+		std::size_t from = static_cast<std::size_t>(std::rand())
+			% versions.size();
+		int key = std::rand() % 1500;
+		std::map<int, int> reference = references[from];
+		if (std::rand() % 3 != 0) {
+			reference[key] = i;
+			versions.push_back(versions[from].with(key, i));
+		} else {
+			reference.erase(key);
+			versions.push_back(versions[from].without(key));
+		}
+		references.push_back(reference);
+
+		if (std::rand() % 3 != 0) {
+			collidingReference[key % 200] = i;
+			colliding.insertOrAssign(key % 200, i);
+		} else if (collidingReference.erase(key % 200) == 1) {
+			colliding.removeValue(key % 200);
+		}
+	}
+
+	for (std::size_t i = 0; i < versions.size(); ++i) {
+		ASSERT_EQ(references[i].size(), versions[i].size());
+		ASSERT_EQ(references[i], contents(versions[i]));
+	}
+	EXPECT_EQ(collidingReference, contents(colliding.persistent()));
+}
+
+TEST(PersistentMapTest, removalFreesOnlyWhatNoVersionHolds)
+{
+	PersistentMap<int, std::shared_ptr<int>>::Transient transient =
+		PersistentMap<int, std::shared_ptr<int>>().transient();
+	for (int i = 0; i < 100; ++i)
+		transient.insertOrAssign(i, std::make_shared<int>(i));
+	PersistentMap<int, std::shared_ptr<int>> map = transient.persistent();
+	std::shared_ptr<int> seven = map.getValue(7);
+	EXPECT_EQ(2, seven.use_count());
+	// The transient still holds the pair.
+	map = map.without(7);
+	EXPECT_EQ(2, seven.use_count());
+	transient.removeValue(7);
+	EXPECT_EQ(1, seven.use_count());
+}
+
+TEST(PersistentMapTest, viewsAndForEach)
+{
+	PersistentMap<int, int> map;
+	for (int i = 0; i < 100; ++i)
+		map = map.with(i, i * 10);
+
+	std::map<int, int> seen;
+	for (auto item : map.items())
+		seen[item.key] = item.value;
+	EXPECT_EQ(contents(map), seen);
+	EXPECT_EQ(100, seen.size());
+
+	int keys = 0;
+	for (int key : map.keys())
+		keys += key;
+	EXPECT_EQ(4950, keys);
+	int values = 0;
+	for (int const& value : map.values())
+		values += value;
+	EXPECT_EQ(49500, values);
+	EXPECT_EQ(100, map.items().size());
+}
@@ -0,0 +1,238 @@
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+#include "../structures/rbtreemap.hpp"
+#include "../exceptions.hpp"
+#include "countedkey.hpp"
+#include "countingallocator.hpp"
+
+
+TEST(RBTreeMapTest, constructor)
+{
+	RBTreeMap<int, std::string> map;
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(true, map.begin() == map.end());
+	EXPECT_EQ(true, map.rbegin() == map.rend());
+}
+
+TEST(RBTreeMapTest, copyAndMove)
+{
+	RBTreeMap<int, std::string> map;
+	for (int i = 0; i < 100; ++i)
+		map.addValue(i, std::to_string(i));
+
+	RBTreeMap<int, std::string> copy{map};
+	map.removeValue(5);
+	EXPECT_EQ(100, copy.size());
+	EXPECT_EQ("5", copy.getValue(5));
+	copy.addValue(100, "100");
+
+	RBTreeMap<int, std::string> moved{std::move(copy)};
+	EXPECT_EQ(101, moved.size());
+	EXPECT_EQ(0, copy.size());
+
+	copy = map;
+	EXPECT_EQ(99, copy.size());
+	EXPECT_EQ(false, copy.contains(5));
+}
+
+TEST(RBTreeMapTest, addGetRemove)
+{
+	RBTreeMap<int, std::string> map;
+	map.addValue(2, "two");
+	map.addValue(1, "one");
+	EXPECT_THROW(map.addValue(1, "uno"), KeyError<int>);
+	EXPECT_EQ("one", map.getValue(1));
+
+	map.getValue(2) = "deux";
+	EXPECT_EQ("deux", map.getValue(2));
+
+	map.removeValue(1);
+	EXPECT_EQ(false, map.contains(1));
+	EXPECT_THROW(map.getValue(1), KeyError<int>);
+	EXPECT_THROW(map.removeValue(1), KeyError<int>);
+	EXPECT_EQ(1, map.size());
+}
+
+TEST(RBTreeMapTest, numbersConvertToTheKey)
+{
+	RBTreeMap<unsigned, int> map;
+	for (int i = 1; i <= 10; ++i)
+		map.addValue(i, -i);
+	EXPECT_EQ(true, map.contains(1));
+	EXPECT_EQ(-10, map.getValue(10));
+	EXPECT_EQ(false, map.contains(0));
+
+	// A double still truncates to the int key it names.
+	RBTreeMap<int, int> ints;
+	ints.addValue(3, 30);
+	EXPECT_EQ(30, ints.getValue(3.5));
+}
+
+TEST(RBTreeMapTest, stringLookupBuildsNoKey)
+{
+	RBTreeMap<CountedString, int> map;
+	const char* names[] = {
+		"a name that does not fit in a short string: first",
+		"a name that does not fit in a short string: second",
+		"a name that does not fit in a short string: third"};
+	for (int i = 0; i < 3; ++i)
+		map.addValue(names[i], i);
+
+	std::size_t before = CountingAllocator<char>::allocations();
+	for (int i = 0; i < 3; ++i)
+		EXPECT_EQ(i, map.getValue(names[i]));
+	EXPECT_EQ(false,
+		map.contains("a name that does not fit in a short string: fourth"));
+	EXPECT_EQ(before, CountingAllocator<char>::allocations());
+}
+
+TEST(RBTreeMapTest, updatesWalkDownOnce)
+{
+	RBTreeMap<CountedKey, int> map;
+	for (int i = 0; i < 1000; ++i)
+		map.addValue(CountedKey{i * 3}, i);
+
+	// The walk that finds the key, or its empty link, is the only one:
+	// recolouring and rotating compare nothing.
+	for (int key : {0, 1, 1500, 2997, 3000}) {
+		CountedKey::comparisons() = 0;
+		bool present = map.contains(CountedKey{key});
+		std::size_t lookup = CountedKey::comparisons();
+		CountedKey::comparisons() = 0;
+		EXPECT_EQ(!present,
+			map.insertOrAssign(CountedKey{key}, key));
+		EXPECT_EQ(lookup, CountedKey::comparisons());
+	}
+	EXPECT_EQ(1002, map.size());
+	EXPECT_EQ(1500, map.getValue(CountedKey{1500}));
+}
+
+TEST(RBTreeMapTest, tryEmplaceLeavesArgsOnHit)
+{
+	RBTreeMap<std::string, std::unique_ptr<int>> map;
+	map.tryEmplace("key", std::unique_ptr<int>{new int(1)});
+
+	std::unique_ptr<int> spare{new int(2)};
+	std::pair<std::unique_ptr<int>&, bool> hit =
+		map.tryEmplace("key", std::move(spare));
+	EXPECT_EQ(false, hit.second);
+	ASSERT_NE(nullptr, spare);
+	EXPECT_EQ(1, *hit.first);
+	EXPECT_EQ(1, map.size());
+}
+
+TEST(RBTreeMapTest, iterators)
+{
+	RBTreeMap<int, int> map;
+	for (int i = 9; i >= 0; --i)
+		map.addValue(i, i);
+
+	int expected = 0;
+	for (int key : map)
+		EXPECT_EQ(expected++, key);
+	EXPECT_EQ(10, expected);
+
+	for (auto it = map.rbegin(); it != map.rend(); ++it)
+		EXPECT_EQ(--expected, *it);
+	EXPECT_EQ(0, expected);
+}
+
+TEST(RBTreeMapTest, iteratorsSurviveOtherRemovals)
+{
+	RBTreeMap<int, int> map;
+	for (int i = 0; i < 1000; ++i)
+		map.addValue(i, i);
+
+	// 500 has two children, so removing its neighbours relinks around it.
+	RBTreeMap<int, int>::iterator it = map.floor(500);
+	int& value = map.getValue(500);
+	for (int i = 0; i < 1000; ++i)
+		if (i != 500 && i % 7 != 0)
+			map.removeValue(i);
+	for (int i = 1000; i < 2000; ++i)
+		map.addValue(i, i);
+
+	EXPECT_EQ(500, *it);
+	EXPECT_EQ(500, value);
+	EXPECT_EQ(504, *++it);
+}
+
+TEST(RBTreeMapTest, floorAndCeiling)
+{
+	RBTreeMap<int, int> map;
+	for (int i = 1; i <= 100; ++i)
+		map.addValue(i * 10, i);
+
+	EXPECT_EQ(true, map.floor(5) == map.end());
+	EXPECT_EQ(10, *map.floor(10));
+	EXPECT_EQ(10, *map.floor(19));
+	EXPECT_EQ(1000, *map.floor(5000));
+
+	EXPECT_EQ(10, *map.ceiling(-5));
+	EXPECT_EQ(20, *map.ceiling(11));
+	EXPECT_EQ(1000, *map.ceiling(1000));
+	EXPECT_EQ(true, map.ceiling(1001) == map.end());
+}
+
+TEST(RBTreeMapTest, matchesReferenceUnderRandomOperations)
+{
+	RBTreeMap<int, int> map;
+	std::map<int, int> reference;
+	std::srand(11);
+
+	for (int i = 0; i < 50000; ++i) {
+		int key = std::rand() % 2000;
+		if (std::rand() % 2 == 0) {
+			if (reference.count(key) == 0) {
+				reference[key] = i;
+				map.addValue(key, i);
+			}
+		} else if (reference.count(key) == 1) {
+			reference.erase(key);
+			map.removeValue(key);
+		}
+	}
+	EXPECT_EQ(reference.size(), map.size());
+
+	auto expected = reference.begin();
+	for (auto item : map.items()) {
+		EXPECT_EQ(expected->first, item.key);
+		EXPECT_EQ(expected->second, item.value);
+		++expected;
+	}
+	EXPECT_EQ(true, expected == reference.end());
+
+	for (auto const& pair : reference)
+		map.removeValue(pair.first);
+	EXPECT_EQ(true, map.isEmpty());
+}
+
+TEST(RBTreeMapTest, viewsAndForEach)
+{
+	RBTreeMap<int, int> map;
+	for (int i = 0; i < 10; ++i)
+		map.addValue(i, i * 10);
+
+	int previous = -1;
+	for (int key : map.keys()) {
+		EXPECT_LT(previous, key);
+		previous = key;
+	}
+	for (int& value : map.values())
+		value += 1;
+	int sum = 0;
+	map.forEach([&](int const& key, int const& value) {
+		EXPECT_EQ(key * 10 + 1, value);
+		sum += value;
+	});
+	EXPECT_EQ(460, sum);
+	EXPECT_EQ(10, map.items().size());
+}
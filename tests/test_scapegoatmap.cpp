@@ -0,0 +1,209 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+#include "../structures/scapegoatmap.hpp"
+#include "../exceptions.hpp"
+#include "countedkey.hpp"
+#include "countingallocator.hpp"
+
+
+/**
+ * \brief Most levels a scapegoat tree of size pairs may have.
+ */
+static std::size_t maxLevels(std::size_t size, double alpha)
+{
+	return static_cast<std::size_t>(std::log(size) / std::log(1 / alpha)) + 1;
+}
+
+TEST(ScapegoatMapTest, constructor)
+{
+	ScapegoatMap<int, std::string> map;
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(0, map.height());
+	EXPECT_EQ(0.7, map.alpha());
+}
+
+TEST(ScapegoatMapTest, alphaIsClamped)
+{
+	ScapegoatMap<int, int> map{0.2};
+	EXPECT_EQ(0.5, map.alpha());
+	map.setAlpha(1.5);
+	EXPECT_EQ(0.95, map.alpha());
+	map.setAlpha(0.6);
+	EXPECT_EQ(0.6, map.alpha());
+}
+
+TEST(ScapegoatMapTest, copyAndMove)
+{
+	ScapegoatMap<int, std::string> map{0.6};
+	for (int i = 0; i < 1000; ++i)
+		map.addValue(i, std::to_string(i));
+
+	ScapegoatMap<int, std::string> copy{map};
+	map.removeValue(5);
+	EXPECT_EQ(1000, copy.size());
+	EXPECT_EQ("5", copy.getValue(5));
+	EXPECT_EQ(0.6, copy.alpha());
+	EXPECT_EQ(10, copy.height());
+
+	ScapegoatMap<int, std::string> moved{std::move(copy)};
+	EXPECT_EQ(1000, moved.size());
+	EXPECT_EQ(0, copy.size());
+
+	copy = map;
+	EXPECT_EQ(999, copy.size());
+	EXPECT_EQ(false, copy.contains(5));
+}
+
+TEST(ScapegoatMapTest, numbersConvertToTheKey)
+{
+	ScapegoatMap<unsigned long, int> map;
+	for (int i = 0; i < 500; ++i)
+		map.addValue(i, i);
+	for (int i = 0; i < 500; i += 7)
+		ASSERT_EQ(i, map.getValue(i));
+	EXPECT_EQ(false, map.contains(500));
+	EXPECT_THROW(map.getValue(1000), KeyError<unsigned long>);
+}
+
+TEST(ScapegoatMapTest, stringLookupBuildsNoKey)
+{
+	ScapegoatMap<CountedString, int> map;
+	std::string stem(32, 's');
+	for (int i = 0; i < 50; ++i)
+		map.addValue((stem + std::to_string(i * 2)).c_str(), i);
+
+	std::size_t before = CountingAllocator<char>::allocations();
+	EXPECT_EQ(10, map.getValue((stem + "20").c_str()));
+	EXPECT_EQ(false, map.contains((stem + "21").c_str()));
+	// The std::string temporaries above do not use the counting allocator.
+	EXPECT_EQ(before, CountingAllocator<char>::allocations());
+}
+
+TEST(ScapegoatMapTest, updatesWalkDownOnce)
+{
+	ScapegoatMap<CountedKey, int> map;
+	for (int i = 0; i < 1023; ++i)
+		map.addValue(CountedKey{i * 2}, i);
+
+	// Hits, and misses that land within the depth limit, walk down once;
+	// only a miss that forces a rebuild looks its key up again.
+	for (int key : {0, 1022, 2044, 1, 1023}) {
+		CountedKey::comparisons() = 0;
+		bool present = map.contains(CountedKey{key});
+		std::size_t lookup = CountedKey::comparisons();
+		CountedKey::comparisons() = 0;
+		EXPECT_EQ(!present, map.tryEmplace(CountedKey{key}, key).second);
+		EXPECT_EQ(lookup, CountedKey::comparisons());
+	}
+	EXPECT_EQ(1025, map.size());
+}
+
+TEST(ScapegoatMapTest, tryEmplaceLeavesArgsOnHit)
+{
+	// Rebuilds copy values, so a long string stands in for a move-only one:
+	// moving from it would leave it empty.
+	ScapegoatMap<int, std::string> map;
+	for (int i = 0; i < 64; ++i)
+		map.tryEmplace(i, std::string(32, 'a' + i % 26));
+
+	std::string spare(32, 'z');
+	EXPECT_EQ(false, map.tryEmplace(7, std::move(spare)).second);
+	EXPECT_EQ(std::string(32, 'z'), spare);
+	EXPECT_EQ(std::string(32, 'h'), map.getValue(7));
+}
+
+TEST(ScapegoatMapTest, addGetRemove)
+{
+	ScapegoatMap<int, std::string> map;
+	map.addValue(2, "two");
+	map.addValue(1, "one");
+	EXPECT_THROW(map.addValue(1, "uno"), KeyError<int>);
+	EXPECT_EQ("one", map.getValue(1));
+
+	map.getValue(2) = "deux";
+	EXPECT_EQ("deux", map.getValue(2));
+
+	map.removeValue(1);
+	EXPECT_EQ(false, map.contains(1));
+	EXPECT_THROW(map.getValue(1), KeyError<int>);
+	EXPECT_THROW(map.removeValue(1), KeyError<int>);
+	map.removeValue(2);
+	EXPECT_EQ(true, map.isEmpty());
+}
+
+TEST(ScapegoatMapTest, sortedInsertsStayShallow)
+{
+	const double alphas[] = {0.5, 0.7, 0.95};
+	for (double alpha : alphas) {
+		ScapegoatMap<int, int> map{alpha};
+		for (int i = 0; i < 4000; ++i) {
+			map.addValue(i, i);
+			ASSERT_LE(map.height(), maxLevels(map.size(), alpha));
+		}
+	}
+}
+
+TEST(ScapegoatMapTest, matchesReferenceUnderRandomOperations)
+{
+	ScapegoatMap<int, int> map{0.6};
+	std::map<int, int> reference;
+	std::srand(17);
+
+	for (int i = 0; i < 50000; ++i) {
+		int key = std::rand() % 3000;
+		if (std::rand() % 3 != 0) {
+			if (reference.count(key) == 0) {
+				reference[key] = i;
+				map.addValue(key, i);
+			}
+		} else if (reference.count(key) == 1) {
+			reference.erase(key);
+			map.removeValue(key);
+		}
+	}
+	EXPECT_EQ(reference.size(), map.size());
+	EXPECT_LE(map.height(), maxLevels(map.size(), 0.6) + 1);
+
+	auto expected = reference.begin();
+	for (auto item : map.items()) {
+		EXPECT_EQ(expected->first, item.key);
+		EXPECT_EQ(expected->second, item.value);
+		++expected;
+	}
+	EXPECT_EQ(true, expected == reference.end());
+
+	for (auto const& pair : reference)
+		map.removeValue(pair.first);
+	EXPECT_EQ(true, map.isEmpty());
+	map.addValue(1, 1);
+	EXPECT_EQ(1, map.getValue(1));
+}
+
+TEST(ScapegoatMapTest, viewsAndForEach)
+{
+	ScapegoatMap<int, int> map;
+	for (int i = 9; i >= 0; --i)
+		map.addValue(i, i * 10);
+
+	int expected = 0;
+	for (int key : map.keys())
+		EXPECT_EQ(expected++, key);
+	EXPECT_EQ(10, expected);
+	for (int& value : map.values())
+		value += 1;
+	int sum = 0;
+	map.forEach([&](int const& key, int const& value) {
+		EXPECT_EQ(key * 10 + 1, value);
+		sum += value;
+	});
+	EXPECT_EQ(460, sum);
+	EXPECT_EQ(10, map.items().size());
+}
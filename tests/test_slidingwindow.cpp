@@ -0,0 +1,104 @@
+#include <cstddef>
+
+#include "gtest/gtest.h"
+
+#include "../structures/slidingwindow.hpp"
+#include "../exceptions.hpp"
+
+
+TEST(SlidingWindowTest, constructor)
+{
+	SlidingWindow<int, WindowSum<int>> window{3};
+	EXPECT_EQ(true, window.isEmpty());
+	EXPECT_EQ(0, window.size());
+	EXPECT_EQ(0, window.value());
+}
+
+TEST(SlidingWindowTest, emptyMinThrows)
+{
+	SlidingWindow<int, WindowMin<int>> window{3};
+	EXPECT_THROW(window.value(), IndexOutOfBoundsException);
+}
+
+TEST(SlidingWindowTest, emptyMeanThrows)
+{
+	SlidingWindow<int, WindowMean<int>> window{3};
+	EXPECT_THROW(window.value(), IndexOutOfBoundsException);
+}
+
+TEST(SlidingWindowTest, minByCount)
+{
+	int samples[8] = {5, 3, 4, 4, 6, 7, 2, 8};
+	int expected[8] = {5, 3, 3, 3, 4, 4, 2, 2};
+	SlidingWindow<int, WindowMin<int>> window{3};
+
+	for (std::size_t i = 0; i < 8; ++i) {
+		window.push(samples[i]);
+		EXPECT_EQ(expected[i], window.value());
+	}
+	EXPECT_EQ(3, window.size());
+}
+
+TEST(SlidingWindowTest, maxByCount)
+{
+	int samples[8] = {5, 3, 4, 4, 6, 7, 2, 8};
+	int expected[8] = {5, 5, 5, 4, 6, 7, 7, 8};
+	SlidingWindow<int, WindowMax<int>> window{3};
+
+	for (std::size_t i = 0; i < 8; ++i) {
+		window.push(samples[i]);
+		EXPECT_EQ(expected[i], window.value());
+	}
+}
+
+TEST(SlidingWindowTest, duplicateExtremes)
+{
+	SlidingWindow<int, WindowMin<int>> window{2};
+	window.push(1);
+	window.push(1);
+	window.push(2);
+	EXPECT_EQ(1, window.value());
+	window.push(3);
+	EXPECT_EQ(2, window.value());
+}
+
+TEST(SlidingWindowTest, sumAndMean)
+{
+	SlidingWindow<int, WindowSum<int>> sum{4};
+	SlidingWindow<int, WindowMean<int>> mean{4};
+	for (int i = 1; i <= 6; ++i) {
+		sum.push(i);
+		mean.push(i);
+	}
+	EXPECT_EQ(3 + 4 + 5 + 6, sum.value());
+	EXPECT_DOUBLE_EQ(4.5, mean.value());
+}
+
+TEST(SlidingWindowTest, evictsByAge)
+{
+	SlidingWindow<int, WindowMax<int>> window{0, 10};
+	window.push(9, 100);
+	window.push(1, 105);
+	EXPECT_EQ(9, window.value());
+	EXPECT_EQ(2, window.size());
+
+	window.push(2, 110);
+	EXPECT_EQ(2, window.value());
+	EXPECT_EQ(2, window.size());
+
+	window.advance(200);
+	EXPECT_EQ(true, window.isEmpty());
+}
+
+TEST(SlidingWindowTest, countAndAgeTogether)
+{
+	SlidingWindow<int, WindowSum<int>> window{2, 100};
+	window.push(1, 0);
+	window.push(2, 1);
+	window.push(3, 2);
+	EXPECT_EQ(5, window.value());
+
+	window.advance(101);
+	EXPECT_EQ(3, window.value());
+	EXPECT_EQ(1, window.size());
+}
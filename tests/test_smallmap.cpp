@@ -0,0 +1,344 @@
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/smallmap.hpp"
+#include "../exceptions.hpp"
+
+
+/**
+ * \brief The pairs of map, sorted.
+ */
+template <typename Map>
+static std::map<int, int> contents(Map const& map)
+{
+	std::map<int, int> pairs;
+	map.forEach([&](int const& key, int const& value) {
+		pairs[key] = value;
+	});
+	return pairs;
+}
+
+TEST(SmallMapTest, constructor)
+{
+	SmallMap<std::string, int> map;
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(true, map.isInline());
+	EXPECT_EQ(false, map.contains("a"));
+	EXPECT_EQ(nullptr, map.find("a"));
+	EXPECT_EQ(true, map.keys().begin() == map.keys().end());
+}
+
+TEST(SmallMapTest, addGetRemove)
+{
+	SmallMap<std::string, std::string> map;
+	map.addValue("two", "2");
+	map.addValue("one", "1");
+	EXPECT_THROW(map.addValue("one", "uno"), KeyError<std::string>);
+	EXPECT_EQ("1", map.getValue("one"));
+
+	map.getValue("two") = "deux";
+	EXPECT_EQ("deux", map.getValue("two"));
+	EXPECT_EQ("deux", *map.find("two"));
+
+	map.removeValue("two");
+	EXPECT_EQ(false, map.contains("two"));
+	EXPECT_EQ("1", map.getValue("one"));
+	EXPECT_THROW(map.getValue("two"), KeyError<std::string>);
+	EXPECT_THROW(map.removeValue("two"), KeyError<std::string>);
+	map.removeValue("one");
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(true, map.isInline());
+}
+
+TEST(SmallMapTest, promotesPastN)
+{
+	SmallMap<int, std::string, 4> map;
+	for (int i = 0; i < 4; ++i)
+		map.addValue(i, std::to_string(i));
+	EXPECT_EQ(true, map.isInline());
+	// Assigning to a present key does not need room.
+	map.insertOrAssign(2, "two");
+	EXPECT_EQ(true, map.isInline());
+
+	map.addValue(4, "4");
+	EXPECT_EQ(false, map.isInline());
+	EXPECT_EQ(5, map.size());
+	EXPECT_EQ("two", map.getValue(2));
+	for (int i = 5; i < 1000; ++i)
+		map.addValue(i, std::to_string(i));
+	EXPECT_EQ(1000, map.size());
+	EXPECT_EQ("999", map.getValue(999));
+	EXPECT_THROW(map.addValue(3, "x"), KeyError<int>);
+
+	// Shrinking keeps the table.
+	for (int i = 0; i < 998; ++i)
+		map.removeValue(i);
+	EXPECT_EQ(false, map.isInline());
+	EXPECT_THROW(map.removeValue(0), KeyError<int>);
+	EXPECT_EQ(2, map.size());
+	EXPECT_EQ("998", map.getValue(998));
+}
+
+/**
+ * \brief Hashes ints, but throws on the given one.
+ */
+struct ThrowingHash
+{
+	std::size_t operator()(int key) const
+	{
+		if (key == 2)
+			throw std::runtime_error("hash");
+		return static_cast<std::size_t>(key);
+	}
+};
+
+TEST(SmallMapTest, failedPromotionKeepsPairs)
+{
+	// Inline lookups never hash, so key 2 only throws once the map promotes.
+	SmallMap<int, std::string, 4, ThrowingHash> map;
+	for (int i = 0; i < 4; ++i)
+		map.addValue(i, std::string(32, static_cast<char>('a' + i)));
+	EXPECT_THROW(map.addValue(4, "e"), std::runtime_error);
+	EXPECT_EQ(true, map.isInline());
+	EXPECT_EQ(4, map.size());
+	for (int i = 0; i < 4; ++i)
+		EXPECT_EQ(std::string(32, static_cast<char>('a' + i)),
+			map.getValue(i));
+
+	map.removeValue(2);
+	map.addValue(4, "e");
+	map.addValue(5, "f");
+	EXPECT_EQ(false, map.isInline());
+	EXPECT_EQ(std::string(32, 'a'), map.getValue(0));
+	EXPECT_EQ("f", map.getValue(5));
+}
+
+/**
+ * \brief A value that can only be copied, and whose copies throw once
+ *        copiesLeft, unless negative, runs out.
+ */
+struct Brittle
+{
+	static int copiesLeft;
+
+	Brittle() = default;
+
+	Brittle(Brittle const&)
+	{
+		if (copiesLeft == 0)
+			throw std::runtime_error("copy");
+		if (copiesLeft > 0)
+			--copiesLeft;
+	}
+
+	Brittle& operator=(Brittle const&) = default;
+};
+
+int Brittle::copiesLeft = -1;
+
+TEST(SmallMapTest, failedPromotionKeepsKeys)
+{
+	// The keys move without throwing, but the first key must not be moved
+	// into the table while the second value is still to be copied.
+	SmallMap<std::string, Brittle, 2> map;
+	map.addValue(std::string(32, 'a'), Brittle{});
+	map.addValue(std::string(32, 'b'), Brittle{});
+	Brittle::copiesLeft = 1;
+	EXPECT_THROW(map.addValue("c", Brittle{}), std::runtime_error);
+	Brittle::copiesLeft = -1;
+
+	EXPECT_EQ(true, map.isInline());
+	EXPECT_EQ(2, map.size());
+	EXPECT_EQ(true, map.contains(std::string(32, 'a')));
+	EXPECT_EQ(true, map.contains(std::string(32, 'b')));
+	map.addValue("c", Brittle{});
+	EXPECT_EQ(false, map.isInline());
+	EXPECT_EQ(true, map.contains(std::string(32, 'a')));
+}
+
+TEST(SmallMapTest, copyAndMove)
+{
+	SmallMap<int, std::string, 4> small;
+	small.addValue(1, "1");
+	small.addValue(2, "2");
+	SmallMap<int, std::string, 4> large;
+	for (int i = 0; i < 100; ++i)
+		large.addValue(i, std::to_string(i));
+
+	SmallMap<int, std::string, 4> copy{small};
+	small.removeValue(1);
+	EXPECT_EQ(2, copy.size());
+	EXPECT_EQ("1", copy.getValue(1));
+	EXPECT_EQ(true, copy.isInline());
+
+	SmallMap<int, std::string, 4> largeCopy{large};
+	large.removeValue(50);
+	EXPECT_EQ(100, largeCopy.size());
+	EXPECT_EQ(false, largeCopy.isInline());
+
+	// A copy of a promoted map that fits is inline again.
+	for (int i = 3; i < 100; ++i)
+		if (i != 50)
+			large.removeValue(i);
+	SmallMap<int, std::string, 4> shrunk{large};
+	EXPECT_EQ(true, shrunk.isInline());
+	EXPECT_EQ("2", shrunk.getValue(2));
+	EXPECT_EQ(3, shrunk.size());
+
+	SmallMap<int, std::string, 4> moved{std::move(largeCopy)};
+	EXPECT_EQ(100, moved.size());
+	EXPECT_EQ(0, largeCopy.size());
+	EXPECT_EQ(true, largeCopy.isInline());
+
+	// Swapping inline maps of different sizes, both ways.
+	swap(copy, small);
+	EXPECT_EQ(1, copy.size());
+	EXPECT_EQ(2, small.size());
+	EXPECT_EQ("1", small.getValue(1));
+	EXPECT_EQ("2", copy.getValue(2));
+	swap(copy, small);
+	EXPECT_EQ(2, copy.size());
+	EXPECT_EQ(1, small.size());
+
+	small = moved;
+	EXPECT_EQ(100, small.size());
+	moved = copy;
+	EXPECT_EQ(true, moved.isInline());
+	EXPECT_EQ("1", moved.getValue(1));
+}
+
+TEST(SmallMapTest, pairsAreDestroyed)
+{
+	std::shared_ptr<int> counted = std::make_shared<int>(0);
+	{
+		SmallMap<int, std::shared_ptr<int>, 4> map;
+		for (int i = 0; i < 3; ++i)
+			map.addValue(i, counted);
+		map.removeValue(0);
+		EXPECT_EQ(3, counted.use_count());
+		SmallMap<int, std::shared_ptr<int>, 4> copy{map};
+		EXPECT_EQ(5, counted.use_count());
+		for (int i = 3; i < 6; ++i)
+			map.addValue(i, counted);
+		EXPECT_EQ(false, map.isInline());
+		EXPECT_EQ(8, counted.use_count());
+	}
+	EXPECT_EQ(1, counted.use_count());
+}
+
+TEST(SmallMapTest, heterogeneousLookup)
+{
+	SmallMap<std::string, int, 2, StringHash, StringEqual> map;
+	map.addValue("one", 1);
+	map.addValue("two", 2);
+	EXPECT_EQ(2, map.getValue("two"));
+	EXPECT_EQ(nullptr, map.find("three"));
+	map.addValue("three", 3);
+	EXPECT_EQ(false, map.isInline());
+	EXPECT_EQ(3, map.getValue("three"));
+	EXPECT_EQ(true, map.contains("one"));
+	EXPECT_THROW(map.getValue("four"), KeyError<std::string>);
+}
+
+TEST(SmallMapTest, rangeConstructorAndInsertBatch)
+{
+	std::vector<std::pair<std::string, int>> pairs = {
+		{"a", 1}, {"b", 2}, {"a", 3}};
+	SmallMap<std::string, int, 4> map{pairs.begin(), pairs.end()};
+	EXPECT_EQ(2, map.size());
+	EXPECT_EQ(3, map.getValue("a"));
+	EXPECT_EQ(true, map.isInline());
+
+	std::map<std::string, int> more = {{"b", 20}, {"c", 4}, {"d", 5}};
+	map.insertBatch(more.begin(), more.end());
+	EXPECT_EQ(false, map.isInline());
+	EXPECT_EQ(4, map.size());
+	EXPECT_EQ(20, map.getValue("b"));
+	EXPECT_EQ(5, map.getValue("d"));
+}
+
+TEST(SmallMapTest, insertOrAssignTryEmplaceUpsert)
+{
+	SmallMap<std::string, int> map;
+	EXPECT_EQ(true, map.insertOrAssign("one", 1));
+	EXPECT_EQ(false, map.insertOrAssign("one", 11));
+	EXPECT_EQ(11, map.getValue("one"));
+
+	std::pair<int&, bool> added = map.tryEmplace("two", 2);
+	EXPECT_EQ(true, added.second);
+	EXPECT_EQ(2, added.first);
+	std::pair<int&, bool> present = map.tryEmplace("two", 22);
+	EXPECT_EQ(false, present.second);
+	present.first = 20;
+	EXPECT_EQ(20, map.getValue("two"));
+
+	std::string words[] = {"a", "b", "a", "c", "a", "b"};
+	for (std::string const& word : words)
+		map.upsert(word, [](int& count) { ++count; });
+	EXPECT_EQ(3, map.getValue("a"));
+	EXPECT_EQ(2, map.getValue("b"));
+	EXPECT_EQ(1, map.getValue("c"));
+	EXPECT_EQ(21, map.upsert("two", [](int& value) { ++value; }));
+	EXPECT_EQ(5, map.size());
+}
+
+TEST(SmallMapTest, matchesReferenceUnderRandomOperations)
+{
+	std::srand(41);
+	for (int round = 0; round < 200; ++round) {
+		// Most rounds stay inline; some grow past N.
+		int keys = round % 10 == 0 ? 64 : 8;
+		SmallMap<int, int, 6> map;
+		std::map<int, int> reference;
+		for (int i = 0; i < 100; ++i) {
+			int key = std::rand() % keys;
+			if (std::rand() % 3 != 0) {
+				reference[key] = i;
+				map.insertOrAssign(key, i);
+			} else if (reference.erase(key) == 1) {
+				map.removeValue(key);
+			} else {
+				ASSERT_EQ(false, map.contains(key));
+			}
+		}
+		ASSERT_EQ(reference.size(), map.size());
+		ASSERT_EQ(reference, contents(map));
+	}
+}
+
+TEST(SmallMapTest, viewsAndForEach)
+{
+	for (int count : {3, 10}) {
+		SmallMap<int, int, 4> map;
+		for (int i = 0; i < count; ++i)
+			map.addValue(i, i * 10);
+
+		int keys = 0;
+		for (int key : map.keys())
+			keys += key;
+		EXPECT_EQ(count * (count - 1) / 2, keys);
+		for (int& value : map.values())
+			value += 1;
+		std::map<int, int> seen;
+		for (auto item : map.items())
+			seen[item.key] = item.value;
+		EXPECT_EQ(contents(map), seen);
+		EXPECT_EQ(1, seen[0]);
+		EXPECT_EQ(count, map.items().size());
+
+		SmallMap<int, int, 4> const& constant = map;
+		int values = 0;
+		for (int const& value : constant.values())
+			values += value;
+		EXPECT_EQ(count * (count - 1) * 5 + count, values);
+	}
+}
@@ -0,0 +1,233 @@
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/splaymap.hpp"
+#include "../exceptions.hpp"
+#include "countedkey.hpp"
+#include "countingallocator.hpp"
+
+
+TEST(SplayMapTest, constructor)
+{
+	SplayMap<int, std::string> map;
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(false, map.isReadOnly());
+	EXPECT_EQ(false, map.contains(1));
+}
+
+TEST(SplayMapTest, copyAndMove)
+{
+	SplayMap<int, std::string> map;
+	for (int i = 0; i < 100; ++i)
+		map.addValue((i * 37) % 100, std::to_string(i));
+
+	SplayMap<int, std::string> copy{map};
+	map.removeValue(5);
+	EXPECT_EQ(100, copy.size());
+	EXPECT_EQ(true, copy.contains(5));
+
+	SplayMap<int, std::string> moved{std::move(copy)};
+	EXPECT_EQ(100, moved.size());
+	EXPECT_EQ(0, copy.size());
+
+	copy = map;
+	EXPECT_EQ(99, copy.size());
+	int expected = 0;
+	for (int key : copy.keys()) {
+		if (expected == 5)
+			++expected;
+		EXPECT_EQ(expected++, key);
+	}
+}
+
+TEST(SplayMapTest, addGetRemove)
+{
+	SplayMap<int, std::string> map;
+	map.addValue(2, "two");
+	map.addValue(1, "one");
+	map.addValue(3, "three");
+	EXPECT_THROW(map.addValue(1, "uno"), KeyError<int>);
+	EXPECT_EQ("one", map.getValue(1));
+
+	map.getValue(2) = "deux";
+	EXPECT_EQ("deux", map.getValue(2));
+
+	map.removeValue(2);
+	EXPECT_EQ(false, map.contains(2));
+	EXPECT_THROW(map.getValue(2), KeyError<int>);
+	EXPECT_THROW(map.removeValue(2), KeyError<int>);
+	EXPECT_EQ(2, map.size());
+	EXPECT_EQ("three", map.getValue(3));
+}
+
+TEST(SplayMapTest, numbersConvertToTheKey)
+{
+	// Each hit splays its key to the root; the next lookup still works.
+	SplayMap<std::size_t, int> map;
+	for (int i = 0; i < 100; ++i)
+		map.addValue(i, i * 3);
+	EXPECT_EQ(3, map.getValue(1));
+	EXPECT_EQ(297, map.getValue(99));
+	EXPECT_EQ(true, map.contains(50));
+	EXPECT_EQ(false, map.contains(100));
+}
+
+TEST(SplayMapTest, stringLookupBuildsNoKey)
+{
+	SplayMap<CountedString, int> map;
+	std::string tail(40, 'z');
+	for (char c = 'a'; c <= 'f'; ++c)
+		map.addValue((std::string(1, c) + tail).c_str(), c - 'a');
+
+	// Misses splay too, and must not build a key either.
+	std::string miss = "m" + tail;
+	std::string hit = "c" + tail;
+	std::size_t before = CountingAllocator<char>::allocations();
+	EXPECT_EQ(false, map.contains(miss.c_str()));
+	EXPECT_EQ(2, map.getValue(hit.c_str()));
+	EXPECT_THROW(map.getValue(miss.c_str()), KeyError<CountedString>);
+	EXPECT_EQ(before, CountingAllocator<char>::allocations());
+}
+
+TEST(SplayMapTest, updatesSplayOnce)
+{
+	// Ascending inserts leave a path, so a second splay from the bottom
+	// would cost as much as the first.
+	SplayMap<CountedKey, int> map;
+	for (int i = 0; i < 500; ++i)
+		map.addValue(CountedKey{i * 2}, i);
+
+	for (int key : {1, 0, 499, 998}) {
+		SplayMap<CountedKey, int> copy{map};
+		CountedKey::comparisons() = 0;
+		copy.contains(CountedKey{key});
+		std::size_t lookup = CountedKey::comparisons();
+
+		// One splay, then at most two comparisons to place the key.
+		CountedKey::comparisons() = 0;
+		map.upsert(CountedKey{key}, [](int& value) { ++value; });
+		EXPECT_GE(lookup + 2, CountedKey::comparisons());
+	}
+	EXPECT_EQ(1, map.getValue(CountedKey{1}));
+	EXPECT_EQ(1, map.getValue(CountedKey{0}));
+}
+
+TEST(SplayMapTest, tryEmplaceLeavesArgsOnHit)
+{
+	SplayMap<int, std::unique_ptr<int>> map;
+	for (int i = 0; i < 10; ++i)
+		map.tryEmplace(i, std::unique_ptr<int>{new int(i)});
+
+	// The hit splays 3 to the root but leaves the argument alone.
+	std::unique_ptr<int> spare{new int(-3)};
+	EXPECT_EQ(false, map.tryEmplace(3, std::move(spare)).second);
+	ASSERT_NE(nullptr, spare);
+	EXPECT_EQ(-3, *spare);
+	EXPECT_EQ(3, *map.getValue(3));
+}
+
+TEST(SplayMapTest, matchesReferenceUnderRandomOperations)
+{
+	SplayMap<int, int> map;
+	std::map<int, int> reference;
+	std::srand(13);
+
+	for (int i = 0; i < 50000; ++i) {
+		int key = std::rand() % 2000;
+		int action = std::rand() % 3;
+		if (action == 0) {
+			if (reference.count(key) == 0) {
+				reference[key] = i;
+				map.addValue(key, i);
+			}
+		} else if (action == 1) {
+			if (reference.count(key) == 1) {
+				reference.erase(key);
+				map.removeValue(key);
+			}
+		} else {
+			EXPECT_EQ(reference.count(key) == 1, map.contains(key));
+		}
+	}
+	EXPECT_EQ(reference.size(), map.size());
+
+	// The views walk parent links, so this also checks those.
+	auto expected = reference.begin();
+	for (auto item : map.items()) {
+		EXPECT_EQ(expected->first, item.key);
+		EXPECT_EQ(expected->second, item.value);
+		++expected;
+	}
+	EXPECT_EQ(true, expected == reference.end());
+}
+
+TEST(SplayMapTest, degenerateTreeDoesNotRecurse)
+{
+	// Ascending inserts leave a single left spine.
+	SplayMap<int, int> map;
+	for (int i = 0; i < 200000; ++i)
+		map.addValue(i, i);
+	map.setReadOnly(true);
+	EXPECT_EQ(0, map.getValue(0));
+
+	SplayMap<int, int> copy{map};
+	EXPECT_EQ(true, copy.isReadOnly());
+	copy.setReadOnly(false);
+	EXPECT_EQ(0, copy.getValue(0));
+	EXPECT_EQ(199999, copy.getValue(199999));
+	EXPECT_EQ(200000, copy.size());
+}
+
+TEST(SplayMapTest, readOnlyLookupsFromManyThreads)
+{
+	SplayMap<int, int> map;
+	for (int i = 0; i < 1000; ++i)
+		map.addValue(i, i * 2);
+	map.setReadOnly(true);
+
+	std::vector<std::thread> readers;
+	std::vector<long> sums(4, 0);
+	for (int t = 0; t < 4; ++t)
+		readers.emplace_back([&, t]() {
+			for (int round = 0; round < 20; ++round)
+				for (int i = 0; i < 1000; ++i)
+					if (map.contains(i))
+						sums[t] += map.getValue(i);
+		});
+	for (std::thread& reader : readers)
+		reader.join();
+
+	for (long sum : sums)
+		EXPECT_EQ(20L * 999 * 1000, sum);
+}
+
+TEST(SplayMapTest, viewsAndForEach)
+{
+	SplayMap<int, int> map;
+	for (int i = 0; i < 10; ++i)
+		map.addValue(i, i * 10);
+
+	int previous = -1;
+	for (int key : map.keys()) {
+		EXPECT_LT(previous, key);
+		previous = key;
+	}
+	for (int& value : map.values())
+		value += 1;
+	int sum = 0;
+	map.forEach([&](int const& key, int const& value) {
+		EXPECT_EQ(key * 10 + 1, value);
+		sum += value;
+	});
+	EXPECT_EQ(460, sum);
+	EXPECT_EQ(10, map.items().size());
+}
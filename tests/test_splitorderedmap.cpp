@@ -0,0 +1,161 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/splitorderedmap.hpp"
+#include "../exceptions.hpp"
+
+
+/**
+ * \brief Sends every key to the same split-order position.
+ */
+struct SplitCollidingHash
+{
+	std::size_t operator()(int) const { return 7; }
+};
+
+TEST(SplitOrderedMapTest, constructor)
+{
+	SplitOrderedMap<int, int> map;
+	EXPECT_EQ(0, map.size());
+	EXPECT_EQ(true, map.isEmpty());
+	EXPECT_EQ(2, map.bucketCount());
+	EXPECT_EQ(false, map.contains(1));
+}
+
+TEST(SplitOrderedMapTest, mapOperations)
+{
+	SplitOrderedMap<std::string, int> map;
+	map.addValue("one", 1);
+	map.addValue("two", 2);
+	EXPECT_THROW(map.addValue("one", 11), KeyError<std::string>);
+
+	EXPECT_EQ(2, map.size());
+	EXPECT_EQ(1, map.getValue("one"));
+	EXPECT_THROW(map.getValue("three"), KeyError<std::string>);
+
+	int value = 0;
+	EXPECT_EQ(true, map.find("two", value));
+	EXPECT_EQ(2, value);
+
+	map.removeValue("one");
+	EXPECT_EQ(false, map.contains("one"));
+	EXPECT_THROW(map.removeValue("one"), KeyError<std::string>);
+	EXPECT_EQ(1, map.size());
+}
+
+TEST(SplitOrderedMapTest, growsWithoutLosingKeys)
+{
+	SplitOrderedMap<int, int> map;
+	for (int i = 0; i < 5000; ++i)
+		map.addValue(i, i * 3);
+
+	EXPECT_LE(2048, map.bucketCount());
+	for (int i = 0; i < 5000; ++i)
+		EXPECT_EQ(i * 3, map.getValue(i));
+	EXPECT_EQ(false, map.contains(5000));
+}
+
+TEST(SplitOrderedMapTest, collidingKeys)
+{
+	SplitOrderedMap<int, int, SplitCollidingHash> map;
+	for (int i = 0; i < 50; ++i)
+		map.addValue(i, i);
+	for (int i = 0; i < 50; i += 2)
+		map.removeValue(i);
+
+	for (int i = 0; i < 50; ++i)
+		EXPECT_EQ(i % 2 == 1, map.contains(i));
+	EXPECT_THROW(map.addValue(1, 1), KeyError<int>);
+}
+
+TEST(SplitOrderedMapTest, forEach)
+{
+	SplitOrderedMap<int, int> map;
+	for (int i = 0; i < 100; ++i)
+		map.addValue(i, i * 2);
+	map.removeValue(50);
+
+	int sum = 0;
+	std::size_t count = 0;
+	map.forEach([&](int const& key, int const& value) {
+		EXPECT_EQ(key * 2, value);
+		sum += key;
+		++count;
+	});
+	EXPECT_EQ(99, count);
+	EXPECT_EQ(99 * 100 / 2 - 50, sum);
+}
+
+TEST(SplitOrderedMapTest, matchesReferenceUnderRandomOperations)
+{
+	SplitOrderedMap<int, int> map;
+	std::map<int, int> reference;
+	std::srand(5);
+
+	for (int i = 0; i < 20000; ++i) {
+		int key = std::rand() % 500;
+		if (std::rand() % 3 == 0) {
+			if (reference.erase(key) == 1)
+				map.removeValue(key);
+			else
+				EXPECT_THROW(map.removeValue(key), KeyError<int>);
+		} else if (reference.find(key) == reference.end()) {
+			reference[key] = i;
+			map.addValue(key, i);
+		}
+	}
+
+	EXPECT_EQ(reference.size(), map.size());
+	for (auto const& pair : reference)
+		EXPECT_EQ(pair.second, map.getValue(pair.first));
+}
+
+TEST(SplitOrderedMapTest, concurrentChurn)
+{
+	const int threads = 4;
+	const int perThread = 3000;
+	SplitOrderedMap<int, int> map;
+	std::atomic<int> removed{0};
+
+	// Every thread inserts its own keys while trying to remove everyone's
+	// even keys, so inserts, removals and bucket splits all overlap.
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; ++t)
+		workers.emplace_back([&, t]() {
+			unsigned seed = 2463534242u + t;
+			for (int i = 0; i < perThread; ++i) {
+				map.addValue(t * perThread + i, t);
+				seed ^= seed << 13;
+				seed ^= seed >> 17;
+				seed ^= seed << 5;
+				int victim = (seed % (threads * perThread)) & ~1;
+				int value;
+				if (map.find(victim, value)) {
+					try {
+						map.removeValue(victim);
+						removed.fetch_add(1);
+					} catch (KeyError<int>&) {
+					}
+				}
+			}
+		});
+	for (std::thread& worker : workers)
+		worker.join();
+
+	EXPECT_EQ(threads * perThread - removed.load(), map.size());
+	std::size_t count = 0;
+	map.forEach([&](int const& key, int const& value) {
+		EXPECT_EQ(key / perThread, value);
+		++count;
+	});
+	EXPECT_EQ(map.size(), count);
+	for (int key = 1; key < threads * perThread; key += 2)
+		EXPECT_EQ(true, map.contains(key));
+}
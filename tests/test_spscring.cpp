@@ -0,0 +1,121 @@
+#include <cstddef>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "../structures/spscring.hpp"
+
+
+TEST(SpscRingTest, constructor)
+{
+	SpscRing<int> ring{3};
+	EXPECT_EQ(true, ring.isEmpty());
+	EXPECT_EQ(0, ring.size());
+	EXPECT_EQ(4, ring.capacity());
+}
+
+TEST(SpscRingTest, pushAndPop)
+{
+	SpscRing<std::string> ring{2};
+	EXPECT_EQ(true, ring.tryPush("a"));
+	EXPECT_EQ(true, ring.tryPush("b"));
+	EXPECT_EQ(false, ring.tryPush("c"));
+
+	std::string value;
+	EXPECT_EQ(true, ring.tryPop(value));
+	EXPECT_EQ("a", value);
+	EXPECT_EQ(true, ring.tryPush("c"));
+	EXPECT_EQ(true, ring.tryPop(value));
+	EXPECT_EQ("b", value);
+	EXPECT_EQ(true, ring.tryPop(value));
+	EXPECT_EQ("c", value);
+	EXPECT_EQ(false, ring.tryPop(value));
+}
+
+TEST(SpscRingTest, reserveAndCommit)
+{
+	SpscRing<int> ring{8};
+	SpscRing<int>::Span span = ring.reserve(5);
+	EXPECT_EQ(5, span.size);
+	for (std::size_t i = 0; i < span.size; ++i)
+		span[i] = static_cast<int>(i);
+
+	// Nothing is visible until it is committed.
+	EXPECT_EQ(0, ring.peek(8).size);
+	ring.commit(3);
+	EXPECT_EQ(3, ring.size());
+
+	SpscRing<int>::Span readable = ring.peek(8);
+	EXPECT_EQ(3, readable.size);
+	int expected = 0;
+	for (int value : readable)
+		EXPECT_EQ(expected++, value);
+	ring.release(2);
+	EXPECT_EQ(1, ring.size());
+}
+
+TEST(SpscRingTest, spansStopAtWrap)
+{
+	SpscRing<int> ring{4};
+	for (int i = 0; i < 3; ++i)
+		ring.tryPush(i);
+	int value;
+	ring.tryPop(value);
+	ring.tryPop(value);
+
+	// Tail is at slot 3: only one slot until the end of the array.
+	EXPECT_EQ(1, ring.reserve(3).size);
+	ring.commit(1);
+	EXPECT_EQ(2, ring.reserve(3).size);
+
+	EXPECT_EQ(2, ring.peek(4).size);
+}
+
+TEST(SpscRingTest, reserveFull)
+{
+	SpscRing<int> ring{2};
+	ring.tryPush(1);
+	ring.tryPush(2);
+	EXPECT_EQ(0, ring.reserve(1).size);
+}
+
+TEST(SpscRingTest, producerAndConsumer)
+{
+	const int items = 100000;
+	SpscRing<int> ring{64};
+
+	std::thread producer([&]() {
+		int next = 0;
+		while (next < items) {
+			if (next % 2 == 0) {
+				SpscRing<int>::Span span = ring.reserve(16);
+				std::size_t i = 0;
+				for (; i < span.size && next < items; ++i)
+					span[i] = next++;
+				ring.commit(i);
+				if (i == 0)
+					std::this_thread::yield();
+			} else if (ring.tryPush(next)) {
+				++next;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	int expected = 0;
+	bool ordered = true;
+	while (expected < items) {
+		SpscRing<int>::Span span = ring.peek(16);
+		for (int value : span)
+			ordered = ordered && value == expected++;
+		ring.release(span.size);
+		if (span.size == 0)
+			std::this_thread::yield();
+	}
+	producer.join();
+
+	EXPECT_EQ(true, ordered);
+	EXPECT_EQ(true, ring.isEmpty());
+}
@@ -0,0 +1,112 @@
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "../structures/workstealingdeque.hpp"
+
+
+TEST(WorkStealingDequeTest, constructor)
+{
+	WorkStealingDeque<int> deque{5};
+	EXPECT_EQ(true, deque.isEmpty());
+	EXPECT_EQ(0, deque.size());
+	EXPECT_EQ(8, deque.capacity());
+}
+
+TEST(WorkStealingDequeTest, popIsLifo)
+{
+	WorkStealingDeque<int> deque;
+	for (int i = 0; i < 5; ++i)
+		deque.push(i);
+
+	int value = -1;
+	for (int i = 4; i >= 0; --i) {
+		EXPECT_EQ(true, deque.pop(value));
+		EXPECT_EQ(i, value);
+	}
+	EXPECT_EQ(false, deque.pop(value));
+}
+
+TEST(WorkStealingDequeTest, stealIsFifo)
+{
+	WorkStealingDeque<int> deque;
+	for (int i = 0; i < 5; ++i)
+		deque.push(i);
+
+	int value = -1;
+	for (int i = 0; i < 5; ++i) {
+		EXPECT_EQ(true, deque.steal(value));
+		EXPECT_EQ(i, value);
+	}
+	EXPECT_EQ(false, deque.steal(value));
+}
+
+TEST(WorkStealingDequeTest, popAndStealMeet)
+{
+	WorkStealingDeque<int> deque;
+	deque.push(1);
+	deque.push(2);
+
+	int value = 0;
+	EXPECT_EQ(true, deque.steal(value));
+	EXPECT_EQ(1, value);
+	EXPECT_EQ(true, deque.pop(value));
+	EXPECT_EQ(2, value);
+	EXPECT_EQ(true, deque.isEmpty());
+}
+
+TEST(WorkStealingDequeTest, grows)
+{
+	WorkStealingDeque<int> deque{2};
+	for (int i = 0; i < 100; ++i)
+		deque.push(i);
+
+	EXPECT_EQ(100, deque.size());
+	EXPECT_EQ(128, deque.capacity());
+
+	int value = -1;
+	EXPECT_EQ(true, deque.steal(value));
+	EXPECT_EQ(0, value);
+	EXPECT_EQ(true, deque.pop(value));
+	EXPECT_EQ(99, value);
+}
+
+TEST(WorkStealingDequeTest, concurrentSteal)
+{
+	const int items = 20000;
+	const int thieves = 3;
+	WorkStealingDeque<int> deque{4};
+	std::vector<std::atomic<int>> seen(items);
+	for (auto& count : seen)
+		count.store(0);
+	std::atomic<bool> done{false};
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < thieves; ++t) {
+		threads.emplace_back([&]() {
+			int value;
+			while (!done.load() || !deque.isEmpty())
+				if (deque.steal(value))
+					seen[value].fetch_add(1);
+		});
+	}
+
+	int value;
+	for (int i = 0; i < items; ++i) {
+		deque.push(i);
+		if (i % 3 == 0 && deque.pop(value))
+			seen[value].fetch_add(1);
+	}
+	while (deque.pop(value))
+		seen[value].fetch_add(1);
+	done.store(true);
+
+	for (auto& thread : threads)
+		thread.join();
+
+	for (int i = 0; i < items; ++i)
+		EXPECT_EQ(1, seen[i].load());
+}